@@ -16,8 +16,10 @@
 #include <minizinc/hash.hh>
 #include <minizinc/stl_map_set.hh>
 #include <minizinc/utils.hh>
+#include <algorithm>
 #include <array>
 #include <set>
+#include <vector>
 
 #ifdef _MSC_VER 
 #define _CRT_SECURE_NO_WARNINGS
@@ -42,7 +44,10 @@ struct MIPD_Infeasibility_Exception {
 namespace MiniZinc {
 
   /// Linearize domain constraints in \a env
-  void MIPdomains(Env& env, bool fVerbose = false);
+  ///
+  /// The cliques of variables are analysed by \a nThreads threads
+  /// (0 for the number of hardware threads)
+  void MIPdomains(Env& env, bool fVerbose = false, unsigned int nThreads = 1);
   
   enum EnumStatIdx__MIPD { 
     N_POSTs__all,                     // N all POSTs in the model
@@ -124,15 +129,44 @@ namespace MiniZinc {
     return os;
   }
   
+  /// A set of intervals, stored in a vector sorted by their left bounds
+  /// Intervals with equal left bounds keep their order of insertion
   template <class N>
-  class SetOfIntervals : public std::multiset<Interval<N> > {
+  class SetOfIntervals : public std::vector<Interval<N> > {
   public:
-    typedef std::multiset<Interval<N> > Base;
+    typedef std::vector<Interval<N> > Base;
     typedef typename Base::iterator iterator;
+    typedef typename Base::const_iterator const_iterator;
     SetOfIntervals() : Base() { }
-    SetOfIntervals(std::initializer_list<Interval<N> > il) : Base( il )  { }
+    SetOfIntervals(std::initializer_list<Interval<N> > il) : Base( il )  {
+      std::stable_sort( this->begin(), this->end() );
+    }
     template <class Iter>
-    SetOfIntervals( Iter i1, Iter i2 ) : Base( i1, i2 )  { }
+    SetOfIntervals( Iter i1, Iter i2 ) : Base( i1, i2 )  {
+      std::stable_sort( this->begin(), this->end() );
+    }
+    /// Insert after all intervals with the same left bound
+    iterator insert(const Interval<N>& intv) {
+      if ( this->empty() || !( intv < this->back() ) ) {    // appending is the common case
+        this->push_back( intv );
+        return this->end()-1;
+      }
+      return Base::insert( upper_bound( intv ), intv );
+    }
+    /// First interval with left bound not less than that of \a intv
+    iterator lower_bound(const Interval<N>& intv) {
+      return std::lower_bound( this->begin(), this->end(), intv );
+    }
+    const_iterator lower_bound(const Interval<N>& intv) const {
+      return std::lower_bound( this->begin(), this->end(), intv );
+    }
+    /// First interval with left bound greater than that of \a intv
+    iterator upper_bound(const Interval<N>& intv) {
+      return std::upper_bound( this->begin(), this->end(), intv );
+    }
+    const_iterator upper_bound(const Interval<N>& intv) const {
+      return std::upper_bound( this->begin(), this->end(), intv );
+    }
     template <class N1>
     void intersect(const SetOfIntervals<N1>& s2);
     /// Assumes open intervals to cut out from closed
@@ -147,6 +181,8 @@ namespace MiniZinc {
     /// Cut out an open interval from a set of closed ones (except for infinities)
     void cutOut(const Interval<N>& intv);
     typedef std::pair<iterator, iterator> SplitResult;
+    /// Split \a it at \a pos in place, \a it must be the last interval
+    /// with a left bound not greater than \a pos
     SplitResult split(iterator& it, N pos);
     bool checkFiniteBounds();
     bool checkDisjunctStrict();
@@ -448,6 +448,8 @@ namespace MiniZinc {
     }
     /// Set declaration
     void decl(VarDecl* d);
+    /// Set the type of this identifier only, leaving its declaration unchanged
+    void typeOfId(const Type& t) { _type = t; }
     /// Redirect to another Id \a id
     void redirect(Id* id) {
       assert(_decl==NULL || _decl->isa<VarDecl>());
@@ -1306,6 +1308,15 @@ namespace MiniZinc {
     void exit(Expression* e) {}
   };
 
+  /// Integer and float literals shared within one garbage collector
+  class LiteralCache {
+  public:
+      /// Keep track of allocated integer literals
+      UNORDERED_NAMESPACE::unordered_map<IntVal, WeakRef> integerMap;
+      /// Keep track of allocated float literals
+      UNORDERED_NAMESPACE::unordered_map<FloatVal, WeakRef> floatMap;
+  };
+
   /// Statically allocated constants
   class Constants {
   private:
@@ -1549,10 +1560,6 @@ namespace MiniZinc {
         ASTString translation;
       } cli_cat;
       
-      /// Keep track of allocated integer literals
-      UNORDERED_NAMESPACE::unordered_map<IntVal, WeakRef> integerMap;
-      /// Keep track of allocated float literals
-      UNORDERED_NAMESPACE::unordered_map<FloatVal, WeakRef> floatMap;
       /// Constructor
       Constants(void);
       /// Return shared BoolLit
@@ -49,10 +49,12 @@ namespace MiniZinc {
     if (v > -(LLONG_MAX >> 3) && v < (LLONG_MAX >> 3))
       return intToUnboxedInt(v.toInt());
     
-    UNORDERED_NAMESPACE::unordered_map<IntVal, WeakRef>::iterator it = constants().integerMap.find(v);
-    if (it==constants().integerMap.end() || it->second()==NULL) {
+    GC::SharedLock lock;
+    LiteralCache& lc = GC::literals();
+    UNORDERED_NAMESPACE::unordered_map<IntVal, WeakRef>::iterator it = lc.integerMap.find(v);
+    if (it==lc.integerMap.end() || it->second()==NULL) {
       IntLit* il = new IntLit(Location().introduce(), v);
-      constants().integerMap.insert(std::make_pair(v, il));
+      lc.integerMap.insert(std::make_pair(v, il));
       return il;
     } else {
       return it->second()->cast<IntLit>();
@@ -78,10 +80,12 @@ namespace MiniZinc {
 
   inline FloatLit*
   FloatLit::a(MiniZinc::FloatVal v) {
-    UNORDERED_NAMESPACE::unordered_map<FloatVal, WeakRef>::iterator it = constants().floatMap.find(v);
-    if (it==constants().floatMap.end() || it->second()==NULL) {
+    GC::SharedLock lock;
+    LiteralCache& lc = GC::literals();
+    UNORDERED_NAMESPACE::unordered_map<FloatVal, WeakRef>::iterator it = lc.floatMap.find(v);
+    if (it==lc.floatMap.end() || it->second()==NULL) {
       FloatLit* fl = new FloatLit(Location().introduce(), v);
-      constants().floatMap.insert(std::make_pair(v, fl));
+      lc.floatMap.insert(std::make_pair(v, fl));
       return fl;
     } else {
       return it->second()->cast<FloatLit>();
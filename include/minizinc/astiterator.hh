@@ -14,9 +14,91 @@
 
 #include <minizinc/ast.hh>
 #include <minizinc/hash.hh>
+#include <minizinc/config.hh>
+
+#include <vector>
+
+/// Hint that the expression node \a e will be visited soon
+#if defined(MZN_AST_PREFETCH) && (defined(__GNUC__) || defined(__clang__))
+#define MZN_PREFETCH_EXPRESSION(e) __builtin_prefetch(e)
+#else
+#define MZN_PREFETCH_EXPRESSION(e)
+#endif
 
 namespace MiniZinc {
-  
+
+  /**
+   * \brief Stack of an expression iterator
+   *
+   * Iterators run very often on small expressions, so instead of allocating
+   * a new stack for every run, the stacks are taken from a pool owned by the
+   * current thread and returned to it (emptied, but keeping their capacity)
+   * when the run is finished. Iterators started from within a visitor take
+   * another stack from the pool.
+   */
+  template<class E>
+  class IteratorStack {
+  protected:
+    /// Stacks of the current thread that are not in use
+    class Pool {
+    public:
+      std::vector<std::vector<E>*> free;
+      ~Pool(void) {
+        for (unsigned int i=0; i<free.size(); i++)
+          delete free[i];
+      }
+    };
+    static Pool& pool(void) {
+      static thread_local Pool p;
+      return p;
+    }
+    /// Stacks that grew larger than this are not kept in the pool
+    static const size_t maxKept = 1 << 16;
+    /// The stack
+    std::vector<E>* _s;
+  public:
+    /// Take a stack from the pool
+    IteratorStack(void) {
+      Pool& p = pool();
+      if (p.free.empty()) {
+        _s = new std::vector<E>();
+      } else {
+        _s = p.free.back();
+        p.free.pop_back();
+      }
+    }
+    /// Return the stack to the pool
+    ~IteratorStack(void) {
+      if (_s->capacity() > maxKept) {
+        delete _s;
+      } else {
+        _s->clear();
+        pool().free.push_back(_s);
+      }
+    }
+    /// Access the stack
+    std::vector<E>& operator *(void) { return *_s; }
+  private:
+    IteratorStack(const IteratorStack&);
+    IteratorStack& operator =(const IteratorStack&);
+  };
+
+  /// Stack item of the bottom-up iterator
+  struct BottomUpStackItem {
+    /// Expression on the stack
+    Expression* _e;
+    /// Whether this expression has been visited before
+    bool _done;
+    /// If part of a generator expression, which one it is
+    int _gen_i;
+    /// Constructor
+    BottomUpStackItem(Expression* e) : _e(e), _done(false), _gen_i(-1) {
+      MZN_PREFETCH_EXPRESSION(e);
+    }
+    /// Constructor for generator expression
+    BottomUpStackItem(Expression* e, int gen_i) : _e(e), _done(true), _gen_i(gen_i) {}
+  };
+
   /**
    * \brief Bottom-up iterator for expressions
    */
@@ -27,18 +109,7 @@ namespace MiniZinc {
     T& _t;
     
     /// Stack item
-    struct C {
-      /// Expression on the stack
-      Expression* _e;
-      /// Whether this expression has been visited before
-      bool _done;
-      /// If part of a generator expression, which one it is
-      int _gen_i;
-      /// Constructor
-      C(Expression* e) : _e(e), _done(false), _gen_i(-1) {}
-      /// Constructor for generator expression
-      C(Expression* e, int gen_i) : _e(e), _done(true), _gen_i(gen_i) {}
-    };
+    typedef BottomUpStackItem C;
     
     /// Push all elements of \a v onto \a stack
     template<class E>
@@ -60,26 +131,45 @@ namespace MiniZinc {
   }
 
   /**
-   * \brief Leaf iterator for expressions
+   * \brief Stack operations of the top-down iterator
    */
-  template<class T>
-  class TopDownIterator {
+  class TopDownIteratorBase {
   protected:
-    /// The visitor to call back during iteration
-    T& _t;
-    
+    /// Push \a e onto \a stack
+    static void push(std::vector<Expression*>& stack, Expression* e) {
+      MZN_PREFETCH_EXPRESSION(e);
+      stack.push_back(e);
+    }
     /// Push all elements of \a v onto \a stack
     template<class E>
     static void pushVec(std::vector<Expression*>& stack, ASTExprVec<E> v) {
       for (unsigned int i=0; i<v.size(); i++)
-        stack.push_back(v[i]);
+        push(stack, v[i]);
     }
-    
+    /// Push the annotations of \a e onto \a stack
+    static void pushAnn(std::vector<Expression*>& stack, Expression* e) {
+      for (ExpressionSetIter it = e->ann().begin(); it != e->ann().end(); ++it)
+        push(stack, *it);
+    }
+    /// Push the children of \a e onto \a stack
+    static void pushChildren(std::vector<Expression*>& stack, Expression* e);
+  };
+
+  /**
+   * \brief Leaf iterator for expressions
+   */
+  template<class T>
+  class TopDownIterator : public TopDownIteratorBase {
+  protected:
+    /// The visitor to call back during iteration
+    T& _t;
   public:
     /// Constructor
     TopDownIterator(T& t) : _t(t) {}
     /// Run iterator on expression \a e
     void run(Expression* e);
+    /// Call the visit function of \a t for \a e (but not for its children)
+    static void visit(T& t, Expression* e);
   };
 
   template<class T>
@@ -91,7 +181,8 @@ namespace MiniZinc {
 
   template<class T> void
   BottomUpIterator<T>::run(Expression* root) {
-    std::vector<C> stack;
+    IteratorStack<C> s;
+    std::vector<C>& stack = *s;
     if (_t.enter(root))
       stack.push_back(C(root));
     while (!stack.empty()) {
@@ -246,7 +337,8 @@ namespace MiniZinc {
 
   template<class T> void
   TopDownIterator<T>::run(Expression* root) {
-    std::vector<Expression*> stack;
+    IteratorStack<Expression*> s;
+    std::vector<Expression*>& stack = *s;
     if (_t.enter(root))
       stack.push_back(root);
     while (!stack.empty()) {
@@ -257,98 +349,138 @@ namespace MiniZinc {
       }
       if (!_t.enter(e))
         continue;
-      for (ExpressionSetIter it = e->ann().begin(); it != e->ann().end(); ++it) {
-        stack.push_back(*it);
-      }
-      switch (e->eid()) {
-        case Expression::E_INTLIT:
-        _t.vIntLit(*e->template cast<IntLit>());
-        break;
-        case Expression::E_FLOATLIT:
-        _t.vFloatLit(*e->template cast<FloatLit>());
-        break;
-        case Expression::E_SETLIT:
-        _t.vSetLit(*e->template cast<SetLit>());
-        pushVec(stack, e->template cast<SetLit>()->v());
-        break;
-        case Expression::E_BOOLLIT:
-        _t.vBoolLit(*e->template cast<BoolLit>());
-        break;
-        case Expression::E_STRINGLIT:
-        _t.vStringLit(*e->template cast<StringLit>());
-        break;
-        case Expression::E_ID:
-        _t.vId(*e->template cast<Id>());
-        break;
-        case Expression::E_ANON:
-        _t.vAnonVar(*e->template cast<AnonVar>());
-        break;
-        case Expression::E_ARRAYLIT:
-        _t.vArrayLit(*e->template cast<ArrayLit>());
-        pushVec(stack, e->template cast<ArrayLit>()->v());
-        break;
-        case Expression::E_ARRAYACCESS:
-        _t.vArrayAccess(*e->template cast<ArrayAccess>());
-        pushVec(stack, e->template cast<ArrayAccess>()->idx());
-        stack.push_back(e->template cast<ArrayAccess>()->v());
-        break;
-        case Expression::E_COMP:
-        _t.vComprehension(*e->template cast<Comprehension>());
-        {
-          Comprehension* comp = e->template cast<Comprehension>();
-          stack.push_back(comp->where());
-          for (unsigned int i=comp->n_generators(); i--; ) {
-            stack.push_back(comp->in(i));
-            for (unsigned int j=comp->n_decls(i); j--; ) {
-              stack.push_back(comp->decl(i, j));
-            }
+      pushAnn(stack, e);
+      visit(_t, e);
+      pushChildren(stack, e);
+    }
+  }
+
+  template<class T> void
+  TopDownIterator<T>::visit(T& t, Expression* e) {
+    switch (e->eid()) {
+      case Expression::E_INTLIT:
+      t.vIntLit(*e->template cast<IntLit>());
+      break;
+      case Expression::E_FLOATLIT:
+      t.vFloatLit(*e->template cast<FloatLit>());
+      break;
+      case Expression::E_SETLIT:
+      t.vSetLit(*e->template cast<SetLit>());
+      break;
+      case Expression::E_BOOLLIT:
+      t.vBoolLit(*e->template cast<BoolLit>());
+      break;
+      case Expression::E_STRINGLIT:
+      t.vStringLit(*e->template cast<StringLit>());
+      break;
+      case Expression::E_ID:
+      t.vId(*e->template cast<Id>());
+      break;
+      case Expression::E_ANON:
+      t.vAnonVar(*e->template cast<AnonVar>());
+      break;
+      case Expression::E_ARRAYLIT:
+      t.vArrayLit(*e->template cast<ArrayLit>());
+      break;
+      case Expression::E_ARRAYACCESS:
+      t.vArrayAccess(*e->template cast<ArrayAccess>());
+      break;
+      case Expression::E_COMP:
+      t.vComprehension(*e->template cast<Comprehension>());
+      break;
+      case Expression::E_ITE:
+      t.vITE(*e->template cast<ITE>());
+      break;
+      case Expression::E_BINOP:
+      t.vBinOp(*e->template cast<BinOp>());
+      break;
+      case Expression::E_UNOP:
+      t.vUnOp(*e->template cast<UnOp>());
+      break;
+      case Expression::E_CALL:
+      t.vCall(*e->template cast<Call>());
+      break;
+      case Expression::E_VARDECL:
+      t.vVarDecl(*e->template cast<VarDecl>());
+      break;
+      case Expression::E_LET:
+      t.vLet(*e->template cast<Let>());
+      break;
+      case Expression::E_TI:
+      t.vTypeInst(*e->template cast<TypeInst>());
+      break;
+      case Expression::E_TIID:
+      t.vTIId(*e->template cast<TIId>());
+      break;
+    }
+  }
+
+  inline void
+  TopDownIteratorBase::pushChildren(std::vector<Expression*>& stack, Expression* e) {
+    switch (e->eid()) {
+      case Expression::E_INTLIT:
+      case Expression::E_FLOATLIT:
+      case Expression::E_BOOLLIT:
+      case Expression::E_STRINGLIT:
+      case Expression::E_ID:
+      case Expression::E_ANON:
+      case Expression::E_TIID:
+      break;
+      case Expression::E_SETLIT:
+      pushVec(stack, e->cast<SetLit>()->v());
+      break;
+      case Expression::E_ARRAYLIT:
+      pushVec(stack, e->cast<ArrayLit>()->v());
+      break;
+      case Expression::E_ARRAYACCESS:
+      pushVec(stack, e->cast<ArrayAccess>()->idx());
+      push(stack, e->cast<ArrayAccess>()->v());
+      break;
+      case Expression::E_COMP:
+      {
+        Comprehension* comp = e->cast<Comprehension>();
+        push(stack, comp->where());
+        for (unsigned int i=comp->n_generators(); i--; ) {
+          push(stack, comp->in(i));
+          for (unsigned int j=comp->n_decls(i); j--; ) {
+            push(stack, comp->decl(i, j));
           }
-          stack.push_back(comp->e());
         }
-        break;
-        case Expression::E_ITE:
-        _t.vITE(*e->template cast<ITE>());
-        {
-          ITE* ite = e->template cast<ITE>();
-          stack.push_back(ite->e_else());
-          for (int i=0; i<ite->size(); i++) {
-            stack.push_back(ite->e_if(i));
-            stack.push_back(ite->e_then(i));
-          }
+        push(stack, comp->e());
+      }
+      break;
+      case Expression::E_ITE:
+      {
+        ITE* ite = e->cast<ITE>();
+        push(stack, ite->e_else());
+        for (int i=0; i<ite->size(); i++) {
+          push(stack, ite->e_if(i));
+          push(stack, ite->e_then(i));
         }
-        break;
-        case Expression::E_BINOP:
-        _t.vBinOp(*e->template cast<BinOp>());
-        stack.push_back(e->template cast<BinOp>()->rhs());
-        stack.push_back(e->template cast<BinOp>()->lhs());
-        break;
-        case Expression::E_UNOP:
-        _t.vUnOp(*e->template cast<UnOp>());
-        stack.push_back(e->template cast<UnOp>()->e());
-        break;
-        case Expression::E_CALL:
-        _t.vCall(*e->template cast<Call>());
-        pushVec(stack, e->template cast<Call>()->args());
-        break;
-        case Expression::E_VARDECL:
-        _t.vVarDecl(*e->template cast<VarDecl>());
-        stack.push_back(e->template cast<VarDecl>()->e());
-        stack.push_back(e->template cast<VarDecl>()->ti());
-        break;
-        case Expression::E_LET:
-        _t.vLet(*e->template cast<Let>());
-        stack.push_back(e->template cast<Let>()->in());
-        pushVec(stack, e->template cast<Let>()->let());
-        break;
-        case Expression::E_TI:
-        _t.vTypeInst(*e->template cast<TypeInst>());
-        stack.push_back(e->template cast<TypeInst>()->domain());
-        pushVec(stack,e->template cast<TypeInst>()->ranges());
-        break;
-        case Expression::E_TIID:
-        _t.vTIId(*e->template cast<TIId>());
-        break;
       }
+      break;
+      case Expression::E_BINOP:
+      push(stack, e->cast<BinOp>()->rhs());
+      push(stack, e->cast<BinOp>()->lhs());
+      break;
+      case Expression::E_UNOP:
+      push(stack, e->cast<UnOp>()->e());
+      break;
+      case Expression::E_CALL:
+      pushVec(stack, e->cast<Call>()->args());
+      break;
+      case Expression::E_VARDECL:
+      push(stack, e->cast<VarDecl>()->e());
+      push(stack, e->cast<VarDecl>()->ti());
+      break;
+      case Expression::E_LET:
+      push(stack, e->cast<Let>()->in());
+      pushVec(stack, e->cast<Let>()->let());
+      break;
+      case Expression::E_TI:
+      push(stack, e->cast<TypeInst>()->domain());
+      pushVec(stack,e->cast<TypeInst>()->ranges());
+      break;
     }
   }
   
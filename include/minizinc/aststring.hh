@@ -136,9 +136,10 @@ namespace MiniZinc {
     size_t hash(void) const {
       return reinterpret_cast<const size_t*>(_data)[0];
     }
-    /// Mark for garbage collection
+    /// Mark for garbage collection (never writes to already marked strings)
     void mark(void) const {
-      _gc_mark = 1;
+      if (_gc_mark==0)
+        _gc_mark = 1;
     }
   };
 
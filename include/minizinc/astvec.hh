@@ -118,7 +118,7 @@ namespace MiniZinc {
     /// Iterator end
     int* end(void) { return begin()+size(); }
     /// Mark as alive for garbage collection
-    void mark(void) const { _gc_mark = 1; }
+    void mark(void) const { if (_gc_mark==0) _gc_mark = 1; }
   };
 
   /// Garbage collected vector of expressions
@@ -145,7 +145,7 @@ namespace MiniZinc {
     /// Iterator end
     T* end(void) { return begin()+size(); }
     /// Mark as alive for garbage collection
-    void mark(void) const { _gc_mark = 1; }
+    void mark(void) const { if (_gc_mark==0) _gc_mark = 1; }
   };
 
   template<class T>
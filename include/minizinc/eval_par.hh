@@ -84,20 +84,20 @@ namespace MiniZinc {
    */
   IntSetVal* compute_intset_bounds(EnvI& env, Expression* e);
 
-  template<class Eval>
+  template<class Eval, class Acc>
   void
   eval_comp_array(EnvI& env, Eval& eval, Comprehension* e, int gen, int id,
-                  KeepAlive in, std::vector<typename Eval::ArrayVal>& a);
+                  KeepAlive in, Acc& a);
 
-  template<class Eval>
+  template<class Eval, class Acc>
   void
   eval_comp_set(EnvI& env, Eval& eval, Comprehension* e, int gen, int id,
-                KeepAlive in, std::vector<typename Eval::ArrayVal>& a);
+                KeepAlive in, Acc& a);
 
-  template<class Eval>
+  template<class Eval, class Acc>
   void
   eval_comp_set(EnvI& env, Eval& eval, Comprehension* e, int gen, int id,
-                IntVal i, KeepAlive in, std::vector<typename Eval::ArrayVal>& a) {
+                IntVal i, KeepAlive in, Acc& a) {
     {
       GCLock lock;
       e->decl(gen,id)->e(IntLit::a(i));
@@ -135,10 +135,10 @@ namespace MiniZinc {
     }
   }
 
-  template<class Eval>
+  template<class Eval, class Acc>
   void
   eval_comp_array(EnvI& env, Eval& eval, Comprehension* e, int gen, int id,
-                  IntVal i, KeepAlive in, std::vector<typename Eval::ArrayVal>& a) {
+                  IntVal i, KeepAlive in, Acc& a) {
     ArrayLit* al = in()->cast<ArrayLit>();
     CallStackItem csi(env, e->decl(gen,id)->id(), i);
     e->decl(gen,id)->e(al->v()[i.toInt()]);
@@ -185,10 +185,10 @@ namespace MiniZinc {
    * in that generator, \a in is the expression of that generator, and
    * \a a is the array in which to place the result.
    */
-  template<class Eval>
+  template<class Eval, class Acc>
   void
   eval_comp_set(EnvI& env, Eval& eval, Comprehension* e, int gen, int id,
-                KeepAlive in, std::vector<typename Eval::ArrayVal>& a) {
+                KeepAlive in, Acc& a) {
     IntSetVal* isv = eval_intset(env, in());
     if (isv->card().isPlusInfinity()) {
       throw EvalError(env,in()->loc(),"comprehension iterates over an infinite set");
@@ -208,10 +208,10 @@ namespace MiniZinc {
    * in that generator, \a in is the expression of that generator, and
    * \a a is the array in which to place the result.
    */
-  template<class Eval>
+  template<class Eval, class Acc>
   void
   eval_comp_array(EnvI& env, Eval& eval, Comprehension* e, int gen, int id,
-                  KeepAlive in, std::vector<typename Eval::ArrayVal>& a) {
+                  KeepAlive in, Acc& a) {
     ArrayLit* al = in()->cast<ArrayLit>();
     for (unsigned int i=0; i<al->v().size(); i++) {
       eval_comp_array<Eval>(env, eval,e,gen,id,i,in,a);
@@ -219,15 +219,15 @@ namespace MiniZinc {
   }
 
   /**
-   * \brief Evaluate comprehension expression
-   * 
+   * \brief Evaluate comprehension expression incrementally
+   *
    * Calls \a eval.e for every element of the comprehension \a e and
-   * returns a vector with all the evaluated results.
+   * passes the result to \a a.push_back, without materialising the
+   * elements.
    */
-  template<class Eval>
-  std::vector<typename Eval::ArrayVal>
-  eval_comp(EnvI& env, Eval& eval, Comprehension* e) {
-    std::vector<typename Eval::ArrayVal> a;
+  template<class Eval, class Acc>
+  void
+  eval_comp_stream(EnvI& env, Eval& eval, Comprehension* e, Acc& a) {
     KeepAlive in;
     {
       GCLock lock;
@@ -246,6 +246,19 @@ namespace MiniZinc {
     } else {
       eval_comp_array<Eval>(env, eval,e,0,0,in,a);
     }
+  }
+
+  /**
+   * \brief Evaluate comprehension expression
+   * 
+   * Calls \a eval.e for every element of the comprehension \a e and
+   * returns a vector with all the evaluated results.
+   */
+  template<class Eval>
+  std::vector<typename Eval::ArrayVal>
+  eval_comp(EnvI& env, Eval& eval, Comprehension* e) {
+    std::vector<typename Eval::ArrayVal> a;
+    eval_comp_stream(env, eval, e, a);
     return a;
   }  
 
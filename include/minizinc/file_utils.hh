@@ -23,6 +23,8 @@ namespace MiniZinc { namespace FileUtils {
   bool file_exists(const std::string& filename);
   /// Test if \a dirname exists and is a directory
   bool directory_exists(const std::string& dirname);
+  /// Return size and modification time of file \a filename, false if it does not exist
+  bool file_stamp(const std::string& filename, long long& size, long long& mtime);
   /// Return full path to file
   std::string file_path(const std::string& filename);
   /// Return list of files with extension \a ext in directory \a dir
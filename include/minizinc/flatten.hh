@@ -27,6 +27,10 @@ namespace MiniZinc {
     }
   };
 
+  class IncrementalFlattening;
+  class Instrumentation;
+  class FlatteningProfiler;
+
   /// Options for the flattener
   struct FlatteningOptions {
     /// Keep output in resulting flat model
@@ -37,9 +41,16 @@ namespace MiniZinc {
     enum OutputMode {
       OUTPUT_ITEM, OUTPUT_DZN, OUTPUT_JSON
     } outputMode;
+    /// Records for reusing flattened constraints across data changes (or NULL)
+    IncrementalFlattening* incremental;
+    /// Measurements of the flattening phases (or NULL)
+    Instrumentation* instrumentation;
+    /// Profiler attributing flattening cost to source locations (or NULL)
+    FlatteningProfiler* profiler;
     /// Default constructor
     FlatteningOptions(void)
-    : keepOutputInFzn(false), onlyRangeDomains(false), outputMode(OUTPUT_ITEM) {}
+    : keepOutputInFzn(false), onlyRangeDomains(false), outputMode(OUTPUT_ITEM),
+      incremental(NULL), instrumentation(NULL), profiler(NULL) {}
   };
   
   /// Flatten model \a m
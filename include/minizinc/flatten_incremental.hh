@@ -0,0 +1,173 @@
+/* -*- mode: C++; c-basic-offset: 2; indent-tabs-mode: nil -*- */
+
+/*
+ *  Main authors:
+ *     agent <agent@local>
+ */
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __MINIZINC_FLATTEN_INCREMENTAL_HH__
+#define __MINIZINC_FLATTEN_INCREMENTAL_HH__
+
+#include <minizinc/flatten_internal.hh>
+#include <minizinc/stl_map_set.hh>
+
+#include <string>
+#include <vector>
+
+namespace MiniZinc {
+
+  /**
+   * \brief Reuse of flattened constraint items across changes of the data
+   *
+   * While a model is flattened, the flat items produced by each top-level
+   * constraint item are recorded together with a fingerprint of the
+   * declarations the item depends on (found through its identifiers and
+   * the functions it calls), and of the current state of the flat
+   * variables it can reach. A fingerprint is the set of printed forms of
+   * these declarations and variables, so that two fingerprints are only
+   * equal if the declarations are. When the same model is flattened again
+   * with different data, a constraint item whose fingerprints are
+   * unchanged is not flattened again. Instead, its recorded flat items are copied into
+   * the new flat model, with fresh names for the variables it introduced.
+   *
+   * An item is only recorded if its flattening did not depend on other
+   * items: it must not reuse entries of the CSE table created by other
+   * items, must not change the variables it can reach, and its flat items
+   * may only refer to variables it introduced or to top-level declarations.
+   * All other items are flattened as usual.
+   */
+  class IncrementalFlattening {
+  protected:
+    /// Declaration outside of a recorded item
+    struct External {
+      /// Placeholder referenced by the recorded items
+      VarDecl* ph;
+      /// Name of the top-level declaration
+      std::string name;
+      /// Whether the placeholder stands for the flat declaration
+      bool flat;
+      /// Index into the flat array literal (or -1 for the declaration)
+      int idx;
+    };
+    /// Fingerprint, as sorted pointers to printed forms in the pool
+    typedef std::vector<const std::string*> Fingerprint;
+    /// Record for one constraint item
+    struct Record {
+      /// Whether the flat items can be reused
+      bool reusable;
+      /// Fingerprint of the declarations the item depends on
+      Fingerprint data;
+      /// Fingerprint of the flat variables the item can reach
+      Fingerprint state;
+      /// First recorded flat item
+      unsigned int first;
+      /// End of recorded flat items
+      unsigned int last;
+      /// Declarations outside of the item
+      std::vector<External> ext;
+      /// Warnings emitted while flattening the item
+      std::vector<std::string> warnings;
+    };
+    /// Direct dependencies of a declaration or function
+    struct Deps {
+      bool done;
+      std::vector<VarDecl*> vds;
+      std::vector<FunctionI*> fns;
+      Deps(void) : done(false) {}
+    };
+    /// Cached fingerprint of a flat variable
+    struct State {
+      TypeInst* ti;
+      Expression* dom;
+      Expression* e;
+      unsigned int anns;
+      const std::string* s;
+    };
+
+    /// Key identifying the model
+    std::string _key;
+    /// Records of the previous run
+    std::vector<Record> _prev;
+    /// Copies of the flat items of the previous run
+    Model* _prevItems;
+    /// Records of the current run
+    std::vector<Record> _cur;
+    /// Copies of the flat items of the current run
+    Model* _curItems;
+    /// Number of constraint items flattened in the current run
+    unsigned int _n;
+    /// Number of constraint items reused in the current run
+    unsigned int _reused;
+    /// Printed forms of declarations and flat variables, each stored once
+    UNORDERED_NAMESPACE::unordered_set<std::string> _pool;
+
+    /// Functions by name
+    UNORDERED_NAMESPACE::unordered_map<std::string,std::vector<FunctionI*> > _fns;
+    /// Top-level declarations by name
+    UNORDERED_NAMESPACE::unordered_map<std::string,VarDecl*> _globals;
+    /// Direct dependencies of functions
+    UNORDERED_NAMESPACE::unordered_map<const FunctionI*,Deps> _fnDeps;
+    /// Direct dependencies of top-level declarations
+    UNORDERED_NAMESPACE::unordered_map<const VarDecl*,Deps> _vdDeps;
+    /// Printed forms of top-level declarations
+    UNORDERED_NAMESPACE::unordered_map<const VarDecl*,const std::string*> _data;
+    /// Printed forms of flat variables
+    UNORDERED_NAMESPACE::unordered_map<const VarDecl*,State> _state;
+    /// Map from flat variables to top-level declaration and array index
+    UNORDERED_NAMESPACE::unordered_map<const VarDecl*,std::pair<VarDecl*,int> > _flatIndex;
+    /// Top-level declarations whose flat variables have been indexed
+    UNORDERED_NAMESPACE::unordered_set<const VarDecl*> _indexed;
+
+    /// Add functions that calls to \a id can be flattened into to \a d
+    void addFns(const std::string& id, Deps& d);
+    /// Add direct dependencies of \a e to \a d
+    void collect(Expression* e, Deps& d);
+    /// Return direct dependencies of \a vd
+    const Deps& deps(VarDecl* vd);
+    /// Return direct dependencies of \a fi
+    const Deps& deps(FunctionI* fi);
+    /// Compute top-level declarations \a e depends on
+    void closure(Expression* e, std::vector<VarDecl*>& cl);
+    /// Return the copy of \a s in the pool
+    const std::string* intern(const std::string& s);
+    /// Return printed form of top-level declaration \a vd
+    const std::string* data(VarDecl* vd);
+    /// Return printed form of flat variable \a vd
+    const std::string* state(VarDecl* vd, int depth=0);
+    /// Compute fingerprint of declarations \a cl
+    void dataPrint(const std::vector<VarDecl*>& cl, Fingerprint& fp);
+    /// Compute fingerprint of flat variables of declarations \a cl
+    void statePrint(const std::vector<VarDecl*>& cl, Fingerprint& fp);
+    /// Flatten \a ci and record the result
+    void record(EnvI& env, ConstraintI* ci, const std::vector<VarDecl*>& cl,
+                const Fingerprint& data, const Fingerprint& state);
+    /// Copy flat items starting at \a first into record \a r
+    bool stash(EnvI& env, unsigned int first, const std::vector<VarDecl*>& cl, Record& r);
+    /// Add copies of the flat items of \a r to the flat model
+    bool replay(EnvI& env, const Record& r);
+  public:
+    /// Constructor
+    IncrementalFlattening(void);
+    /// Destructor
+    ~IncrementalFlattening(void);
+    /// Set \a key identifying the model, discarding records of a different model
+    void model(const std::string& key);
+    /// Start flattening the model of \a env
+    void start(EnvI& env);
+    /// Flatten constraint item \a ci, reusing the previous result if possible
+    void flatten(EnvI& env, ConstraintI* ci);
+    /// Finish flattening, keeping the records for the next run
+    void finish(EnvI& env);
+    /// Return number of constraint items flattened in the last run
+    unsigned int items(void) const { return _n; }
+    /// Return number of constraint items reused in the last run
+    unsigned int reused(void) const { return _reused; }
+  };
+
+}
+
+#endif
@@ -13,6 +13,8 @@
 #define __MINIZINC_FLATTEN_INTERNAL_HH__
 
 #include <cmath>
+#include <deque>
+#include <mutex>
 
 #include <minizinc/copy.hh>
 #include <minizinc/flatten.hh>
@@ -87,9 +89,23 @@ namespace MiniZinc {
     std::vector<int> modifiedVarDecls;
     int in_redundant_constraint;
     int in_maybe_partial;
+    /// Whether CSE map accesses are recorded (for incremental flattening)
+    bool cse_record;
+    /// Whether a recorded lookup hit an entry inserted before recording started
+    bool cse_foreign;
+    /// Keys inserted into the CSE map since recording started
+    UNORDERED_NAMESPACE::unordered_set<Expression*> cse_keys;
+    /// Number of CSE map lookups
+    unsigned long long cse_lookups;
+    /// Number of CSE map lookups that found a valid entry
+    unsigned long long cse_hits;
+    /// Profiler following the call stack (or NULL)
+    FlatteningProfiler* profiler;
   protected:
     Map map;
     Model* _flat;
+    /// Number of constraints removed from the flat model since it was last compacted
+    unsigned int _flatRemoved;
     bool _failed;
     unsigned int ids;
     ASTStringMap<ASTString>::t reifyMap;
@@ -98,7 +114,10 @@ namespace MiniZinc {
     std::vector<VarDeclI*> enumVarDecls;
     typedef UNORDERED_NAMESPACE::unordered_map<std::string,unsigned int> ArrayEnumMap;
     ArrayEnumMap arrayEnumMap;
-    std::vector<std::vector<unsigned int> > arrayEnumDecls;
+    /// Array enums (a deque, so that references to them stay valid)
+    std::deque<std::vector<unsigned int> > arrayEnumDecls;
+    /// Protects the array enums, which the typechecker can register in parallel
+    mutable std::mutex arrayEnumMutex;
   public:
     EnvI(Model* orig0);
     ~EnvI(void);
@@ -119,6 +138,15 @@ namespace MiniZinc {
     void flat_addItem(Item* i);
     void flat_removeItem(int i);
     void flat_removeItem(Item* i);
+    /// Remove the items marked as removed from the flat model
+    ///
+    /// Unless \a all is true, only removed constraints are removed, and only
+    /// once they make up a quarter of the model. This renumbers the items,
+    /// so it must not be called while item indices are held.
+    void flat_compact(bool all=false);
+    /// Rebuild all indices of flat items after items have been moved, or
+    /// the items in \a removed have been taken out of the flat model
+    void flat_reindex(const VarOccurrences::Items& removed);
     void vo_add_exp(VarDecl* vd);
     void fail(void);
     bool failed(void) const;
@@ -0,0 +1,149 @@
+/* -*- mode: C++; c-basic-offset: 2; indent-tabs-mode: nil -*- */
+
+/*
+ *  Main authors:
+ *     agent <agent@local>
+ */
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __MINIZINC_FLATTEN_PROFILER_HH__
+#define __MINIZINC_FLATTEN_PROFILER_HH__
+
+#include <minizinc/ast.hh>
+#include <minizinc/timer.hh>
+#include <minizinc/stl_map_set.hh>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace MiniZinc {
+
+  class EnvI;
+
+  /**
+   * \brief Accounting profiler for flattening
+   *
+   * The profiler follows the call stack of the flattener (see
+   * CallStackItem). Each frame is labelled with the source location of the
+   * expression being flattened, and for calls also with the name of the
+   * function. Time, garbage collected memory and the flat variables and
+   * constraints added to the flat model are attributed to the innermost
+   * frame, and accumulated in a tree of distinct call paths.
+   *
+   * The report lists the source locations and functions with the highest
+   * cost, and the call paths can be written in the folded format used by
+   * flame graph tools.
+   */
+  class FlatteningProfiler {
+  public:
+    /// Cost of a label or function, summed over all call paths
+    struct Cost {
+      /// Time spent in the frame itself (ms)
+      double self;
+      /// Time including callees (ms)
+      double total;
+      /// Flat variables added including callees
+      unsigned long long vars;
+      /// Flat constraints added including callees
+      unsigned long long cons;
+      /// Bytes allocated including callees
+      unsigned long long alloc;
+    };
+    /// Attach profiler \a p (if not NULL) to \a env while the object exists
+    class Scope {
+    protected:
+      EnvI& _env;
+      FlatteningProfiler* _p;
+    public:
+      Scope(EnvI& env, FlatteningProfiler* p);
+      ~Scope(void);
+    };
+  protected:
+    /// Identity of a frame label
+    struct LabelKey {
+      const char* fn;
+      const char* file;
+      unsigned int line;
+      bool operator ==(const LabelKey& k) const {
+        return fn==k.fn && file==k.file && line==k.line;
+      }
+    };
+    struct LabelKeyHash {
+      size_t operator ()(const LabelKey& k) const {
+        size_t h = reinterpret_cast<size_t>(k.fn);
+        h = h*31 + reinterpret_cast<size_t>(k.file);
+        return h*31 + k.line;
+      }
+    };
+    /// Node of the call path tree
+    struct Node {
+      /// Parent node (node 0 is the root)
+      unsigned int parent;
+      /// Label of the frame
+      unsigned int label;
+      /// Time spent in the frame itself (ms)
+      double self;
+      /// Flat variables added by the frame itself
+      unsigned long long vars;
+      /// Flat constraints added by the frame itself
+      unsigned long long cons;
+      /// Bytes allocated by the frame itself
+      unsigned long long alloc;
+    };
+    /// Call path tree
+    std::vector<Node> _nodes;
+    /// Children of nodes, indexed by parent and label
+    UNORDERED_NAMESPACE::unordered_map<unsigned long long,unsigned int> _children;
+    /// Label strings
+    std::vector<std::string> _labels;
+    /// Function called by each label (or -1)
+    std::vector<int> _labelFn;
+    /// Function names
+    std::vector<std::string> _fns;
+    /// Labels by identity
+    UNORDERED_NAMESPACE::unordered_map<LabelKey,unsigned int,LabelKeyHash> _labelIdx;
+    /// Function indices by name
+    UNORDERED_NAMESPACE::unordered_map<std::string,int> _fnIdx;
+    /// Current call path
+    std::vector<unsigned int> _stack;
+    /// Clock
+    Timer _timer;
+    /// Time of the last event
+    double _last;
+    /// Allocated memory at the last event
+    unsigned long long _lastAlloc;
+    /// Whether the profiler is running
+    bool _running;
+
+    /// Attribute time and memory since the last event to the current frame
+    void account(void);
+    /// Return label for expression \a e
+    unsigned int label(Expression* e);
+    /// Compute costs of labels and functions
+    void costs(std::vector<Cost>& labels, std::vector<Cost>& fns) const;
+  public:
+    /// Constructor
+    FlatteningProfiler(void);
+    /// Start measuring
+    void start(void);
+    /// Stop measuring
+    void stop(void);
+    /// Enter frame for \a e
+    void enter(Expression* e);
+    /// Leave current frame
+    void leave(void);
+    /// Count item \a i added to the flat model
+    void addItem(Item* i);
+    /// Write the \a n most expensive locations and functions to \a os
+    void report(std::ostream& os, unsigned int n) const;
+    /// Write call paths weighted by self time in microseconds to \a os
+    void folded(std::ostream& os) const;
+  };
+
+}
+
+#endif
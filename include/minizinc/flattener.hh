@@ -21,11 +21,15 @@
 
 #include <minizinc/model.hh>
 #include <minizinc/parser.hh>
+#include <minizinc/library_index.hh>
 #include <minizinc/typecheck.hh>
 #include <minizinc/astexception.hh>
 
 #include <minizinc/flatten.hh>
 #include <minizinc/flatten_internal.hh>  // temp., TODO
+#include <minizinc/flatten_incremental.hh>
+#include <minizinc/instrumentation.hh>
+#include <minizinc/flatten_profiler.hh>
 #include <minizinc/MIPdomains.hh>
 #include <minizinc/optimize.hh>
 #include <minizinc/builtins.hh>
@@ -58,11 +62,23 @@ namespace MiniZinc {
     virtual void set_flag_statistics(bool f) { flag_statistics = f; }
     virtual bool get_flag_statistics() const { return flag_statistics; }
     virtual Env* getEnv() const { assert(pEnv.get()); return pEnv.get(); }
+    /// Copy library files from \a c instead of parsing them, and add parsed ones to it
+    virtual void setLibraryCache(LibraryCache* c) { pLibraryCache = c; }
+    /// Reuse flattened constraints recorded in \a inc, and record the new ones in it
+    virtual void setIncrementalFlattening(IncrementalFlattening* inc) { pIncremental = inc; }
     
     SolverInstance::Status status = SolverInstance::UNKNOWN;
     
   private:
-    
+    /// Flatten the model with the base data files, recording the results for reuse
+    void flattenBase();
+    /// Return key identifying the model files
+    std::string modelKey() const;
+    /// Write the instrumentation results to the file given by --instrument-json
+    void printInstrumentation();
+    /// Write the profile to the file given by --profile-flattening
+    void printProfile();
+
     bool fOutputByDefault = true;      // if the class is used in mzn2fzn, write .fzn+.ozn by default
     std::vector<std::string> filenames;
     std::vector<std::string> datafiles;
@@ -72,13 +88,26 @@ namespace MiniZinc {
     bool flag_ignoreStdlib = false;
     bool flag_typecheck = true;
     bool flag_verbose = false;
+    int flag_typecheck_threads = 1;
+    bool flag_lazy_stdlib = false;
+    std::string flag_stdlib_index;
+    LibraryCache* pLibraryCache = NULL;
     bool flag_newfzn = false;
     bool flag_optimize = true;
     bool flag_werror = false;
     bool flag_only_range_domains = false;
     bool flag_noMIPdomains = false;
+    int flag_MIPdomains_threads = 1;
     bool flag_statistics = false;
     bool flag_stdinInput = false;
+    IncrementalFlattening* pIncremental = NULL;
+    std::vector<std::string> flag_incremental_base;
+    std::unique_ptr<IncrementalFlattening> pBaseIncremental;
+    std::string flag_instrument_json;
+    std::unique_ptr<Instrumentation> pInstrumentation;
+    std::string flag_profile_flattening;
+    int flag_profile_top = 20;
+    std::unique_ptr<FlatteningProfiler> pProfiler;
 
     std::string std_lib_dir;
     std::string globals_dir;
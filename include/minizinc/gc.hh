@@ -15,6 +15,7 @@
 #include <cstdlib>
 #include <cassert>
 #include <new>
+#include <mutex>
 #include <minizinc/stl_map_set.hh>
 
 namespace MiniZinc {
@@ -111,6 +112,7 @@ namespace MiniZinc {
   class WeakRef;
 
   class ASTNodeWeakMap;
+  class LiteralCache;
   
   /// Garbage collector
   class GC {
@@ -120,16 +122,25 @@ namespace MiniZinc {
     friend class KeepAlive;
     friend class WeakRef;
     friend class ASTNodeWeakMap;
+    friend class GCContext;
+    friend class GCPermanent;
+    friend class GCShared;
   private:
     class Heap;
     /// The memory controlled by the collector
     Heap* _heap;
     /// Count how many locks are currently active
     unsigned int _lock_count;
+    /// Shared literals allocated by this collector
+    LiteralCache* _literals;
+    /// Mutex protecting the collector while several threads use it (or NULL)
+    std::recursive_mutex* _shared;
     /// Return thread-local GC object
     static GC*& gc(void);
     /// Constructor
     GC(void);
+    /// Destructor (frees all memory controlled by the collector)
+    ~GC(void);
 
     /// Allocate garbage collected memory
     void* alloc(size_t size);
@@ -142,6 +153,23 @@ namespace MiniZinc {
     static void removeNodeWeakMap(ASTNodeWeakMap* m);
     
   public:
+    /// Exclusive access to the collector of the current thread if it is shared
+    class SharedLock {
+    protected:
+      /// The mutex of the collector (or NULL if it is not shared)
+      std::recursive_mutex* _m;
+    public:
+      /// Acquire access to the collector of the current thread
+      SharedLock(void);
+      /// Acquire access to collector \a gc
+      explicit SharedLock(GC* gc) : _m(gc ? gc->_shared : NULL) {
+        if (_m) _m->lock();
+      }
+      /// Release access
+      ~SharedLock(void) {
+        if (_m) _m->unlock();
+      }
+    };
     /// Acquire garbage collector lock for this thread
     static void lock(void);
     /// Release garbage collector lock for this thread
@@ -162,6 +190,110 @@ namespace MiniZinc {
     
     /// Return maximum allocated memory (high water mark)
     static size_t maxMem(void);
+    /// Return memory currently in use
+    static size_t mem(void);
+    /// Return total memory allocated so far (including collected memory)
+    static unsigned long long allocated(void);
+    /// Return number of garbage collections run so far
+    static unsigned long long collections(void);
+
+    /// Return shared literals allocated by the current collector
+    static LiteralCache& literals(void);
+  };
+
+  /**
+   * \brief Garbage collector that is not tied to a thread
+   *
+   * Each thread normally allocates from its own collector. A context owns
+   * a separate collector, which any thread can use while it holds a
+   * GCContext::Use object for it. Uses of the same context by different
+   * threads are serialised, so threads can work in parallel on data
+   * allocated in different contexts.
+   *
+   * Models, KeepAlive and WeakRef objects must be destroyed by a thread
+   * that uses the context they were created in, and before the context.
+   */
+  class GCContext {
+  protected:
+    /// The collector
+    GC* _gc;
+    /// Serialises uses of the context
+    std::recursive_mutex _mutex;
+  public:
+    /// Constructor
+    GCContext(void);
+    /// Destructor (frees all memory allocated in the context)
+    ~GCContext(void);
+
+    /// Use of a context by the current thread
+    class Use {
+    protected:
+      /// The context
+      GCContext& _c;
+      /// Collector used by the thread before
+      GC* _prev;
+    public:
+      /// Make \a c the context of the current thread
+      Use(GCContext& c);
+      /// Restore the previous collector of the current thread
+      ~Use(void);
+    };
+  };
+
+  /**
+   * \brief Allocation of data that lives as long as the program
+   *
+   * While a GCPermanent object exists, the current thread allocates from a
+   * collector that never frees memory. Statically allocated data such as
+   * constants() is shared by all threads and contexts, so it must not be
+   * owned by the collector of the thread that happens to create it.
+   */
+  class GCPermanent {
+  protected:
+    /// Collector used by the thread before
+    GC* _prev;
+  public:
+    /// Start allocating permanent data
+    GCPermanent(void);
+    /// Finish allocating permanent data
+    ~GCPermanent(void);
+  };
+
+  /**
+   * \brief Use of the collector of one thread by several threads
+   *
+   * While a GCShared object exists, other threads can work on the data of
+   * the thread that created it by holding a GCShared::Use object. All
+   * threads then allocate from the same collector, whose state is protected
+   * by a mutex, and no garbage is collected.
+   *
+   * Uses must end before the GCShared object is destroyed, and KeepAlive
+   * and WeakRef objects created during a use must be destroyed before it
+   * ends.
+   */
+  class GCShared {
+  protected:
+    /// The shared collector
+    GC* _gc;
+    /// Serialises accesses to the collector
+    std::recursive_mutex _mutex;
+  public:
+    /// Share the collector of the current thread
+    GCShared(void);
+    /// Stop sharing the collector
+    ~GCShared(void);
+
+    /// Use of the shared collector by the current thread
+    class Use {
+    protected:
+      /// Collector used by the thread before
+      GC* _prev;
+    public:
+      /// Make the collector shared by \a s the collector of the current thread
+      Use(GCShared& s);
+      /// Restore the previous collector of the current thread
+      ~Use(void);
+    };
   };
 
   /// Automatic garbage collection lock
@@ -0,0 +1,102 @@
+/* -*- mode: C++; c-basic-offset: 2; indent-tabs-mode: nil -*- */
+
+/*
+ *  Main authors:
+ *     agent <agent@local>
+ */
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __MINIZINC_INSTRUMENTATION_HH__
+#define __MINIZINC_INSTRUMENTATION_HH__
+
+#include <minizinc/timer.hh>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace MiniZinc {
+
+  /**
+   * \brief Time, memory use and counters of the phases of a compilation
+   *
+   * Each phase is measured by an Instrumentation::Scope object, which
+   * records the elapsed time as well as the memory allocated and the number
+   * of collections run by the garbage collector of the current thread.
+   * Phases that run more than once are summed up. Nested phases are named
+   * with a dot (e.g. flatten.output), and their measurements are included
+   * in the enclosing phase. The result can be written as a JSON object,
+   * which is also the input format of the compiler benchmark harness
+   * (tests/benchmarks/run-compiler.py).
+   */
+  class Instrumentation {
+  public:
+    /// Measurements of one phase
+    struct Phase {
+      /// Name of the phase
+      std::string name;
+      /// Number of times the phase was run
+      unsigned int runs;
+      /// Elapsed time in milliseconds
+      double ms;
+      /// Bytes allocated by the garbage collector
+      unsigned long long allocated;
+      /// Number of garbage collections
+      unsigned long long collections;
+      /// Heap size at the end of the phase
+      unsigned long long heap;
+      /// Maximum heap size at the end of the phase
+      unsigned long long maxHeap;
+      /// Peak resident set size of the process at the end of the phase
+      unsigned long long peakRss;
+    };
+    /// Measure the phase \a name while the object exists
+    class Scope {
+    protected:
+      /// The instrumentation (or NULL if disabled)
+      Instrumentation* _i;
+      /// Name of the phase
+      const char* _name;
+      /// Start time
+      Timer _t;
+      /// Bytes allocated at start
+      unsigned long long _allocated;
+      /// Collections run at start
+      unsigned long long _collections;
+    public:
+      /// Start phase \a name, nothing is measured if \a i is NULL
+      Scope(Instrumentation* i, const char* name);
+      /// Finish the current phase and start phase \a name
+      void next(const char* name);
+      /// Finish the current phase
+      void finish(void);
+      /// Finish the current phase
+      ~Scope(void);
+    };
+  protected:
+    /// Phases in the order they were first started
+    std::vector<Phase> _phases;
+    /// Counters in the order they were first set
+    std::vector<std::pair<std::string,long long> > _counters;
+    /// Time since construction
+    Timer _total;
+    /// Add measurements for phase \a name
+    void add(const char* name, double ms, unsigned long long allocated,
+             unsigned long long collections);
+  public:
+    /// Return the peak resident set size of the process in bytes (0 if unknown)
+    static unsigned long long peakRss(void);
+    /// Set counter \a name to \a value
+    void counter(const std::string& name, long long value);
+    /// Return measured phases
+    const std::vector<Phase>& phases(void) const { return _phases; }
+    /// Write all measurements as a JSON object to \a os
+    void json(std::ostream& os) const;
+  };
+
+}
+
+#endif
@@ -0,0 +1,95 @@
+/* -*- mode: C++; c-basic-offset: 2; indent-tabs-mode: nil -*- */
+
+/*
+ *  Main authors:
+ *     agent <agent@local>
+ */
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __MINIZINC_INTSETOPS_HH__
+#define __MINIZINC_INTSETOPS_HH__
+
+#include <minizinc/values.hh>
+#include <vector>
+
+namespace MiniZinc {
+
+  /**
+   * \brief Bulk operations on integer sets
+   *
+   * Computes unions and intersections of any number of sets in scratch
+   * buffers that are reused between operations, and only allocates the
+   * final IntSetVal. Combining sets pairwise through the iterators in
+   * iter.hh instead allocates one intermediate set per operand.
+   *
+   * Unions of many ranges over a small, dense universe are computed
+   * using a bitset instead of sorting the ranges.
+   *
+   * Usage:
+   * \code
+   * IntSetOps ops;
+   * ops.startUnion();
+   * for (...) ops.add(isv);
+   * IntSetVal* u = ops.result();
+   * \endcode
+   */
+  class IntSetOps {
+  public:
+    typedef IntSetVal::Range Range;
+  protected:
+    /// Operation currently being computed
+    enum Op { OP_NONE, OP_UNION, OP_INTER } _op;
+    /// Ranges of the current (partial) result
+    std::vector<Range> _r;
+    /// Scratch buffer for intersection
+    std::vector<Range> _tmp;
+    /// Scratch buffer for bitset representation
+    std::vector<unsigned long long int> _bits;
+    /// Whether \a _r is sorted and does not contain overlapping ranges
+    bool _normalised;
+    /// Whether any set has been added to the current intersection
+    bool _started;
+    /// Sort and merge the ranges in \a _r
+    void normalise(void);
+    /// Merge the ranges in \a _r using a bitset for universe \a lb..\a ub
+    void normaliseBitset(long long int lb, long long int ub);
+    /// Intersect \a _r with the ranges of \a s
+    template<class S>
+    void intersect(const S& s);
+  public:
+    /// Maximum size of universe for which bitsets are used
+    static const long long int bitsetMaxUniverse = 1<<16;
+    /// Constructor
+    IntSetOps(void);
+
+    /// Start computing a union (the empty union is the empty set)
+    void startUnion(void);
+    /// Start computing an intersection (the empty intersection is the universe)
+    void startIntersect(void);
+    /// Add set \a s to the current operation
+    void add(const IntSetVal* s);
+    /// Add range \a min..\a max to the current operation
+    void add(IntVal min, IntVal max);
+    /// Return whether the current result is known to be empty
+    bool empty(void) const;
+    /// Allocate the result of the current operation
+    IntSetVal* result(void);
+
+    /// Return the union of \a s0 and \a s1
+    IntSetVal* unionSet(const IntSetVal* s0, const IntSetVal* s1);
+    /// Return the intersection of \a s0 and \a s1
+    IntSetVal* interSet(const IntSetVal* s0, const IntSetVal* s1);
+    /// Return the difference of \a s0 and \a s1
+    IntSetVal* diffSet(const IntSetVal* s0, const IntSetVal* s1);
+    /// Return the symmetric difference of \a s0 and \a s1
+    IntSetVal* symdiffSet(const IntSetVal* s0, const IntSetVal* s1);
+    /// Return the set of values in \a v (which may contain duplicates)
+    IntSetVal* fromValues(const std::vector<IntVal>& v);
+  };
+
+}
+
+#endif
@@ -0,0 +1,194 @@
+/* -*- mode: C++; c-basic-offset: 2; indent-tabs-mode: nil -*- */
+
+/*
+ *  Main authors:
+ *     agent <agent@local>
+ */
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __MINIZINC_LIBRARY_INDEX_HH__
+#define __MINIZINC_LIBRARY_INDEX_HH__
+
+#include <minizinc/model.hh>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace MiniZinc {
+
+  /**
+   * \brief Index of the library files
+   *
+   * For each library file, the index records the functions and predicates
+   * the file defines, the functions it calls, and the files it includes.
+   * The parser uses it to parse only the library files that define
+   * functions the model can reach (see LazyLibrary).
+   *
+   * The index is kept in a text file between runs. Entries are looked up
+   * by the full path of the library file, and ignored if the size or
+   * modification time of the file changed since they were recorded.
+   */
+  class LibraryIndex {
+  public:
+    /// What the index records about a library file
+    struct Entry {
+      /// Size of the file
+      long long size;
+      /// Modification time of the file
+      long long mtime;
+      /// Whether the file only contains functions, predicates and includes
+      bool pure;
+      /// Identifiers of the functions and predicates defined in the file
+      std::vector<std::string> defines;
+      /// Identifiers of the functions and operators called in the file
+      std::vector<std::string> calls;
+      /// Files included by the file, as written in the include items
+      std::vector<std::string> includes;
+    };
+  protected:
+    typedef UNORDERED_NAMESPACE::unordered_map<std::string,Entry> Entries;
+    /// The file the index is kept in (or empty)
+    std::string _filename;
+    /// The entries, by full path of the library file
+    Entries _entries;
+    /// Whether entries were added since the index was loaded
+    bool _modified;
+  public:
+    /// Load the index kept in \a filename (no file if empty)
+    LibraryIndex(const std::string& filename);
+    /// Return default file for the index (or an empty string)
+    static std::string defaultFilename(void);
+    /// Write the index back to its file if it was modified, return false on failure
+    bool save(void);
+
+    /// Return up-to-date entry for the library file \a path, or NULL
+    const Entry* find(const std::string& path) const;
+    /// Record the items of model \a m, parsed from library file \a path
+    const Entry* add(const std::string& path, Model* m);
+
+    /// Add the identifiers of the functions and operators called by the items of \a m to \a calls
+    static void collectCalls(Model* m, std::vector<std::string>& calls);
+  };
+
+  /**
+   * \brief Demand-driven parsing of library files
+   *
+   * The parser asks whether each library file should be deferred. A file
+   * that only defines functions and predicates is deferred if the index
+   * has an entry for it, unless it is included (directly or indirectly) by
+   * stdlib.mzn, whose functions the compiler uses implicitly. Once the model
+   * and data have been parsed, resolve() returns the deferred files that
+   * define, or include files that define, functions called by the parsed
+   * models, and the parser then parses these files (deferring their
+   * includes in turn), until no more files are needed.
+   *
+   * A deferred file that is never needed stays an empty model, so it is
+   * neither typechecked nor flattened. A function is needed if it is called,
+   * or if its name is that of a called function followed by "_reif", as
+   * the flattener looks up reified versions by name.
+   */
+  class LazyLibrary {
+  protected:
+    /// A deferred file
+    struct Deferred {
+      /// Directory of the including file
+      std::string parentPath;
+      /// The (empty) model of the file
+      Model* m;
+      /// Full path of the file
+      std::string fullname;
+    };
+    /// The index (or NULL if parsing is not demand-driven)
+    LibraryIndex* _index;
+    /// Library search path
+    std::vector<std::string> _includePaths;
+    /// Models of stdlib.mzn and the files it includes
+    UNORDERED_NAMESPACE::unordered_set<Model*> _core;
+    /// Files that have been deferred and not yet parsed
+    std::vector<Deferred> _deferred;
+    /// Models of deferred files that are needed after all
+    UNORDERED_NAMESPACE::unordered_set<Model*> _needed;
+    /// Parsed models that are not library files
+    std::vector<Model*> _userModels;
+    /// Identifiers of the functions called by the parsed files
+    UNORDERED_NAMESPACE::unordered_set<std::string> _used;
+    /// Whether library file \a path defines (or includes a file that defines) a used function
+    bool needed(const std::string& path, UNORDERED_NAMESPACE::unordered_map<std::string,bool>& memo);
+  public:
+    /// Constructor (not demand-driven if \a index is NULL)
+    LazyLibrary(LibraryIndex* index, const std::vector<std::string>& includePaths);
+    /// Whether \a m, found in library file \a fullname, should be deferred
+    bool defer(const std::string& parentPath, Model* m, const std::string& fullname);
+    /// Record that \a m was parsed from \a fullname (a library file if \a inLibrary)
+    void parsed(Model* m, const std::string& fullname, bool inLibrary);
+    /// Add the deferred files that are needed to \a files, return whether there were any
+    bool resolve(std::vector<std::pair<std::string,Model*> >& files);
+    /// Number of files that were deferred and never parsed
+    unsigned int skipped(void) const { return static_cast<unsigned int>(_deferred.size()); }
+    /// Number of files that were deferred and parsed later
+    unsigned int resolved(void) const { return static_cast<unsigned int>(_needed.size()); }
+  };
+
+  /**
+   * \brief Parsed library files kept between runs of the parser
+   *
+   * A process that compiles many models with the same library (such as the
+   * compiler server) keeps a copy of the items of each library file it
+   * parsed. The parser then copies the items of an up-to-date cached file
+   * into the model, instead of reading and parsing the file again. The
+   * copies are made right after parsing, before the items are typechecked,
+   * so compiling a model never changes the cached items.
+   *
+   * A process that compiles a single model with a cache it inherited, like
+   * the request processes forked by the compiler server, can instead take
+   * the cached items themselves (see take()), which avoids copying them.
+   */
+  class LibraryCache {
+  protected:
+    /// A cached file
+    struct Entry {
+      /// Size of the file
+      long long size;
+      /// Modification time of the file
+      long long mtime;
+      /// Copies of the items of the file (includes without their models)
+      Model* m;
+    };
+    typedef UNORDERED_NAMESPACE::unordered_map<std::string,Entry> Entries;
+    /// The cached files, by full path
+    Entries _entries;
+    /// Number of lookups that found an up-to-date file
+    unsigned int _hits;
+    /// Whether the items are handed out instead of copied
+    bool _take;
+    /// Models whose items have been handed out
+    std::vector<Model*> _taken;
+  public:
+    /// Constructor
+    LibraryCache(void);
+    /// Destructor
+    ~LibraryCache(void);
+    /// Return the cached items of library file \a path if up to date, or NULL
+    ///
+    /// Unless take() was called, the items must be copied. Otherwise, the
+    /// file is removed from the cache, and the items can be used directly.
+    Model* find(const std::string& path);
+    /// Keep a copy of the items of model \a m, parsed from library file \a path
+    void add(EnvI& env, const std::string& path, Model* m);
+    /// Hand out the cached items themselves from now on
+    void take(void) { _take = true; }
+    /// Whether the items returned by find() must be copied
+    bool mustCopy(void) const { return !_take; }
+    /// Number of cached files
+    unsigned int size(void) const { return static_cast<unsigned int>(_entries.size()); }
+    /// Number of lookups that found an up-to-date file
+    unsigned int hits(void) const { return _hits; }
+  };
+
+}
+
+#endif
@@ -142,6 +142,11 @@ namespace MiniZinc {
     
     /// Remove all items marked as removed
     void compact(void);
+    /// Remove the items marked as removed, and add them to \a removed
+    ///
+    /// If \a onlyConstraints is true, other removed items stay in place.
+    void compact(UNORDERED_NAMESPACE::unordered_set<Item*>& removed,
+                 bool onlyConstraints);
   };
 
   class VarDeclIterator {
@@ -47,6 +47,9 @@ namespace MiniZinc {
     
     /// Clear all entries
     void clear(void);
+    
+    /// Remove the items in \a removed from all occurrence lists
+    void remove(const Items& removed);
   };
   
   class CollectOccurrencesE : public EVisitor {
@@ -106,12 +106,22 @@ namespace MiniZinc {
 
   };
 
+  class LibraryIndex;
+  class LibraryCache;
+
+  /// Parse model files \a filename and data files \a datafiles
+  ///
+  /// If \a libIndex is not NULL, library files that do not define
+  /// functions the model uses are not parsed (see LazyLibrary). If
+  /// \a libCache is not NULL, library files are copied from the cache
+  /// when possible, and added to it when parsed.
   Model* parse(Env& env,
                const std::vector<std::string>& filename,
                const std::vector<std::string>& datafiles,
                const std::vector<std::string>& includePaths,
                bool ignoreStdlib, bool parseDocComments, bool verbose,
-               std::ostream& err);
+               std::ostream& err, LibraryIndex* libIndex = NULL,
+               LibraryCache* libCache = NULL);
 
   Model* parseFromString(const std::string& model,
                          const std::string& filename,
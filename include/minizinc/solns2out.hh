@@ -19,6 +19,7 @@
 #include <ctime>
 #include <memory>
 #include <iomanip>
+#include <cstdio>
 
 #include <minizinc/model.hh>
 #include <minizinc/parser.hh>
@@ -45,6 +46,8 @@ namespace MiniZinc {
 
     typedef std::pair<VarDecl*, KeepAlive> DE;
     ASTStringMap<DE>::t declmap;
+    /// Entries of declmap in the order of the output model
+    std::vector<DE*> outputDecls;
     Expression* outputExpr = NULL;
     bool fNewSol2Print = false;     // should be set for evalOutput to work
     
@@ -61,6 +64,7 @@ namespace MiniZinc {
       int flag_ignore_lines = 0;
       bool flag_unique = 0;
       bool flag_canonicalize = 0;
+      int flag_canonicalize_memory = 256;
       std::string flag_output_noncanonical;
       std::string flag_output_raw;
       int flag_number_output = -1;
@@ -122,6 +126,11 @@ namespace MiniZinc {
     virtual bool evalStatus(SolverInstance::Status status);
 
     virtual void printStatistics(std::ostream& );
+
+    /// Return number of solutions printed (or buffered for canonical output)
+    int getNSolns() const { return nSolns; }
+    /// Return number of duplicate solutions suppressed by --unique or --canonicalize
+    int getNDuplicates() const { return nDuplicates; }
     
     virtual Env* getEnv() const { assert(pEnv); return pEnv; }
     virtual Model* getModel() const { assert(getEnv()->output()); return getEnv()->output(); }
@@ -133,7 +142,25 @@ namespace MiniZinc {
     std::unique_ptr<std::ostream> pOfs_non_canon;
     std::unique_ptr<std::ostream> pOfs_raw;
     int nSolns = 0;
-    std::set<std::string> sSolsCanon;
+    int nDuplicates = 0;
+
+    /// 128-bit fingerprint of the values assigned to the output variables
+    struct Fingerprint {
+      unsigned long long h1;
+      unsigned long long h2;
+      bool operator ==(const Fingerprint& f) const { return h1==f.h1 && h2==f.h2; }
+    };
+    struct FingerprintHash {
+      size_t operator()(const Fingerprint& f) const { return static_cast<size_t>(f.h1); }
+    };
+    /// Fingerprints of the solutions seen so far
+    UNORDERED_NAMESPACE::unordered_set<Fingerprint,FingerprintHash> sSolsSeen;
+    /// Rendered solutions buffered for canonical output
+    std::vector<std::string> vSolsCanon;
+    /// Size of the buffered solutions in bytes
+    size_t nBytesCanon = 0;
+    /// Sorted runs of buffered solutions spilled to temporary files
+    std::vector<FILE*> vRunsCanon;
     std::string line_part;   // non-finished line from last chunk
 
   protected:
@@ -147,6 +174,10 @@ namespace MiniZinc {
     void restoreDefaults();
     /// Parsing fznsolver's complete raw text output
     void parseAssignments( std::string& );
+    /// Compute fingerprint of the current assignment to the output variables
+    Fingerprint fingerprintOutput();
+    /// Sort the buffered solutions and write them to a temporary file
+    void spillCanon();
     
     virtual bool __evalOutput(std::ostream& os, bool flag_flush);
     virtual bool __evalOutputFinal( bool flag_flush );
@@ -78,6 +78,8 @@ namespace MiniZinc {
     virtual bool processOption(int& i, int argc, const char** argv) { return false; }
 
     virtual std::string getVersion( ) { return "Abstract solver v0.-1"; }
+    /// Short name of the solver, used to select it with --portfolio
+    virtual std::string getId( ) { return "abstract"; }
     virtual void printHelp(std::ostream& ) { }
   };  // SolverFactory
   
@@ -94,6 +96,8 @@ namespace MiniZinc {
     /// global options
     bool flag_verbose=0;
     bool flag_statistics=0;
+    /// Ids of the solvers raced in portfolio mode (empty if not racing)
+    std::vector<std::string> portfolio;
     
     /// solver options, not used    TODO
     Options options_solver;          // currently can create solver object only after flattening
@@ -117,7 +121,12 @@ namespace MiniZinc {
     virtual bool get_flag_verbose() { return flag_verbose; /*getFlt()->get_flag_verbose();*/ }
     virtual bool get_flag_statistics() { return flag_statistics; }
     
-  private:
+  protected:
+    /// Race the solvers of the portfolio on the flat model, each in a child
+    /// process, merging their solutions into s2out
+    virtual void solvePortfolio();
+    /// Return the linked solver factory called \a id (or NULL)
+    SolverFactory* findSolverFactory(const std::string& id);
   };
 
 }
@@ -12,7 +12,9 @@
 #ifndef __MINIZINC_SOLVER_INSTANCE_BASE_HH__
 #define __MINIZINC_SOLVER_INSTANCE_BASE_HH__
 
+#include <atomic>
 #include <iostream>
+#include <limits>
 
 #include <minizinc/model.hh>
 #include <minizinc/flatten.hh>
@@ -24,12 +26,55 @@
 
 namespace MiniZinc {
 
+  /**
+   * \brief Objective bound shared by solvers racing on the same flat model
+   *
+   * Solvers publish the objective values of their solutions, and solvers
+   * that support it only search for solutions improving on the bound. The
+   * object contains no pointers, so it can be placed in memory shared between
+   * processes.
+   */
+  class SharedObjectiveBound {
+  protected:
+    /// Best objective value published so far
+    std::atomic<double> _value;
+    /// Whether the objective is minimized
+    bool _minimize;
+  public:
+    /// Create bound for a minimization (or maximization) problem
+    SharedObjectiveBound(bool minimize)
+      : _value(minimize ? std::numeric_limits<double>::infinity()
+                        : -std::numeric_limits<double>::infinity()),
+        _minimize(minimize) {}
+    /// Whether the objective is minimized
+    bool minimize(void) const { return _minimize; }
+    /// Whether \a v is better than \a w
+    bool better(double v, double w) const { return _minimize ? v < w : v > w; }
+    /// Publish objective value \a v, return whether it improved the bound
+    bool improve(double v) {
+      double cur = _value.load();
+      while (better(v, cur)) {
+        if (_value.compare_exchange_weak(cur, v))
+          return true;
+      }
+      return false;
+    }
+    /// Store the bound in \a v, return false if no value has been published
+    bool get(double& v) const {
+      v = _value.load();
+      return v != std::numeric_limits<double>::infinity() &&
+             v != -std::numeric_limits<double>::infinity();
+    }
+  };
+
   /// An abstract SI
   class SolverInstanceBase {
   protected:
     Env& _env;
     Options _options;
     Solns2Out* pS2Out=0;
+    /// Objective bound shared with other solvers (or NULL)
+    SharedObjectiveBound* _sharedBound=0;
     
   public:
     typedef SolverInstance::Status Status;
@@ -51,6 +96,23 @@ namespace MiniZinc {
     Solns2Out* getSolns2Out() const { assert(pS2Out); return pS2Out; }
     void setSolns2Out(Solns2Out* s2o) { pS2Out = s2o; }
 
+    /// Share objective bounds with other solvers through \a b
+    /// (must be set before processFlatZinc)
+    virtual void setSharedBound(SharedObjectiveBound* b) { _sharedBound = b; }
+    SharedObjectiveBound* getSharedBound() const { return _sharedBound; }
+    /// Store the objective value of the last solution in \a v, return false
+    /// for satisfaction problems or if the solver does not report it
+    virtual bool getObjectiveValue(double& v) { return false; }
+    /// Optimise \a obj in direction \a st (instead of the objective of the
+    /// solve item) from the next reset on, return false if not supported
+    virtual bool setObjective(SolveI::SolveType st, Id* obj) { return false; }
+    /// Publish the objective value of the last solution to the shared bound
+    void publishObjective(void) {
+      double v;
+      if (_sharedBound && getObjectiveValue(v))
+        _sharedBound->improve(v);
+    }
+
     virtual void printSolution();
 //     virtual void printSolution(ostream& );  // deprecated
     /// print statistics in form of comments
@@ -63,6 +125,14 @@ namespace MiniZinc {
     virtual void processFlatZinc(void) = 0;
     /// solve the problem instance (according to the solve specification in the flatzinc model)
     virtual Status solve(void);
+    /// whether the solve item has a lex_objectives annotation
+    bool hasLexObjectives(void);
+    /// solve the objective of the solve item and then the objectives of its
+    /// lex_objectives annotation, fixing each optimum as a permanent constraint
+    /// before optimising the next objective. The optimal solution of each
+    /// level is printed; returns OPT if all levels have been solved to
+    /// optimality, SAT if some solution has been printed
+    Status solveLexicographic(void);
     /// return reason for status given by solve
     virtual StatusReason reason(void) {return _status_reason;}
     virtual Status status(void) {return _status;}
@@ -70,11 +140,13 @@ namespace MiniZinc {
 
     /// reset the model to its core (removing temporary cts) and the solver to the root node of the search 
     void reset(void);
-    /// reset the solver to the root node of the search TODO: difference between reset() and resetSolver()?
+    /// reset the solver to the root node of the search, removing all temporary
+    /// variables and constraints (the core is the model given to processFlatZinc
+    /// plus all permanent constraints)
     virtual void resetSolver(void) = 0;
-    /// reset the solver and add temporary constraints given by the iterator
+    /// reset the solver and add the temporary variables and constraints of the flat items in [\a begin, \a end)
     virtual void resetWithConstraints(Model::iterator begin, Model::iterator end);
-    /// add permanent constraints given by the iterator to the solver instance
+    /// add the variables and constraints of the flat items in [\a begin, \a end) permanently to the core
     virtual void processPermanentConstraints(Model::iterator begin, Model::iterator end);
   protected:
     /// flatten the search annotations, pushing them into the vector \a out
@@ -100,9 +172,36 @@ namespace MiniZinc {
   protected:
     std::vector<VarDecl*> _varsWithOutput;    // this is to extract fzn vars. Identical to output()?  TODO
 
+    /// Precompiled extraction of the solution value of one output variable
+    struct OutputEntry {
+      /// Declaration in the flat model
+      VarDecl* flat;
+      /// Declaration in the output model
+      VarDecl* output;
+      /// Whether the variable is an output array
+      bool isArray;
+      /// Index sets of the output array
+      std::vector<std::pair<int,int> > dims;
+      /// Elements of the output array (literals, or identifiers of variables)
+      std::vector<Expression*> elems;
+      /// Positions of the array elements that are variables
+      std::vector<unsigned int> vars;
+    };
+    /// Extraction plan for all output variables
+    std::vector<OutputEntry> _outputPlan;
+    /// Solns2Out object the plan has been compiled for
+    Solns2Out* _outputPlanS2Out;
+    /// Buffer for the elements of an output array
+    std::vector<Expression*> _outputElems;
+    /// Compile the extraction plan (done once, when the first solution is assigned)
+    void compileOutputPlan();
+    /// Discard the extraction plan, so that it is compiled again for the next
+    /// solution (to be called by resetSolver, since the flat model may have changed)
+    void resetOutputPlan(void) { _outputPlan.clear(); _outputPlanS2Out = NULL; }
+
   public:
     SolverInstanceBase2(Env& env, const Options& options=Options())
-      : SolverInstanceBase(env, options) {}
+      : SolverInstanceBase(env, options), _outputPlanS2Out(NULL) {}
   };
   
   typedef void (*poster) (SolverInstanceBase&, const Call* call);
@@ -44,6 +44,11 @@ class MIP_cplex_wrapper : public MIP_wrapper {
     /// actual adding new variables to the solver
     virtual void doAddVars(size_t n, double *obj, double *lb, double *ub,
       VarType *vt, std::string *names);
+    /// actual removal of rows/columns from the solver
+    virtual void doRemoveRows(int first, int n);
+    virtual void doRemoveCols(int first, int n);
+    /// actual change of objective coefficients in the solver
+    virtual void doSetObjCoefs(int n, int *ind, double *obj);
 
     /// adding a linear constraint
     virtual void addRow(int nnz, int *rmatind, double* rmatval,
@@ -0,0 +1,58 @@
+/* -*- mode: C++; c-basic-offset: 2; indent-tabs-mode: nil -*- */
+
+/*
+ *  Main authors:
+ *     agent <agent@local>
+ */
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __MINIZINC_MIP_CUTPOOL_H__
+#define __MINIZINC_MIP_CUTPOOL_H__
+
+#include <minizinc/solvers/MIP/MIP_wrap.hh>
+
+#include <vector>
+
+namespace MiniZinc {
+
+  /// Candidate cuts of one separation round, collected from all generators
+  class CutPool {
+  public:
+    struct Options {
+      /// Maximal number of cuts returned per round, 0 for all
+      int nMaxCuts = 0;
+      /// Minimal violation of a returned cut
+      double dMinViol = 0.01;
+    };
+    /// Counters of a series of rounds
+    struct Statistics {
+      long long nRounds = 0;
+      long long nCandidates = 0;
+      long long nDuplicates = 0;
+      long long nAdded = 0;
+      /// Time spent in the separation callback
+      double dTimeMs = 0.0;
+    };
+    /// The candidates, filled by CutGen::generate
+    MIP_wrapper::CutInput cands;
+    /// Move the most violated distinct candidates for \a x into \a cutsOut,
+    /// updating \a stats
+    void select(const double* x, int nCols, const Options& opts,
+                MIP_wrapper::CutInput& cutsOut, Statistics& stats);
+  private:
+    /// Violation of each candidate
+    std::vector<double> viol;
+    /// Sort the indices of cut \a i and merge repeated variables
+    void normalize(size_t i);
+    /// Hash of the normalized cut \a i
+    size_t hash(size_t i) const;
+    /// Whether normalized cuts \a i and \a j are the same
+    bool same(size_t i, size_t j) const;
+  };
+
+}
+
+#endif
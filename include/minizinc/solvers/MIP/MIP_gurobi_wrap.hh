@@ -47,6 +47,10 @@ class MIP_gurobi_wrapper : public MIP_wrapper {
     int (__stdcall *dll_GRBcblazy) (void *cbdata, int lazylen, const int *lazyind,
                           const double *lazyval, char lazysense, double lazyrhs);
 
+    int (__stdcall *dll_GRBdelconstrs) (GRBmodel *model, int len, int *ind);
+
+    int (__stdcall *dll_GRBdelvars) (GRBmodel *model, int len, int *ind);
+
     void (__stdcall *dll_GRBfreeenv) (GRBenv *env);
 
     int (__stdcall *dll_GRBfreemodel) (GRBmodel *model);
@@ -76,6 +80,9 @@ class MIP_gurobi_wrapper : public MIP_wrapper {
                                    int (__stdcall *cb)(CB_ARGS),
                                    void  *usrdata);
 
+    int (__stdcall *dll_GRBsetdblattrlist) (GRBmodel *model, const char *attrname,
+                    int len, int *ind, double *newvalues);
+
     int (__stdcall *dll_GRBsetdblparam) (GRBenv *env, const char *paramname, double value);
 
     int (__stdcall *dll_GRBsetintparam) (GRBenv *env, const char *paramname, int value);
@@ -114,6 +121,11 @@ class MIP_gurobi_wrapper : public MIP_wrapper {
     /// actual adding new variables to the solver
     virtual void doAddVars(size_t n, double *obj, double *lb, double *ub,
       VarType *vt, string *names);
+    /// actual removal of rows/columns from the solver
+    virtual void doRemoveRows(int first, int n);
+    virtual void doRemoveCols(int first, int n);
+    /// actual change of objective coefficients in the solver
+    virtual void doSetObjCoefs(int n, int *ind, double *obj);
 
     /// adding a linear constraint
     virtual void addRow(int nnz, int *rmatind, double* rmatval,
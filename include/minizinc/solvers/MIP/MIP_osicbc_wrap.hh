@@ -61,6 +61,11 @@ class MIP_osicbc_wrapper : public MIP_wrapper {
     /// actual adding new variables to the solver
     virtual void doAddVars(size_t n, double *obj, double *lb, double *ub,
       VarType *vt, string *names);
+    /// actual removal of rows/columns from the solver
+    virtual void doRemoveRows(int first, int n);
+    virtual void doRemoveCols(int first, int n);
+    /// actual change of objective coefficients in the solver
+    virtual void doSetObjCoefs(int n, int *ind, double *obj);
     
     void addPhase1Vars() {
       if (fVerbose)
@@ -86,9 +91,8 @@ class MIP_osicbc_wrapper : public MIP_wrapper {
       return osi.getNumCols();
     }
     virtual int getNRows() {
-      if (rowlb.size())
-        return rowlb.size();
-      return osi.getNumRows();
+      /// rows are buffered until solve()
+      return osi.getNumRows() + rowlb.size();
     }
                         
 //     void setObjUB(double ub) { objUB = ub; }
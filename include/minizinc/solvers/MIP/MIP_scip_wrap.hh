@@ -51,6 +51,19 @@ class MIP_scip_wrapper : public MIP_wrapper {
     }
     virtual SCIP_RETCODE doAddVars_SCIP(size_t n, double *obj, double *lb, double *ub,
       VarType *vt, string *names);
+    /// actual removal of rows/columns from the solver
+    virtual void doRemoveRows(int first, int n) {
+      wrap_assert(doRemoveRows_SCIP(first, n));
+    }
+    virtual SCIP_RETCODE doRemoveRows_SCIP(int first, int n);
+    virtual void doRemoveCols(int first, int n) {
+      wrap_assert(doRemoveCols_SCIP(first, n));
+    }
+    virtual SCIP_RETCODE doRemoveCols_SCIP(int first, int n);
+    virtual void doSetObjCoefs(int n, int *ind, double *obj) {
+      wrap_assert(doSetObjCoefs_SCIP(n, ind, obj));
+    }
+    virtual SCIP_RETCODE doSetObjCoefs_SCIP(int n, int *ind, double *obj);
 
     /// adding a linear constraint
     virtual void addRow(int nnz, int *rmatind, double* rmatval,
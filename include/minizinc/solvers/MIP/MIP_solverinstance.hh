@@ -15,6 +15,9 @@
 #include <minizinc/flattener.hh>
 #include <minizinc/solver.hh>
 #include <minizinc/solvers/MIP/MIP_wrap.hh>
+#include <minizinc/solvers/MIP/MIP_cutpool.hh>
+
+#include <mutex>
 
 namespace MiniZinc {
   
@@ -36,7 +39,9 @@ namespace MiniZinc {
     virtual ~CutGen() { }
     /// Say what type of cuts
     virtual int getMask() { return MIP_wrapper::MaskConsType_Usercut; }
-    /// Adds new cuts to the 2nd parameter
+    /// Adds candidate cuts for the (read-only) solution in the 1st parameter
+    /// to the 2nd parameter. Any number of candidates can be added, they need
+    /// not be violated: the CutPool filters and selects them
     virtual void generate(const MIP_wrapper::Output&, MIP_wrapper::CutInput&) = 0;
     virtual void print( std::ostream& ) { }
   };
@@ -58,6 +63,27 @@ namespace MiniZinc {
       
       const unique_ptr<MIP_wrapper> mip_wrap;
       vector< unique_ptr<CutGen> > cutGenerators;
+      /// selection of the cuts, and counters over all callbacks
+      CutPool::Options cutPoolOptions;
+      CutPool::Statistics cutStats;
+      /// protects cutStats when the solver calls back from several threads
+      std::mutex cutStatsMutex;
+
+      /// size of the model without temporary constraints, restored by resetSolver()
+      int nRootRows=0, nRootCols=0;
+      size_t nRootCutGens=0;
+      Status rootStatus=SolverInstance::UNKNOWN;
+      /// the variables added by resetWithConstraints
+      vector<Id*> tempVars;
+      /// direction of the current objective (that of the solve item unless changed by setObjective)
+      SolveI::SolveType objType=SolveI::SolveType::ST_SAT;
+
+      /// create the MIP variable for \a vd
+      void processVarDecl(VarDecl* vd, VarDecl* objVd);
+      /// post the variables and constraints of the items in [\a begin, \a end), recording the variables in \a vars if not NULL
+      void processItems(Model::iterator begin, Model::iterator end, vector<Id*>* vars);
+      /// remember the current model as the root
+      void markRoot();
       
     public:
       void registerCutGenerator( unique_ptr<CutGen>&& pCG ) {
@@ -70,9 +96,10 @@ namespace MiniZinc {
       double dObjVarLB=-1e300, dObjVarUB=1e300;
     public:
 
-      MIP_solverinstance(Env& env) :
+      MIP_solverinstance(Env& env, const CutPool::Options& cpo = CutPool::Options()) :
         SolverInstanceImpl(env),
-        mip_wrap(GETMIPWRAPPER)
+        mip_wrap(GETMIPWRAPPER),
+        cutPoolOptions(cpo)
       {
         assert(mip_wrap.get()); 
         registerConstraints();
@@ -82,7 +109,11 @@ namespace MiniZinc {
       virtual Status next(void) { assert(0); return SolverInstance::UNKNOWN; }
       virtual void processFlatZinc(void);
       virtual Status solve(void);
-      virtual void resetSolver(void) { }
+      virtual bool getObjectiveValue(double& v);
+      virtual bool setObjective(SolveI::SolveType st, Id* obj);
+      virtual void resetSolver(void);
+      virtual void resetWithConstraints(Model::iterator begin, Model::iterator end);
+      virtual void processPermanentConstraints(Model::iterator begin, Model::iterator end);
       
       virtual void genCuts
         ( const MIP_wrapper::Output& , MIP_wrapper::CutInput& , bool fMIPSol);
@@ -103,13 +134,15 @@ namespace MiniZinc {
   };  // MIP_solverinstance
   
   class MIP_SolverFactory: public SolverFactory {
+    CutPool::Options cutPoolOptions;
   public:
-    SolverInstanceBase* doCreateSI(Env& env)   { return new MIP_solverinstance(env); }
+    SolverInstanceBase* doCreateSI(Env& env)
+      { return new MIP_solverinstance(env, cutPoolOptions); }
     
-    bool processOption(int& i, int argc, const char** argv)
-      { return MIP_WrapperFactory::processOption(i, argc, argv); }
+    bool processOption(int& i, int argc, const char** argv);
     string getVersion( );
-    void printHelp(std::ostream& os) { MIP_WrapperFactory::printHelp(os); }
+    string getId( ) { return "mip"; }
+    void printHelp(std::ostream& os);
   };
 
 }
@@ -19,19 +19,31 @@
 #include <iostream>
 #include <sstream>
 #include <cassert>
+#include <stdexcept>
 
 
 /// Facilitate lhs computation of a cut
+/// Four independent partial sums break the dependency chain of the additions,
+/// so that the gathers and multiplications can be pipelined or vectorised
 inline
 double computeSparse( int n, const int* ind, const double* coef, const double* dense, int nVarsDense ) {
-  assert( ind && coef && dense );
-  double val=0.0;
-  for ( int i=0; i<n; ++i ) {
+  assert( n==0 || ( ind && coef && dense ) );
+  double v0=0.0, v1=0.0, v2=0.0, v3=0.0;
+  int i=0;
+  for ( ; i+4<=n; i+=4 ) {
+    assert( ind[i]>=0 && ind[i]<nVarsDense && ind[i+1]>=0 && ind[i+1]<nVarsDense );
+    assert( ind[i+2]>=0 && ind[i+2]<nVarsDense && ind[i+3]>=0 && ind[i+3]<nVarsDense );
+    v0 += coef[i] * dense[ ind[i] ];
+    v1 += coef[i+1] * dense[ ind[i+1] ];
+    v2 += coef[i+2] * dense[ ind[i+2] ];
+    v3 += coef[i+3] * dense[ ind[i+3] ];
+  }
+  for ( ; i<n; ++i ) {
     assert( ind[i]>=0 );
     assert( ind[i]<nVarsDense );
-    val += coef[i] * dense[ ind [ i ] ];
+    v0 += coef[i] * dense[ ind[i] ];
   }
-  return val;
+  return (v0+v1)+(v2+v3);
 }
 
 class MIP_wrapper;
@@ -123,7 +135,7 @@ class MIP_wrapper {
         rmatind.push_back( i );
         rmatval.push_back( c );
       }
-      double computeViol( const double* x, int nCols ) {
+      double computeViol( const double* x, int nCols ) const {
         double lhs = computeSparse( rmatind.size(), rmatind.data(), rmatval.data(), x, nCols );
         if ( LQ==sense ) {
           return lhs-rhs;
@@ -203,6 +215,18 @@ class MIP_wrapper {
     /// actual adding new variables to the solver. "Updates" the model (e.g., Gurobi). No direct use
     virtual void doAddVars(size_t n, double *obj, double *lb, double *ub,
       VarType *vt, std::string *names) = 0;
+    /// actual removal of the rows [first, first+n) from the solver. No direct use
+    virtual void doRemoveRows(int first, int n) {
+      throw std::runtime_error("  MIP_wrapper: this solver does not support removing constraints");
+    }
+    /// actual removal of the columns [first, first+n) from the solver. No direct use
+    virtual void doRemoveCols(int first, int n) {
+      throw std::runtime_error("  MIP_wrapper: this solver does not support removing variables");
+    }
+    /// actual change of the objective coefficients of the columns \a ind to \a obj. No direct use
+    virtual void doSetObjCoefs(int n, int *ind, double *obj) {
+      throw std::runtime_error("  MIP_wrapper: this solver does not support changing the objective");
+    }
 
   public:
     /// debugging stuff
@@ -221,6 +245,8 @@ class MIP_wrapper {
       return res;
     }
     int nLitVars=0;
+    /// columns of the literal variables, in the order they were added
+    std::vector<VarId> litVarCols;
     /// adding a literal as a variable. Should not happen in feasible models
     virtual VarId addLitVar(double v) {
       // Cannot do this: at least CBC does not support duplicated indexes    TODO??
@@ -239,6 +265,7 @@ class MIP_wrapper {
         addVar(res);
 //       cerr << "  AddLitVar " << v << "   (PROBABLY WRONG)" << endl;
       sLitValues[v] = res;
+      litVarCols.push_back(res);
       return res;
     }
     /// adding all local variables upfront. Makes sure it's called only once
@@ -259,6 +286,49 @@ class MIP_wrapper {
                         int mask = MaskConsType_Normal,
                         std::string rowName = "") = 0;
     int nAddedRows = 0;   // for name counting
+    /// remove all rows and columns added after the model had \a nRows rows
+    /// and \a nCols columns, used to roll back temporary constraints.
+    /// Cuts and lazy constraints in separate pools are not removed
+    virtual void restoreModel(int nRows, int nCols) {
+      int nr = getNRows();
+      if (nr > nRows)
+        doRemoveRows(nRows, nr-nRows);
+      if (colObj.size() > (size_t)nCols) {
+        if (fPhase1Over)
+          doRemoveCols(nCols, colObj.size()-nCols);
+        colObj.resize(nCols);
+        colLB.resize(nCols);
+        colUB.resize(nCols);
+        colTypes.resize(nCols);
+        colNames.resize(nCols);
+        for (auto it = sLitValues.begin(); it != sLitValues.end(); ) {
+          if (it->second >= nCols)
+            it = sLitValues.erase(it);
+          else
+            ++it;
+        }
+        while (!litVarCols.empty() && litVarCols.back() >= nCols)
+          litVarCols.pop_back();
+        nLitVars = litVarCols.size();
+      }
+    }
+    /// make column \a j (with coefficient 1) the objective, used to optimise
+    /// lexicographic objectives one after the other on the same model
+    virtual void setObjective(VarId j) {
+      std::vector<int> ind;
+      std::vector<double> obj;
+      for (size_t i=0; i<colObj.size(); ++i) {
+        double c = ( (VarId)i == j ) ? 1.0 : 0.0;
+        if ( colObj[i] != c ) {
+          colObj[i] = c;
+          ind.push_back(i);
+          obj.push_back(c);
+        }
+      }
+      if (fPhase1Over && !ind.empty())
+        doSetObjCoefs(ind.size(), ind.data(), obj.data());
+      output.nObjVarIndex = j;
+    }
     /// adding an implication
 //     virtual void addImpl() = 0;
     virtual void setObjSense(int s) = 0;   // +/-1 for max/min
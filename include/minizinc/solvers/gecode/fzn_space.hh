@@ -76,11 +76,13 @@ namespace MiniZinc {
     bool _copyAuxVars;  
     /// solve type (SAT, MIN or MAX)
     MiniZinc::SolveI::SolveType _solveType;
+    /// Objective bound shared with other solvers (or NULL)
+    const SharedObjectiveBound* _sharedBound;
     
     /// copy constructor
     FznSpace(bool share, FznSpace&);
     /// standard constructor
-    FznSpace(void) : _optVarIsInt(true), _optVarIdx(-1), _copyAuxVars(true) {};
+    FznSpace(void) : _optVarIsInt(true), _optVarIdx(-1), _copyAuxVars(true), _sharedBound(NULL) {};
     ~FznSpace(void) {} 
             
     /// get the index of the Boolean variable in bv; return -1 if not exists
@@ -0,0 +1,103 @@
+/* -*- mode: C++; c-basic-offset: 2; indent-tabs-mode: nil -*- */
+
+/*
+ *  Main authors:
+ *     agent <agent@local>
+ */
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __MINIZINC_GECODE_LNS_HH__
+#define __MINIZINC_GECODE_LNS_HH__
+
+#include <gecode/search.hh>
+#include <minizinc/solvers/gecode/fzn_space.hh>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace MiniZinc {
+
+  /**
+   * \brief Large neighbourhood search over a Gecode space
+   *
+   * Each iteration copies the root space (including its branchers), fixes a
+   * random subset of the neighbourhood variables to their values in the
+   * incumbent solution, requires the objective to improve on the incumbent,
+   * and runs branch and bound on the result until a failure limit is
+   * reached. The best solution found becomes the new incumbent. The failure
+   * limits of the iterations follow a restart strategy. Several neighbourhoods
+   * of the same incumbent can be explored in parallel threads, in which case
+   * the best of their solutions is accepted.
+   */
+  class GecodeLNS {
+  public:
+    /// Sequence of failure limits
+    enum RestartStrategy { RS_CONSTANT, RS_LINEAR, RS_LUBY, RS_GEOMETRIC };
+    /// Parameters of the search
+    struct Options {
+      /// Probability (in percent) that a variable is fixed
+      unsigned int percentage;
+      /// Failure limit of the first iteration
+      unsigned int failLimit;
+      /// How the failure limit evolves over the iterations
+      RestartStrategy restart;
+      /// Factor of the geometric restart strategy
+      double restartBase;
+      /// Maximum number of iterations (0 for no limit)
+      unsigned int iterations;
+      /// Neighbourhoods explored in parallel in each iteration
+      unsigned int threads;
+      /// Seed of the random neighbourhood selection
+      unsigned int seed;
+      /// Time limit in milliseconds (0 for no limit)
+      unsigned int time;
+      /// Node limit (0 for no limit)
+      unsigned int nodes;
+      /// Whether to print statistics of each iteration
+      bool stats;
+      /// Default options
+      Options(void);
+    };
+  protected:
+    /// Stable root space with branchers
+    FznSpace* _root;
+    /// Indices of the integer neighbourhood variables in FznSpace::iv
+    std::vector<int> _iv;
+    /// Indices of the Boolean neighbourhood variables in FznSpace::bv
+    std::vector<int> _bv;
+    /// The options
+    Options _o;
+    /// Accumulated search statistics
+    Gecode::Search::Statistics _stat;
+    /// Number of iterations run
+    unsigned int _iterations;
+    /// Number of iterations that improved the incumbent
+    unsigned int _improvements;
+    /// Failure limit of iteration \a i
+    unsigned int failLimit(unsigned int i) const;
+  public:
+    /// Search neighbourhoods of \a root (which is not modified)
+    GecodeLNS(FznSpace* root, const std::vector<int>& iv,
+              const std::vector<int>& bv, const Options& o);
+    /// Improve \a incumbent and return the best solution found
+    ///
+    /// Takes ownership of \a incumbent. \a optimal is set if the search
+    /// proved that the result is optimal.
+    FznSpace* run(FznSpace* incumbent, bool& optimal, std::ostream& err);
+    /// Statistics of all iterations
+    const Gecode::Search::Statistics& statistics(void) const { return _stat; }
+    /// Number of iterations run
+    unsigned int iterations(void) const { return _iterations; }
+    /// Number of iterations that improved the incumbent
+    unsigned int improvements(void) const { return _improvements; }
+    /// Parse restart strategy \a s into \a r, return false if unknown
+    static bool parseRestart(const std::string& s, RestartStrategy& r);
+  };
+
+}
+
+#endif
@@ -209,8 +209,14 @@ namespace MiniZinc {
   public:
     /// the Gecode space that will be/has been solved
     FznSpace* _current_space; 
+    /// copy of the root space without branchers and temporary constraints (or NULL)
+    FznSpace* _root_space;
+    /// the variables added by resetWithConstraints
+    std::vector<Id*> _tempVars;
     /// the solution (or NULL if does not exist or not yet computed)
     FznSpace* _solution;
+    /// the objective set by setObjective (or NULL for the objective of the solve item)
+    Id* _objective;
     /// the variable declarations with output annotations
     std::vector<VarDecl*> _varsWithOutput;
     /// declaration map for processing and printing output
@@ -228,7 +234,11 @@ namespace MiniZinc {
     virtual Status next(void);    
     virtual void processFlatZinc(void);    
     virtual Status solve(void);
+    virtual bool getObjectiveValue(double& v);
+    virtual bool setObjective(SolveI::SolveType st, Id* obj);
     virtual void resetSolver(void);
+    virtual void resetWithConstraints(Model::iterator begin, Model::iterator end);
+    virtual void processPermanentConstraints(Model::iterator begin, Model::iterator end);
 
     // Presolve the currently loaded model, updating variables with the same
     // names in the given Model* m.
@@ -306,10 +316,21 @@ namespace MiniZinc {
     void registerConstraints(void);
     void registerConstraint(std::string name, poster p);
 
+    /// create the Gecode variable for \a vd in the current space
+    void processVarDecl(VarDecl* vd);
+    /// post the variables and constraints of the items in [\a begin, \a end), recording the variables in \a vars if not NULL
+    void processItems(Model::iterator begin, Model::iterator end, std::vector<Id*>* vars);
+    /// copy the current space to the root space unless it already exists or the space has failed
+    void saveRootSpace(void);
     /// creates the gecode branchers // TODO: what is decay, ignoreUnknown -> do we need all the args?
     void createBranchers(Annotation& ann, Expression* additionalAnn, int seed, double decay,
             bool ignoreUnknown, std::ostream& err);
     void prepareEngine(void);
+    /// collect the neighbourhood variables for large neighbourhood search,
+    /// and the percentage given by a relax_and_reconstruct annotation (if any)
+    void lnsVariables(std::vector<int>& iv, std::vector<int>& bv, int& percentage);
+    /// improve \a incumbent using large neighbourhood search within \a timeLeft ms (0 = no limit)
+    FznSpace* lns(FznSpace* incumbent, unsigned int timeLeft, bool& optimal);
     void setSearchStrategyFromAnnotation(std::vector<Expression*> flatAnn, 
                                                         std::vector<bool>& iv_searched, 
                                                         std::vector<bool>& bv_searched,
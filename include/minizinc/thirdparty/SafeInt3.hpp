@@ -142,8 +142,9 @@ Please read the leading comments before using the class.
         #define NEEDS_NULLPTR_DEFINED 0
         #endif
     #else
-    // Let everything else trigger based on whether we have nullptr_t
-    #if defined nullptr_t
+    // Let everything else trigger based on whether we have nullptr_t,
+    // which every C++11 compiler provides
+    #if defined nullptr_t || __cplusplus >= 201103L
         #define NEEDS_NULLPTR_DEFINED 0
         #else
         #define NEEDS_NULLPTR_DEFINED 1
@@ -12,6 +12,8 @@
 #ifndef __MINIZINC_TIMER_HH__
 #define __MINIZINC_TIMER_HH__
 
+#include <cstddef>
+
 #ifdef _WIN32
 #include <windows.h>
 #else
@@ -79,8 +79,12 @@ namespace MiniZinc {
   };
   
   /// Type check the model \a m
+  ///
+  /// Function bodies and constraint items are checked by \a nThreads
+  /// threads (0 for the number of hardware threads).
   void typecheck(Env& env, Model* m, std::vector<TypeError>& typeErrors,
-                 bool ignoreUndefinedParameters = false);
+                 bool ignoreUndefinedParameters = false,
+                 unsigned int nThreads = 1);
 
   /// Type check new assign item \a ai in model \a m
   void typecheck(Env& env, Model* m, AssignI* ai);
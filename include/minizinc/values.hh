@@ -17,6 +17,7 @@
 #include <minizinc/stl_map_set.hh>
 #include <minizinc/thirdparty/SafeInt3.hpp>
 #include <algorithm>
+#include <cmath>
 #include <functional>
 #include <vector>
 #include <string>
@@ -488,12 +489,12 @@ namespace std {
   inline
   MiniZinc::FloatVal floor(const MiniZinc::FloatVal& x) {
     if (!x.isFinite()) return x;
-    return floor(x.toDouble());
+    return std::floor(x.toDouble());
   }
   inline
   MiniZinc::FloatVal ceil(const MiniZinc::FloatVal& x) {
     if (!x.isFinite()) return x;
-    return ceil(x.toDouble());
+    return std::ceil(x.toDouble());
   }
 
   template<>
@@ -673,7 +674,8 @@ namespace MiniZinc {
     
     /// Mark for garbage collection
     void mark(void) {
-      _gc_mark = 1;
+      if (_gc_mark==0)
+        _gc_mark = 1;
     }
   };
   
@@ -860,7 +862,8 @@ namespace MiniZinc {
     
     /// Mark for garbage collection
     void mark(void) {
-      _gc_mark = 1;
+      if (_gc_mark==0)
+        _gc_mark = 1;
     }
   };
   
@@ -4,6 +4,27 @@ using namespace MiniZinc;
 using namespace std;
 
 
+VarDeclI*
+MznModel::findDecl(const char* const name)
+{
+  if (declIndex == NULL)
+    declIndex = new UNORDERED_NAMESPACE::unordered_map<string, VarDeclI*>;
+  // Items are only ever appended to _m, so only the new ones need to be indexed
+  for (; declIndexSize < _m->size(); declIndexSize++)
+    if (VarDeclI* vdi = (*_m)[declIndexSize]->dyn_cast<VarDeclI>())
+      declIndex->insert(make_pair(vdi->e()->id()->str().str(), vdi));
+  UNORDERED_NAMESPACE::unordered_map<string, VarDeclI*>::iterator it = declIndex->find(name);
+  return it == declIndex->end() ? NULL : it->second;
+}
+
+void
+MznModel::clearDeclIndex()
+{
+  delete declIndex;
+  declIndex = NULL;
+  declIndexSize = 0;
+}
+
 int
 MznModel::addData(const char* const name, PyObject* value)
 {
@@ -12,18 +33,13 @@ MznModel::addData(const char* const name, PyObject* value)
     PyErr_SetString(PyExc_TypeError, "MiniZinc: Model.addData: Received a NULL value");
     return -1;
   }
-  for (unsigned int i=0; i<_m->size(); i++) 
-    if (VarDeclI* vdi = (*_m)[i]->dyn_cast<VarDeclI>()) {
-      if (strcmp(vdi->e()->id()->str().c_str(), name) == 0) {
-        vector<pair<int, int> > dimList;
-        Type type;
-        Expression* rhs = python_to_minizinc(value, vdi->e()->ti()->ranges());//, vdi->e()->type(), name);
-        if (rhs == NULL)
-          return -1;
-        vdi->e()->e(rhs);
-        return 0;
-      }
-    }
+  if (VarDeclI* vdi = findDecl(name)) {
+    Expression* rhs = python_to_minizinc(value, vdi->e()->ti()->ranges());//, vdi->e()->type(), name);
+    if (rhs == NULL)
+      return -1;
+    vdi->e()->e(rhs);
+    return 0;
+  }
   MZN_PYERR_SET_STRING(PyExc_TypeError, "MiniZinc: Model.addData: Undefined name '%s'", name);
   return -1;
 }
@@ -31,6 +47,7 @@ MznModel::addData(const char* const name, PyObject* value)
 int 
 MznModel::load(PyObject *args, PyObject *keywds, bool fromFile)
 {
+  MznModelContext context(gcContext);
   GCLock Lock;
   Model* saveModel = _m;
   stringstream errorStream;
@@ -44,7 +61,7 @@ MznModel::load(PyObject *args, PyObject *keywds, bool fromFile)
   bool isDict = false;
 
   if (fromFile) {
-    char *kwlist[] = {"file","data","options"};
+    char *kwlist[] = {"file","data","options",NULL};
     if (!PyArg_ParseTupleAndKeywords(args, keywds, "s|Os", kwlist, &py_string, &obj, &options)) {
       PyErr_SetString(PyExc_TypeError, "MiniZinc: load: Parsing error");
       return -1;
@@ -95,17 +112,20 @@ MznModel::load(PyObject *args, PyObject *keywds, bool fromFile)
       }
     }
     vector<string> models {py_string};
-    _m = parse(models, data, *includePaths, false, false, false, errorStream);
-    _e = new Env(_m);
+    _e = new Env();
+    _m = parse(*_e, models, data, *includePaths, false, false, false, errorStream);
+    _e->model(_m);
   } else {
-    char *kwlist[] = {"string","error","options"};
+    char *kwlist[] = {"string","error","options",NULL};
     if (!PyArg_ParseTupleAndKeywords(args, keywds, "s|ss", kwlist, &py_string, &errorFile, &options)) {
       PyErr_SetString(PyExc_TypeError, "MiniZinc: Model.load: Keyword parsing error");
       return -1;
     }
-    _m = parseFromString(string(py_string), errorFile, *includePaths, false, false, false, errorStream);
+    vector<SyntaxError> syntaxErrors;
+    _m = parseFromString(string(py_string), errorFile, *includePaths, false, false, false, errorStream, syntaxErrors);
     _e = new Env(_m);
   }
+  clearDeclIndex();
   if (_m) {
     delete saveModel;
     if (isDict) {
@@ -151,6 +171,7 @@ PyObject* MznModel::solve(PyObject* args, PyObject* kwds)
     return NULL;
   }
 
+  MznModelContext context(gcContext);
   Model* saveModel;
   {
     GCLock lock;
@@ -180,43 +201,49 @@ PyObject* MznModel::solve(PyObject* args, PyObject* kwds)
     SOLVE__ERROR_HANDLING:
     delete _m;
     _m = saveModel;
+    clearDeclIndex();
     _e = new Env(_m);
     return NULL;
   }
 
   SOLVE__NO_ERROR:
+  Env* env = _e;
   vector<TypeError> typeErrors;
+  // Errors are collected while the GIL is released and raised afterwards
+  PyObject* errorType = NULL;
+  stringstream errorLog;
+  Py_BEGIN_ALLOW_THREADS
   try {
-    MiniZinc::typecheck(*_e, _m, typeErrors, false);
+    MiniZinc::typecheck(*env, _m, typeErrors, false);
   } catch (LocationException& e) {
-    MZN_PYERR_SET_STRING(PyExc_RuntimeError, "MiniZinc: Model.solve:   %s: %s", e.what(), e.msg().c_str());
-    return NULL;
+    errorType = PyExc_RuntimeError;
+    errorLog << "MiniZinc: Model.solve:   " << e.what() << ": " << e.msg();
   }
-  if (typeErrors.size() > 0) {
-    stringstream errorLog;
+  if (errorType == NULL && typeErrors.size() > 0) {
+    errorType = PyExc_TypeError;
     for (unsigned int i=0; i<typeErrors.size(); i++) {
       errorLog << typeErrors[i].loc() << ":" << endl;
       errorLog << typeErrors[i].what() << ": " << typeErrors[i].msg() << "\n";
     }
-    const std::string& tmp = errorLog.str();
-    const char* cstr = tmp.c_str();
-    PyErr_SetString(PyExc_TypeError, cstr);
-    return NULL;
   }
-  MiniZinc::registerBuiltins(*_e, _m);
-
-  Env* env = _e;
-  try {
-    FlatteningOptions fopts;
-    flatten(*env,fopts);
-  } catch (LocationException& e) {
-    stringstream errorLog;
-    errorLog << e.what() << ": " << std::endl;
-    env->dumpErrorStack(errorLog);
-    errorLog << "  " << e.msg() << std::endl;
+  if (errorType == NULL) {
+    MiniZinc::registerBuiltins(*env, _m);
+    try {
+      FlatteningOptions fopts;
+      flatten(*env,fopts);
+      optimize(*env);
+      oldflatzinc(*env);
+    } catch (LocationException& e) {
+      errorType = PyExc_RuntimeError;
+      errorLog << e.what() << ": " << std::endl;
+      env->dumpErrorStack(errorLog);
+      errorLog << "  " << e.msg() << std::endl;
+    }
+  }
+  Py_END_ALLOW_THREADS
+  if (errorType != NULL) {
     const std::string& tmp = errorLog.str();
-    const char* cstr = tmp.c_str();
-    PyErr_SetString(PyExc_RuntimeError, cstr);
+    PyErr_SetString(errorType, tmp.c_str());
     return NULL;
   }
   if (env->warnings().size()!=0)
@@ -230,14 +257,13 @@ PyObject* MznModel::solve(PyObject* args, PyObject* kwds)
     const char* cstr = tmp.c_str();
     PyErr_WarnEx(PyExc_RuntimeWarning, cstr, 1);
   }
-  optimize(*env);
-  oldflatzinc(*env);
   GCLock lock;
   Options options;
   if (timeLimit != 0)
     options.setIntParam("time", timeLimit);
   delete _m;
   _m = saveModel;
+  clearDeclIndex();
   _e = new Env(_m);
   PyMznSolver* ret = reinterpret_cast<PyMznSolver*>(PyMznSolver_new(&PyMznSolver_Type, NULL, NULL));
   switch (sc) {
@@ -250,8 +276,14 @@ PyObject* MznModel::solve(PyObject* args, PyObject* kwds)
       ret->solver = new GecodeSolverInstance(*env, options);
       break;
   }
+  ret->s2out = new Solns2Out();
+  ret->s2out->initFromEnv(env);
+  ret->solver->setSolns2Out(ret->s2out);
   ret->solver->processFlatZinc();
   ret->env = env;
+  Py_INCREF(this);
+  ret->model = reinterpret_cast<PyObject*>(this);
+  ret->gcContext = gcContext;
   return reinterpret_cast<PyObject*>(ret);
 }
 
@@ -268,6 +300,7 @@ MznModel_Constraint(MznModel* self, PyObject* args)
     return NULL;
   }
 
+  MznModelContext context(self->gcContext);
   GCLock Lock;
   ConstraintI* i;
   if (PyObject_ExactTypeCheck(obj, &MznExpression_Type)) {
@@ -317,6 +350,7 @@ MznModel_SolveItem(MznModel* self, PyObject* args)
     }
   }
 
+  MznModelContext context(self->gcContext);
   GCLock Lock;
   SolveI* i;
   switch (solveType) {
@@ -379,6 +413,9 @@ MznModel_new(PyTypeObject* type, PyObject* args, PyObject* kwds)
   self->includePaths = NULL;
   self->_m = NULL;
   self->_e = NULL;
+  self->declIndex = NULL;
+  self->declIndexSize = 0;
+  self->gcContext = new GCContext();
   return reinterpret_cast<PyObject*>(self);
 }
 
@@ -444,7 +481,10 @@ MznModel_init(MznModel* self, PyObject* args = NULL)
   self->includePaths->push_back(std_lib_dir+"/std/");
   self->sc = MznModel::default_solver;
   stringstream errorStream;
-  self->_m = parseFromString(libNamesStr,"error.txt",*(self->includePaths),false,false,false, errorStream);
+  MznModelContext context(self->gcContext);
+  vector<SyntaxError> syntaxErrors;
+  self->_m = parseFromString(libNamesStr,"error.txt",*(self->includePaths),false,false,false, errorStream, syntaxErrors);
+  self->clearDeclIndex();
   self->_e = new Env(self->_m);
   if (!(self->_m)) {
     const std::string& tmp = errorStream.str();
@@ -458,10 +498,16 @@ MznModel_init(MznModel* self, PyObject* args = NULL)
 static void
 MznModel_dealloc(MznModel* self)
 {
-  if (self->_m)
-    delete self->_m;
+  {
+    MznModelContext context(self->gcContext);
+    if (self->_m)
+      delete self->_m;
+  }
   if (self->_m)
     delete self->includePaths;
+  delete self->declIndex;
+  // Frees all remaining nodes of the model
+  delete self->gcContext;
   Py_TYPE(self)->tp_free(reinterpret_cast<PyObject*>(self));
 }
 
@@ -475,6 +521,7 @@ static PyObject* MznModel_addData(MznModel* self, PyObject* args)
     PyErr_SetString(PyExc_RuntimeError, "MiniZinc: Model.addData:  Parsing error");
     return NULL;
   }
+  MznModelContext context(self->gcContext);
   if (self->addData(name,obj)==-1) {
     // addData set error string already
     return NULL;
@@ -487,8 +534,12 @@ static PyObject*
 MznModel_copy(MznModel* self)
 {
   MznModel* ret = reinterpret_cast<MznModel*>(MznModel_new(&MznModel_Type, NULL, NULL));
+  // The copy is allocated by the collector of the new model
+  MznModelContext context(self->gcContext);
+  MznModelContext retContext(ret->gcContext);
   GCLock lock;
   ret->_m = copy(self->_e->envi(), self->_m);
+  ret->_e = new Env(ret->_m);
   ret->includePaths = new vector<string>(*(self->includePaths));
 
   ret->timeLimit = self->timeLimit;
@@ -499,6 +550,7 @@ MznModel_copy(MznModel* self)
 static PyObject*
 MznModel_debugprint(MznModel* self)
 {
+  MznModelContext context(self->gcContext);
   debugprint(self->_m);
   Py_RETURN_NONE;
 }
@@ -569,6 +621,7 @@ MznModel_set_solver(MznModel *self, PyObject *args)
 static PyObject*
 MznModel_Declaration(MznModel* self, PyObject* args)
 {
+  MznModelContext context(self->gcContext);
   GCLock Lock;
   enum TypeId { 
         PARINT,         // 0
@@ -11,6 +11,8 @@
 
 struct MznModel {
   PyObject_HEAD
+  // Garbage collector owning all nodes of _e and _m
+  GCContext* gcContext;
   Env* _e;
   Model* _m;
   vector<string>* includePaths;
@@ -26,11 +28,21 @@ struct MznModel {
   unsigned long timeLimit;
   bool loaded;
 
+  // Index from names to declaration items of _m, built on first use
+  UNORDERED_NAMESPACE::unordered_map<string, VarDeclI*>* declIndex;
+  // Number of items of _m already added to declIndex
+  unsigned int declIndexSize;
+
   MznModel();
 
   int load(PyObject *args, PyObject *keywds, bool fromFile);
   int addData(const char* const name, PyObject* value);
 
+  // Returns the declaration item of name in _m, NULL if not declared
+  VarDeclI* findDecl(const char* const name);
+  // Drops the index of declarations, must be called whenever _m is replaced
+  void clearDeclIndex();
+
   PyObject* set_solver(const char* s);
   PyObject* solve(PyObject* args, PyObject* kwds);
 };
@@ -134,8 +146,8 @@ static PyObject* MznModel_debugprint(MznModel* self);
 
 // Declare all the functions
 static PyMethodDef MznModel_methods[] = {
-  {"load", (PyCFunction)MznModel_load, METH_KEYWORDS, "Load MiniZinc model from MiniZinc file"},
-  {"load_from_string", (PyCFunction)MznModel_load_from_string, METH_KEYWORDS, "Load MiniZinc model from standard input"},
+  {"load", (PyCFunction)MznModel_load, METH_VARARGS | METH_KEYWORDS, "Load MiniZinc model from MiniZinc file"},
+  {"load_from_string", (PyCFunction)MznModel_load_from_string, METH_VARARGS | METH_KEYWORDS, "Load MiniZinc model from standard input"},
   {"addData", (PyCFunction)MznModel_addData, METH_VARARGS, "Add data to a MiniZinc model"},
   {"solve", (PyCFunction)MznModel_solve, METH_VARARGS | METH_KEYWORDS, "Solve a loaded MiniZinc model"},
   {"set_time_limit", (PyCFunction)MznModel_set_time_limit, METH_VARARGS, "Limit the execution time of the model"},
@@ -43,6 +43,7 @@ PyMznSolver_get_value(PyMznSolver* self, PyObject* args) {
     PyErr_SetString(PyExc_TypeError,"Accept 1 argument of strings or list/tuple of strings");
     return NULL;
   }
+  MznModelContext context(self->gcContext);
   if (PyUnicode_Check(obj)) {
     name = PyUnicode_AsUTF8(obj);
     return PyMznSolver_get_value_helper(self, name);;
@@ -99,8 +100,12 @@ PyMznSolver::next()
 {
   if (solver==NULL)
     throw runtime_error("Solver Object not found");
+  MznModelContext context(gcContext);
   GCLock lock;
-  SolverInstance::Status status = solver->solve();
+  SolverInstance::Status status;
+  Py_BEGIN_ALLOW_THREADS
+  status = solver->solve();
+  Py_END_ALLOW_THREADS
   if (status == SolverInstance::SAT || status == SolverInstance::OPT) {
     _m = env->output();
     Py_RETURN_NONE; 
@@ -115,10 +120,16 @@ PyMznSolver::next()
 static void
 PyMznSolver_dealloc(PyMznSolver* self)
 {
-  if (self->env)
-    delete self->env;
-  if (self->solver)
-    delete self->solver;
+  if (self->gcContext) {
+    MznModelContext context(self->gcContext);
+    // The solver and the output refer to env, so they are deleted first
+    if (self->solver)
+      delete self->solver;
+    delete self->s2out;
+    if (self->env)
+      delete self->env;
+  }
+  Py_XDECREF(self->model);
   Py_TYPE(self)->tp_free(reinterpret_cast<PyObject*>(self));
 }
 
@@ -127,8 +138,11 @@ PyMznSolver_new(PyTypeObject* type, PyObject* args, PyObject* kwds)
 {
   PyMznSolver* self = reinterpret_cast<PyMznSolver*>(type->tp_alloc(type,0));
   self->solver = NULL;
+  self->s2out = NULL;
   self->_m = NULL;
   self->env = NULL;
+  self->model = NULL;
+  self->gcContext = NULL;
   return reinterpret_cast<PyObject*>(self);
 }
 
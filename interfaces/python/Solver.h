@@ -13,8 +13,13 @@
 struct PyMznSolver {
   PyObject_HEAD
   MiniZinc::SolverInstanceBase* solver;
+  // Receives the values of the output variables of each solution
+  MiniZinc::Solns2Out* s2out;
   MiniZinc::Env* env;
   MiniZinc::Model* _m;
+  // The model this solver was created from, whose collector owns env
+  PyObject* model;
+  MiniZinc::GCContext* gcContext;
 
   PyObject* next();
 };
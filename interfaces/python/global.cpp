@@ -110,7 +110,7 @@ one_dim_minizinc_to_python(Expression* e, const Type& type)
     case Type::BT_INT:
       return c_to_py_number(eval_int(env.envi(), e).toInt());
     case Type::BT_FLOAT:
-      return PyFloat_FromDouble(eval_float(env.envi(),e));
+      return PyFloat_FromDouble(eval_float(env.envi(),e).toDouble());
     case Type::BT_STRING:
     {
       string temp(eval_string(env.envi(), e));
@@ -272,23 +272,118 @@ one_dim_python_to_minizinc(PyObject* pvalue, Type::BaseType& code)
 }
 
 
+int
+buffer_to_minizinc(PyObject* pvalue, vector<Py_ssize_t>& dimensions, vector<Expression*>& elems, Type::BaseType& code)
+{
+  if (PyBytes_Check(pvalue) || PyByteArray_Check(pvalue) || !PyObject_CheckBuffer(pvalue))
+    return 1;
+  Py_buffer view;
+  if (PyObject_GetBuffer(pvalue, &view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) == -1) {
+    PyErr_Clear();
+    return 1;
+  }
+  // Only native byte order is supported, and the element type must be given by a single character
+  const char* format = view.format == NULL ? "B" : view.format;
+  if (format[0] == '@' || format[0] == '=')
+    ++format;
+  else if (format[0] == '<') {
+    const unsigned short one = 1;
+    if (*reinterpret_cast<const unsigned char*>(&one) == 1)
+      ++format;
+  }
+  enum { BUF_INT64, BUF_FLOAT64, BUF_BOOL, BUF_UNSUPPORTED } kind = BUF_UNSUPPORTED;
+  if (format[0] != '\0' && format[1] == '\0') {
+    if ((format[0] == 'q' || format[0] == 'l') && view.itemsize == 8)
+      kind = BUF_INT64;
+    else if (format[0] == 'd' && view.itemsize == 8)
+      kind = BUF_FLOAT64;
+    else if (format[0] == '?' && view.itemsize == 1)
+      kind = BUF_BOOL;
+  }
+  if (kind == BUF_UNSUPPORTED) {
+    MZN_PYERR_SET_STRING(PyExc_TypeError, "MiniZinc: Unsupported buffer format '%s': expected int64, float64 or bool elements", view.format == NULL ? "B" : view.format);
+    PyBuffer_Release(&view);
+    return -1;
+  }
+
+  Py_ssize_t n = 1;
+  dimensions.resize(view.ndim);
+  for (int i=0; i!=view.ndim; ++i) {
+    dimensions[i] = view.shape[i];
+    n *= view.shape[i];
+  }
+  elems.resize(n);
+  switch (kind) {
+    case BUF_INT64:
+      {
+        const long long* data = static_cast<const long long*>(view.buf);
+        for (Py_ssize_t i=0; i!=n; ++i) {
+          if (data[i] >= LLONG_MAX || data[i] <= -LLONG_MAX) {
+            MZN_PYERR_SET_STRING(PyExc_OverflowError, "MiniZinc: Integer value at position %zd is out of range", i);
+            PyBuffer_Release(&view);
+            return -1;
+          }
+          elems[i] = IntLit::a(IntVal(data[i]));
+        }
+        code = Type::BT_INT;
+      }
+      break;
+    case BUF_FLOAT64:
+      {
+        const double* data = static_cast<const double*>(view.buf);
+        for (Py_ssize_t i=0; i!=n; ++i)
+          elems[i] = new FloatLit(Location(), data[i]);
+        code = Type::BT_FLOAT;
+      }
+      break;
+    default:
+      {
+        const unsigned char* data = static_cast<const unsigned char*>(view.buf);
+        for (Py_ssize_t i=0; i!=n; ++i)
+          elems[i] = constants().boollit(data[i] != 0);
+        code = Type::BT_BOOL;
+      }
+  }
+  PyBuffer_Release(&view);
+  return 0;
+}
+
+
 Expression*
 python_to_minizinc(PyObject* pvalue, const ASTExprVec<TypeInst>& ranges)
 {
+  vector<Py_ssize_t> dimensions;
+  vector<Expression*> onedArray;
+  Type::BaseType code = Type::BT_UNKNOWN;
+  int buffered = 1;
   if (PyObject_TypeCheck(pvalue, &MznObject_Type)) {
     return MznObject_get_e(reinterpret_cast<MznObject*>(pvalue));
-  } else if (PyList_Check(pvalue)) {
-    vector<Py_ssize_t> dimensions;
-    vector<PyObject*> simpleArray;
-    if (getList(pvalue, dimensions, simpleArray, 0) == -1)
-      // getList should already set the error string
-      return NULL;
+  } else if (!PyList_Check(pvalue) && (buffered = buffer_to_minizinc(pvalue, dimensions, onedArray, code)) == -1) {
+    // buffer_to_minizinc should already set the error string
+    return NULL;
+  }
+  if (buffered == 0 && dimensions.empty()) {
+    return onedArray[0];
+  } else if (buffered == 0 || PyList_Check(pvalue)) {
+    if (buffered != 0) {
+      vector<PyObject*> simpleArray;
+      if (getList(pvalue, dimensions, simpleArray, 0) == -1)
+        // getList should already set the error string
+        return NULL;
+      onedArray.resize(simpleArray.size());
+      for (int i=0; i!=simpleArray.size(); ++i) {
+        PyObject* temp= simpleArray[i];
+        Expression* rhs = one_dim_python_to_minizinc(temp, code);
+        if (rhs == NULL)
+          return NULL;
+        onedArray[i] = rhs;
+      }
+    }
     if (ranges.size()!=dimensions.size()) {
       PyErr_SetString(PyExc_ValueError, "MiniZinc: python_to_minizinc: size of declared array and actual array not matched");
       return NULL;
     }
     vector<Expression*> callArgument(dimensions.size()+1);
-    vector<Expression*> onedArray(simpleArray.size());
 
     stringstream buffer;
     buffer << "array" << dimensions.size() << "d";
@@ -303,19 +398,10 @@ python_to_minizinc(PyObject* pvalue, const ASTExprVec<TypeInst>& ranges)
         callArgument[i] = domain;
       }
     }
-    Type::BaseType code = Type::BT_UNKNOWN;
-    for (int i=0; i!=simpleArray.size(); ++i) {
-      PyObject* temp= simpleArray[i];
-      Expression* rhs = one_dim_python_to_minizinc(temp, code);
-      if (rhs == NULL)
-        return NULL;
-      onedArray[i] = rhs;
-    }
     callArgument[dimensions.size()] = new ArrayLit(Location(), onedArray);
     Expression* rhs = new Call(Location(), callName, callArgument);
     return rhs;
   } else {
-    Type::BaseType code = Type::BT_UNKNOWN;
     Expression* rhs = one_dim_python_to_minizinc(pvalue, code); 
     return rhs;
   }
@@ -326,13 +412,23 @@ Expression*
 python_to_minizinc(PyObject* pvalue, Type& returnType, vector<pair<int, int> >& dimList)
 {
   Type::BaseType code = Type::BT_UNKNOWN;
+  vector<Py_ssize_t> dimensions;
+  vector<Expression*> v;
+  int buffered = 1;
   if (PyObject_TypeCheck(pvalue, &MznObject_Type)) {
     returnType = Type::parsetint();
     return MznObject_get_e(reinterpret_cast<MznObject*>(pvalue));
-  } else if (PyList_Check(pvalue)) {
-    vector<Py_ssize_t> dimensions;
+  } else if (!PyList_Check(pvalue) && (buffered = buffer_to_minizinc(pvalue, dimensions, v, code)) == -1) {
+    // buffer_to_minizinc should set error string already
+    return NULL;
+  }
+  if (buffered == 0 && dimensions.empty()) {
+    returnType = Type();
+    returnType.bt(code);
+    return v[0];
+  } else if (buffered == 0 || PyList_Check(pvalue)) {
     vector<PyObject*> simpleArray;
-    if (getList(pvalue, dimensions, simpleArray, 0) == -1) {
+    if (buffered != 0 && getList(pvalue, dimensions, simpleArray, 0) == -1) {
       // getList should set error string already
       return NULL;
     }
@@ -351,7 +447,6 @@ python_to_minizinc(PyObject* pvalue, Type& returnType, vector<pair<int, int> >&
         }
       }
     }
-    vector<Expression*> v;
     for (int i=0; i!=simpleArray.size(); ++i) {
       PyObject* temp= simpleArray[i];
       Expression* rhs = one_dim_python_to_minizinc(temp, code);
@@ -43,6 +43,7 @@
 #include <minizinc/builtins.hh>
 #include <minizinc/file_utils.hh>
 #include <minizinc/solvers/gecode_solverinstance.hh>
+#include <minizinc/solns2out.hh>
 #include <minizinc/prettyprinter.hh>
 #include <minizinc/copy.hh>
 
@@ -53,6 +54,22 @@
 using namespace std;
 using namespace MiniZinc;
 
+/* Attaches the garbage collector of a model to the calling thread for the
+ * lifetime of the object. Each model has its own collector, so different
+ * models can be used by different threads at the same time. The GIL is
+ * released while waiting for another thread that uses the same model.
+ */
+class MznModelContext {
+  GCContext::Use* _use;
+public:
+  MznModelContext(GCContext* c) {
+    Py_BEGIN_ALLOW_THREADS
+    _use = new GCContext::Use(*c);
+    Py_END_ALLOW_THREADS
+  }
+  ~MznModelContext() { delete _use; }
+};
+
 static PyObject* MznModel_new_error;
 static PyObject* MznModel_init_error;
 static PyObject* MznModel_solve_error;
@@ -143,6 +160,19 @@ inline Expression* one_dim_python_to_minizinc(PyObject* pvalue, Type::BaseType&
  */
 Expression* python_to_minizinc(PyObject* pvalue, const ASTExprVec<TypeInst>& ranges);
 
+/*
+ * Description: Converts an object exposing the buffer protocol (for example a NumPy array)
+ *              of int64, float64 or bool elements to a 1d-array of MiniZinc literals,
+ *              reading the elements directly from the buffer memory
+ *              dimensions: the size of each dimension (empty for a 0-dimensional buffer)
+ *              elems: the literals, in row-major order
+ *              code: the type of the elements
+ * Return: 0 if success, -1 if error occurred (error string is set),
+ *         1 if pvalue does not expose a contiguous buffer
+ * Note: Need an outer GCLock
+ */
+int buffer_to_minizinc(PyObject* pvalue, vector<Py_ssize_t>& dimensions, vector<Expression*>& elems, Type::BaseType& code);
+
 
 
 
@@ -10,10 +10,17 @@
 using namespace MiniZinc;
 using namespace std;
 
+/* Expressions created by the functions below can be added to any model, and
+ * each model has its own garbage collector. They are therefore allocated in
+ * the permanent heap, which is never collected.
+ */
+
 
 static PyObject*
 Mzn_Call(PyObject* self, PyObject* args)
 {
+  GCPermanent permanent;
+  GCLock Lock;
   const char* name;
   PyObject* variableTuple;
   PyTypeObject* returnType;
@@ -56,6 +63,8 @@ Mzn_Call(PyObject* self, PyObject* args)
 static PyObject*
 Mzn_Id(PyObject* self, PyObject* args)
 {
+  GCPermanent permanent;
+  GCLock Lock;
   const char* name;
   if (!PyArg_ParseTuple(args, "s", &name)) {
     PyErr_SetString(PyExc_TypeError, "MiniZinc: Mzn_Id: Argument must be a string");
@@ -68,6 +77,8 @@ Mzn_Id(PyObject* self, PyObject* args)
 
 static PyObject* Mzn_at(PyObject* self, PyObject* args)
 {
+  GCPermanent permanent;
+  GCLock Lock;
   PyObject* Py_array;
   PyObject* Py_idx;
   if (!PyArg_ParseTuple(args, "OO", &Py_array, &Py_idx)) {
@@ -126,6 +137,8 @@ Mzn_UnOp(PyObject* self, PyObject* args)
     UOT_PLUS,         // 1
     UOT_MINUS         // 2
   };*/
+  GCPermanent permanent;
+  GCLock Lock;
   PyObject* r;
   unsigned int op;
   if (!PyArg_ParseTuple(args, "IO", &op, &r)) {
@@ -161,9 +174,6 @@ Mzn_UnOp(PyObject* self, PyObject* args)
     return NULL;
   }
 
-
-  GCLock Lock;
-
   PyObject* ret = MznExpression_new(&MznExpression_Type, NULL, NULL);
   reinterpret_cast<MznExpression*>(ret)->e = new UnOp(Location(), static_cast<UnOpType>(op), rhs);
   return ret;
@@ -207,6 +217,8 @@ Mzn_BinOp(PyObject* self, PyObject* args)
     BOT_XOR,          //25
     BOT_DOTDOT        //26
   };*/
+  GCPermanent permanent;
+  GCLock Lock;
   PyObject* PyPre[2];
   unsigned int op;
   if (!PyArg_ParseTuple(args, "OIO", &PyPre[0], &op, &PyPre[1])) {
@@ -250,9 +262,6 @@ Mzn_BinOp(PyObject* self, PyObject* args)
     }
   }
 
-
-  GCLock Lock;
-
   PyObject* ret = MznExpression_new(&MznExpression_Type, NULL, NULL);
   reinterpret_cast<MznExpression*>(ret)->e = (new BinOp(Location(), pre[0], static_cast<BinOpType>(op), pre[1]));
   return ret;
@@ -312,10 +321,13 @@ Mzn_retrieveNames(PyObject* self, PyObject* args) {
   if (MznModel_init(tempModel,libName) != 0) {
     return NULL;
   }
-  CollectBoolFuncNames bool_fv(boolfuncs, include_global_mzn);
-  CollectAnnNames ann_fv(annfuncs, annvars, include_global_mzn);
-  iterItems(bool_fv, tempModel->_m);
-  iterItems(ann_fv, tempModel->_m);
+  {
+    MznModelContext context(tempModel->gcContext);
+    CollectBoolFuncNames bool_fv(boolfuncs, include_global_mzn);
+    CollectAnnNames ann_fv(annfuncs, annvars, include_global_mzn);
+    iterItems(bool_fv, tempModel->_m);
+    iterItems(ann_fv, tempModel->_m);
+  }
   MznModel_dealloc(tempModel);
 
   PyObject* dict = PyDict_New();
@@ -217,8 +217,8 @@ public:
 
 
 static PyMethodDef Mzn_methods[] = {
-  {"load", (PyCFunction)Mzn_load, METH_KEYWORDS, "Load MiniZinc model from MiniZinc file"},
-  {"load_from_string", (PyCFunction)Mzn_load_from_string, METH_KEYWORDS, "Load MiniZinc model from stdin"},
+  {"load", (PyCFunction)Mzn_load, METH_VARARGS | METH_KEYWORDS, "Load MiniZinc model from MiniZinc file"},
+  {"load_from_string", (PyCFunction)Mzn_load_from_string, METH_VARARGS | METH_KEYWORDS, "Load MiniZinc model from stdin"},
   {"BinOp", (PyCFunction)Mzn_BinOp, METH_VARARGS, "Add a binary expression into the model"},
   {"UnOp", (PyCFunction)Mzn_UnOp, METH_VARARGS, "Add a unary expression into the model"},
   {"Id", (PyCFunction)Mzn_Id, METH_VARARGS, "Return a MiniZinc Variable containing the given name"},
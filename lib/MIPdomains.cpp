@@ -32,7 +32,12 @@
 #include <minizinc/prettyprinter.hh>
 //#include <ostream>
 
+#include <minizinc/timer.hh>
+
+#include <atomic>
 #include <map>
+#include <memory>
+#include <thread>
 
 
 /// TODOs
@@ -87,12 +92,14 @@ namespace MiniZinc {
 
   class MIPD {  
   public:
-    MIPD(Env* env, bool fV=false) : __env(env) { getEnv(); fVerbose=fV; }
+    MIPD(Env* env, bool fV=false, unsigned int nT=0)
+      : __env(env), nThreads(nT) { getEnv(); fVerbose=fV; }
     static bool fVerbose;
     bool MIPdomains() {
       MIPD__stats[ N_POSTs__NSubintvMin ] = 1e100;
       MIPD__stats[ N_POSTs__SubSizeMin ] = 1e100;
       
+      Timer timer;
       if (!registerLinearConstraintDecls())
         return true;
       if (!register__POSTconstraintDecls())    // not declared => no conversions
@@ -100,7 +107,10 @@ namespace MiniZinc {
       register__POSTvariables();
       if ( vVarDescr.empty() )
         return true;
+      dRegisterMs = timer.ms();
+      timer.reset();
       constructVarViewCliques();
+      dCliquesMs = timer.ms();
       if ( !decomposeDomains() )
         return false;
       if ( fVerbose )
@@ -113,6 +123,13 @@ namespace MiniZinc {
     Env* __env=0;
     Env* getEnv() { MZN_MIPD__assert_hard(__env); return __env; }
     
+    /// Threads analysing cliques, 0 for the number of hardware threads
+    unsigned int nThreads=1;
+    /// Phase times in milliseconds
+    double dRegisterMs=0.0, dCliquesMs=0.0, dAnalysisMs=0.0, dImplementMs=0.0;
+    /// Number of clique analyses repeated by the main thread
+    int nReanalysed=0;
+    
     typedef VarDecl* PVarDecl;
     
     FunctionI *int_lin_eq;
@@ -211,11 +228,14 @@ namespace MiniZinc {
       boolShort fInt=0;
       ConstraintI* pEqEncoding=0;
       boolShort fDomainConstrProcessed=0;
+      boolShort fDomainChanged=0;       // domain set by a decomposition
 //       boolShort fPropagatedViews=0;
 //       boolShort fPropagatedLargerEqns=0;
     };
     
     std::vector<VarDescr> vVarDescr;
+    /// Variables whose fDomainChanged is set, reset for each batch of cliques
+    std::vector<int> aDomainChanged;
     
     FunctionI *int_le_reif__POST=0, *int_ge_reif__POST=0, *int_eq_reif__POST=0, *int_ne__POST=0,
       *float_le_reif__POST=0, *float_ge_reif__POST=0, *aux_float_lt_zero_iff_1__POST=0, 
@@ -712,12 +732,17 @@ namespace MiniZinc {
         // it is a var with eq_encode, ||
         // an (integer if any) variable with the least rel. factor
       bool fRef1HasEqEncode=false;
+      /// Hash variables by their number rather than their address, so that
+      /// the maps below are iterated in the same order in every run
+      struct THashVar {
+        size_t operator()( VarDecl* vd ) const { return std::hash<int>()( vd->payload() ); }
+      };
       /// This map stores the relations y = ax+b of all the clique's vars to y
-      typedef UNORDERED_NAMESPACE::unordered_map<VarDecl*, std::pair<double, double> >
+      typedef UNORDERED_NAMESPACE::unordered_map<VarDecl*, std::pair<double, double>, THashVar >
         TMapVars;
       TMapVars mRef0, mRef1;   // to the main var 0, 1
       
-      class TMatrixVars : public UNORDERED_NAMESPACE::unordered_map<VarDecl*, TMapVars> {
+      class TMatrixVars : public UNORDERED_NAMESPACE::unordered_map<VarDecl*, TMapVars, THashVar> {
       public:
         /// Check existing connection
         template <class IVarDecl>
@@ -750,6 +775,9 @@ namespace MiniZinc {
       class LinEqGraph : public TMatrixVars {
       public:
         static double dCoefMin, dCoefMax;
+        /// Coefficient range of this graph, merged into dCoefMin/Max
+        /// by the thread implementing the clique
+        double dCoefMinGraph=+1e100, dCoefMaxGraph=-1e100;
         /// Stores the arc (x1, x2) as x1 = a*x2 + b
         /// so that a constraint on x2, say x2<=c <-> f,
         /// is equivalent to one for x1:  x1 <=/>= a*c+b <-> f
@@ -770,10 +798,10 @@ namespace MiniZinc {
           checkExistingArc(begV, negBA, CA);
           (*this)[*begV][*(begV+1)] = std::make_pair(negBA, CA);
           const double dCoefAbs = std::fabs( negBA );
-          if ( dCoefAbs<dCoefMin )
-            dCoefMin = dCoefAbs;
-          if ( dCoefAbs>dCoefMax )
-            dCoefMax = dCoefAbs;
+          if ( dCoefAbs<dCoefMinGraph )
+            dCoefMinGraph = dCoefAbs;
+          if ( dCoefAbs>dCoefMaxGraph )
+            dCoefMaxGraph = dCoefAbs;
         }
         void addEdge(const LinEq2Vars& led) {
           addArc( led.coefs.begin(), led.vd.begin(), led.rhs );
@@ -860,6 +888,9 @@ namespace MiniZinc {
       }
     };  // class TCliqueSorter
     
+    /// Thrown when an analysis in a worker thread needs the main thread
+    struct MIPD_Deferred { };
+    
     /// Build a domain decomposition for a clique
     /// a clique can consist of just 1 var without a clique object
     class DomainDecomp {
@@ -869,10 +900,19 @@ namespace MiniZinc {
       TCliqueSorter cls;
       SetOfIntvReal sDomain;
       
-      DomainDecomp(MIPD* pm, int iv) : mipd(*pm), iVarStart(iv), cls(pm, iv)  {
+      /// Statistics of the analysis, added to MIPD__stats by implement()
+      std::vector<double> aStats;
+      /// Whether the analysis runs in a worker thread, so must not evaluate
+      /// anything that allocates
+      bool fConcurrent=false;
+      
+      DomainDecomp(MIPD* pm, int iv) : mipd(*pm), iVarStart(iv), cls(pm, iv),
+        aStats( N_POSTs__size, 0.0 ) {
         sDomain.insert(IntvReal());   // the decomposed domain. Init to +-inf
       }
-      void doProcess() {
+      /// Relate the clique's variables && compute the domain decomposition
+      /// Does ! modify the model, can run in parallel for different cliques
+      void analyse() {
         // Choose the main variable && relate all others to it
         const int nClique =  mipd.vVarDescr[iVarStart].nClique;
         if ( nClique >= 0 ) {
@@ -903,7 +943,16 @@ namespace MiniZinc {
         
         MZN_MIPD__assert_hard( sDomain.checkFiniteBounds() );
         MZN_MIPD__assert_hard( sDomain.checkDisjunctStrict() );
-        
+      }
+      /// Whether implementing earlier cliques changed a domain the analysis used
+      bool domainsChanged() const {
+        for ( auto& iRef1 : cls.mRef1 )
+          if ( mipd.vVarDescr[ iRef1.first->payload() ].fDomainChanged )
+            return true;
+        return false;
+      }
+      /// Add the decomposition's variables && constraints to the model
+      void implement() {
         makeRangeDomains();
         
         // Then, use equality_encoding if available
@@ -917,6 +966,12 @@ namespace MiniZinc {
         implement__POSTs();
         
         // Statistics
+        for ( int i=0; i<N_POSTs__size; ++i )
+          MIPD__stats[ i ] += aStats[ i ];
+        if ( cls.leg.dCoefMinGraph < TCliqueSorter::LinEqGraph::dCoefMin )
+          TCliqueSorter::LinEqGraph::dCoefMin = cls.leg.dCoefMinGraph;
+        if ( cls.leg.dCoefMaxGraph > TCliqueSorter::LinEqGraph::dCoefMax )
+          TCliqueSorter::LinEqGraph::dCoefMax = cls.leg.dCoefMaxGraph;
         if ( sDomain.size() < MIPD__stats[ N_POSTs__NSubintvMin ] )
           MIPD__stats[ N_POSTs__NSubintvMin ] = sDomain.size();
         MIPD__stats[ N_POSTs__NSubintvSum ] += sDomain.size();
@@ -998,11 +1053,11 @@ namespace MiniZinc {
               convertIntSet( pCall->args()[1], SS, cls.varRef1, A, B );
               if ( RIT_Static == dct.nReifType ) {
                 sDomain.intersect(SS);
-                ++MIPD__stats[ N_POSTs__setIn ];
+                ++aStats[ N_POSTs__setIn ];
               }
               else {
                 sDomain.cutDeltas(SS, std::max( 1.0, std::fabs( A ) ) );      // deltas to scale
-                ++MIPD__stats[ N_POSTs__setInReif ];
+                ++aStats[ N_POSTs__setInReif ];
               }
             }
               break;
@@ -1038,7 +1093,7 @@ namespace MiniZinc {
                   default:
                     MZN_MIPD__assert_hard_msg( 0, " No other reified cmp type " );
                 }
-                ++MIPD__stats[ ( vd->ti()->type().isint() ) ?
+                ++aStats[ ( vd->ti()->type().isint() ) ?
                   N_POSTs__intCmpReif : N_POSTs__floatCmpReif ];
               } else if ( RIT_Static == dct.nReifType ) {
                   // _ne, later maybe static ineq                                 TODO
@@ -1051,11 +1106,11 @@ namespace MiniZinc {
                   const double delta = computeDelta( cls.varRef1, vd, bnds, A, pCall, 2 );
                   sDomain.cutOut( { rhsRnd-delta, rhsRnd+delta } );
                 }
-                ++MIPD__stats[ ( vd->ti()->type().isint() ) ?
+                ++aStats[ ( vd->ti()->type().isint() ) ?
                   N_POSTs__intNE : N_POSTs__floatNE ];
               } else {  // aux_ relate to 0.0
                         // But we don't modify domain splitting for them currently
-                ++MIPD__stats[ ( vd->ti()->type().isint() ) ?
+                ++aStats[ ( vd->ti()->type().isint() ) ?
                   N_POSTs__intAux : N_POSTs__floatAux ];
                 MZN_MIPD__assert_hard ( RIT_Halfreif==dct.nReifType );
 //                 const double rhs = B;               // + A*0
@@ -1064,7 +1119,7 @@ namespace MiniZinc {
               break;
             case CT_Encode:
               // See if any further constraints here?                             TODO
-              ++MIPD__stats[ N_POSTs__eq_encode ];
+              ++aStats[ N_POSTs__eq_encode ];
               break;
             default:
               MZN_MIPD__assert_hard_msg( 0, "Unknown constraint type" );
@@ -1418,6 +1473,14 @@ namespace MiniZinc {
       
       void setVarDomain( VarDecl* vd, double lb, double ub ) {
         // need to check if the new range is in the previous bounds...   TODO
+        // New variables have payload 0, so check it is a registered one
+        const int iVar = vd->payload();
+        if ( iVar >= 0 && iVar < (int)mipd.vVarDescr.size()
+            && vd == mipd.vVarDescr[ iVar ].vd
+            && ! mipd.vVarDescr[ iVar ].fDomainChanged ) {
+          mipd.vVarDescr[ iVar ].fDomainChanged = 1;
+          mipd.aDomainChanged.push_back( iVar );
+        }
         if ( vd->type().isfloat() ) {
 //           if ( 0.0==lb && 0.0==ub ) {
             BinOp* newDom = new BinOp(Location().introduce(),
@@ -1548,6 +1611,11 @@ namespace MiniZinc {
       void convertIntSet( Expression* e, SetOfIntvReal& s, VarDecl* varTarget,
                           double A, double B ) {
         MZN_MIPD__assert_hard( A != 0.0 );
+        if ( fConcurrent ) {           // evaluating other expressions allocates
+          SetLit* sl = e->dyn_cast<SetLit>();
+          if ( 0==sl || ( e->type().isintset() ? 0==sl->isv() : 0==sl->fsv() ) )
+            throw MIPD_Deferred();
+        }
         if (e->type().isintset()) {
           IntSetVal* S = eval_intset( mipd.getEnv()->envi(), e );
           IntSetRanges domr(S);
@@ -1612,14 +1680,74 @@ namespace MiniZinc {
 //         TClique& clq = aCliques[iClq];
 //       }
       bool fRetTrue = true;
+      // Each clique is given by its first variable, 1-var cliques by the var
+      std::vector<int> aStarts;
+      std::vector<bool> fCliqueSeen( aCliques.size(), false );
       for ( int iVar=0; iVar<vVarDescr.size(); ++iVar ) {
-//         VarDescr& var = vVarDescr[iVar];
-        if ( ! vVarDescr[iVar].fDomainConstrProcessed ) {
+        const int nClique = vVarDescr[iVar].nClique;
+        if ( nClique < 0 )
+          aStarts.push_back( iVar );
+        else if ( ! fCliqueSeen[ nClique ] ) {
+          fCliqueSeen[ nClique ] = true;
+          aStarts.push_back( iVar );
+        }
+      }
+      if ( 0==nThreads )
+        nThreads = std::max( 1u, std::thread::hardware_concurrency() );
+      // The cliques are analysed in parallel in batches, && then implemented
+      // in their original order by this thread, which owns the model.
+      // An analysis is repeated here if it needs to evaluate expressions,
+      // fails, || read domains that implementing an earlier clique changed.
+      const size_t nBatch = ( nThreads > 1 ) ? 4096 : 1;
+      for ( size_t iBatch=0; fRetTrue && iBatch<aStarts.size(); iBatch += nBatch ) {
+        GCLock lock;
+        // The analyses of this batch see the domains set by earlier batches
+        for ( int iVar : aDomainChanged )
+          vVarDescr[ iVar ].fDomainChanged = 0;
+        aDomainChanged.clear();
+        const size_t nInBatch = std::min( nBatch, aStarts.size()-iBatch );
+        std::vector<std::unique_ptr<DomainDecomp> > aDD( nInBatch );
+        std::vector<unsigned char> fRedo( nInBatch, 0 );
+        Timer timer;
+        if ( nThreads > 1 ) {
+          for ( size_t i=0; i<nInBatch; ++i ) {
+            aDD[i].reset( new DomainDecomp(this, aStarts[iBatch+i]) );
+            aDD[i]->fConcurrent = true;
+          }
+          std::atomic<size_t> iNext( 0 );
+          auto analyseNext = [&]() {
+            for ( size_t i; (i = iNext++) < nInBatch; ) {
+              try {
+                aDD[i]->analyse();
+              } catch ( ... ) {
+                fRedo[i] = 1;
+              }
+            }
+          };
+          std::vector<std::thread> workers;
+          for ( unsigned int k=1; k<nThreads && k<nInBatch; ++k )
+            workers.push_back( std::thread( analyseNext ) );
+          analyseNext();
+          for ( auto& w : workers )
+            w.join();
+        } else {
+          fRedo.assign( nInBatch, 1 );
+        }
+        dAnalysisMs += timer.ms();
+        timer.reset();
+        double dRedoMs = 0.0;
+        for ( size_t i=0; i<nInBatch; ++i ) {
           try {
-            GCLock lock;      
-            DomainDecomp dd(this, iVar);
-            dd.doProcess();
-            vVarDescr[iVar].fDomainConstrProcessed = true;
+            if ( fRedo[i] || aDD[i]->domainsChanged() ) {
+              Timer timerRedo;
+              if ( nThreads > 1 )
+                ++nReanalysed;
+              aDD[i].reset( new DomainDecomp(this, aStarts[iBatch+i]) );
+              aDD[i]->analyse();
+              dRedoMs += timerRedo.ms();
+            }
+            aDD[i]->implement();
+            vVarDescr[ aStarts[iBatch+i] ].fDomainConstrProcessed = true;
           } catch (const MIPD_Infeasibility_Exception& exc) {
             std::cerr << "  INFEASIBILITY: " << exc.msg << std::endl;
             fRetTrue = false;
@@ -1631,7 +1759,10 @@ namespace MiniZinc {
 // //           } catch ( ... ) {  // a contradiction
 // //             return false;
           }
+          aDD[i].reset();
         }
+        dAnalysisMs += dRedoMs;
+        dImplementMs += timer.ms() - dRedoMs;
       }
       // Clean up __POSTs:
       for ( auto& vVar: vVarDescr ) {
@@ -1769,6 +1900,12 @@ namespace MiniZinc {
         << "--"
         << TCliqueSorter::LinEqGraph::dCoefMax
         << " abs coefs";
+      os << ", times: register " << dRegisterMs
+        << " ms, cliques " << dCliquesMs
+        << " ms, analysis " << dAnalysisMs
+        << " ms (" << nThreads << " threads, "
+        << nReanalysed << " repeated), implementation " << dImplementMs
+        << " ms";
       os << " ... ";
     }
 
@@ -1806,65 +1943,47 @@ namespace MiniZinc {
       << " from " << (*this) );
     if ( this->empty() )
       return;
-    iterator it1 = ( Interval<N>::infMinus() == intv.left ) ?
-      this->lower_bound( Interval<N>( intv.left, intv.right ) ) :
-      this->upper_bound( Interval<N>( intv.left, intv.right ) );
-    auto it2Del1 = it1;                                     // from which to delete
-    if ( this->begin() != it1 ) {
-      --it1;
-      const N it1l = it1->left;
-      MZN_MIPD__assert_hard( it1l <= intv.left );
+    // Positions instead of iterators, which inserting invalidates
+    size_t iDel1 = ( ( Interval<N>::infMinus() == intv.left ) ?
+      this->lower_bound( intv ) :
+      this->upper_bound( intv ) ) - this->begin();          // from which to delete
+    if ( 0 != iDel1 ) {
+      iterator it1 = this->begin() + (iDel1-1);
+      MZN_MIPD__assert_hard( it1->left <= intv.left );
       if ( it1->right > intv.left ) {                       // split it
-        it2Del1 = split( it1, intv.left ).second;
-//         it1->right = intv.left;  READ-ONLY
-//         this->erase(it1);
-//         it1 = this->end();
-//         auto iR = this->insert( Interval<N>( it1l, intv.left ) );
-//         MZN_MIPD__assert_hard( iR.second );
+        iterator it2Del1 = split( it1, intv.left ).second;
+        iDel1 = it2Del1 - this->begin();
       }
     }
     DBGOUT_MIPD__( "; after split 1: " << (*this) );
     // Processing the right end:
-    auto it2 = this->lower_bound( Interval<N>( intv.right, intv.right+1 ) );
-    auto it2Del2 = it2;
-    if ( this->begin() != it2 ) {
-      --it2;
-      MZN_MIPD__assert_hard( it2->left < intv.right );
-      const N it2r = it2->right;
+    size_t iDel2 =
+      this->lower_bound( Interval<N>( intv.right, intv.right+1 ) ) - this->begin();
+    if ( 0 != iDel2 ) {
+      const size_t i2 = iDel2-1;
+      MZN_MIPD__assert_hard( (*this)[i2].left < intv.right );
+      const N it2r = (*this)[i2].right;
       if ( ( Interval<N>::infPlus() == intv.right ) ?
         ( it2r > intv.right ) : ( it2r >= intv.right ) ) {   // >=: split it
-//         it2Del2 = split( it2, intv.right ).second;
-          const bool fEEE = (it2Del1 == it2);
-          this->erase(it2);
-          it2 = this->end();
-          it2Del2 = this->insert( Interval<N>( intv.right, it2r ) );
-          if ( fEEE )
-            it2Del1 = it2Del2;
+        const bool fEEE = (iDel1 == i2);
+        this->erase( this->begin()+i2 );
+        if ( iDel1 > i2 )
+          --iDel1;
+        iDel2 = this->insert( Interval<N>( intv.right, it2r ) ) - this->begin();
+        if ( fEEE )
+          iDel1 = iDel2;
+        else if ( iDel1 >= iDel2 )
+          ++iDel1;
       }
     }
     DBGOUT_MIPD__( "; after split 2: " << (*this) );
-    DBGOUT_MIPD__( "; cutting out: " << SetOfIntervals(it2Del1, it2Del2) );
+    DBGOUT_MIPD__( "; cutting out: "
+      << SetOfIntervals(this->begin()+iDel1, this->begin()+iDel2) );
 #ifdef MZN_DBG_CHECK_ITER_CUTOUT
-    {
-      auto it=this->begin();
-      int nO=0;
-      do {
-        if ( it==it2Del1 ) {
-          MZN_MIPD__assert_hard( !nO );
-          ++ nO;
-        }
-        if ( it==it2Del2 ) {
-          MZN_MIPD__assert_hard( 1==nO );
-          ++ nO;
-        }
-        if ( this->end()==it )
-          break;
-        ++it;
-      } while ( 1 );
-      MZN_MIPD__assert_hard( 2==nO );
-    }
+    MZN_MIPD__assert_hard( iDel1 <= iDel2 );
+    MZN_MIPD__assert_hard( iDel2 <= this->size() );
 #endif
-    this->erase( it2Del1,  it2Del2 );
+    this->erase( this->begin()+iDel1, this->begin()+iDel2 );
     DBGOUT_MIPD( " ... gives " << (*this) );
   }
   template <class N> typename
@@ -1872,9 +1991,9 @@ namespace MiniZinc {
     MZN_MIPD__assert_hard( pos>=it->left );
     MZN_MIPD__assert_hard( pos<=it->right );
     Interval<N> intvOld = *it;
-    this->erase(it);
-    iterator it_01 = this->insert( Interval<N> ( intvOld.left, pos ) );
-    iterator it_02 = this->insert( Interval<N> ( pos, intvOld.right ) );
+    *it = Interval<N> ( intvOld.left, pos );
+    iterator it_02 = Base::insert( it+1, Interval<N> ( pos, intvOld.right ) );
+    iterator it_01 = it_02-1;
     it = this->end();
     return std::make_pair( it_01, it_02 );
   }
@@ -1882,9 +2001,7 @@ namespace MiniZinc {
   Interval<N> SetOfIntervals<N>::getBounds() const {
     if ( this->empty() )
       return Interval<N>( Interval<N>::infPlus(), Interval<N>::infMinus() );
-    iterator it2 = this->end();
-    --it2;
-    return Interval<N>( this->begin()->left, it2->right );
+    return Interval<N>( this->front().left, this->back().right );
   }
   template <class N>
   bool SetOfIntervals<N>::checkFiniteBounds() {
@@ -1909,11 +2026,16 @@ namespace MiniZinc {
     }
     return true;
   }
+
+  // Also used by the interval tests (tests/cpp/intervals.cpp)
+  template class SetOfIntervals<double>;
+  template void SetOfIntervals<double>::intersect<double>(const SetOfIntervals<double>&);
+  template void SetOfIntervals<double>::cutDeltas<double>(const SetOfIntervals<double>&, double);
   
   bool MIPD::fVerbose = false;
 
-  void MIPdomains(Env& env, bool fVerbose) {
-    MIPD mipd( &env, fVerbose );
+  void MIPdomains(Env& env, bool fVerbose, unsigned int nThreads) {
+    MIPD mipd( &env, fVerbose, nThreads );
     if ( ! mipd.MIPdomains() ) {
       GCLock lock;
       env.envi().fail();
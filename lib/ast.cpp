@@ -444,6 +444,7 @@ namespace MiniZinc {
       Id* sBOT_NOT;
       
       OpToString(void) {
+        GCPermanent permanent;
         GCLock lock;
         rootSetModel = new Model();
         std::vector<Expression*> rootSet;
@@ -1081,6 +1082,7 @@ namespace MiniZinc {
   }
   
   Constants::Constants(void) {
+    GCPermanent permanent;
     GCLock lock;
     TypeInst* ti = new TypeInst(Location(), Type::parbool());
     lit_true = new BoolLit(Location(), true);
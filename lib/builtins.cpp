@@ -17,6 +17,7 @@
 #include <minizinc/prettyprinter.hh>
 #include <minizinc/flatten_internal.hh>
 #include <minizinc/file_utils.hh>
+#include <minizinc/intsetops.hh>
 
 #include <iomanip>
 #include <climits>
@@ -80,6 +81,147 @@ namespace MiniZinc {
     }
   }
 
+  namespace {
+    /*
+     * Fast paths for par numeric arrays
+     *
+     * After evaluation, par int and float arrays almost always consist of
+     * literals only. The builtins below read such literals straight from
+     * the ArrayLit, bypassing eval_int/eval_float, and only fall back to the
+     * generic code at the first element that is not a finite literal.
+     */
+
+    /// Set \a v to the value of \a e if \a e is a finite integer literal
+    inline bool par_value(Expression* e, long long int& v) {
+      if (e->isUnboxedInt()) {
+        v = e->unboxedIntToIntVal().toInt();
+        return true;
+      }
+      if (e->eid()==Expression::E_INTLIT) {
+        IntVal iv = e->cast<IntLit>()->v();
+        if (iv.isFinite()) {
+          v = iv.toInt();
+          return true;
+        }
+      }
+      return false;
+    }
+
+    /// Set \a v to the value of \a e if \a e is a finite float literal
+    inline bool par_value(Expression* e, double& v) {
+      FloatLit* fl = e->dyn_cast<FloatLit>();
+      if (fl==NULL || !fl->v().isFinite())
+        return false;
+      v = fl->v().toDouble();
+      return true;
+    }
+
+    /// Copy values of \a al into \a v if all elements are finite literals
+    template<class T>
+    bool par_values(ArrayLit* al, std::vector<T>& v) {
+      ASTExprVec<Expression> a = al->v();
+      v.resize(a.size());
+      for (unsigned int i=0; i<a.size(); i++) {
+        if (!par_value(a[i], v[i]))
+          return false;
+      }
+      return true;
+    }
+
+    /**
+     * \brief Find minimum and maximum of the non-empty array \a al
+     *
+     * Returns false if an element of \a al is not a finite literal.
+     * Otherwise sets \a mn and \a mx, and \a imin and \a imax to the
+     * positions of their first occurrences.
+     */
+    template<class T>
+    bool par_minmax(ArrayLit* al, T& mn, T& mx, unsigned int& imin, unsigned int& imax) {
+      ASTExprVec<Expression> a = al->v();
+      if (!par_value(a[0], mn))
+        return false;
+      mx = mn;
+      imin = 0;
+      imax = 0;
+      for (unsigned int i=1; i<a.size(); i++) {
+        T v;
+        if (!par_value(a[i], v))
+          return false;
+        if (v < mn) {
+          mn = v;
+          imin = i;
+        }
+        if (v > mx) {
+          mx = v;
+          imax = i;
+        }
+      }
+      return true;
+    }
+
+    /// Return \a e if it is an array comprehension that can be folded without materialising it
+    Comprehension* par_array_comp(Expression* e) {
+      Comprehension* c = e->dyn_cast<Comprehension>();
+      return (c != NULL && !c->set() && c->type().ispar()) ? c : NULL;
+    }
+
+    /// Evaluators for elements of par comprehensions
+    class CompIntVal {
+    public:
+      typedef IntVal ArrayVal;
+      static IntVal e(EnvI& env, Expression* e) { return eval_int(env,e); }
+    };
+    class CompFloatVal {
+    public:
+      typedef FloatVal ArrayVal;
+      static FloatVal e(EnvI& env, Expression* e) { return eval_float(env,e); }
+    };
+    class CompBoolVal {
+    public:
+      typedef bool ArrayVal;
+      static bool e(EnvI& env, Expression* e) { return eval_bool(env,e); }
+    };
+
+    /// Accumulators for folding comprehensions using eval_comp_stream
+    template<class T>
+    class SumAcc {
+    public:
+      T v;
+      SumAcc(void) : v(0) {}
+      void push_back(const T& x) { v += x; }
+    };
+    template<class T, bool isMin>
+    class MinMaxAcc {
+    public:
+      T v;
+      bool empty;
+      MinMaxAcc(void) : v(0), empty(true) {}
+      void push_back(const T& x) {
+        if (empty || (isMin ? x < v : x > v))
+          v = x;
+        empty = false;
+      }
+    };
+    /// Accumulator for forall (\a isForall) or exists
+    ///
+    /// All elements are evaluated (as for an array argument), so that
+    /// errors in elements after the one deciding the result are reported.
+    template<bool isForall>
+    class BoolAcc {
+    public:
+      bool v;
+      BoolAcc(void) : v(isForall) {}
+      void push_back(bool x) { if (x != isForall) v = x; }
+    };
+
+    /// Fold the par comprehension \a c into accumulator \a a
+    template<class Eval, class Acc>
+    void fold_comp(EnvI& env, Comprehension* c, Acc& a) {
+      Eval eval;
+      eval_comp_stream(env, eval, c, a);
+    }
+  }
+
   IntVal b_int_min(EnvI& env, Call* call) {
     ASTExprVec<Expression> args = call->args();
     switch (args.size()) {
@@ -88,9 +230,21 @@ namespace MiniZinc {
         throw EvalError(env, args[0]->loc(), "sets not supported");
       } else {
         GCLock lock;
+        if (Comprehension* c = par_array_comp(args[0])) {
+          MinMaxAcc<IntVal,true> acc;
+          fold_comp<CompIntVal>(env, c, acc);
+          if (acc.empty)
+            throw ResultUndefinedError(env, c->loc(), "minimum of empty array is undefined");
+          return acc.v;
+        }
         ArrayLit* al = eval_array_lit(env,args[0]);
         if (al->v().size()==0)
           throw ResultUndefinedError(env, al->loc(), "minimum of empty array is undefined");
+        long long int mn, mx;
+        unsigned int imin, imax;
+        if (par_minmax(al, mn, mx, imin, imax)) {
+          return mn;
+        }
         IntVal m = eval_int(env,al->v()[0]);
         for (unsigned int i=1; i<al->v().size(); i++)
           m = std::min(m, eval_int(env,al->v()[i]));
@@ -113,9 +267,21 @@ namespace MiniZinc {
         throw EvalError(env, args[0]->loc(), "sets not supported");
       } else {
         GCLock lock;
+        if (Comprehension* c = par_array_comp(args[0])) {
+          MinMaxAcc<IntVal,false> acc;
+          fold_comp<CompIntVal>(env, c, acc);
+          if (acc.empty)
+            throw ResultUndefinedError(env, c->loc(), "maximum of empty array is undefined");
+          return acc.v;
+        }
         ArrayLit* al = eval_array_lit(env,args[0]);
         if (al->v().size()==0)
           throw ResultUndefinedError(env, al->loc(), "maximum of empty array is undefined");
+        long long int mn, mx;
+        unsigned int imin, imax;
+        if (par_minmax(al, mn, mx, imin, imax)) {
+          return mx;
+        }
         IntVal m = eval_int(env,al->v()[0]);
         for (unsigned int i=1; i<al->v().size(); i++)
           m = std::max(m, eval_int(env,al->v()[i]));
@@ -136,6 +302,11 @@ namespace MiniZinc {
     ArrayLit* al = eval_array_lit(env,args[0]);
     if (al->v().size()==0)
       throw ResultUndefinedError(env, al->loc(), "argmin of empty array is undefined");
+    long long int mn, mx;
+    unsigned int imin, imax;
+    if (par_minmax(al, mn, mx, imin, imax)) {
+      return static_cast<long long int>(imin)+1;
+    }
     IntVal m = eval_int(env,al->v()[0]);
     int m_idx = 0;
     for (unsigned int i=1; i<al->v().size(); i++) {
@@ -153,6 +324,11 @@ namespace MiniZinc {
     ArrayLit* al = eval_array_lit(env,args[0]);
     if (al->v().size()==0)
       throw ResultUndefinedError(env, al->loc(), "argmax of empty array is undefined");
+    long long int mn, mx;
+    unsigned int imin, imax;
+    if (par_minmax(al, mn, mx, imin, imax)) {
+      return static_cast<long long int>(imax)+1;
+    }
     IntVal m = eval_int(env,al->v()[0]);
     int m_idx = 0;
     for (unsigned int i=1; i<al->v().size(); i++) {
@@ -170,6 +346,11 @@ namespace MiniZinc {
     ArrayLit* al = eval_array_lit(env,args[0]);
     if (al->v().size()==0)
       throw ResultUndefinedError(env, al->loc(), "argmin of empty array is undefined");
+    double mn, mx;
+    unsigned int imin, imax;
+    if (par_minmax(al, mn, mx, imin, imax)) {
+      return static_cast<long long int>(imin)+1;
+    }
     FloatVal m = eval_float(env,al->v()[0]);
     int m_idx = 0;
     for (unsigned int i=1; i<al->v().size(); i++) {
@@ -187,6 +368,11 @@ namespace MiniZinc {
     ArrayLit* al = eval_array_lit(env,args[0]);
     if (al->v().size()==0)
       throw ResultUndefinedError(env, al->loc(), "argmax of empty array is undefined");
+    double mn, mx;
+    unsigned int imin, imax;
+    if (par_minmax(al, mn, mx, imin, imax)) {
+      return static_cast<long long int>(imax)+1;
+    }
     FloatVal m = eval_float(env,al->v()[0]);
     int m_idx = 0;
     for (unsigned int i=1; i<al->v().size(); i++) {
@@ -291,11 +477,17 @@ namespace MiniZinc {
       if (al->v().size()==0)
         throw EvalError(env, Location(), "lower bound of empty array undefined");
       IntVal min = IntVal::infinity();
-      for (unsigned int i=0; i<al->v().size(); i++) {
-        IntBounds ib = compute_int_bounds(env,al->v()[i]);
-        if (!ib.valid)
-          goto b_array_lb_int_done;
-        min = std::min(min, ib.l);
+      long long int mn, mx;
+      unsigned int imin, imax;
+      if (par_minmax(al, mn, mx, imin, imax)) {
+        min = mn;
+      } else {
+        for (unsigned int i=0; i<al->v().size(); i++) {
+          IntBounds ib = compute_int_bounds(env,al->v()[i]);
+          if (!ib.valid)
+            goto b_array_lb_int_done;
+          min = std::min(min, ib.l);
+        }
       }
       if (foundMin)
         array_lb = std::max(array_lb, min);
@@ -351,11 +543,17 @@ namespace MiniZinc {
       if (al->v().size()==0)
         throw EvalError(env, Location(), "upper bound of empty array undefined");
       IntVal max = -IntVal::infinity();
-      for (unsigned int i=0; i<al->v().size(); i++) {
-        IntBounds ib = compute_int_bounds(env,al->v()[i]);
-        if (!ib.valid)
-          goto b_array_ub_int_done;
-        max = std::max(max, ib.u);
+      long long int mn, mx;
+      unsigned int imin, imax;
+      if (par_minmax(al, mn, mx, imin, imax)) {
+        max = mx;
+      } else {
+        for (unsigned int i=0; i<al->v().size(); i++) {
+          IntBounds ib = compute_int_bounds(env,al->v()[i]);
+          if (!ib.valid)
+            goto b_array_ub_int_done;
+          max = std::max(max, ib.u);
+        }
       }
       if (foundMax)
         array_ub = std::min(array_ub, max);
@@ -375,11 +573,24 @@ namespace MiniZinc {
     ASTExprVec<Expression> args = call->args();
     assert(args.size()==1);
     GCLock lock;
+    if (Comprehension* c = par_array_comp(args[0])) {
+      SumAcc<IntVal> acc;
+      fold_comp<CompIntVal>(env, c, acc);
+      return acc.v;
+    }
     ArrayLit* al = eval_array_lit(env,args[0]);
-    if (al->v().size()==0)
-      return 0;
-    IntVal m = 0;
-    for (unsigned int i=0; i<al->v().size(); i++)
+    // Add literals without overflow checks until a partial sum would
+    // overflow, then continue with checked IntVal arithmetic, which throws
+    // an ArithmeticError exactly where the generic code would
+    long long int s = 0;
+    unsigned int i = 0;
+    for (long long int v; i<al->v().size() && par_value(al->v()[i], v); i++) {
+      if (v > 0 ? s > LLONG_MAX - v : s < LLONG_MIN - v)
+        break;
+      s += v;
+    }
+    IntVal m = s;
+    for (; i<al->v().size(); i++)
       m += eval_int(env,al->v()[i]);
     return m;
   }
@@ -392,8 +603,13 @@ namespace MiniZinc {
     if (al->v().size()==0)
       return 1;
     IntVal m = 1;
-    for (unsigned int i=0; i<al->v().size(); i++)
-      m *= eval_int(env,al->v()[i]);
+    for (unsigned int i=0; i<al->v().size(); i++) {
+      long long int v;
+      if (par_value(al->v()[i], v))
+        m *= v;
+      else
+        m *= eval_int(env,al->v()[i]);
+    }
     return m;
   }
 
@@ -404,8 +620,12 @@ namespace MiniZinc {
     ArrayLit* al = eval_array_lit(env,args[0]);
     if (al->v().size()==0)
       return 1;
-    FloatVal m = 1.0;
-    for (unsigned int i=0; i<al->v().size(); i++)
+    double p = 1.0;
+    unsigned int i = 0;
+    for (double v; i<al->v().size() && par_value(al->v()[i], v); i++)
+      p *= v;
+    FloatVal m = p;
+    for (; i<al->v().size(); i++)
       m *= eval_float(env,al->v()[i]);
     return m;
   }
@@ -542,11 +762,21 @@ namespace MiniZinc {
     ASTExprVec<Expression> args = call->args();
     assert(args.size()==1);
     GCLock lock;
+    if (Comprehension* c = par_array_comp(args[0])) {
+      SumAcc<FloatVal> acc;
+      fold_comp<CompFloatVal>(env, c, acc);
+      return acc.v;
+    }
     ArrayLit* al = eval_array_lit(env,args[0]);
     if (al->v().size()==0)
       return 0;
-    FloatVal m = 0;
-    for (unsigned int i=0; i<al->v().size(); i++)
+    // Keep the sequential order of additions so that rounding is not affected
+    double sum = 0.0;
+    unsigned int i = 0;
+    for (double v; i<al->v().size() && par_value(al->v()[i], v); i++)
+      sum += v;
+    FloatVal m = sum;
+    for (; i<al->v().size(); i++)
       m += eval_float(env,al->v()[i]);
     return m;
   }
@@ -559,9 +789,21 @@ namespace MiniZinc {
           throw EvalError(env, args[0]->loc(), "sets not supported");
         } else {
           GCLock lock;
+          if (Comprehension* c = par_array_comp(args[0])) {
+            MinMaxAcc<FloatVal,true> acc;
+            fold_comp<CompFloatVal>(env, c, acc);
+            if (acc.empty)
+              throw EvalError(env, c->loc(), "min on empty array undefined");
+            return acc.v;
+          }
           ArrayLit* al = eval_array_lit(env,args[0]);
           if (al->v().size()==0)
             throw EvalError(env, al->loc(), "min on empty array undefined");
+          double mn, mx;
+          unsigned int imin, imax;
+          if (par_minmax(al, mn, mx, imin, imax)) {
+            return mn;
+          }
           FloatVal m = eval_float(env,al->v()[0]);
           for (unsigned int i=1; i<al->v().size(); i++)
             m = std::min(m, eval_float(env,al->v()[i]));
@@ -584,9 +826,21 @@ namespace MiniZinc {
           throw EvalError(env, args[0]->loc(), "sets not supported");
         } else {
           GCLock lock;
+          if (Comprehension* c = par_array_comp(args[0])) {
+            MinMaxAcc<FloatVal,false> acc;
+            fold_comp<CompFloatVal>(env, c, acc);
+            if (acc.empty)
+              throw EvalError(env, c->loc(), "max on empty array undefined");
+            return acc.v;
+          }
           ArrayLit* al = eval_array_lit(env,args[0]);
           if (al->v().size()==0)
             throw EvalError(env, al->loc(), "max on empty array undefined");
+          double mn, mx;
+          unsigned int imin, imax;
+          if (par_minmax(al, mn, mx, imin, imax)) {
+            return mx;
+          }
           FloatVal m = eval_float(env,al->v()[0]);
           for (unsigned int i=1; i<al->v().size(); i++)
             m = std::max(m, eval_float(env,al->v()[i]));
@@ -742,14 +996,11 @@ namespace MiniZinc {
     ArrayLit* al = eval_array_lit(env,args[0]);
     if (al->v().size()==0)
       throw EvalError(env, Location(), "upper bound of empty array undefined");
-    IntSetVal* ub = b_ub_set(env,al->v()[0]);
-    for (unsigned int i=1; i<al->v().size(); i++) {
-      IntSetRanges isr(ub);
-      IntSetRanges r(b_ub_set(env,al->v()[i]));
-      Ranges::Union<IntVal,IntSetRanges,IntSetRanges> u(isr,r);
-      ub = IntSetVal::ai(u);
-    }
-    return ub;
+    IntSetOps ops;
+    ops.startUnion();
+    for (unsigned int i=0; i<al->v().size(); i++)
+      ops.add(b_ub_set(env,al->v()[i]));
+    return ops.result();
   }
 
   IntSetVal* b_dom_varint(EnvI& env, Expression* e) {
@@ -882,14 +1133,12 @@ namespace MiniZinc {
     }
     if (al->v().size()==0)
       return IntSetVal::a();
-    IntSetVal* isv = b_dom_varint(env,al->v()[0]);
-    for (unsigned int i=1; i<al->v().size(); i++) {
-      IntSetRanges isr(isv);
-      IntSetRanges r(b_dom_varint(env,al->v()[i]));
-      Ranges::Union<IntVal,IntSetRanges,IntSetRanges> u(isr,r);
-      isv = IntSetVal::ai(u);
-    }
-    return isv;
+    GCLock lock;
+    IntSetOps ops;
+    ops.startUnion();
+    for (unsigned int i=0; i<al->v().size(); i++)
+      ops.add(b_dom_varint(env,al->v()[i]));
+    return ops.result();
   }
   IntSetVal* b_compute_div_bounds(EnvI& env, Call* call) {
     ASTExprVec<Expression> args = call->args();
@@ -1047,6 +1296,11 @@ namespace MiniZinc {
     if (args.size()!=1)
       throw EvalError(env, Location(), "forall needs exactly one argument");
     GCLock lock;
+    if (Comprehension* c = par_array_comp(args[0])) {
+      BoolAcc<true> acc;
+      fold_comp<CompBoolVal>(env, c, acc);
+      return acc.v;
+    }
     ArrayLit* al = eval_array_lit(env,args[0]);
     for (unsigned int i=al->v().size(); i--;)
       if (!eval_bool(env,al->v()[i]))
@@ -1058,6 +1312,11 @@ namespace MiniZinc {
     if (args.size()!=1)
       throw EvalError(env, Location(), "exists needs exactly one argument");
     GCLock lock;
+    if (Comprehension* c = par_array_comp(args[0])) {
+      BoolAcc<false> acc;
+      fold_comp<CompBoolVal>(env, c, acc);
+      return acc.v;
+    }
     ArrayLit* al = eval_array_lit(env,args[0]);
     for (unsigned int i=al->v().size(); i--;)
       if (eval_bool(env,al->v()[i]))
@@ -1606,64 +1865,27 @@ namespace MiniZinc {
   IntSetVal* b_array_union(EnvI& env, Call* call) {
     ASTExprVec<Expression> args = call->args();
     assert(args.size()==1);
+    GCLock lock;
     ArrayLit* al = eval_array_lit(env,args[0]);
-    if (al->v().size()==0)
-      return IntSetVal::a();
-    IntSetVal* isv = eval_intset(env,al->v()[0]);
-    for (unsigned int i=0; i<al->v().size(); i++) {
-      IntSetRanges i0(isv);
-      IntSetRanges i1(eval_intset(env,al->v()[i]));
-      Ranges::Union<IntVal,IntSetRanges, IntSetRanges> u(i0,i1);
-      isv = IntSetVal::ai(u);
-    }
-    return isv;
+    IntSetOps ops;
+    ops.startUnion();
+    for (unsigned int i=0; i<al->v().size(); i++)
+      ops.add(eval_intset(env,al->v()[i]));
+    return ops.result();
   }
   
   IntSetVal* b_array_intersect(EnvI& env, Call* call) {
     ASTExprVec<Expression> args = call->args();
     assert(args.size()==1);
+    GCLock lock;
     ArrayLit* al = eval_array_lit(env,args[0]);
-    std::vector<IntSetVal::Range> ranges;
-    if (al->v().size() > 0) {
-      IntSetVal* i0 = eval_intset(env,al->v()[0]);
-      if (i0->size() > 0) {
-        IntSetRanges i0r(i0);
-        IntVal min = i0r.min();
-        while (i0r()) {
-          // Initialize with last interval
-          IntVal max = i0r.max();
-          // Intersect with all other intervals
-        restart:
-          for (int j=al->v().size(); j--;) {
-            IntSetRanges ij(eval_intset(env,al->v()[j]));
-            // Skip intervals that are too small
-            while (ij() && (ij.max() < min))
-              ++ij;
-            if (!ij())
-              goto done;
-            if (ij.min() > max) {
-              min=ij.min();
-              max=ij.max();
-              goto restart;
-            }
-            // Now the intervals overlap
-            if (min < ij.min())
-              min = ij.min();
-            if (max > ij.max())
-              max = ij.max();
-          }
-          ranges.push_back(IntSetVal::Range(min,max));
-          // The next interval must be at least two elements away
-          min = max + 2;
-        }
-      done:
-        return IntSetVal::a(ranges);
-      } else {
-        return IntSetVal::a();
-      }
-    } else {
+    if (al->v().size()==0)
       return IntSetVal::a();
-    }
+    IntSetOps ops;
+    ops.startIntersect();
+    for (unsigned int i=0; i<al->v().size() && !ops.empty(); i++)
+      ops.add(eval_intset(env,al->v()[i]));
+    return ops.result();
   }
   
   Expression* b_sort_by_int(EnvI& env, Call* call) {
@@ -1675,7 +1897,11 @@ namespace MiniZinc {
     std::vector<int> a(order_e->v().size());
     for (unsigned int i=0; i<order.size(); i++) {
       a[i] = i;
-      order[i] = eval_int(env,order_e->v()[i]);
+      long long int v;
+      if (par_value(order_e->v()[i], v))
+        order[i] = v;
+      else
+        order[i] = eval_int(env,order_e->v()[i]);
     }
     struct Ord {
       std::vector<IntVal>& order;
@@ -1702,7 +1928,11 @@ namespace MiniZinc {
     std::vector<int> a(order_e->v().size());
     for (unsigned int i=0; i<order.size(); i++) {
       a[i] = i;
-      order[i] = eval_float(env,order_e->v()[i]);
+      double v;
+      if (par_value(order_e->v()[i], v))
+        order[i] = v;
+      else
+        order[i] = eval_float(env,order_e->v()[i]);
     }
     struct Ord {
       std::vector<FloatVal>& order;
@@ -1725,6 +1955,27 @@ namespace MiniZinc {
     assert(args.size()==1);
     ArrayLit* al = eval_array_lit(env,args[0]);
     std::vector<Expression*> sorted(al->v().size());
+    if (al->type().bt()==Type::BT_INT) {
+      std::vector<long long int> v;
+      if (par_values(al, v)) {
+        std::sort(v.begin(), v.end());
+        for (unsigned int i=sorted.size(); i--;)
+          sorted[i] = IntLit::a(v[i]);
+        ArrayLit* al_sorted = new ArrayLit(al->loc(), sorted);
+        al_sorted->type(al->type());
+        return al_sorted;
+      }
+    } else if (al->type().bt()==Type::BT_FLOAT) {
+      std::vector<double> v;
+      if (par_values(al, v)) {
+        std::sort(v.begin(), v.end());
+        for (unsigned int i=sorted.size(); i--;)
+          sorted[i] = FloatLit::a(v[i]);
+        ArrayLit* al_sorted = new ArrayLit(al->loc(), sorted);
+        al_sorted->type(al->type());
+        return al_sorted;
+      }
+    }
     for (unsigned int i=sorted.size(); i--;)
       sorted[i] = al->v()[i];
     struct Ord {
@@ -1,2 +1,2 @@
 set(lexer_lxx_md5_cached "329d57c60eba35fcd1af07b097da6d2b")
-set(parser_yxx_md5_cached "8d990570ba88d129d1f294af8dbb6a5e")
\ No newline at end of file
+set(parser_yxx_md5_cached "4a20d54ebd5b335625e7d9fd7db2cace")
\ No newline at end of file
@@ -334,6 +334,8 @@ namespace MiniZinc{ class Location; }
 #include <minizinc/parser.hh>
 #include <minizinc/file_utils.hh>
 #include <minizinc/json_parser.hh>
+#include <minizinc/library_index.hh>
+#include <minizinc/copy.hh>
 
 using namespace std;
 using namespace MiniZinc;
@@ -425,6 +427,37 @@ Expression* createArrayAccess(const Location& loc, Expression* e, std::vector<st
   return ret;
 }
 
+// Add the items of \a cached, the cached library file \a fullname, to \a m
+// (copies if \a mustCopy), and queue the included files like the include
+// items of the parser
+void addCachedItems(EnvI& env, Model* cached, bool mustCopy, Model* m, const string& fullname,
+                    vector<pair<string,Model*> >& files, map<string,Model*>& seenModels) {
+  string fpath, fbase; filepath(fullname, fpath, fbase);
+  if (fpath=="")
+    fpath="./";
+  CopyMap cm;
+  for (unsigned int i=0; i<cached->size(); i++) {
+    Item* item = (*cached)[i];
+    if (IncludeI* ci = item->dyn_cast<IncludeI>()) {
+      IncludeI* ii = new IncludeI(ci->loc(),ci->f());
+      map<string,Model*>::iterator ret = seenModels.find(ci->f().str());
+      if (ret == seenModels.end()) {
+        Model* im = new Model;
+        im->setParent(m);
+        im->setFilename(ci->f().str());
+        files.push_back(pair<string,Model*>(fpath, im));
+        ii->m(im);
+        seenModels.insert(pair<string,Model*>(ci->f().str(),im));
+      } else {
+        ii->m(ret->second, false);
+      }
+      m->addItem(ii);
+    } else {
+      m->addItem(mustCopy ? copy(env,cm,item) : item);
+    }
+  }
+}
+
 namespace MiniZinc {
 
   Model* parseFromString(const string& text,
@@ -550,7 +583,9 @@ namespace MiniZinc {
              bool ignoreStdlib,
              bool parseDocComments,
              bool verbose,
-             ostream& err) {
+             ostream& err,
+             LibraryIndex* libIndex,
+             LibraryCache* libCache) {
     
     vector<string> includePaths;
     for (unsigned int i=0; i<ip.size(); i++)
@@ -558,6 +593,8 @@ namespace MiniZinc {
     
     vector<pair<string,Model*> > files;
     map<string,Model*> seenModels;
+    LazyLibrary lazy(libIndex, includePaths);
+    bool parsedData = false;
     
     if (filenames.size() > 0) {
       GCLock lock;
@@ -598,6 +635,7 @@ namespace MiniZinc {
       model->addItem(stdlibinc);
     }
     
+  parse_files:
     while (!files.empty()) {
       GCLock lock;
       pair<string,Model*>& np = files.back();
@@ -617,6 +655,7 @@ namespace MiniZinc {
       }
       ifstream file;
       string fullname;
+      bool inLibrary = false;
       if (parentPath=="") {
         if (filenames.size() == 0) {
           err << "Internal error." << endl;
@@ -632,8 +671,10 @@ namespace MiniZinc {
           fullname = includePaths[i]+f;
           if (FileUtils::file_exists(fullname)) {
             file.open(fullname.c_str(), std::ios::binary);
-            if (file.is_open())
+            if (file.is_open()) {
+              inLibrary = i+1 < includePaths.size();
               break;
+            }
           }
         }
         includePaths.pop_back();
@@ -642,6 +683,18 @@ namespace MiniZinc {
         err << "Error: cannot open file '" << f << "'." << endl;
         goto error;
       }
+      if (inLibrary && lazy.defer(parentPath, m, fullname))
+        continue;
+      if (inLibrary && libCache) {
+        if (Model* cached = libCache->find(fullname)) {
+          if (verbose)
+            std::cerr << "using cached file '" << fullname << "'" << endl;
+          m->setFilepath(fullname);
+          addCachedItems(env.envi(), cached, libCache->mustCopy(), m, fullname, files, seenModels);
+          lazy.parsed(m, fullname, inLibrary);
+          continue;
+        }
+      }
       if (verbose)
         std::cerr << "processing file '" << fullname << "'" << endl;
       std::string s = get_file_contents(file);
@@ -659,9 +712,12 @@ namespace MiniZinc {
       if (pp.hadError) {
         goto error;
       }
+      lazy.parsed(m, fullname, inLibrary);
+      if (inLibrary && libCache)
+        libCache->add(env.envi(), fullname, m);
     }
     
-    for (unsigned int i=0; i<datafiles.size(); i++) {
+    for (unsigned int i=0; !parsedData && i<datafiles.size(); i++) {
       GCLock lock;
       string f = datafiles[i];
       if (f.size()>6 && f.substr(f.size()-5,string::npos)==".json") {
@@ -694,6 +750,14 @@ namespace MiniZinc {
         }
       }
     }
+    parsedData = true;
+    
+    // Parse the deferred library files that the model and data need
+    if (lazy.resolve(files))
+      goto parse_files;
+    if (verbose && libIndex)
+      std::cerr << "skipped " << lazy.skipped() << " library files ("
+                << lazy.resolved() << " parsed on demand)" << endl;
     
     return;
   error:
@@ -708,7 +772,9 @@ namespace MiniZinc {
                bool ignoreStdlib,
                bool parseDocComments,
                bool verbose,
-               ostream& err) {
+               ostream& err,
+               LibraryIndex* libIndex,
+               LibraryCache* libCache) {
 
     if (filenames.empty()) {
       err << "Error: no model given" << std::endl;
@@ -721,7 +787,7 @@ namespace MiniZinc {
       model = new Model();
     }
     parse(env, model, filenames, datafiles,
-          ip, ignoreStdlib, parseDocComments, verbose, err);
+          ip, ignoreStdlib, parseDocComments, verbose, err, libIndex, libCache);
     return model;
   }
 
@@ -736,7 +802,7 @@ namespace MiniZinc {
     
     vector<string> filenames;
     parse(env, model, filenames, datafiles, includePaths,
-          ignoreStdlib, parseDocComments, verbose, err);
+          ignoreStdlib, parseDocComments, verbose, err, NULL, NULL);
     return model;
   }
 
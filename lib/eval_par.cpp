@@ -12,6 +12,7 @@
 #include <minizinc/eval_par.hh>
 #include <minizinc/astexception.hh>
 #include <minizinc/iter.hh>
+#include <minizinc/intsetops.hh>
 #include <minizinc/hash.hh>
 #include <minizinc/copy.hh>
 #include <minizinc/astiterator.hh>
@@ -535,6 +536,20 @@ namespace MiniZinc {
       throw ResultUndefinedError(env, e->loc(), "array access out of bounds");
   }
   
+  namespace {
+    /// Collect the operands of nested applications of set operator \a op
+    void collect_set_operands(Expression* e, BinOpType op, std::vector<Expression*>& operands) {
+      BinOp* bo = e->dyn_cast<BinOp>();
+      if (bo && bo->op()==op && bo->type().isintset() &&
+          bo->lhs()->type().isintset() && bo->rhs()->type().isintset()) {
+        collect_set_operands(bo->lhs(), op, operands);
+        collect_set_operands(bo->rhs(), op, operands);
+      } else {
+        operands.push_back(e);
+      }
+    }
+  }
+
   IntSetVal* eval_intset(EnvI& env, Expression* e) {
     if (SetLit* sl = e->dyn_cast<SetLit>()) {
       if (sl->isv())
@@ -548,7 +563,8 @@ namespace MiniZinc {
         std::vector<IntVal> vals(sl->v().size());
         for (unsigned int i=0; i<sl->v().size(); i++)
           vals[i] = eval_int(env,sl->v()[i]);
-        return IntSetVal::a(vals);
+        IntSetOps ops;
+        return ops.fromValues(vals);
       }
     case Expression::E_BOOLLIT:
     case Expression::E_INTLIT: 
@@ -567,14 +583,16 @@ namespace MiniZinc {
         std::vector<IntVal> vals(al->v().size());
         for (unsigned int i=0; i<al->v().size(); i++)
           vals[i] = eval_int(env,al->v()[i]);
-        return IntSetVal::a(vals);
+        IntSetOps ops;
+        return ops.fromValues(vals);
       }
       break;
     case Expression::E_COMP:
       {
         Comprehension* c = e->cast<Comprehension>();
         std::vector<IntVal> a = eval_comp<EvalIntVal>(env,c);
-        return IntSetVal::a(a);
+        IntSetOps ops;
+        return ops.fromValues(a);
       }
     case Expression::E_ID:
       {
@@ -601,38 +619,34 @@ namespace MiniZinc {
     case Expression::E_BINOP:
       {
         BinOp* bo = e->cast<BinOp>();
+        if ((bo->op()==BOT_UNION || bo->op()==BOT_INTERSECT) && bo->type().isintset()) {
+          // Evaluate nested unions or intersections in a single n-ary operation
+          GCLock lock;
+          std::vector<Expression*> operands;
+          collect_set_operands(bo, bo->op(), operands);
+          std::vector<IntSetVal*> sets(operands.size());
+          for (unsigned int i=0; i<operands.size(); i++)
+            sets[i] = eval_intset(env,operands[i]);
+          IntSetOps ops;
+          if (bo->op()==BOT_UNION)
+            ops.startUnion();
+          else
+            ops.startIntersect();
+          for (unsigned int i=0; i<sets.size(); i++)
+            ops.add(sets[i]);
+          return ops.result();
+        }
         Expression* lhs = eval_par(env, bo->lhs());
         Expression* rhs = eval_par(env, bo->rhs());
         if (lhs->type().isintset() && rhs->type().isintset()) {
           IntSetVal* v0 = eval_intset(env,lhs);
           IntSetVal* v1 = eval_intset(env,rhs);
-          IntSetRanges ir0(v0);
-          IntSetRanges ir1(v1);
+          IntSetOps ops;
           switch (bo->op()) {
-          case BOT_UNION:
-            {
-              Ranges::Union<IntVal,IntSetRanges,IntSetRanges> u(ir0,ir1);
-              return IntSetVal::ai(u);
-            }
           case BOT_DIFF:
-            {
-              Ranges::Diff<IntVal,IntSetRanges,IntSetRanges> u(ir0,ir1);
-              return IntSetVal::ai(u);
-            }
+            return ops.diffSet(v0,v1);
           case BOT_SYMDIFF:
-            {
-              Ranges::Union<IntVal,IntSetRanges,IntSetRanges> u(ir0,ir1);
-              Ranges::Inter<IntVal,IntSetRanges,IntSetRanges> i(ir0,ir1);
-              Ranges::Diff<IntVal,
-                           Ranges::Union<IntVal,IntSetRanges,IntSetRanges>,
-                           Ranges::Inter<IntVal,IntSetRanges,IntSetRanges>> sd(u,i);
-              return IntSetVal::ai(sd);
-            }
-          case BOT_INTERSECT:
-            {
-              Ranges::Inter<IntVal,IntSetRanges,IntSetRanges> u(ir0,ir1);
-              return IntSetVal::ai(u);
-            }
+            return ops.symdiffSet(v0,v1);
           default: throw EvalError(env, e->loc(),"not a set of int expression", bo->opToString());
           }
         } else if (lhs->type().isint() && rhs->type().isint()) {
@@ -2433,6 +2447,7 @@ namespace MiniZinc {
     std::vector<IntSetVal*> _bounds;
     bool valid;
     EnvI& env;
+    IntSetOps ops;
     ComputeIntSetBounds(EnvI& env0) : valid(true), env(env0) {}
     bool enter(Expression* e) {
       if (e->type().isann())
@@ -2455,20 +2470,21 @@ namespace MiniZinc {
       assert(sl.type().isvar());
       assert(sl.isv()==NULL);
 
-      IntSetVal* isv = IntSetVal::a();
+      std::vector<IntBounds> ibs;
+      ibs.reserve(sl.v().size());
       for (unsigned int i=0; i<sl.v().size(); i++) {
-        IntSetRanges i0(isv);
         IntBounds ib = compute_int_bounds(env,sl.v()[i]);
         if (!ib.valid || !ib.l.isFinite() || !ib.u.isFinite()) {
           valid = false;
           _bounds.push_back(NULL);
           return;
         }
-        Ranges::Const<IntVal> cr(ib.l,ib.u);
-        Ranges::Union<IntVal,IntSetRanges, Ranges::Const<IntVal> > u(i0,cr);
-        isv = IntSetVal::ai(u);
+        ibs.push_back(ib);
       }
-      _bounds.push_back(isv);
+      ops.startUnion();
+      for (unsigned int i=0; i<ibs.size(); i++)
+        ops.add(ibs[i].l,ibs[i].u);
+      _bounds.push_back(ops.result());
     }
     /// Visit identifier
     void vId(const Id& id) {
@@ -2542,12 +2558,7 @@ namespace MiniZinc {
         switch (bo.op()) {
         case BOT_INTERSECT:
         case BOT_UNION:
-          {
-            IntSetRanges b0r(b0);
-            IntSetRanges b1r(b1);
-            Ranges::Union<IntVal,IntSetRanges,IntSetRanges> u(b0r,b1r);
-            _bounds.push_back(IntSetVal::ai(u));
-          }
+          _bounds.push_back(ops.unionSet(b0,b1));
           break;
         case BOT_DIFF:
           {
@@ -2596,10 +2607,7 @@ namespace MiniZinc {
       if (valid && (c.id() == "set_intersect" || c.id() == "set_union")) {
         IntSetVal* b0 = _bounds.back(); _bounds.pop_back();
         IntSetVal* b1 = _bounds.back(); _bounds.pop_back();
-        IntSetRanges b0r(b0);
-        IntSetRanges b1r(b1);
-        Ranges::Union<IntVal,IntSetRanges,IntSetRanges> u(b0r,b1r);
-        _bounds.push_back(IntSetVal::ai(u));
+        _bounds.push_back(ops.unionSet(b0,b1));
       } else if (valid && c.id() == "set_diff") {
         IntSetVal* b0 = _bounds.back(); _bounds.pop_back();
         _bounds.pop_back(); // don't need bounds of right hand side
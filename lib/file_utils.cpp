@@ -110,6 +110,15 @@ namespace MiniZinc { namespace FileUtils {
 #endif
   }
 
+  bool file_stamp(const std::string& filename, long long& size, long long& mtime) {
+    struct stat info;
+    if (stat(filename.c_str(), &info)!=0 || !(info.st_mode & S_IFREG))
+      return false;
+    size = static_cast<long long>(info.st_size);
+    mtime = static_cast<long long>(info.st_mtime);
+    return true;
+  }
+
   std::string file_path(const std::string& filename) {
 #ifdef _MSC_VER
     LPSTR lpBuffer, lpFilePart;
@@ -21,6 +21,9 @@
 #include <minizinc/stl_map_set.hh>
 
 #include <minizinc/flatten_internal.hh>
+#include <minizinc/flatten_incremental.hh>
+#include <minizinc/instrumentation.hh>
+#include <minizinc/flatten_profiler.hh>
 
 namespace MiniZinc {
 
@@ -169,7 +172,7 @@ namespace MiniZinc {
 
 #define MZN_FILL_REIFY_MAP(T,ID) reifyMap.insert(std::pair<ASTString,ASTString>(constants().ids.T.ID,constants().ids.T ## reif.ID));
 
-  EnvI::EnvI(Model* orig0) : orig(orig0), output(new Model), ignorePartial(false), maxCallStack(0), collect_vardecls(false), in_redundant_constraint(0), in_maybe_partial(0), _flat(new Model), _failed(false), ids(0) {
+  EnvI::EnvI(Model* orig0) : orig(orig0), output(new Model), ignorePartial(false), maxCallStack(0), collect_vardecls(false), in_redundant_constraint(0), in_maybe_partial(0), cse_record(false), cse_foreign(false), cse_lookups(0), cse_hits(0), profiler(NULL), _flat(new Model), _flatRemoved(0), _failed(false), ids(0) {
     MZN_FILL_REIFY_MAP(int_,lin_eq);
     MZN_FILL_REIFY_MAP(int_,lin_le);
     MZN_FILL_REIFY_MAP(int_,lin_ne);
@@ -215,10 +218,13 @@ namespace MiniZinc {
   void EnvI::map_insert(Expression* e, const EE& ee) {
       KeepAlive ka(e);
       map.insert(ka,WW(ee.r(),ee.b()));
+      if (cse_record)
+        cse_keys.insert(e);
     }
   EnvI::Map::iterator EnvI::map_find(Expression* e) {
     KeepAlive ka(e);
     Map::iterator it = map.find(ka);
+    cse_lookups++;
     if (it != map.end()) {
       if (it->second.r()) {
         if (it->second.r()->isa<VarDecl>()) {
@@ -229,6 +235,10 @@ namespace MiniZinc {
       } else {
         return map.end();
       }
+      if (cse_record && !it->first()->type().ispar() &&
+          cse_keys.find(it->first()) == cse_keys.end())
+        cse_foreign = true;
+      cse_hits++;
     }
     return it;
   }
@@ -254,6 +264,8 @@ namespace MiniZinc {
     assert(_flat);
     if (_failed)
       return;
+    if (profiler)
+      profiler->addItem(i);
     _flat->addItem(i);
     Expression* toAnnotate = NULL;
     Expression* toAdd = NULL;
@@ -315,10 +327,44 @@ namespace MiniZinc {
   }
   
   void EnvI::flat_removeItem(MiniZinc::Item* i) {
+    if (!i->removed() && i->isa<ConstraintI>())
+      _flatRemoved++;
     i->remove();
   }
   void EnvI::flat_removeItem(int i) {
-    (*_flat)[i]->remove();
+    flat_removeItem((*_flat)[i]);
+  }
+  void EnvI::flat_compact(bool all) {
+    // Removed constraints are only compacted away once they make up a
+    // quarter of the model, so that the passes that scan the whole model do
+    // not keep skipping them, while the cost of reindexing is amortised over
+    // the removals. Removed variable declarations stay, since optimize still
+    // looks up unified variables through their indices.
+    if (!all && (_flatRemoved==0 || _flatRemoved < _flat->size()/4))
+      return;
+    VarOccurrences::Items removed;
+    _flat->compact(removed, !all);
+    flat_reindex(removed);
+  }
+  void EnvI::flat_reindex(const VarOccurrences::Items& removed) {
+    // This is the only place where indices of flat items are rebuilt, so
+    // it must cover everything that refers to flat items: the positions of
+    // the variable declarations (vo.idx), the occurrence lists, which must
+    // not keep items that have left the model, and the count of removed
+    // constraints that are still in the model.
+    IdMap<int> idx;
+    _flatRemoved = 0;
+    for (unsigned int i=0; i<_flat->size(); i++) {
+      Item* item = (*_flat)[i];
+      if (VarDeclI* vdi = item->dyn_cast<VarDeclI>()) {
+        if (vo.find(vdi->e()) != -1)
+          idx.insert(vdi->e()->id(), i);
+      } else if (item->removed() && item->isa<ConstraintI>()) {
+        _flatRemoved++;
+      }
+    }
+    std::swap(vo.idx, idx);
+    vo.remove(removed);
   }
   
   void EnvI::fail(void) {
@@ -361,6 +407,7 @@ namespace MiniZinc {
     return enumVarDecls[i-1];
   }
   unsigned int EnvI::registerArrayEnum(const std::vector<unsigned int>& arrayEnum) {
+    std::lock_guard<std::mutex> guard(arrayEnumMutex);
     std::ostringstream oss;
     for (unsigned int i=0; i<arrayEnum.size(); i++) {
       assert(arrayEnum[i] <= enumVarDecls.size());
@@ -378,6 +425,7 @@ namespace MiniZinc {
     return ret+1;
   }
   const std::vector<unsigned int>& EnvI::getArrayEnum(unsigned int i) const {
+    std::lock_guard<std::mutex> guard(arrayEnumMutex);
     assert(i > 0 && i <= arrayEnumDecls.size());
     return arrayEnumDecls[i-1];
   }
@@ -461,6 +509,10 @@ namespace MiniZinc {
   }
   
   void EnvI::createErrorStack(void) {
+    // Nothing to do (and nothing to write) if there is no call stack, as
+    // during typechecking, which can raise errors in several threads
+    if (callStack.empty() && errorStack.empty())
+      return;
     errorStack.clear();
     for (unsigned int i=callStack.size(); i--;) {
       Expression* e = callStack[i]->untag();
@@ -479,13 +531,19 @@ namespace MiniZinc {
       env.in_maybe_partial++;
     env.callStack.push_back(e);
     env.maxCallStack = std::max(env.maxCallStack, static_cast<unsigned int>(env.callStack.size()));
+    if (env.profiler)
+      env.profiler->enter(e);
   }
   CallStackItem::CallStackItem(EnvI& env0, Id* ident, IntVal i) : env(env0) {
     Expression* ee = ident->tag();
     env.callStack.push_back(ee);
     env.maxCallStack = std::max(env.maxCallStack, static_cast<unsigned int>(env.callStack.size()));
+    if (env.profiler)
+      env.profiler->enter(ident);
   }
   CallStackItem::~CallStackItem(void) {
+    if (env.profiler)
+      env.profiler->leave();
     Expression* e = env.callStack.back()->untag();
     if (e->isa<VarDecl>())
       env.idStack.pop_back();
@@ -4631,11 +4689,30 @@ namespace MiniZinc {
         if (ctx.b==C_ROOT && decl->e()==NULL &&
             cid == constants().ids.forall && r==constants().var_true) {
           ret.b = bind(env,ctx,b,constants().lit_true);
-          EE flat_al = flat_exp(env,Ctx(),c->args()[0],constants().var_ignore,constants().var_true);
-          ArrayLit* al = follow_id(flat_al.r())->cast<ArrayLit>();
-          nctx.b = C_ROOT;
-          for (unsigned int i=0; i<al->v().size(); i++)
-            (void) flat_exp(env,nctx,al->v()[i],r,b);
+          Comprehension* comp = c->args()[0]->dyn_cast<Comprehension>();
+          if (comp && !comp->set() && !comp->type().isopt()) {
+            // Flatten the elements in root context as they are generated,
+            // without collecting them into an array
+            class EvalRoot {
+            public:
+              EE e(EnvI& env, Expression* e0) {
+                return flat_exp(env,Ctx(),e0,constants().var_true,constants().var_true);
+              }
+            } _evalroot;
+            class Discard {
+            public:
+              void push_back(const EE&) {}
+            } _discard;
+            KeepAlive comp_ka(comp);
+            CallStackItem _csi_comp(env,comp);
+            eval_comp_stream(env,_evalroot,comp,_discard);
+          } else {
+            EE flat_al = flat_exp(env,Ctx(),c->args()[0],constants().var_ignore,constants().var_true);
+            ArrayLit* al = follow_id(flat_al.r())->cast<ArrayLit>();
+            nctx.b = C_ROOT;
+            for (unsigned int i=0; i<al->v().size(); i++)
+              (void) flat_exp(env,nctx,al->v()[i],r,b);
+          }
           ret.r = bind(env,ctx,r,constants().lit_true);
         } else {
           if (decl->e() && decl->params().size()==1 && decl->e()->isa<Id>() &&
@@ -5293,6 +5370,10 @@ namespace MiniZinc {
     try {
 
       EnvI& env = e.envi();
+      FlatteningProfiler::Scope profile(env, opt.profiler);
+
+      if (opt.incremental)
+        opt.incremental->start(env);
       
       bool onlyRangeDomains = false;
       if ( opt.onlyRangeDomains ) {
@@ -5355,7 +5436,9 @@ namespace MiniZinc {
       public:
         EnvI& env;
         bool& hadSolveItem;
-        FV(EnvI& env0, bool& hadSolveItem0) : env(env0), hadSolveItem(hadSolveItem0) {}
+        IncrementalFlattening* incremental;
+        FV(EnvI& env0, bool& hadSolveItem0, IncrementalFlattening* incremental0)
+        : env(env0), hadSolveItem(hadSolveItem0), incremental(incremental0) {}
         bool enter(Item* i) {
           return !(i->isa<ConstraintI>()  && env.failed());
         }
@@ -5397,7 +5480,10 @@ namespace MiniZinc {
           }
         }
         void vConstraintI(ConstraintI* ci) {
-          (void) flat_exp(env,Ctx(),ci->e(),constants().var_true,constants().var_true);
+          if (incremental)
+            incremental->flatten(env,ci);
+          else
+            (void) flat_exp(env,Ctx(),ci->e(),constants().var_true,constants().var_true);
         }
         void vSolveI(SolveI* si) {
           if (hadSolveItem)
@@ -5421,8 +5507,10 @@ namespace MiniZinc {
           }
           env.flat_addItem(nsi);
         }
-      } _fv(env,hadSolveItem);
+      } _fv(env,hadSolveItem,opt.incremental);
       iterItems<FV>(_fv,e.model());
+      if (opt.incremental)
+        opt.incremental->finish(env);
       
       if (!hadSolveItem) {
         e.envi().errorStack.clear();
@@ -5434,10 +5522,13 @@ namespace MiniZinc {
       std::vector<VarDecl*> deletedVarDecls;
 
       // Create output model
-      if (opt.keepOutputInFzn) {
-        copyOutput(env);
-      } else {
-        createOutput(env, deletedVarDecls, opt.outputMode);
+      {
+        Instrumentation::Scope phase(opt.instrumentation, "flatten.output");
+        if (opt.keepOutputInFzn) {
+          copyOutput(env);
+        } else {
+          createOutput(env, deletedVarDecls, opt.outputMode);
+        }
       }
       
       // Flatten remaining redefinitions
@@ -5901,6 +5992,7 @@ namespace MiniZinc {
         }
       }
 
+      env.flat_compact();
       cleanupOutput(env);
     } catch (ModelInconsistent& e) {
       
@@ -5939,8 +6031,8 @@ namespace MiniZinc {
     }
 
     // Remove items marked for removal
-    m->compact();
     EnvI& env = e.envi();
+    env.flat_compact(true);
 
     int msize = m->size();
 
@@ -6333,22 +6425,8 @@ namespace MiniZinc {
     }
 
     // Remove marked items
-    m->compact();
-    e.envi().output->compact();
-
-    for (IdMap<VarOccurrences::Items>::iterator it = env.vo._m.begin();
-         it != env.vo._m.end(); ++it) {
-      std::vector<Item*> toRemove;
-      for (VarOccurrences::Items::iterator iit = it->second.begin();
-           iit != it->second.end(); ++iit) {
-        if ((*iit)->removed()) {
-          toRemove.push_back(*iit);
-        }
-      }
-      for (unsigned int i=0; i<toRemove.size(); i++) {
-        it->second.erase(toRemove[i]);
-      }
-    }
+    env.flat_compact(true);
+    env.output->compact();
 
     class Cmp {
     public:
@@ -6395,6 +6473,7 @@ namespace MiniZinc {
     } _cmp;
     // Perform final sorting
     std::stable_sort(m->begin(),m->end(),_cmp);
+    env.flat_reindex(VarOccurrences::Items());
   }
 
   FlatModelStatistics statistics(Env& m) {
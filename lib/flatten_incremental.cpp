@@ -0,0 +1,736 @@
+/* -*- mode: C++; c-basic-offset: 2; indent-tabs-mode: nil -*- */
+
+/*
+ *  Main authors:
+ *     agent <agent@local>
+ */
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <minizinc/flatten_incremental.hh>
+#include <minizinc/astiterator.hh>
+#include <minizinc/prettyprinter.hh>
+#include <minizinc/copy.hh>
+
+#include <algorithm>
+#include <sstream>
+
+namespace MiniZinc {
+
+  namespace {
+    // Printed expressions never contain a null character, so it separates
+    // the parts of a printed form unambiguously
+
+    /// Print \a e to \a os, followed by a separator
+    void print(std::ostream& os, Expression* e) {
+      os << *e << '\0';
+    }
+
+    /// Print the annotations of \a e to \a os
+    void print_anns(std::ostream& os, Expression* e) {
+      // The order of annotations depends on their hash values, which can
+      // differ between runs, so sort the printed annotations
+      std::vector<std::string> anns;
+      for (ExpressionSetIter it = e->ann().begin(); it != e->ann().end(); ++it) {
+        std::ostringstream oss;
+        oss << **it;
+        anns.push_back(oss.str());
+      }
+      std::sort(anns.begin(), anns.end());
+      os << anns.size() << '\0';
+      for (unsigned int i=0; i<anns.size(); i++)
+        os << anns[i] << '\0';
+    }
+
+    /// Record accesses to the CSE map while an item is flattened
+    class CSERecord {
+    public:
+      EnvI& env;
+      CSERecord(EnvI& env0) : env(env0) {
+        env.cse_record = true;
+        env.cse_foreign = false;
+        env.cse_keys.clear();
+      }
+      ~CSERecord(void) {
+        env.cse_record = false;
+        env.cse_keys.clear();
+      }
+    };
+
+    /// Collect the declarations referenced by flat items
+    class CollectRefs : public EVisitor {
+    public:
+      std::vector<VarDecl*>& refs;
+      UNORDERED_NAMESPACE::unordered_set<VarDecl*> seen;
+      bool overloaded;
+      CollectRefs(std::vector<VarDecl*>& refs0) : refs(refs0), overloaded(false) {}
+      void vId(const Id& id) {
+        if (id.decl() && seen.insert(id.decl()).second)
+          refs.push_back(id.decl());
+      }
+      void vBinOp(const BinOp& bo) {
+        if (bo.decl())
+          overloaded = true;
+      }
+      void vUnOp(const UnOp& uo) {
+        if (uo.decl())
+          overloaded = true;
+      }
+    };
+
+    typedef UNORDERED_NAMESPACE::unordered_map<VarDecl*,VarDecl*> DeclMap;
+
+    /// Copy flat expression \a e, replacing declarations according to \a decls
+    Expression* instantiate(EnvI& env, CopyMap& cm, const DeclMap& decls, Expression* e) {
+      // Flat expressions mostly consist of calls, array literals, identifiers
+      // and literals, which are copied here without going through the copy map
+      if (e==NULL)
+        return NULL;
+      Expression* ret;
+      switch (e->eid()) {
+        case Expression::E_INTLIT:
+        case Expression::E_FLOATLIT:
+        case Expression::E_BOOLLIT:
+        case Expression::E_STRINGLIT:
+          if (!e->ann().isEmpty())
+            return copy(env,cm,e,false,false,true);
+          return e;
+        case Expression::E_SETLIT:
+          if (!e->ann().isEmpty() || e->cast<SetLit>()->v().size() > 0)
+            return copy(env,cm,e,false,false,true);
+          return e;
+        case Expression::E_ID:
+          {
+            Id* id = e->cast<Id>();
+            if (id->decl()==NULL)
+              return id->ann().isEmpty() ? e : copy(env,cm,e,false,false,true);
+            DeclMap::const_iterator it = decls.find(id->decl());
+            if (it==decls.end())
+              return copy(env,cm,e,false,false,true);
+            return it->second->id();
+          }
+        case Expression::E_ARRAYLIT:
+          {
+            ArrayLit* al = e->cast<ArrayLit>();
+            std::vector<std::pair<int,int> > dims(al->dims());
+            for (unsigned int i=al->dims(); i--;) {
+              dims[i].first = al->min(i);
+              dims[i].second = al->max(i);
+            }
+            std::vector<Expression*> elems(al->v().size());
+            for (unsigned int i=al->v().size(); i--;)
+              elems[i] = instantiate(env,cm,decls,al->v()[i]);
+            ret = new ArrayLit(al->loc(),elems,dims);
+          }
+          break;
+        case Expression::E_CALL:
+          {
+            Call* c = e->cast<Call>();
+            std::vector<Expression*> args(c->args().size());
+            for (unsigned int i=c->args().size(); i--;)
+              args[i] = instantiate(env,cm,decls,c->args()[i]);
+            ret = new Call(c->loc(),c->id(),args,c->decl());
+          }
+          break;
+        default:
+          return copy(env,cm,e,false,false,true);
+      }
+      ret->type(e->type());
+      for (ExpressionSetIter it = e->ann().begin(); it != e->ann().end(); ++it)
+        ret->addAnnotation(instantiate(env,cm,decls,*it));
+      return ret;
+    }
+
+    /// Create copy of flat declaration \a vd without right hand side, with identifier \a id
+    VarDecl* copyDecl(EnvI& env, CopyMap& cm, const DeclMap& decls, VarDecl* vd, long long int id) {
+      TypeInst* ti;
+      if (vd->ti()->ranges().size()==0 && vd->ti()->ann().isEmpty()) {
+        ti = new TypeInst(vd->ti()->loc(),vd->ti()->type(),
+                          instantiate(env,cm,decls,vd->ti()->domain()));
+      } else {
+        ti = copy(env,cm,vd->ti(),false,false,true)->cast<TypeInst>();
+      }
+      // Copying does not preserve whether the domain was computed
+      ti->setComputedDomain(vd->ti()->computedDomain());
+      VarDecl* nvd = new VarDecl(vd->loc(),ti,id);
+      nvd->toplevel(vd->toplevel());
+      nvd->introduced(vd->introduced());
+      nvd->flat(nvd);
+      return nvd;
+    }
+
+    /// Remove declarations of calls, so that recorded items do not refer to the old model
+    class ClearDecls : public EVisitor {
+    public:
+      void vCall(Call& c) { c.decl(NULL); }
+    };
+
+    /// Find declarations of calls in the current model
+    class MatchDecls : public EVisitor {
+    public:
+      EnvI& env;
+      MatchDecls(EnvI& env0) : env(env0) {}
+      void vCall(Call& c) {
+        if (FunctionI* fi = env.orig->matchFn(env, &c, false))
+          c.decl(fi);
+      }
+    };
+  }
+
+  IncrementalFlattening::IncrementalFlattening(void)
+    : _prevItems(NULL), _curItems(NULL), _n(0), _reused(0) {}
+
+  IncrementalFlattening::~IncrementalFlattening(void) {
+    delete _prevItems;
+    delete _curItems;
+  }
+
+  void
+  IncrementalFlattening::model(const std::string& key) {
+    if (key != _key) {
+      _key = key;
+      _prev.clear();
+      delete _prevItems;
+      _prevItems = NULL;
+      _pool.clear();
+    }
+  }
+
+  void
+  IncrementalFlattening::start(EnvI& env) {
+    _n = 0;
+    _reused = 0;
+    _cur.clear();
+    delete _curItems;
+    _curItems = new Model;
+    _fns.clear();
+    _globals.clear();
+    _fnDeps.clear();
+    _vdDeps.clear();
+    _data.clear();
+    _state.clear();
+    _flatIndex.clear();
+    _indexed.clear();
+
+    class Index : public ItemVisitor {
+    public:
+      IncrementalFlattening& inc;
+      Index(IncrementalFlattening& inc0) : inc(inc0) {}
+      void vVarDeclI(VarDeclI* vdi) {
+        if (vdi->e()->id()->idn()==-1)
+          inc._globals[vdi->e()->id()->str().str()] = vdi->e();
+      }
+      void vFunctionI(FunctionI* fi) {
+        inc._fns[fi->id().str()].push_back(fi);
+      }
+    } _index(*this);
+    iterItems(_index, env.orig);
+  }
+
+  void
+  IncrementalFlattening::addFns(const std::string& id, Deps& d) {
+    // Calls can be flattened into reified or half-reified versions
+    const char* suffix[] = {"", "_reif", "_imp"};
+    for (unsigned int i=0; i<3; i++) {
+      UNORDERED_NAMESPACE::unordered_map<std::string,std::vector<FunctionI*> >::iterator it =
+        _fns.find(id+suffix[i]);
+      if (it != _fns.end())
+        d.fns.insert(d.fns.end(), it->second.begin(), it->second.end());
+    }
+  }
+
+  void
+  IncrementalFlattening::collect(Expression* e, Deps& d) {
+    class Collect : public EVisitor {
+    public:
+      IncrementalFlattening& inc;
+      Deps& d;
+      Collect(IncrementalFlattening& inc0, Deps& d0) : inc(inc0), d(d0) {}
+      void vId(const Id& id) {
+        if (id.decl() && id.decl()->toplevel())
+          d.vds.push_back(id.decl());
+      }
+      void vCall(const Call& c) {
+        if (c.decl()) {
+          d.fns.push_back(c.decl());
+          inc.addFns(c.id().str(), d);
+        }
+      }
+      void vBinOp(const BinOp& bo) {
+        if (bo.decl())
+          d.fns.push_back(bo.decl());
+      }
+      void vUnOp(const UnOp& uo) {
+        if (uo.decl())
+          d.fns.push_back(uo.decl());
+      }
+    } _collect(*this, d);
+    if (e)
+      topDown(_collect, e);
+  }
+
+  const IncrementalFlattening::Deps&
+  IncrementalFlattening::deps(VarDecl* vd) {
+    Deps& d = _vdDeps[vd];
+    if (!d.done) {
+      d.done = true;
+      collect(vd->ti(), d);
+      collect(vd->e(), d);
+      for (ExpressionSetIter it = vd->ann().begin(); it != vd->ann().end(); ++it)
+        collect(*it, d);
+    }
+    return d;
+  }
+
+  const IncrementalFlattening::Deps&
+  IncrementalFlattening::deps(FunctionI* fi) {
+    Deps& d = _fnDeps[fi];
+    if (!d.done) {
+      d.done = true;
+      collect(fi->ti(), d);
+      collect(fi->e(), d);
+      for (unsigned int i=0; i<fi->params().size(); i++)
+        collect(fi->params()[i]->ti(), d);
+      for (ExpressionSetIter it = fi->ann().begin(); it != fi->ann().end(); ++it)
+        collect(*it, d);
+    }
+    return d;
+  }
+
+  void
+  IncrementalFlattening::closure(Expression* e, std::vector<VarDecl*>& cl) {
+    UNORDERED_NAMESPACE::unordered_set<const VarDecl*> seenVd;
+    UNORDERED_NAMESPACE::unordered_set<const FunctionI*> seenFn;
+    Deps d;
+    collect(e, d);
+    std::vector<const Deps*> todo;
+    todo.push_back(&d);
+    while (!todo.empty()) {
+      const Deps* cur = todo.back();
+      todo.pop_back();
+      for (unsigned int i=0; i<cur->vds.size(); i++) {
+        if (seenVd.insert(cur->vds[i]).second) {
+          cl.push_back(cur->vds[i]);
+          todo.push_back(&deps(cur->vds[i]));
+        }
+      }
+      for (unsigned int i=0; i<cur->fns.size(); i++) {
+        if (seenFn.insert(cur->fns[i]).second)
+          todo.push_back(&deps(cur->fns[i]));
+      }
+    }
+  }
+
+  const std::string*
+  IncrementalFlattening::intern(const std::string& s) {
+    return &*_pool.insert(s).first;
+  }
+
+  const std::string*
+  IncrementalFlattening::data(VarDecl* vd) {
+    UNORDERED_NAMESPACE::unordered_map<const VarDecl*,const std::string*>::iterator it =
+      _data.find(vd);
+    if (it != _data.end())
+      return it->second;
+    std::ostringstream oss;
+    oss << vd->id()->str().str() << '\0';
+    print(oss, vd->ti());
+    if (vd->e())
+      print(oss, vd->e());
+    const std::string* s = intern(oss.str());
+    _data[vd] = s;
+    return s;
+  }
+
+  const std::string*
+  IncrementalFlattening::state(VarDecl* vd, int depth) {
+    Expression* e = vd->e();
+    Expression* dom = vd->ti()->domain();
+    bool cacheable = e==NULL || !(e->isa<Id>() || e->isa<ArrayLit>());
+    unsigned int nAnns = 0;
+    for (ExpressionSetIter it = vd->ann().begin(); it != vd->ann().end(); ++it)
+      nAnns++;
+    if (cacheable) {
+      UNORDERED_NAMESPACE::unordered_map<const VarDecl*,State>::iterator it = _state.find(vd);
+      if (it != _state.end() && it->second.ti==vd->ti() && it->second.dom==dom &&
+          it->second.e==e && it->second.anns==nAnns)
+        return it->second.s;
+    }
+    std::ostringstream oss;
+    if (dom)
+      print(oss, dom);
+    else
+      oss << '\0';
+    print_anns(oss, vd);
+    if (e) {
+      if (Id* id = e->dyn_cast<Id>()) {
+        // Aliases are followed, since flattening returns the aliased variable
+        if (id->decl() && depth < 100)
+          oss << '=' << *state(id->decl(), depth+1) << '\0';
+        else
+          print(oss, id);
+      } else if (ArrayLit* al = e->dyn_cast<ArrayLit>()) {
+        oss << '[' << al->v().size() << '\0';
+        for (unsigned int i=0; i<al->v().size(); i++) {
+          Id* id = al->v()[i]->dyn_cast<Id>();
+          if (id && id->decl() && depth < 100)
+            oss << '=' << *state(id->decl(), depth+1) << '\0';
+          else
+            print(oss, al->v()[i]);
+        }
+      } else if (e->type().ispar()) {
+        print(oss, e);
+      } else {
+        oss << "var" << '\0';
+      }
+    }
+    const std::string* s = intern(oss.str());
+    if (cacheable) {
+      State st;
+      st.ti = vd->ti();
+      st.dom = dom;
+      st.e = e;
+      st.anns = nAnns;
+      st.s = s;
+      _state[vd] = st;
+    }
+    return s;
+  }
+
+  void
+  IncrementalFlattening::dataPrint(const std::vector<VarDecl*>& cl, Fingerprint& fp) {
+    // The order of the closure can differ between runs, so sort the printed
+    // forms. Since they are stored only once in the pool, equal forms have
+    // equal pointers.
+    fp.resize(cl.size());
+    for (unsigned int i=0; i<cl.size(); i++)
+      fp[i] = data(cl[i]);
+    std::sort(fp.begin(), fp.end());
+  }
+
+  void
+  IncrementalFlattening::statePrint(const std::vector<VarDecl*>& cl, Fingerprint& fp) {
+    fp.clear();
+    for (unsigned int i=0; i<cl.size(); i++) {
+      if (!cl[i]->type().isvar())
+        continue;
+      std::string s = *data(cl[i]);
+      if (VarDecl* f = cl[i]->flat())
+        s += *state(f);
+      fp.push_back(intern(s));
+    }
+    std::sort(fp.begin(), fp.end());
+  }
+
+  void
+  IncrementalFlattening::flatten(EnvI& env, ConstraintI* ci) {
+    unsigned int idx = _n++;
+    std::vector<VarDecl*> cl;
+    closure(ci->e(), cl);
+    Fingerprint d;
+    dataPrint(cl, d);
+    Fingerprint s;
+    statePrint(cl, s);
+    if (idx < _prev.size()) {
+      Record& r = _prev[idx];
+      if (r.reusable && r.data==d && r.state==s && replay(env, r)) {
+        _reused++;
+        Record nr(r);
+        nr.first = _curItems->size();
+        for (unsigned int i=r.first; i<r.last; i++)
+          _curItems->addItem((*_prevItems)[i]);
+        nr.last = _curItems->size();
+        _cur.push_back(nr);
+        return;
+      }
+    }
+    record(env, ci, cl, d, s);
+  }
+
+  void
+  IncrementalFlattening::record(EnvI& env, ConstraintI* ci, const std::vector<VarDecl*>& cl,
+                                const Fingerprint& data, const Fingerprint& state) {
+    unsigned int first = env.flat()->size();
+    unsigned int nWarnings = static_cast<unsigned int>(env.warnings.size());
+    bool foreign;
+    {
+      CSERecord cr(env);
+      (void) flat_exp(env,Ctx(),ci->e(),constants().var_true,constants().var_true);
+      foreign = env.cse_foreign;
+    }
+    Record r;
+    r.reusable = false;
+    r.data = data;
+    r.state = state;
+    r.first = r.last = _curItems->size();
+    // The item must not have changed any of the variables it can reach
+    if (!foreign && !env.failed()) {
+      Fingerprint after;
+      statePrint(cl, after);
+      if (after==state)
+        r.reusable = stash(env, first, cl, r);
+    }
+    for (unsigned int i=nWarnings; i<env.warnings.size(); i++)
+      r.warnings.push_back(env.warnings[i]);
+    _cur.push_back(r);
+  }
+
+  bool
+  IncrementalFlattening::stash(EnvI& env, unsigned int first,
+                               const std::vector<VarDecl*>& cl, Record& r) {
+    GCLock lock;
+    Model& flat = *env.flat();
+    UNORDERED_NAMESPACE::unordered_set<VarDecl*> own;
+    std::vector<Item*> items;
+    for (unsigned int i=first; i<flat.size(); i++) {
+      Item* item = flat[i];
+      if (item->removed())
+        continue;
+      if (VarDeclI* vdi = item->dyn_cast<VarDeclI>()) {
+        if (!vdi->e()->introduced() || vdi->e()->id()->idn()==-1)
+          return false;
+        own.insert(vdi->e());
+      } else if (!item->isa<ConstraintI>()) {
+        return false;
+      }
+      items.push_back(item);
+    }
+
+    std::vector<VarDecl*> refs;
+    CollectRefs cr(refs);
+    for (unsigned int i=0; i<items.size(); i++) {
+      if (VarDeclI* vdi = items[i]->dyn_cast<VarDeclI>())
+        topDown(cr, vdi->e());
+      else
+        topDown(cr, items[i]->cast<ConstraintI>()->e());
+    }
+    if (cr.overloaded)
+      return false;
+
+    // Index the flat variables of the declarations the item depends on
+    UNORDERED_NAMESPACE::unordered_set<const VarDecl*> inClosure;
+    for (unsigned int i=0; i<cl.size(); i++) {
+      inClosure.insert(cl[i]);
+      VarDecl* f = cl[i]->flat();
+      if (f==NULL || _indexed.find(cl[i]) != _indexed.end())
+        continue;
+      if (cl[i]->type().dim() > 0 && (f->e()==NULL || !f->e()->isa<ArrayLit>()))
+        continue;
+      _indexed.insert(cl[i]);
+      _flatIndex[f] = std::make_pair(cl[i],-1);
+      if (cl[i]->type().dim() > 0) {
+        ArrayLit* al = f->e()->cast<ArrayLit>();
+        for (unsigned int j=0; j<al->v().size(); j++) {
+          if (Id* id = al->v()[j]->dyn_cast<Id>()) {
+            if (id->decl())
+              _flatIndex[id->decl()] = std::make_pair(cl[i],static_cast<int>(j));
+          }
+        }
+      }
+    }
+
+    CopyMap cm;
+    DeclMap decls;
+    std::vector<VarDecl*> parDecls;
+    for (unsigned int i=0; i<refs.size(); i++) {
+      VarDecl* vd = refs[i];
+      if (own.find(vd) != own.end())
+        continue;
+      External x;
+      UNORDERED_NAMESPACE::unordered_map<const VarDecl*,std::pair<VarDecl*,int> >::iterator fi =
+        _flatIndex.find(vd);
+      if (fi != _flatIndex.end() && inClosure.find(fi->second.first) != inClosure.end()) {
+        x.name = fi->second.first->id()->str().str();
+        x.flat = true;
+        x.idx = fi->second.second;
+      } else if (vd->toplevel() && !vd->type().isvar() && vd->id()->idn()==-1 &&
+                 _globals.find(vd->id()->str().str()) != _globals.end() &&
+                 _globals[vd->id()->str().str()]==vd) {
+        x.name = vd->id()->str().str();
+        x.flat = false;
+        x.idx = -1;
+      } else if (vd->introduced() && vd->type().ispar() && vd->flat()==vd) {
+        // Constants shared with other items through the CSE table are copied
+        own.insert(vd);
+        parDecls.push_back(vd);
+        continue;
+      } else {
+        return false;
+      }
+      TypeInst* ti = new TypeInst(Location().introduce(),vd->type());
+      x.ph = vd->id()->idn()==-1 ? new VarDecl(Location().introduce(),ti,vd->id()->v())
+                                 : new VarDecl(Location().introduce(),ti,vd->id()->idn());
+      cm.insert(vd, x.ph);
+      decls[vd] = x.ph;
+      r.ext.push_back(x);
+    }
+
+    // Create copies of the declarations first, since items can refer to
+    // declarations that come later
+    std::vector<VarDecl*> ownDecls(parDecls);
+    for (unsigned int i=0; i<items.size(); i++) {
+      if (VarDeclI* vdi = items[i]->dyn_cast<VarDeclI>())
+        ownDecls.push_back(vdi->e());
+    }
+    for (unsigned int i=0; i<ownDecls.size(); i++) {
+      VarDecl* vd = ownDecls[i];
+      decls[vd] = copyDecl(env,cm,decls,vd,vd->id()->idn());
+    }
+    r.first = _curItems->size();
+    for (unsigned int i=0; i<ownDecls.size(); i++) {
+      VarDecl* vd = ownDecls[i];
+      VarDecl* nvd = decls[vd];
+      nvd->e(instantiate(env,cm,decls,vd->e()));
+      for (ExpressionSetIter it = vd->ann().begin(); it != vd->ann().end(); ++it)
+        nvd->addAnnotation(instantiate(env,cm,decls,*it));
+      if (i < parDecls.size())
+        _curItems->addItem(new VarDeclI(vd->loc(),nvd));
+    }
+    for (unsigned int i=0; i<items.size(); i++) {
+      if (VarDeclI* vdi = items[i]->dyn_cast<VarDeclI>()) {
+        _curItems->addItem(new VarDeclI(vdi->loc(),decls[vdi->e()]));
+      } else {
+        ConstraintI* ci = items[i]->cast<ConstraintI>();
+        _curItems->addItem(new ConstraintI(ci->loc(),instantiate(env,cm,decls,ci->e())));
+      }
+    }
+    r.last = _curItems->size();
+    ClearDecls clear;
+    for (unsigned int i=r.first; i<r.last; i++) {
+      if (VarDeclI* vdi = (*_curItems)[i]->dyn_cast<VarDeclI>())
+        topDown(clear, vdi->e());
+      else
+        topDown(clear, (*_curItems)[i]->cast<ConstraintI>()->e());
+    }
+    return true;
+  }
+
+  bool
+  IncrementalFlattening::replay(EnvI& env, const Record& r) {
+    GCLock lock;
+    CopyMap cm;
+    DeclMap decls;
+    for (unsigned int i=0; i<r.ext.size(); i++) {
+      const External& x = r.ext[i];
+      UNORDERED_NAMESPACE::unordered_map<std::string,VarDecl*>::iterator it = _globals.find(x.name);
+      if (it == _globals.end())
+        return false;
+      VarDecl* vd = it->second;
+      if (x.flat) {
+        vd = vd->flat();
+        if (vd==NULL)
+          return false;
+        if (x.idx >= 0) {
+          ArrayLit* al = vd->e() ? vd->e()->dyn_cast<ArrayLit>() : NULL;
+          if (al==NULL || static_cast<unsigned int>(x.idx) >= al->v().size())
+            return false;
+          Id* id = al->v()[x.idx]->dyn_cast<Id>();
+          if (id==NULL || id->decl()==NULL)
+            return false;
+          vd = id->decl();
+        }
+      }
+      cm.insert(x.ph, vd);
+      decls[x.ph] = vd;
+    }
+
+    // Create fresh variables for the variables introduced by the item
+    std::vector<VarDecl*> oldDecls;
+    std::vector<std::pair<long long int,unsigned int> > byId;
+    for (unsigned int i=r.first; i<r.last; i++) {
+      if (VarDeclI* vdi = (*_prevItems)[i]->dyn_cast<VarDeclI>()) {
+        byId.push_back(std::make_pair(vdi->e()->id()->idn(),
+                                      static_cast<unsigned int>(oldDecls.size())));
+        oldDecls.push_back(vdi->e());
+      }
+    }
+    // Generate the new names in the order of the old ones, which determines
+    // the order of arguments of some flat constraints
+    std::sort(byId.begin(), byId.end());
+    std::vector<VarDecl*> newDecls(oldDecls.size());
+    for (unsigned int i=0; i<byId.size(); i++) {
+      VarDecl* ovd = oldDecls[byId[i].second];
+      if (ovd->type().ispar() && ovd->e() && ovd->e()->isa<ArrayLit>()) {
+        // Share constant arrays with the rest of the flat model
+        Expression* al = instantiate(env,cm,decls,ovd->e());
+        EnvI::Map::iterator it = env.map_find(al);
+        if (it != env.map_end() && it->second.r()->isa<VarDecl>()) {
+          cm.insert(ovd, it->second.r());
+          decls[ovd] = it->second.r()->cast<VarDecl>();
+          newDecls[byId[i].second] = NULL;
+          continue;
+        }
+      }
+      VarDecl* nvd = copyDecl(env,cm,decls,ovd,env.genId());
+      cm.insert(ovd, nvd);
+      decls[ovd] = nvd;
+      newDecls[byId[i].second] = nvd;
+    }
+    for (unsigned int i=0; i<oldDecls.size(); i++) {
+      if (newDecls[i]==NULL)
+        continue;
+      newDecls[i]->e(instantiate(env,cm,decls,oldDecls[i]->e()));
+      for (ExpressionSetIter it = oldDecls[i]->ann().begin(); it != oldDecls[i]->ann().end(); ++it)
+        newDecls[i]->addAnnotation(instantiate(env,cm,decls,*it));
+      if (newDecls[i]->type().ispar() && newDecls[i]->e() && newDecls[i]->e()->isa<ArrayLit>())
+        env.map_insert(newDecls[i]->e(),EE(newDecls[i],NULL));
+    }
+
+    std::vector<Item*> items;
+    MatchDecls match(env);
+    unsigned int nextDecl = 0;
+    for (unsigned int i=r.first; i<r.last; i++) {
+      if ((*_prevItems)[i]->isa<VarDeclI>()) {
+        VarDecl* nvd = newDecls[nextDecl++];
+        if (nvd==NULL)
+          continue;
+        topDown(match, nvd);
+        items.push_back(new VarDeclI((*_prevItems)[i]->loc(),nvd));
+      } else {
+        ConstraintI* ci = (*_prevItems)[i]->cast<ConstraintI>();
+        Expression* e = instantiate(env,cm,decls,ci->e());
+        topDown(match, e);
+        items.push_back(new ConstraintI(ci->loc(),e));
+      }
+    }
+    for (unsigned int i=0; i<items.size(); i++)
+      env.flat_addItem(items[i]);
+    for (unsigned int i=0; i<r.warnings.size(); i++)
+      env.warnings.push_back(r.warnings[i]);
+    return true;
+  }
+
+  void
+  IncrementalFlattening::finish(EnvI& env) {
+    _prev.swap(_cur);
+    _cur.clear();
+    delete _prevItems;
+    _prevItems = _curItems;
+    _curItems = NULL;
+    // The caches refer to the model that has just been flattened
+    _fns.clear();
+    _globals.clear();
+    _fnDeps.clear();
+    _vdDeps.clear();
+    _data.clear();
+    _state.clear();
+    _flatIndex.clear();
+    _indexed.clear();
+    // Only keep the printed forms that the records refer to
+    UNORDERED_NAMESPACE::unordered_set<const std::string*> used;
+    for (unsigned int i=0; i<_prev.size(); i++) {
+      used.insert(_prev[i].data.begin(), _prev[i].data.end());
+      used.insert(_prev[i].state.begin(), _prev[i].state.end());
+    }
+    for (UNORDERED_NAMESPACE::unordered_set<std::string>::iterator it = _pool.begin();
+         it != _pool.end();) {
+      if (used.find(&*it) == used.end())
+        it = _pool.erase(it);
+      else
+        ++it;
+    }
+  }
+
+}
@@ -0,0 +1,292 @@
+/* -*- mode: C++; c-basic-offset: 2; indent-tabs-mode: nil -*- */
+
+/*
+ *  Main authors:
+ *     agent <agent@local>
+ */
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <minizinc/flatten_profiler.hh>
+#include <minizinc/flatten_internal.hh>
+#include <minizinc/gc.hh>
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace MiniZinc {
+
+  FlatteningProfiler::Scope::Scope(EnvI& env, FlatteningProfiler* p)
+    : _env(env), _p(p) {
+    if (_p) {
+      _env.profiler = _p;
+      _p->start();
+    }
+  }
+
+  FlatteningProfiler::Scope::~Scope(void) {
+    if (_p) {
+      _p->stop();
+      _env.profiler = NULL;
+    }
+  }
+
+  FlatteningProfiler::FlatteningProfiler(void)
+    : _last(0.0), _lastAlloc(0), _running(false) {
+    Node root;
+    root.parent = 0;
+    root.label = 0;
+    root.self = 0.0;
+    root.vars = 0;
+    root.cons = 0;
+    root.alloc = 0;
+    _nodes.push_back(root);
+    _labels.push_back("flatten");
+    _labelFn.push_back(-1);
+    _stack.push_back(0);
+  }
+
+  void
+  FlatteningProfiler::start(void) {
+    _running = true;
+    _last = _timer.ms();
+    _lastAlloc = GC::allocated();
+  }
+
+  void
+  FlatteningProfiler::stop(void) {
+    account();
+    _running = false;
+  }
+
+  void
+  FlatteningProfiler::account(void) {
+    if (!_running)
+      return;
+    double now = _timer.ms();
+    unsigned long long alloc = GC::allocated();
+    Node& n = _nodes[_stack.back()];
+    n.self += now-_last;
+    // The allocation counter restarts when a new collector is used
+    if (alloc >= _lastAlloc)
+      n.alloc += alloc-_lastAlloc;
+    _last = now;
+    _lastAlloc = alloc;
+  }
+
+  unsigned int
+  FlatteningProfiler::label(Expression* e) {
+    LabelKey k;
+    Call* c = e->dyn_cast<Call>();
+    k.fn = c ? c->id().c_str() : NULL;
+    k.file = e->loc().filename.c_str();
+    k.line = e->loc().first_line;
+    UNORDERED_NAMESPACE::unordered_map<LabelKey,unsigned int,LabelKeyHash>::iterator it =
+      _labelIdx.find(k);
+    if (it != _labelIdx.end())
+      return it->second;
+    std::ostringstream oss;
+    std::string file = k.file ? k.file : "";
+    if (file.empty())
+      file = "unknown file";
+    if (c)
+      oss << k.fn << " (" << file << ":" << k.line << ")";
+    else
+      oss << file << ":" << k.line;
+    std::string l = oss.str();
+    // Separator of the folded format
+    std::replace(l.begin(), l.end(), ';', ',');
+    int fn = -1;
+    if (c) {
+      UNORDERED_NAMESPACE::unordered_map<std::string,int>::iterator fit = _fnIdx.find(k.fn);
+      if (fit == _fnIdx.end()) {
+        fn = static_cast<int>(_fns.size());
+        _fns.push_back(k.fn);
+        _fnIdx.insert(std::make_pair(k.fn, fn));
+      } else {
+        fn = fit->second;
+      }
+    }
+    unsigned int idx = static_cast<unsigned int>(_labels.size());
+    _labels.push_back(l);
+    _labelFn.push_back(fn);
+    _labelIdx.insert(std::make_pair(k, idx));
+    return idx;
+  }
+
+  void
+  FlatteningProfiler::enter(Expression* e) {
+    account();
+    unsigned int parent = _stack.back();
+    unsigned int l = label(e->untag());
+    unsigned long long key = (static_cast<unsigned long long>(parent) << 32) | l;
+    UNORDERED_NAMESPACE::unordered_map<unsigned long long,unsigned int>::iterator it =
+      _children.find(key);
+    unsigned int child;
+    if (it == _children.end()) {
+      Node n;
+      n.parent = parent;
+      n.label = l;
+      n.self = 0.0;
+      n.vars = 0;
+      n.cons = 0;
+      n.alloc = 0;
+      child = static_cast<unsigned int>(_nodes.size());
+      _nodes.push_back(n);
+      _children.insert(std::make_pair(key, child));
+    } else {
+      child = it->second;
+    }
+    _stack.push_back(child);
+  }
+
+  void
+  FlatteningProfiler::leave(void) {
+    account();
+    assert(_stack.size() > 1);
+    _stack.pop_back();
+  }
+
+  void
+  FlatteningProfiler::addItem(Item* i) {
+    Node& n = _nodes[_stack.back()];
+    if (i->isa<VarDeclI>())
+      n.vars++;
+    else if (i->isa<ConstraintI>())
+      n.cons++;
+  }
+
+  void
+  FlatteningProfiler::costs(std::vector<Cost>& labels, std::vector<Cost>& fns) const {
+    Cost zero = {0.0, 0.0, 0, 0, 0};
+    labels.assign(_labels.size(), zero);
+    fns.assign(_fns.size(), zero);
+    // Inclusive cost of each node (children always follow their parent)
+    std::vector<Cost> total(_nodes.size());
+    for (unsigned int i=0; i<_nodes.size(); i++) {
+      const Node& n = _nodes[i];
+      Cost c = {n.self, n.self, n.vars, n.cons, n.alloc};
+      total[i] = c;
+    }
+    for (unsigned int i=static_cast<unsigned int>(_nodes.size()); i-- > 1;) {
+      Cost& p = total[_nodes[i].parent];
+      p.total += total[i].total;
+      p.vars += total[i].vars;
+      p.cons += total[i].cons;
+      p.alloc += total[i].alloc;
+    }
+    for (unsigned int i=0; i<_nodes.size(); i++) {
+      const Node& n = _nodes[i];
+      int fn = _labelFn[n.label];
+      labels[n.label].self += n.self;
+      if (fn >= 0)
+        fns[fn].self += n.self;
+      // Inclusive costs only count the outermost frame of recursive paths
+      bool outerLabel = true;
+      bool outerFn = fn >= 0;
+      for (unsigned int a = i; a != 0;) {
+        a = _nodes[a].parent;
+        if (a==0)
+          break;
+        if (_nodes[a].label==n.label)
+          outerLabel = false;
+        if (fn >= 0 && _labelFn[_nodes[a].label]==fn)
+          outerFn = false;
+      }
+      if (outerLabel) {
+        Cost& c = labels[n.label];
+        c.total += total[i].total;
+        c.vars += total[i].vars;
+        c.cons += total[i].cons;
+        c.alloc += total[i].alloc;
+      }
+      if (outerFn) {
+        Cost& c = fns[fn];
+        c.total += total[i].total;
+        c.vars += total[i].vars;
+        c.cons += total[i].cons;
+        c.alloc += total[i].alloc;
+      }
+    }
+  }
+
+  namespace {
+    class CmpCost {
+    public:
+      const std::vector<double>& key;
+      CmpCost(const std::vector<double>& key0) : key(key0) {}
+      bool operator ()(unsigned int i, unsigned int j) const {
+        return key[i] > key[j] || (key[i]==key[j] && i < j);
+      }
+    };
+
+    void printTable(std::ostream& os, const std::string& title,
+                    const std::vector<std::string>& names,
+                    const std::vector<FlatteningProfiler::Cost>& costs,
+                    bool bySelf, unsigned int n) {
+      std::vector<double> key(costs.size());
+      std::vector<unsigned int> idx(costs.size());
+      for (unsigned int i=0; i<costs.size(); i++) {
+        key[i] = bySelf ? costs[i].self : costs[i].total;
+        idx[i] = i;
+      }
+      std::sort(idx.begin(), idx.end(), CmpCost(key));
+      if (idx.size() > n)
+        idx.resize(n);
+      os << title << ":\n";
+      os << std::setw(11) << "self ms" << std::setw(11) << "total ms"
+         << std::setw(10) << "vars" << std::setw(10) << "cons"
+         << std::setw(12) << "alloc KB" << "  name\n";
+      for (unsigned int i=0; i<idx.size(); i++) {
+        const FlatteningProfiler::Cost& c = costs[idx[i]];
+        os << std::setw(11) << c.self << std::setw(11) << c.total
+           << std::setw(10) << c.vars << std::setw(10) << c.cons
+           << std::setw(12) << c.alloc/1024 << "  " << names[idx[i]] << "\n";
+      }
+      os << "\n";
+    }
+  }
+
+  void
+  FlatteningProfiler::report(std::ostream& os, unsigned int n) const {
+    std::vector<Cost> labels;
+    std::vector<Cost> fns;
+    costs(labels, fns);
+    std::ios_base::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << std::fixed << std::setprecision(1);
+    os << "Flattening profile: " << labels[0].total << " ms, "
+       << labels[0].vars << " variables, " << labels[0].cons << " constraints, "
+       << labels[0].alloc/1024 << " KB allocated\n\n";
+    printTable(os, "Source locations by self time", _labels, labels, true, n);
+    printTable(os, "Functions by total time", _fns, fns, false, n);
+    os.flags(flags);
+    os.precision(precision);
+  }
+
+  void
+  FlatteningProfiler::folded(std::ostream& os) const {
+    std::vector<unsigned int> path;
+    for (unsigned int i=0; i<_nodes.size(); i++) {
+      unsigned long long us = static_cast<unsigned long long>(_nodes[i].self*1000.0+0.5);
+      if (us==0)
+        continue;
+      path.clear();
+      for (unsigned int a = i; ; a = _nodes[a].parent) {
+        path.push_back(_nodes[a].label);
+        if (a==0)
+          break;
+      }
+      for (unsigned int j=static_cast<unsigned int>(path.size()); j--;) {
+        os << _labels[path[j]];
+        if (j > 0)
+          os << ";";
+      }
+      os << " " << us << "\n";
+    }
+  }
+
+}
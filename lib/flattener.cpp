@@ -46,6 +46,9 @@ void Flattener::printHelp(ostream& os)
   << std::endl
   << "Flattener input options:" << std::endl
   << "  --ignore-stdlib\n    Ignore the standard libraries stdlib.mzn and builtins.mzn" << std::endl
+  << "  --typecheck-threads <n>\n    Number of threads typechecking function bodies and constraints\n    (default 1, 0 for the number of hardware threads)" << std::endl
+  << "  --lazy-stdlib\n    Only parse the library files that define functions used by the model,\n    using an index of the library kept between runs" << std::endl
+  << "  --stdlib-index <file>\n    Keep the library index in <file> (implies --lazy-stdlib)" << std::endl
   << "  --instance-check-only\n    Check the model instance (including data) for errors, but do not\n    convert to FlatZinc." << std::endl
   << "  -e, --model-check-only\n    Check the model (without requiring data) for errors, but do not\n    convert to FlatZinc." << std::endl
   << "  --model-interface-only\n    Only extract parameters and output variables." << std::endl
@@ -58,7 +61,12 @@ void Flattener::printHelp(ostream& os)
   << "  - --input-from-stdin\n    Read problem from standard input" << std::endl
   << "  -I --search-dir\n    Additionally search for included files in <dir>." << std::endl
   << "  -D \"fMIPdomains=false\"\n    No domain unification for MIP" << std::endl
+  << "  --MIPdomains-threads <n>\n    Number of threads analysing the domains for MIP (default: 1, 0 for the\n    number of hardware threads)" << std::endl
   << "  --only-range-domains\n    When no MIPdomains: all domains contiguous, holes replaced by inequalities" << std::endl
+  << "  --incremental-base <file>\n    Flatten the model with data file <file> first, and reuse the results\n    when flattening with the actual data. This flattens the model twice,\n    and is meant for checking the reuse of flattened constraints" << std::endl
+  << "  --instrument-json <file>\n    Write time and memory used by each compilation phase, and other\n    counters, as JSON to <file> (- for standard error)" << std::endl
+  << "  --profile-flattening <file>\n    Write the source locations and functions that are most expensive to\n    flatten to <file> (- for standard error), and the call paths in folded\n    flame graph format to <file>.folded\n    (<output-base>.folded if <file> is -)" << std::endl
+  << "  --profile-top <n>\n    Number of entries listed in the flattening profile (default 20)" << std::endl
   << std::endl;
   os
   << "Flattener output options:" << std::endl
@@ -86,6 +94,13 @@ bool Flattener::processOption(int& i, const int argc, const char** argv)
     flag_ignoreStdlib = true;
   } else if ( cop.getOption( "--no-typecheck") ) {
     flag_typecheck = false;
+  } else if ( cop.getOption( "--typecheck-threads", &flag_typecheck_threads ) ) {
+    if (flag_typecheck_threads < 0)
+      goto error;
+  } else if ( cop.getOption( "--lazy-stdlib") ) {
+    flag_lazy_stdlib = true;
+  } else if ( cop.getOption( "--stdlib-index", &flag_stdlib_index ) ) {
+    flag_lazy_stdlib = true;
   } else if ( cop.getOption( "--instance-check-only") ) {
     flag_instance_check_only = true;
   } else if ( cop.getOption( "-e --model-check-only") ) {
@@ -141,6 +156,19 @@ bool Flattener::processOption(int& i, const int argc, const char** argv)
     flag_only_range_domains = true;
   } else if ( cop.getOption( "--no-MIPdomains" ) ) {   // internal
     flag_noMIPdomains = true;
+  } else if ( cop.getOption( "--MIPdomains-threads", &flag_MIPdomains_threads ) ) {
+    if (flag_MIPdomains_threads < 0)
+      goto error;
+  } else if ( cop.getOption( "--incremental-base", &buffer ) ) {
+    if ( buffer.length()<=4 ||
+         buffer.substr(buffer.length()-4,string::npos) != ".dzn")
+      goto error;
+    flag_incremental_base.push_back(buffer);
+  } else if ( cop.getOption( "--instrument-json", &flag_instrument_json ) ) {
+  } else if ( cop.getOption( "--profile-flattening", &flag_profile_flattening ) ) {
+  } else if ( cop.getOption( "--profile-top", &flag_profile_top ) ) {
+    if (flag_profile_top <= 0)
+      goto error;
   } else if ( cop.getOption( "-Werror" ) ) {
     flag_werror = true;
   } else {
@@ -193,10 +221,64 @@ Flattener::~Flattener()
 }
 
 
+std::string Flattener::modelKey() const
+{
+  std::ostringstream key;
+  for (unsigned int i=0; i<filenames.size(); i++) {
+    std::ifstream is(filenames[i].c_str(), std::ios::in | std::ios::binary);
+    std::string contents((istreambuf_iterator<char>(is)), istreambuf_iterator<char>());
+    key << filenames[i] << ":" << std::hash<std::string>()(contents) << ";";
+  }
+  return key.str();
+}
+
+void Flattener::flattenBase()
+{
+  if (flag_verbose) {
+    std::cerr << "Flattening with base data '" << flag_incremental_base[0] << '\'';
+    for (unsigned int i=1; i<flag_incremental_base.size(); i++)
+      std::cerr << ", '" << flag_incremental_base[i] << '\'';
+    std::cerr << " ...";
+  }
+  std::stringstream errstream;
+  Env env;
+  Model* m = parse(env, filenames, flag_incremental_base, includePaths, flag_ignoreStdlib, false, false, errstream, NULL, pLibraryCache);
+  if (m==NULL) {
+    if (flag_verbose)
+      std::cerr << std::endl;
+    std::copy(istreambuf_iterator<char>(errstream),istreambuf_iterator<char>(),ostreambuf_iterator<char>(std::cerr));
+    exit(EXIT_FAILURE);
+  }
+  env.model(m);
+  vector<TypeError> typeErrors;
+  MiniZinc::typecheck(env, m, typeErrors, false);
+  if (typeErrors.size() > 0) {
+    if (flag_verbose)
+      std::cerr << std::endl;
+    for (unsigned int i=0; i<typeErrors.size(); i++) {
+      std::cerr << typeErrors[i].loc() << ":" << std::endl;
+      std::cerr << typeErrors[i].what() << ": " << typeErrors[i].msg() << std::endl;
+    }
+    exit(EXIT_FAILURE);
+  }
+  MiniZinc::registerBuiltins(env, m);
+  // Warnings are reported when the recorded items are reused
+  ::flatten(env,fopts);
+  if (flag_verbose)
+    std::cerr << " done (" << stoptime(lasttime) << "), reused "
+    << fopts.incremental->reused() << " of " << fopts.incremental->items() << " constraints" << std::endl;
+}
+
 void Flattener::flatten()
 {
   starttime01 = std::clock();
   lasttime = starttime01;
+  if (!flag_instrument_json.empty())
+    pInstrumentation.reset(new Instrumentation());
+  fopts.instrumentation = pInstrumentation.get();
+  if (!flag_profile_flattening.empty())
+    pProfiler.reset(new FlatteningProfiler());
+  fopts.profiler = pProfiler.get();
   
   if (flag_verbose)
     printVersion(cerr);
@@ -278,9 +360,29 @@ void Flattener::flatten()
     }
   }
 
+  IncrementalFlattening* incremental = pIncremental;
+  if (incremental==NULL && !flag_incremental_base.empty()) {
+    if (pBaseIncremental.get()==NULL)
+      pBaseIncremental.reset(new IncrementalFlattening());
+    incremental = pBaseIncremental.get();
+  }
+  if (incremental && !flag_stdinInput && !is_flatzinc) {
+    incremental->model(modelKey());
+    fopts.incremental = incremental;
+  } else {
+    fopts.incremental = NULL;
+  }
+
   {
     std::stringstream errstream;
     try {
+      if (fopts.incremental && !flag_incremental_base.empty()) {
+        fopts.onlyRangeDomains = flag_only_range_domains;
+        fopts.outputMode = flag_output_mode;
+        Instrumentation::Scope phase(pInstrumentation.get(), "flatten_base");
+        flattenBase();
+      }
+      Instrumentation::Scope phase(pInstrumentation.get(), "parse");
       Model* m;
       pEnv.reset(new Env());
       Env& env = *getEnv();
@@ -300,7 +402,12 @@ void Flattener::flatten()
             std::cerr << ", '" << sFln << '\'';
           std::cerr << " ..." << std::endl;
         }
-        m = parse(env, filenames, datafiles, includePaths, flag_ignoreStdlib, false, flag_verbose, errstream);
+        std::unique_ptr<LibraryIndex> libIndex;
+        if (flag_lazy_stdlib)
+          libIndex.reset(new LibraryIndex(flag_stdlib_index.empty() ? LibraryIndex::defaultFilename() : flag_stdlib_index));
+        m = parse(env, filenames, datafiles, includePaths, flag_ignoreStdlib, false, flag_verbose, errstream, libIndex.get(), pLibraryCache);
+        if (libIndex && !libIndex->save() && flag_verbose)
+          std::cerr << "Warning: could not write library index" << std::endl;
       }
       if (m) {
         env.model(m);
@@ -310,8 +417,10 @@ void Flattener::flatten()
             std::cerr << " done parsing (" << stoptime(lasttime) << ")" << std::endl;
           if (flag_verbose)
             std::cerr << "Typechecking ...";
+          phase.next("typecheck");
           vector<TypeError> typeErrors;
-          MiniZinc::typecheck(env, m, typeErrors, flag_model_check_only || flag_model_interface_only);
+          MiniZinc::typecheck(env, m, typeErrors, flag_model_check_only || flag_model_interface_only,
+                              flag_typecheck_threads);
           if (typeErrors.size() > 0) {
             for (unsigned int i=0; i<typeErrors.size(); i++) {
               if (flag_verbose)
@@ -331,12 +440,14 @@ void Flattener::flatten()
           
           if (!flag_instance_check_only && !flag_model_check_only && !flag_model_interface_only) {
             if (is_flatzinc) {
+              phase.next("output");
               GCLock lock;
               env.swap();
               populateOutput(env);
             } else {
               if (flag_verbose)
                 std::cerr << "Flattening ...";
+              phase.next("flatten");
 
               try {
                 fopts.onlyRangeDomains = flag_only_range_domains;
@@ -358,14 +469,20 @@ void Flattener::flatten()
               }
               env.clearWarnings();
               //            Model* flat = env.flat();
-              if (flag_verbose)
+              if (flag_verbose) {
                 std::cerr << " done (" << stoptime(lasttime)
-                << "), max stack depth " << env.maxCallStack() << std::endl;
+                << "), max stack depth " << env.maxCallStack();
+                if (fopts.incremental)
+                  std::cerr << ", reused " << fopts.incremental->reused()
+                  << " of " << fopts.incremental->items() << " constraints";
+                std::cerr << std::endl;
+              }
 
               if ( ! flag_noMIPdomains ) {
                 if (flag_verbose)
                   std::cerr << "MIP domains ...";
-                MIPdomains(env, flag_statistics);
+                phase.next("MIPdomains");
+                MIPdomains(env, flag_statistics, flag_MIPdomains_threads);
                 if (flag_verbose)
                   std::cerr << " done (" << stoptime(lasttime) << ")" << std::endl;
               }
@@ -373,6 +490,7 @@ void Flattener::flatten()
               if (flag_optimize) {
                 if (flag_verbose)
                   std::cerr << "Optimizing ...";
+                phase.next("optimize");
                 optimize(env);
                 for (unsigned int i=0; i<env.warnings().size(); i++) {
                   std::cerr << (flag_werror ? "\n  ERROR: " : "\n  WARNING: ") << env.warnings()[i];
@@ -387,15 +505,19 @@ void Flattener::flatten()
               if (!flag_newfzn) {
                 if (flag_verbose)
                   std::cerr << "Converting to old FlatZinc ...";
+                phase.next("oldflatzinc");
                 oldflatzinc(env);
                 if (flag_verbose)
                   std::cerr << " done (" << stoptime(lasttime) << ")" << std::endl;
               } else {
-                env.flat()->compact();
+                phase.next("compact");
+                env.envi().flat_compact(true);
                 env.output()->compact();
               }
             }
 
+            phase.finish();
+
             if (flag_statistics) {
               FlatModelStatistics stats = statistics(env);
               std::cerr << "Generated FlatZinc statistics:\n";
@@ -435,6 +557,7 @@ void Flattener::flatten()
             if (flag_output_fzn_stdout) {
               if (flag_verbose)
                 std::cerr << "Printing FlatZinc to stdout ..." << std::endl;
+              phase.next("print_fzn");
               Printer p(std::cout,0);
               p.print(env.flat());
               if (flag_verbose)
@@ -443,6 +566,7 @@ void Flattener::flatten()
               if (flag_verbose)
                 std::cerr << "Printing FlatZinc to '"
                 << flag_output_fzn << "' ..." << std::flush;
+              phase.next("print_fzn");
               std::ofstream os;
               os.open(flag_output_fzn.c_str(), ios::out);
               checkIOStatus (os.good(), " I/O error: cannot open fzn output file. ");
@@ -457,6 +581,7 @@ void Flattener::flatten()
               if (flag_output_ozn_stdout) {
                 if (flag_verbose)
                   std::cerr << "Printing .ozn to stdout ..." << std::endl;
+                phase.next("print_ozn");
                 Printer p(std::cout,0);
                 p.print(env.output());
                 if (flag_verbose)
@@ -465,6 +590,7 @@ void Flattener::flatten()
                 if (flag_verbose)
                   std::cerr << "Printing .ozn to '"
                   << flag_output_ozn << "' ..." << std::flush;
+                phase.next("print_ozn");
                 std::ofstream os;
                 os.open(flag_output_ozn.c_str(), std::ios::out);
                 checkIOStatus (os.good(), " I/O error: cannot open ozn output file. ");
@@ -524,6 +650,60 @@ void Flattener::flatten()
       std::cerr << "Maximum memory " << mem/(1024*1024) << " Mbytes";
     std::cerr << "." << std::endl;    
   }
+
+  if (pInstrumentation.get())
+    printInstrumentation();
+  if (pProfiler.get())
+    printProfile();
+}
+
+void Flattener::printInstrumentation()
+{
+  Instrumentation& instr = *pInstrumentation;
+  Env& env = *getEnv();
+  if (env.flat()) {
+    FlatModelStatistics stats = statistics(env);
+    instr.counter("flat_bool_vars", stats.n_bool_vars);
+    instr.counter("flat_int_vars", stats.n_int_vars);
+    instr.counter("flat_float_vars", stats.n_float_vars);
+    instr.counter("flat_set_vars", stats.n_set_vars);
+    instr.counter("flat_bool_constraints", stats.n_bool_ct);
+    instr.counter("flat_int_constraints", stats.n_int_ct);
+    instr.counter("flat_float_constraints", stats.n_float_ct);
+    instr.counter("flat_set_constraints", stats.n_set_ct);
+  }
+  instr.counter("cse_lookups", env.envi().cse_lookups);
+  instr.counter("cse_hits", env.envi().cse_hits);
+  instr.counter("max_call_stack", env.maxCallStack());
+  if (fopts.incremental) {
+    instr.counter("incremental_items", fopts.incremental->items());
+    instr.counter("incremental_reused", fopts.incremental->reused());
+  }
+  if (flag_instrument_json == "-") {
+    instr.json(std::cerr);
+  } else {
+    std::ofstream os(flag_instrument_json.c_str(), ios::out);
+    checkIOStatus (os.good(), " I/O error: cannot open instrumentation output file. ");
+    instr.json(os);
+    checkIOStatus (os.good(), " I/O error: cannot write instrumentation output file. ");
+  }
+}
+
+void Flattener::printProfile()
+{
+  if (flag_profile_flattening == "-") {
+    pProfiler->report(std::cerr, flag_profile_top);
+  } else {
+    std::ofstream os(flag_profile_flattening.c_str(), ios::out);
+    checkIOStatus (os.good(), " I/O error: cannot open profile output file. ");
+    pProfiler->report(os, flag_profile_top);
+    checkIOStatus (os.good(), " I/O error: cannot write profile output file. ");
+  }
+  std::string folded = (flag_profile_flattening == "-" ? flag_output_base : flag_profile_flattening)+".folded";
+  std::ofstream os(folded.c_str(), ios::out);
+  checkIOStatus (os.good(), " I/O error: cannot open folded profile output file. ");
+  pProfiler->folded(os);
+  checkIOStatus (os.good(), " I/O error: cannot write folded profile output file. ");
 }
 
 void Flattener::printStatistics(ostream&)
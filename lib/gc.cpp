@@ -41,9 +41,14 @@ namespace MiniZinc {
   bool
   GC::locked(void) {
     assert(gc());
+    SharedLock lock(gc());
     return gc()->_lock_count > 0;
   }
 
+  GC::SharedLock::SharedLock(void) : _m(gc() ? gc()->_shared : NULL) {
+    if (_m) _m->lock();
+  }
+
   GCLock::GCLock(void) {
     GC::lock();
   }
@@ -76,6 +81,7 @@ namespace MiniZinc {
   /// Memory managed by the garbage collector
   class GC::Heap {
     friend class GC;
+    friend class GCPermanent;
 #if defined(MINIZINC_GC_STATS)
     static const char* _nodeid[Item::II_END+1];
     struct GCStat {
@@ -117,6 +123,10 @@ namespace MiniZinc {
     size_t _gc_threshold;
     /// High water mark of all allocated memory
     size_t _max_alloced_mem;
+    /// Total amount of memory handed out since the heap was created
+    unsigned long long _total_alloced;
+    /// Number of garbage collections run
+    unsigned long long _collections;
 
     /// A trail item
     struct TItem {
@@ -138,10 +148,21 @@ namespace MiniZinc {
       , _alloced_mem(0)
       , _free_mem(0)
       , _gc_threshold(10)
-      , _max_alloced_mem(0) {
+      , _max_alloced_mem(0)
+      , _total_alloced(0)
+      , _collections(0) {
       for (int i=_max_fl+1; i--;)
         _fl[i] = NULL;
     }
+    ~Heap(void) {
+      // Nothing is marked, so this finalises all nodes
+      sweep();
+      while (_page) {
+        HeapPage* p = _page;
+        _page = p->next;
+        ::free(p);
+      }
+    }
 
     /// Default size of pages to allocate
     static const size_t pageSize = 1<<20;
@@ -231,6 +252,7 @@ namespace MiniZinc {
 #endif
         mark();
         sweep();
+        _collections++;
         _gc_threshold = static_cast<size_t>(_alloced_mem * 1.5);
 #ifdef MINIZINC_GC_STATS
         std::cerr << "done\n\talloced " << (_alloced_mem/1024) << "\n\tfree " << (_free_mem/1024) << "\n\tdiff "
@@ -241,6 +263,7 @@ namespace MiniZinc {
       }
     }
     void mark(void);
+    void markAll(void);
     void sweep(void);
 
     static size_t
@@ -337,6 +360,7 @@ namespace MiniZinc {
     if (gc()==NULL) {
       gc() = new GC();
     }
+    SharedLock lock(gc());
     if (gc()->_lock_count==0)
       gc()->_heap->rungc();
     gc()->_lock_count++;
@@ -344,6 +368,7 @@ namespace MiniZinc {
   void
   GC::unlock(void) {
     assert(locked());
+    SharedLock lock(gc());
     gc()->_lock_count--;
   }
 
@@ -359,11 +384,101 @@ namespace MiniZinc {
     sizeof(Item)+6*sizeof(void*),
   };
 
-  GC::GC(void) : _heap(new Heap()), _lock_count(0) {}
+  GC::GC(void) : _heap(new Heap()), _lock_count(0), _literals(NULL), _shared(NULL) {}
+
+  GC::~GC(void) {
+    assert(gc()==this);
+    delete _literals;
+    delete _heap;
+  }
+
+  LiteralCache&
+  GC::literals(void) {
+    GC* gc = GC::gc();
+    SharedLock lock(gc);
+    if (gc->_literals==NULL)
+      gc->_literals = new LiteralCache();
+    return *gc->_literals;
+  }
+
+  GCContext::GCContext(void) : _gc(new GC()) {}
+
+  GCContext::~GCContext(void) {
+    std::lock_guard<std::recursive_mutex> guard(_mutex);
+    GC* prev = GC::gc();
+    GC::gc() = _gc;
+    delete _gc;
+    GC::gc() = prev;
+  }
+
+  GCContext::Use::Use(GCContext& c) : _c(c) {
+    _c._mutex.lock();
+    _prev = GC::gc();
+    GC::gc() = _c._gc;
+  }
+
+  GCContext::Use::~Use(void) {
+    GC::gc() = _prev;
+    _c._mutex.unlock();
+  }
+
+  GCShared::GCShared(void) {
+    // Hold a lock while the collector is shared, so that it never runs
+    GC::lock();
+    _gc = GC::gc();
+    assert(_gc->_shared==NULL);
+    _gc->_shared = &_mutex;
+  }
+
+  GCShared::~GCShared(void) {
+    assert(GC::gc()==_gc);
+    _gc->_shared = NULL;
+    GC::unlock();
+  }
+
+  GCShared::Use::Use(GCShared& s) {
+    _prev = GC::gc();
+    GC::gc() = s._gc;
+  }
+
+  GCShared::Use::~Use(void) {
+    GC::gc() = _prev;
+  }
+
+  namespace {
+    std::recursive_mutex& permanentMutex(void) {
+      static std::recursive_mutex m;
+      return m;
+    }
+  }
+
+  GCPermanent::GCPermanent(void) {
+    permanentMutex().lock();
+    static GC* permanent = NULL;
+    if (permanent==NULL) {
+      permanent = new GC();
+      // The permanent collector is always locked, so it never runs
+      permanent->_lock_count = 1;
+    }
+    _prev = GC::gc();
+    GC::gc() = permanent;
+  }
+
+  GCPermanent::~GCPermanent(void) {
+    // Mark all permanent data now, including nodes that are only referenced
+    // from static objects (such as the strings in Constants). Collectors of
+    // other threads then find it marked and never write to it.
+    GC::gc()->_heap->markAll();
+    // Threads that had no collector yet get their own one, as if the
+    // permanent data had been allocated in it
+    GC::gc() = _prev==NULL ? new GC() : _prev;
+    permanentMutex().unlock();
+  }
 
   void
   GC::add(Model* m) {
     GC* gc = GC::gc();
+    SharedLock lock(gc);
     if (gc->_heap->_rootset) {
       m->_roots_next = gc->_heap->_rootset;
       m->_roots_prev = m->_roots_next->_roots_prev;
@@ -377,6 +492,7 @@ namespace MiniZinc {
   void
   GC::remove(Model* m) {
     GC* gc = GC::gc();
+    SharedLock lock(gc);
     if (m->_roots_next == m) {
       gc->_heap->_rootset = NULL;
     } else {
@@ -390,6 +506,8 @@ namespace MiniZinc {
   void*
   GC::alloc(size_t size) {
     assert(locked());
+    SharedLock lock(this);
+    _heap->_total_alloced += size;
     void* ret;
     if (size < _heap->_fl_size[0] || size > _heap->_fl_size[_heap->_max_fl]) {
       ret = _heap->alloc(size,true);
@@ -521,6 +639,18 @@ namespace MiniZinc {
 #endif
   }
     
+  void
+  GC::Heap::markAll(void) {
+    for (HeapPage* p = _page; p != NULL; p = p->next) {
+      size_t off = 0;
+      while (off < p->used) {
+        ASTNode* n = reinterpret_cast<ASTNode*>(p->data+off);
+        n->_gc_mark = 1;
+        off += nodesize(n);
+      }
+    }
+  }
+
   void
   GC::Heap::sweep(void) {
 #if defined(MINIZINC_GC_STATS)
@@ -639,17 +769,20 @@ namespace MiniZinc {
   void
   GC::mark(void) {
     GC* gc = GC::gc();
+    SharedLock lock(gc);
     if (!gc->_heap->trail.empty())
       gc->_heap->trail.back().mark = true;
   }
   void
   GC::trail(Expression** l,Expression* v) {
     GC* gc = GC::gc();
+    SharedLock lock(gc);
     gc->_heap->trail.push_back(GC::Heap::TItem(l,v));
   }
   void
   GC::untrail(void) {
     GC* gc = GC::gc();
+    SharedLock lock(gc);
     while (!gc->_heap->trail.empty() && !gc->_heap->trail.back().mark) {
       *gc->_heap->trail.back().l = gc->_heap->trail.back().v;
       gc->_heap->trail.pop_back();
@@ -662,6 +795,24 @@ namespace MiniZinc {
     GC* gc = GC::gc();
     return gc->_heap->_max_alloced_mem;
   }
+
+  size_t
+  GC::mem(void) {
+    GC* gc = GC::gc();
+    return gc==NULL ? 0 : gc->_heap->_alloced_mem-gc->_heap->_free_mem;
+  }
+
+  unsigned long long
+  GC::allocated(void) {
+    GC* gc = GC::gc();
+    return gc==NULL ? 0 : gc->_heap->_total_alloced;
+  }
+
+  unsigned long long
+  GC::collections(void) {
+    GC* gc = GC::gc();
+    return gc==NULL ? 0 : gc->_heap->_collections;
+  }
   
 
   void*
@@ -671,6 +822,7 @@ namespace MiniZinc {
 
   void
   GC::addKeepAlive(KeepAlive* e) {
+    SharedLock lock(GC::gc());
     assert(e->_p==NULL);
     assert(e->_n==NULL);
     e->_n = GC::gc()->_heap->_roots;
@@ -680,6 +832,7 @@ namespace MiniZinc {
   }
   void
   GC::removeKeepAlive(KeepAlive* e) {
+    SharedLock lock(GC::gc());
     if (e->_p) {
       e->_p->_n = e->_n;
     } else {
@@ -721,6 +874,7 @@ namespace MiniZinc {
 
   void
   GC::addWeakRef(WeakRef* e) {
+    SharedLock lock(GC::gc());
     assert(e->_p==NULL);
     assert(e->_n==NULL);
     e->_n = GC::gc()->_heap->_weakRefs;
@@ -730,6 +884,7 @@ namespace MiniZinc {
   }
   void
   GC::removeWeakRef(MiniZinc::WeakRef *e) {
+    SharedLock lock(GC::gc());
     if (e->_p) {
       e->_p->_n = e->_n;
     } else {
@@ -742,6 +897,7 @@ namespace MiniZinc {
   }
   void
   GC::addNodeWeakMap(ASTNodeWeakMap* m) {
+    SharedLock lock(GC::gc());
     assert(m->_p==NULL);
     assert(m->_n==NULL);
     m->_n = GC::gc()->_heap->_nodeWeakMaps;
@@ -751,6 +907,7 @@ namespace MiniZinc {
   }
   void
   GC::removeNodeWeakMap(ASTNodeWeakMap* m) {
+    SharedLock lock(GC::gc());
     if (m->_p) {
       m->_p->_n = m->_n;
     } else {
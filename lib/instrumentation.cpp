@@ -0,0 +1,149 @@
+/* -*- mode: C++; c-basic-offset: 2; indent-tabs-mode: nil -*- */
+
+/*
+ *  Main authors:
+ *     agent <agent@local>
+ */
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <minizinc/instrumentation.hh>
+#include <minizinc/gc.hh>
+
+#include <iomanip>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace MiniZinc {
+
+  Instrumentation::Scope::Scope(Instrumentation* i, const char* name)
+    : _i(i), _name(name), _allocated(0), _collections(0) {
+    if (_i) {
+      _allocated = GC::allocated();
+      _collections = GC::collections();
+    }
+  }
+
+  void
+  Instrumentation::Scope::next(const char* name) {
+    finish();
+    _name = name;
+    _t.reset();
+    _allocated = GC::allocated();
+    _collections = GC::collections();
+  }
+
+  void
+  Instrumentation::Scope::finish(void) {
+    if (_i && _name) {
+      _i->add(_name, _t.ms(), GC::allocated()-_allocated,
+              GC::collections()-_collections);
+    }
+    _name = NULL;
+  }
+
+  Instrumentation::Scope::~Scope(void) {
+    finish();
+  }
+
+  void
+  Instrumentation::add(const char* name, double ms, unsigned long long allocated,
+                       unsigned long long collections) {
+    Phase* p = NULL;
+    for (unsigned int i=0; i<_phases.size(); i++) {
+      if (_phases[i].name==name) {
+        p = &_phases[i];
+        break;
+      }
+    }
+    if (p==NULL) {
+      Phase np;
+      np.name = name;
+      np.runs = 0;
+      np.ms = 0.0;
+      np.allocated = 0;
+      np.collections = 0;
+      _phases.push_back(np);
+      p = &_phases.back();
+    }
+    p->runs++;
+    p->ms += ms;
+    p->allocated += allocated;
+    p->collections += collections;
+    p->heap = GC::mem();
+    p->maxHeap = GC::maxMem();
+    p->peakRss = peakRss();
+  }
+
+  unsigned long long
+  Instrumentation::peakRss(void) {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+      return pmc.PeakWorkingSetSize;
+    return 0;
+#else
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0)
+      return 0;
+#ifdef __APPLE__
+    return ru.ru_maxrss;
+#else
+    // Linux and the BSDs report kilobytes
+    return static_cast<unsigned long long>(ru.ru_maxrss)*1024;
+#endif
+#endif
+  }
+
+  void
+  Instrumentation::counter(const std::string& name, long long value) {
+    for (unsigned int i=0; i<_counters.size(); i++) {
+      if (_counters[i].first==name) {
+        _counters[i].second = value;
+        return;
+      }
+    }
+    _counters.push_back(std::make_pair(name, value));
+  }
+
+  void
+  Instrumentation::json(std::ostream& os) const {
+    std::ios_base::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << std::fixed << std::setprecision(3);
+    os << "{\n  \"phases\": [";
+    for (unsigned int i=0; i<_phases.size(); i++) {
+      const Phase& p = _phases[i];
+      os << (i==0 ? "\n" : ",\n");
+      os << "    {\"name\": \"" << p.name << "\", \"runs\": " << p.runs
+         << ", \"time_ms\": " << p.ms
+         << ", \"gc_allocated_bytes\": " << p.allocated
+         << ", \"gc_collections\": " << p.collections
+         << ", \"gc_heap_bytes\": " << p.heap
+         << ", \"gc_max_heap_bytes\": " << p.maxHeap
+         << ", \"peak_rss_bytes\": " << p.peakRss << "}";
+    }
+    os << "\n  ],\n  \"counters\": {";
+    for (unsigned int i=0; i<_counters.size(); i++) {
+      os << (i==0 ? "\n" : ",\n");
+      os << "    \"" << _counters[i].first << "\": " << _counters[i].second;
+    }
+    os << "\n  },\n";
+    os << "  \"gc\": {\"allocated_bytes\": " << GC::allocated()
+       << ", \"collections\": " << GC::collections()
+       << ", \"heap_bytes\": " << GC::mem()
+       << ", \"max_heap_bytes\": " << GC::maxMem() << "},\n";
+    os << "  \"peak_rss_bytes\": " << peakRss() << ",\n";
+    os << "  \"total_time_ms\": " << _total.ms() << "\n}\n";
+    os.flags(flags);
+    os.precision(precision);
+  }
+
+}
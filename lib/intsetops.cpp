@@ -0,0 +1,383 @@
+/* -*- mode: C++; c-basic-offset: 2; indent-tabs-mode: nil -*- */
+
+/*
+ *  Main authors:
+ *     agent <agent@local>
+ */
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <minizinc/intsetops.hh>
+#include <minizinc/iter.hh>
+
+namespace MiniZinc {
+
+  namespace {
+    typedef IntSetVal::Range Range;
+
+    /// Count trailing zero bits of \a x (which must not be 0)
+    inline int ctz64(unsigned long long int x) {
+#if defined(__GNUC__)
+      return __builtin_ctzll(x);
+#else
+      int n = 0;
+      while ((x & 1ULL)==0) {
+        x >>= 1;
+        n++;
+      }
+      return n;
+#endif
+    }
+
+    /// Set bits \a a to \a b (inclusive) in bitset \a bits
+    inline void setBits(std::vector<unsigned long long int>& bits,
+                        unsigned long long int a, unsigned long long int b) {
+      size_t wa = static_cast<size_t>(a >> 6);
+      size_t wb = static_cast<size_t>(b >> 6);
+      unsigned long long int ma = ~0ULL << (a & 63);
+      unsigned long long int mb = ~0ULL >> (63 - (b & 63));
+      if (wa==wb) {
+        bits[wa] |= ma & mb;
+      } else {
+        bits[wa] |= ma;
+        for (size_t w=wa+1; w<wb; w++)
+          bits[w] = ~0ULL;
+        bits[wb] |= mb;
+      }
+    }
+
+    /// Convert the first \a n bits of \a bits into ranges starting at \a lb
+    void bitsToRanges(const std::vector<unsigned long long int>& bits,
+                      unsigned long long int n, long long int lb,
+                      std::vector<Range>& r) {
+      r.clear();
+      size_t words = bits.size();
+      unsigned long long int i = 0;
+      while (i < n) {
+        // Find next set bit
+        size_t w = static_cast<size_t>(i >> 6);
+        unsigned long long int word = bits[w] & (~0ULL << (i & 63));
+        while (word==0) {
+          if (++w==words)
+            return;
+          word = bits[w];
+        }
+        unsigned long long int start = static_cast<unsigned long long int>(w)*64+ctz64(word);
+        if (start >= n)
+          return;
+        // Find next unset bit
+        unsigned long long int end = n;
+        w = static_cast<size_t>(start >> 6);
+        word = ~bits[w] & (~0ULL << (start & 63));
+        while (word==0) {
+          if (++w==words)
+            break;
+          word = ~bits[w];
+        }
+        if (w < words)
+          end = std::min(end, static_cast<unsigned long long int>(w)*64+ctz64(word));
+        r.push_back(Range(lb+static_cast<long long int>(start),
+                          lb+static_cast<long long int>(end-1)));
+        i = end;
+      }
+    }
+
+    /// Compare ranges by their minimum
+    struct RangeMinOrd {
+      bool operator ()(const Range& r0, const Range& r1) const {
+        return r0.min < r1.min;
+      }
+    };
+
+    /// Adaptor for a vector of ranges
+    class RangeVec {
+    protected:
+      const std::vector<Range>& _v;
+    public:
+      RangeVec(const std::vector<Range>& v) : _v(v) {}
+      int size(void) const { return static_cast<int>(_v.size()); }
+      IntVal min(int i) const { return _v[i].min; }
+      IntVal max(int i) const { return _v[i].max; }
+    };
+
+    /// Adaptor for a single range
+    class SingleRange {
+    protected:
+      IntVal _min;
+      IntVal _max;
+    public:
+      SingleRange(IntVal min, IntVal max) : _min(min), _max(max) {}
+      int size(void) const { return 1; }
+      IntVal min(int) const { return _min; }
+      IntVal max(int) const { return _max; }
+    };
+
+    /// Compute the ranges of \a s0 without \a s1 into \a r
+    template<class S0, class S1>
+    void diffRanges(const S0& s0, const S1& s1, std::vector<Range>& r) {
+      r.clear();
+      int j = 0;
+      int n = s1.size();
+      for (int i=0; i<s0.size(); i++) {
+        IntVal cur = s0.min(i);
+        IntVal b = s0.max(i);
+        while (j < n && s1.max(j) < cur)
+          j++;
+        bool done = false;
+        for (int k=j; k<n && s1.min(k) <= b; k++) {
+          if (s1.min(k) > cur)
+            r.push_back(Range(cur, s1.min(k)-1));
+          if (!s1.max(k).isFinite()) {
+            done = true;
+            break;
+          }
+          cur = s1.max(k)+1;
+          if (cur > b) {
+            done = true;
+            break;
+          }
+        }
+        if (!done)
+          r.push_back(Range(cur,b));
+      }
+    }
+  }
+
+  const long long int IntSetOps::bitsetMaxUniverse;
+
+  IntSetOps::IntSetOps(void)
+    : _op(OP_NONE), _normalised(true), _started(false) {}
+
+  void
+  IntSetOps::startUnion(void) {
+    _op = OP_UNION;
+    _r.clear();
+    _normalised = true;
+  }
+
+  void
+  IntSetOps::startIntersect(void) {
+    _op = OP_INTER;
+    _r.clear();
+    _normalised = true;
+    _started = false;
+  }
+
+  template<class S>
+  void
+  IntSetOps::intersect(const S& s) {
+    _tmp.clear();
+    size_t i = 0;
+    int j = 0;
+    int n = s.size();
+    while (i < _r.size() && j < n) {
+      IntVal lo = std::max(_r[i].min, s.min(j));
+      IntVal hi = std::min(_r[i].max, s.max(j));
+      if (lo <= hi)
+        _tmp.push_back(Range(lo,hi));
+      if (_r[i].max < s.max(j))
+        i++;
+      else
+        j++;
+    }
+    _r.swap(_tmp);
+  }
+
+  void
+  IntSetOps::add(const IntSetVal* s) {
+    assert(_op != OP_NONE);
+    if (_op==OP_UNION) {
+      if (s->size()==0)
+        return;
+      if (_normalised && !_r.empty() && Ranges::overlaps(_r.back().max, s->min(0)))
+        _normalised = false;
+      for (int i=0; i<s->size(); i++)
+        _r.push_back(Range(s->min(i),s->max(i)));
+    } else {
+      if (!_started) {
+        _started = true;
+        for (int i=0; i<s->size(); i++)
+          _r.push_back(Range(s->min(i),s->max(i)));
+      } else if (!_r.empty()) {
+        intersect(*s);
+      }
+    }
+  }
+
+  void
+  IntSetOps::add(IntVal min, IntVal max) {
+    assert(_op != OP_NONE);
+    if (_op==OP_UNION) {
+      if (min > max)
+        return;
+      if (_normalised && !_r.empty() && Ranges::overlaps(_r.back().max, min))
+        _normalised = false;
+      _r.push_back(Range(min,max));
+    } else {
+      if (!_started) {
+        _started = true;
+        if (min <= max)
+          _r.push_back(Range(min,max));
+      } else if (!_r.empty()) {
+        intersect(SingleRange(min,max));
+      }
+    }
+  }
+
+  bool
+  IntSetOps::empty(void) const {
+    return _r.empty() && (_op==OP_UNION || _started);
+  }
+
+  void
+  IntSetOps::normaliseBitset(long long int lb, long long int ub) {
+    unsigned long long int n =
+      static_cast<unsigned long long int>(ub)-static_cast<unsigned long long int>(lb)+1;
+    _bits.assign(static_cast<size_t>((n+63)>>6), 0ULL);
+    for (unsigned int i=0; i<_r.size(); i++) {
+      setBits(_bits,
+              static_cast<unsigned long long int>(_r[i].min.toInt())-static_cast<unsigned long long int>(lb),
+              static_cast<unsigned long long int>(_r[i].max.toInt())-static_cast<unsigned long long int>(lb));
+    }
+    bitsToRanges(_bits, n, lb, _r);
+  }
+
+  void
+  IntSetOps::normalise(void) {
+    if (_r.size() <= 1) {
+      _normalised = true;
+      return;
+    }
+    bool finite = true;
+    IntVal lb = _r[0].min;
+    IntVal ub = _r[0].max;
+    for (unsigned int i=0; i<_r.size(); i++) {
+      if (!_r[i].min.isFinite() || !_r[i].max.isFinite()) {
+        finite = false;
+        break;
+      }
+      lb = std::min(lb, _r[i].min);
+      ub = std::max(ub, _r[i].max);
+    }
+    if (finite) {
+      unsigned long long int n =
+        static_cast<unsigned long long int>(ub.toInt())-static_cast<unsigned long long int>(lb.toInt());
+      // Use bitset if universe is small and the bitset is not much larger than the ranges
+      if (n < static_cast<unsigned long long int>(bitsetMaxUniverse) && (n>>6) <= 4*_r.size()) {
+        normaliseBitset(lb.toInt(), ub.toInt());
+        _normalised = true;
+        return;
+      }
+    }
+    std::sort(_r.begin(), _r.end(), RangeMinOrd());
+    size_t j = 0;
+    for (size_t i=1; i<_r.size(); i++) {
+      if (Ranges::overlaps(_r[j].max, _r[i].min)) {
+        _r[j].max = std::max(_r[j].max, _r[i].max);
+      } else {
+        _r[++j] = _r[i];
+      }
+    }
+    _r.resize(j+1);
+    _normalised = true;
+  }
+
+  IntSetVal*
+  IntSetOps::result(void) {
+    assert(_op != OP_NONE);
+    IntSetVal* ret;
+    if (_op==OP_INTER && !_started) {
+      ret = IntSetVal::a(-IntVal::infinity(),IntVal::infinity());
+    } else {
+      if (!_normalised)
+        normalise();
+      ret = _r.empty() ? IntSetVal::a() : IntSetVal::a(_r);
+    }
+    _op = OP_NONE;
+    _r.clear();
+    return ret;
+  }
+
+  IntSetVal*
+  IntSetOps::unionSet(const IntSetVal* s0, const IntSetVal* s1) {
+    startUnion();
+    add(s0);
+    add(s1);
+    return result();
+  }
+
+  IntSetVal*
+  IntSetOps::interSet(const IntSetVal* s0, const IntSetVal* s1) {
+    startIntersect();
+    add(s0);
+    add(s1);
+    return result();
+  }
+
+  IntSetVal*
+  IntSetOps::diffSet(const IntSetVal* s0, const IntSetVal* s1) {
+    diffRanges(*s0, *s1, _r);
+    IntSetVal* ret = _r.empty() ? IntSetVal::a() : IntSetVal::a(_r);
+    _r.clear();
+    return ret;
+  }
+
+  IntSetVal*
+  IntSetOps::symdiffSet(const IntSetVal* s0, const IntSetVal* s1) {
+    // Compute union and intersection, then subtract
+    startUnion();
+    add(s0);
+    add(s1);
+    if (!_normalised)
+      normalise();
+    std::vector<Range> u;
+    u.swap(_r);
+    startIntersect();
+    add(s0);
+    add(s1);
+    std::vector<Range> i;
+    i.swap(_r);
+    _op = OP_NONE;
+    diffRanges(RangeVec(u), RangeVec(i), _r);
+    IntSetVal* ret = _r.empty() ? IntSetVal::a() : IntSetVal::a(_r);
+    _r.clear();
+    return ret;
+  }
+
+  IntSetVal*
+  IntSetOps::fromValues(const std::vector<IntVal>& v) {
+    if (v.empty())
+      return IntSetVal::a();
+    IntVal lb = v[0];
+    IntVal ub = v[0];
+    bool finite = true;
+    for (unsigned int i=0; i<v.size(); i++) {
+      if (!v[i].isFinite()) {
+        finite = false;
+        break;
+      }
+      lb = std::min(lb, v[i]);
+      ub = std::max(ub, v[i]);
+    }
+    if (finite) {
+      unsigned long long int n =
+        static_cast<unsigned long long int>(ub.toInt())-static_cast<unsigned long long int>(lb.toInt());
+      if (n < static_cast<unsigned long long int>(bitsetMaxUniverse) && (n>>6) <= 4*v.size()) {
+        _bits.assign(static_cast<size_t>((n+64)>>6), 0ULL);
+        for (unsigned int i=0; i<v.size(); i++) {
+          unsigned long long int b =
+            static_cast<unsigned long long int>(v[i].toInt())-static_cast<unsigned long long int>(lb.toInt());
+          _bits[static_cast<size_t>(b>>6)] |= 1ULL << (b & 63);
+        }
+        bitsToRanges(_bits, n+1, lb.toInt(), _r);
+        IntSetVal* ret = IntSetVal::a(_r);
+        _r.clear();
+        return ret;
+      }
+    }
+    return IntSetVal::a(v);
+  }
+
+}
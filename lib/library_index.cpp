@@ -0,0 +1,371 @@
+/* -*- mode: C++; c-basic-offset: 2; indent-tabs-mode: nil -*- */
+
+/*
+ *  Main authors:
+ *     agent <agent@local>
+ */
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <minizinc/library_index.hh>
+#include <minizinc/astiterator.hh>
+#include <minizinc/copy.hh>
+#include <minizinc/file_utils.hh>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace MiniZinc {
+
+  namespace {
+
+    /// First line of an index file, changed whenever the format changes
+    const char* indexHeader = "% MiniZinc library index 1";
+
+    /// Collect the identifiers of called functions and operators
+    class CollectCalls : public EVisitor {
+    public:
+      std::vector<std::string>& calls;
+      CollectCalls(std::vector<std::string>& calls0) : calls(calls0) {}
+      void vCall(const Call& c) { calls.push_back(c.id().str()); }
+      void vBinOp(const BinOp& bo) { calls.push_back(bo.opToString().str()); }
+      void vUnOp(const UnOp& uo) { calls.push_back(uo.opToString().str()); }
+    };
+
+    /// Collect the calls in the items of one model (but not of its includes)
+    class CollectCallsI : public ItemVisitor {
+    public:
+      Model* m;
+      CollectCalls& cc;
+      CollectCallsI(Model* m0, CollectCalls& cc0) : m(m0), cc(cc0) {}
+      bool enterModel(Model* m0) { return m0==m; }
+      void vVarDeclI(VarDeclI* vdi) { topDown(cc, vdi->e()); }
+      void vAssignI(AssignI* ai) { topDown(cc, ai->e()); }
+      void vConstraintI(ConstraintI* ci) { topDown(cc, ci->e()); }
+      void vSolveI(SolveI* si) {
+        topDown(cc, si->e());
+        for (ExpressionSetIter it = si->ann().begin(); it != si->ann().end(); ++it)
+          topDown(cc, *it);
+      }
+      void vOutputI(OutputI* oi) { topDown(cc, oi->e()); }
+      void vFunctionI(FunctionI* fi) {
+        topDown(cc, fi->e());
+        topDown(cc, fi->ti());
+        for (unsigned int i=fi->params().size(); i--;)
+          topDown(cc, fi->params()[i]);
+      }
+    };
+
+    /// Directory part of \a path (including the trailing slash, or ./)
+    std::string dirname(const std::string& path) {
+      size_t p = path.find_last_of('/');
+      return p==std::string::npos ? "./" : path.substr(0,p+1);
+    }
+
+  }
+
+  LibraryIndex::LibraryIndex(const std::string& filename)
+    : _filename(filename), _modified(false) {
+    if (_filename.empty())
+      return;
+    std::ifstream is(_filename.c_str());
+    std::string line;
+    if (!is.good() || !std::getline(is,line) || line != indexHeader)
+      return;
+    Entry* e = NULL;
+    while (std::getline(is,line)) {
+      if (line.size() < 2 || line[1] != ' ')
+        continue;
+      std::string arg = line.substr(2);
+      switch (line[0]) {
+        case 'F':
+        {
+          std::istringstream iss(arg);
+          Entry entry;
+          int pure;
+          std::string path;
+          if (iss >> entry.size >> entry.mtime >> pure && iss.get()==' ' && std::getline(iss,path)) {
+            entry.pure = pure != 0;
+            e = &(_entries[path] = entry);
+          } else {
+            e = NULL;
+          }
+        }
+          break;
+        case 'd':
+          if (e) e->defines.push_back(arg);
+          break;
+        case 'c':
+          if (e) e->calls.push_back(arg);
+          break;
+        case 'i':
+          if (e) e->includes.push_back(arg);
+          break;
+      }
+    }
+  }
+
+  std::string
+  LibraryIndex::defaultFilename(void) {
+    if (const char* f = getenv("MZN_LIBRARY_INDEX"))
+      return f;
+    const char* dirs[] = { "XDG_CACHE_HOME", "LOCALAPPDATA" };
+    for (unsigned int i=0; i<sizeof(dirs)/sizeof(dirs[0]); i++) {
+      const char* d = getenv(dirs[i]);
+      if (d && FileUtils::directory_exists(d))
+        return std::string(d)+"/minizinc-library-index";
+    }
+    if (const char* h = getenv("HOME")) {
+      std::string cache = std::string(h)+"/.cache";
+      if (FileUtils::directory_exists(cache))
+        return cache+"/minizinc-library-index";
+    }
+    return "";
+  }
+
+  bool
+  LibraryIndex::save(void) {
+    if (!_modified || _filename.empty())
+      return true;
+    // Write a temporary file first, so that concurrent compilers never read
+    // a partially written index
+    std::ostringstream tmp;
+    tmp << _filename << "." << std::chrono::steady_clock::now().time_since_epoch().count()
+        << "." << reinterpret_cast<size_t>(this) << ".tmp";
+    {
+      std::ofstream os(tmp.str().c_str());
+      if (!os.good())
+        return false;
+      os << indexHeader << "\n";
+      for (Entries::const_iterator it = _entries.begin(); it != _entries.end(); ++it) {
+        const Entry& e = it->second;
+        os << "F " << e.size << " " << e.mtime << " " << (e.pure ? 1 : 0) << " " << it->first << "\n";
+        for (unsigned int i=0; i<e.defines.size(); i++)
+          os << "d " << e.defines[i] << "\n";
+        for (unsigned int i=0; i<e.calls.size(); i++)
+          os << "c " << e.calls[i] << "\n";
+        for (unsigned int i=0; i<e.includes.size(); i++)
+          os << "i " << e.includes[i] << "\n";
+      }
+      if (!os.good()) {
+        std::remove(tmp.str().c_str());
+        return false;
+      }
+    }
+    if (std::rename(tmp.str().c_str(), _filename.c_str()) != 0) {
+      // Renaming does not replace existing files on all platforms
+      std::remove(_filename.c_str());
+      if (std::rename(tmp.str().c_str(), _filename.c_str()) != 0) {
+        std::remove(tmp.str().c_str());
+        return false;
+      }
+    }
+    _modified = false;
+    return true;
+  }
+
+  const LibraryIndex::Entry*
+  LibraryIndex::find(const std::string& path) const {
+    Entries::const_iterator it = _entries.find(path);
+    if (it == _entries.end())
+      return NULL;
+    long long size, mtime;
+    if (!FileUtils::file_stamp(path, size, mtime) ||
+        size != it->second.size || mtime != it->second.mtime)
+      return NULL;
+    return &it->second;
+  }
+
+  const LibraryIndex::Entry*
+  LibraryIndex::add(const std::string& path, Model* m) {
+    Entry e;
+    if (!FileUtils::file_stamp(path, e.size, e.mtime))
+      e.size = e.mtime = -1;
+    e.pure = true;
+    for (unsigned int i=0; i<m->size(); i++) {
+      Item* item = (*m)[i];
+      if (FunctionI* fi = item->dyn_cast<FunctionI>()) {
+        e.defines.push_back(fi->id().str());
+      } else if (IncludeI* ii = item->dyn_cast<IncludeI>()) {
+        e.includes.push_back(ii->f().str());
+      } else {
+        e.pure = false;
+      }
+    }
+    collectCalls(m, e.calls);
+    _modified = true;
+    return &(_entries[path] = e);
+  }
+
+  void
+  LibraryIndex::collectCalls(Model* m, std::vector<std::string>& calls) {
+    std::vector<std::string> all;
+    CollectCalls cc(all);
+    CollectCallsI cci(m, cc);
+    iterItems(cci, m);
+    UNORDERED_NAMESPACE::unordered_set<std::string> seen(calls.begin(), calls.end());
+    for (unsigned int i=0; i<all.size(); i++) {
+      if (seen.insert(all[i]).second)
+        calls.push_back(all[i]);
+    }
+  }
+
+  LazyLibrary::LazyLibrary(LibraryIndex* index, const std::vector<std::string>& includePaths)
+    : _index(index), _includePaths(includePaths) {}
+
+  bool
+  LazyLibrary::defer(const std::string& parentPath, Model* m, const std::string& fullname) {
+    if (_index==NULL || _needed.find(m) != _needed.end())
+      return false;
+    Model* p = m->parent();
+    if (p==NULL ? m->filename()=="stdlib.mzn" : _core.find(p) != _core.end()) {
+      _core.insert(m);
+      return false;
+    }
+    const LibraryIndex::Entry* e = _index->find(fullname);
+    if (e==NULL || !e->pure)
+      return false;
+    Deferred d;
+    d.parentPath = parentPath;
+    d.m = m;
+    d.fullname = fullname;
+    _deferred.push_back(d);
+    return true;
+  }
+
+  void
+  LazyLibrary::parsed(Model* m, const std::string& fullname, bool inLibrary) {
+    if (_index==NULL)
+      return;
+    if (!inLibrary) {
+      _userModels.push_back(m);
+      return;
+    }
+    const LibraryIndex::Entry* e = _index->find(fullname);
+    if (e==NULL)
+      e = _index->add(fullname, m);
+    _used.insert(e->calls.begin(), e->calls.end());
+  }
+
+  bool
+  LazyLibrary::needed(const std::string& path, UNORDERED_NAMESPACE::unordered_map<std::string,bool>& memo) {
+    UNORDERED_NAMESPACE::unordered_map<std::string,bool>::iterator it = memo.find(path);
+    if (it != memo.end())
+      return it->second;
+    // Guard against cyclic includes (reported by the parser)
+    memo[path] = false;
+    const LibraryIndex::Entry* e = _index->find(path);
+    // Files that are not indexed, or that contain more than functions, are
+    // always parsed, and so are the files that include them
+    bool ret = (e==NULL || !e->pure);
+    for (unsigned int i=0; !ret && i<e->defines.size(); i++) {
+      const std::string& d = e->defines[i];
+      ret = _used.find(d) != _used.end() ||
+        (d.size() > 5 && d.compare(d.size()-5,5,"_reif")==0 && _used.find(d.substr(0,d.size()-5)) != _used.end());
+    }
+    for (unsigned int i=0; !ret && i<e->includes.size(); i++) {
+      // Same search order as the parser
+      std::string inc;
+      for (unsigned int j=0; j<=_includePaths.size(); j++) {
+        std::string f = (j<_includePaths.size() ? _includePaths[j] : dirname(path))+e->includes[i];
+        if (FileUtils::file_exists(f)) {
+          inc = f;
+          break;
+        }
+      }
+      ret = inc.empty() || needed(inc, memo);
+    }
+    memo[path] = ret;
+    return ret;
+  }
+
+  bool
+  LazyLibrary::resolve(std::vector<std::pair<std::string,Model*> >& files) {
+    if (_index==NULL || _deferred.empty())
+      return false;
+    if (!_userModels.empty()) {
+      std::vector<std::string> calls;
+      for (unsigned int i=0; i<_userModels.size(); i++)
+        LibraryIndex::collectCalls(_userModels[i], calls);
+      _used.insert(calls.begin(), calls.end());
+      _userModels.clear();
+    }
+    UNORDERED_NAMESPACE::unordered_map<std::string,bool> memo;
+    std::vector<Deferred> deferred;
+    bool found = false;
+    for (unsigned int i=0; i<_deferred.size(); i++) {
+      if (needed(_deferred[i].fullname, memo)) {
+        files.push_back(std::make_pair(_deferred[i].parentPath, _deferred[i].m));
+        _needed.insert(_deferred[i].m);
+        found = true;
+      } else {
+        deferred.push_back(_deferred[i]);
+      }
+    }
+    _deferred.swap(deferred);
+    return found;
+  }
+
+  LibraryCache::LibraryCache(void) : _hits(0), _take(false) {}
+
+  LibraryCache::~LibraryCache(void) {
+    for (Entries::iterator it = _entries.begin(); it != _entries.end(); ++it)
+      delete it->second.m;
+    for (unsigned int i=0; i<_taken.size(); i++)
+      delete _taken[i];
+  }
+
+  Model*
+  LibraryCache::find(const std::string& path) {
+    Entries::iterator it = _entries.find(path);
+    if (it == _entries.end())
+      return NULL;
+    long long size, mtime;
+    if (!FileUtils::file_stamp(path, size, mtime) ||
+        size != it->second.size || mtime != it->second.mtime) {
+      delete it->second.m;
+      _entries.erase(it);
+      return NULL;
+    }
+    _hits++;
+    Model* m = it->second.m;
+    if (_take) {
+      _taken.push_back(m);
+      _entries.erase(it);
+    }
+    return m;
+  }
+
+  void
+  LibraryCache::add(EnvI& env, const std::string& path, Model* m) {
+    Entry e;
+    if (!FileUtils::file_stamp(path, e.size, e.mtime))
+      return;
+    e.m = new Model;
+    e.m->setFilename(m->filename().str());
+    e.m->setFilepath(path);
+    CopyMap cm;
+    for (unsigned int i=0; i<m->size(); i++) {
+      Item* item = (*m)[i];
+      if (IncludeI* ii = item->dyn_cast<IncludeI>()) {
+        // The included files are cached separately
+        e.m->addItem(new IncludeI(ii->loc(), ii->f()));
+      } else {
+        e.m->addItem(copy(env, cm, item));
+      }
+    }
+    Entries::iterator it = _entries.find(path);
+    if (it != _entries.end()) {
+      delete it->second.m;
+      it->second = e;
+    } else {
+      _entries.insert(std::make_pair(path, e));
+    }
+  }
+
+}
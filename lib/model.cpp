@@ -381,5 +381,20 @@ namespace MiniZinc {
     _items.erase(remove_if(_items.begin(),_items.end(),isremoved),
                  _items.end());
   }
+
+  void
+  Model::compact(UNORDERED_NAMESPACE::unordered_set<Item*>& removed,
+                 bool onlyConstraints) {
+    unsigned int j=0;
+    for (unsigned int i=0; i<_items.size(); i++) {
+      Item* item = _items[i];
+      if (item->removed() && (!onlyConstraints || item->isa<ConstraintI>())) {
+        removed.insert(item);
+      } else {
+        _items[j++] = item;
+      }
+    }
+    _items.resize(j);
+  }
   
 }
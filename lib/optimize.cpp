@@ -92,6 +92,19 @@ namespace MiniZinc {
     idx.clear();
   }
   
+  void VarOccurrences::remove(const Items& removed) {
+    if (removed.empty())
+      return;
+    for (IdMap<Items>::iterator it = _m.begin(); it != _m.end(); ++it) {
+      for (Items::iterator iit = it->second.begin(); iit != it->second.end();) {
+        if (removed.find(*iit) != removed.end())
+          iit = it->second.erase(iit);
+        else
+          ++iit;
+      }
+    }
+  }
+
   int VarOccurrences::occurrences(VarDecl* v) {
     IdMap<Items>::iterator vi = _m.find(v->id()->decl()->id());
     return (vi==_m.end() ? 0 : vi->second.size());
@@ -110,7 +123,7 @@ namespace MiniZinc {
   void CollectOccurrencesI::vSolveI(SolveI* si) {
     CollectOccurrencesE ce(vo,si);
     topDown(ce,si->e());
-    for (ExpressionSetIter it = si->ann().begin(); it != si->ann().end(); ++si)
+    for (ExpressionSetIter it = si->ann().begin(); it != si->ann().end(); ++it)
       topDown(ce,*it);
   }
 
@@ -246,6 +259,10 @@ namespace MiniZinc {
   void pushDependentConstraints(EnvI& env, Id* id, std::vector<Item*>& q) {
     IdMap<VarOccurrences::Items>::iterator it = env.vo._m.find(id->decl()->id());
     if (it != env.vo._m.end()) {
+      // Declarations of unified variables stay in the occurrences, and
+      // usually all refer to the same variable, so remember the last one
+      VarDecl* unified = NULL;
+      VarDeclI* unifiedItem = NULL;
       for (VarOccurrences::Items::iterator item = it->second.begin(); item != it->second.end(); ++item) {
         if (ConstraintI* ci = (*item)->dyn_cast<ConstraintI>()) {
           if (!ci->removed() && !ci->flag()) {
@@ -253,8 +270,13 @@ namespace MiniZinc {
             q.push_back(ci);
           }
         } else if (VarDeclI* vdi = (*item)->dyn_cast<VarDeclI>()) {
-          if (vdi->e()->id()->decl() != vdi->e()) {
-            vdi = (*env.flat())[env.vo.find(vdi->e()->id()->decl())]->cast<VarDeclI>();
+          VarDecl* vd = vdi->e()->id()->decl();
+          if (vd != vdi->e()) {
+            if (vd != unified) {
+              unified = vd;
+              unifiedItem = (*env.flat())[env.vo.find(vd)]->cast<VarDeclI>();
+            }
+            vdi = unifiedItem;
           }
           if (!vdi->removed() && !vdi->flag() && vdi->e()->e()) {
             vdi->flag(true);
@@ -466,7 +488,7 @@ namespace MiniZinc {
             if (bi->isa<ConstraintI>()) {
               CollectDecls cd(envi.vo,deletedVarDecls,bi);
               topDown(cd,bi->cast<ConstraintI>()->e());
-              bi->remove();
+              envi.flat_removeItem(bi);
             } else {
               CollectDecls cd(envi.vo,deletedVarDecls,bi);
               topDown(cd,bi->cast<VarDeclI>()->e()->e());
@@ -485,7 +507,7 @@ namespace MiniZinc {
             finalId->decl()->e(constants().boollit(!finalIdNeg));
           CollectDecls cd(envi.vo,deletedVarDecls,bi);
           topDown(cd,bi->cast<ConstraintI>()->e());
-          bi->remove();
+          envi.flat_removeItem(bi);
           pushVarDecl(envi, envi.vo.idx.find(finalId->decl()->id())->second, vardeclQueue);
           pushDependentConstraints(envi, finalId, constraintQueue);
         }
@@ -699,7 +721,7 @@ namespace MiniZinc {
             if (bi->isa<ConstraintI>()) {
               CollectDecls cd(envi.vo,deletedVarDecls,bi);
               topDown(cd,bi->cast<ConstraintI>()->e());
-              bi->remove();
+              envi.flat_removeItem(bi);
             } else {
               CollectDecls cd(envi.vo,deletedVarDecls,bi);
               topDown(cd,bi->cast<VarDeclI>()->e()->e());
@@ -763,6 +785,7 @@ namespace MiniZinc {
           }
         }
       }
+      envi.flat_compact();
     } catch (ModelInconsistent&) {
       
     }
@@ -351,6 +351,7 @@ namespace MiniZinc {
     class Register {
     public:
       Register(void) {
+        GCPermanent permanent;
         GCLock lock;
         Model* m = new Model;
         ASTString id_element("array_int_element");
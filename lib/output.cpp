@@ -157,6 +157,8 @@ namespace MiniZinc {
       }
     } _par;
     topDown(_par, e);
+    // Calls are resolved using the par types of their arguments, so this
+    // needs a separate pass after the whole expression has been made par
     class Decls : public EVisitor {
     protected:
       static std::string createEnumToStringName(Id* ident, std::string prefix) {
@@ -16,11 +16,164 @@
 #endif
 
 #include <minizinc/solns2out.hh>
+#include <minizinc/prettyprinter.hh>
 #include <fstream>
+#include <algorithm>
+#include <queue>
+#include <cstring>
 
 using namespace std;
 using namespace MiniZinc;
 
+namespace {
+
+  /// Incremental computation of a 128-bit fingerprint
+  class FingerprintBuilder {
+  protected:
+    unsigned long long h1;
+    unsigned long long h2;
+    static unsigned long long mix(unsigned long long z) {
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      return z ^ (z >> 31);
+    }
+  public:
+    FingerprintBuilder(void) : h1(0x243f6a8885a308d3ULL), h2(0x13198a2e03707344ULL) {}
+    void add(unsigned long long x) {
+      h1 = mix(h1 ^ (x + 0x9e3779b97f4a7c15ULL));
+      h2 = mix(((h2 << 23) | (h2 >> 41)) ^ (x * 0xff51afd7ed558ccdULL + 0xc4ceb9fe1a85ec53ULL));
+    }
+    void add(const std::string& s) {
+      add(s.size());
+      for (size_t i=0; i<s.size(); i+=8) {
+        unsigned long long x = 0;
+        memcpy(&x, s.data()+i, std::min<size_t>(8, s.size()-i));
+        add(x);
+      }
+    }
+    void add(const IntVal& v) {
+      if (v.isFinite()) {
+        add(0);
+        add(static_cast<unsigned long long>(v.toInt()));
+      } else {
+        add(v.isPlusInfinity() ? 1 : 2);
+      }
+    }
+    void add(const FloatVal& v) {
+      if (v.isFinite()) {
+        double d = v.toDouble();
+        unsigned long long x;
+        memcpy(&x, &d, sizeof(x));
+        add(0);
+        add(x);
+      } else {
+        add(v.isPlusInfinity() ? 1 : 2);
+      }
+    }
+    unsigned long long first(void) const { return h1; }
+    unsigned long long second(void) const { return h2; }
+  };
+
+  /// Add the value \a e to the fingerprint \a fb
+  void fingerprintValue(FingerprintBuilder& fb, Expression* e) {
+    if (e==NULL) {
+      fb.add(0);
+      return;
+    }
+    fb.add(e->eid()+1);
+    switch (e->eid()) {
+      case Expression::E_INTLIT:
+        fb.add(e->cast<IntLit>()->v());
+        break;
+      case Expression::E_FLOATLIT:
+        fb.add(e->cast<FloatLit>()->v());
+        break;
+      case Expression::E_BOOLLIT:
+        fb.add(e->cast<BoolLit>()->v());
+        break;
+      case Expression::E_STRINGLIT:
+        fb.add(e->cast<StringLit>()->v().str());
+        break;
+      case Expression::E_SETLIT:
+        {
+          SetLit* sl = e->cast<SetLit>();
+          if (IntSetVal* isv = sl->isv()) {
+            fb.add(1);
+            fb.add(isv->size());
+            for (int i=0; i<isv->size(); i++) {
+              fb.add(isv->min(i));
+              fb.add(isv->max(i));
+            }
+          } else if (FloatSetVal* fsv = sl->fsv()) {
+            fb.add(2);
+            fb.add(fsv->size());
+            for (int i=0; i<fsv->size(); i++) {
+              fb.add(fsv->min(i));
+              fb.add(fsv->max(i));
+            }
+          } else {
+            fb.add(3);
+            fb.add(sl->v().size());
+            for (unsigned int i=0; i<sl->v().size(); i++)
+              fingerprintValue(fb, sl->v()[i]);
+          }
+        }
+        break;
+      case Expression::E_ARRAYLIT:
+        {
+          ArrayLit* al = e->cast<ArrayLit>();
+          fb.add(al->dims());
+          for (int i=0; i<al->dims(); i++) {
+            fb.add(al->min(i));
+            fb.add(al->max(i));
+          }
+          fb.add(al->v().size());
+          for (unsigned int i=0; i<al->v().size(); i++)
+            fingerprintValue(fb, al->v()[i]);
+        }
+        break;
+      case Expression::E_CALL:
+        {
+          // arrayXd calls in solutions parsed from text
+          Call* c = e->cast<Call>();
+          fb.add(c->id().str());
+          fb.add(c->args().size());
+          for (unsigned int i=0; i<c->args().size(); i++)
+            fingerprintValue(fb, c->args()[i]);
+        }
+        break;
+      case Expression::E_ID:
+        fb.add(e->cast<Id>()->str().str());
+        break;
+      default:
+        {
+          std::ostringstream oss;
+          oss << *e;
+          fb.add(oss.str());
+        }
+    }
+  }
+
+  /// Write solution \a s to the temporary file \a f
+  void writeCanon(FILE* f, const std::string& s) {
+    unsigned long long n = s.size();
+    MZN_ASSERT_HARD_MSG( fwrite(&n, sizeof(n), 1, f) == 1 && fwrite(s.data(), 1, s.size(), f) == s.size(),
+                         "solns2out_base: could not write canonical solutions to temporary file" );
+  }
+
+  /// Read the next solution from the temporary file \a f into \a s, returns false at the end
+  bool readCanon(FILE* f, std::string& s) {
+    unsigned long long n;
+    if (fread(&n, sizeof(n), 1, f) != 1)
+      return false;
+    s.resize(n);
+    MZN_ASSERT_HARD_MSG( n == 0 || fread(&s[0], 1, n, f) == n,
+                         "solns2out_base: could not read canonical solutions from temporary file" );
+    return true;
+  }
+
+}
+
 
 void Solns2Out::printHelp(ostream& os)
 {
@@ -35,8 +188,9 @@ void Solns2Out::printHelp(ostream& os)
   "    Specify solution status messages. The defaults:\n"
   "    \"=====UNSATISFIABLE=====\", \"=====UNSATorUNBOUNDED=====\", \"=====UNBOUNDED=====\",\n"
   "    \"=====UNKNOWN=====\", \"=====ERROR=====\", \"==========\", respectively." << std::endl
-  << "  --unique\n    Avoid duplicate solutions.\n"
+  << "  --unique\n    Avoid duplicate solutions (same values of the output variables).\n"
   << "  -c, --canonicalize\n    Canonicalize the output solution stream (i.e., buffer and sort).\n"
+  << "  --canonicalize-memory <n>\n    Megabytes of solutions kept in memory for canonicalization (default 256),\n    further solutions are sorted and spilled to temporary files.\n"
   << "  --output-non-canonical <file>\n    Non-buffered solution output file in case of canonicalization.\n"
   << "  --output-raw <file>\n    File to dump the solver's raw output (not for hard-linked solvers)\n"
   // Unclear how to exit then:
@@ -71,6 +225,7 @@ bool Solns2Out::processOption(int& i, const int argc, const char** argv)
     _opt.flag_unique = true;
   } else if ( cop.getOption( "-c --canonicalize") ) {
     _opt.flag_canonicalize = true;
+  } else if ( cop.getOption( "--canonicalize-memory", &_opt.flag_canonicalize_memory) ) {
   } else if ( cop.getOption( "--output-non-canonical", &_opt.flag_output_noncanonical) ) {
   } else if ( cop.getOption( "--output-raw", &_opt.flag_output_raw) ) {
 //   } else if ( cop.getOption( "--number-output", &_opt.flag_number_output ) ) {
@@ -104,7 +259,8 @@ bool Solns2Out::initFromEnv(Env* pE) {
 void Solns2Out::createOutputMap() {
   for (unsigned int i=0; i<getModel()->size(); i++) {
     if (VarDeclI* vdi = (*getModel())[i]->dyn_cast<VarDeclI>()) {
-      declmap.insert(pair<ASTString,DE>(vdi->e()->id()->str(),DE(vdi->e(),vdi->e()->e())));
+      auto res = declmap.insert(pair<ASTString,DE>(vdi->e()->id()->str(),DE(vdi->e(),vdi->e()->e())));
+      outputDecls.push_back(&res.first->second);
     } else if (OutputI* oi = (*getModel())[i]->dyn_cast<OutputI>()) {
       MZN_ASSERT_HARD_MSG( outputExpr == oi->e(),
         "solns2out_base: <=1 output items allowed currently  TODO?" );
@@ -164,19 +320,55 @@ void Solns2Out::declNewOutput() {
   status = SolverInstance::SAT;
 }
 
+Solns2Out::Fingerprint Solns2Out::fingerprintOutput() {
+  if ( declmap.empty() )
+    createOutputMap();
+  FingerprintBuilder fb;
+  for (unsigned int i=0; i<outputDecls.size(); i++) {
+    Expression* e = outputDecls[i]->first->e();
+    if ( e != outputDecls[i]->second() ) {    // only variables assigned by the solution
+      fb.add(i);
+      fingerprintValue(fb, e);
+    }
+  }
+  Fingerprint fp;
+  fp.h1 = fb.first();
+  fp.h2 = fb.second();
+  return fp;
+}
+
+void Solns2Out::spillCanon() {
+  sort( vSolsCanon.begin(), vSolsCanon.end() );
+  FILE* f = tmpfile();
+  MZN_ASSERT_HARD_MSG( f, "solns2out_base: could not create temporary file for canonical solutions" );
+  vRunsCanon.push_back( f );
+  for ( unsigned int i=0; i<vSolsCanon.size(); i++ )
+    if ( 0==i || vSolsCanon[i] != vSolsCanon[i-1] )
+      writeCanon( f, vSolsCanon[i] );
+  rewind( f );
+  vector<string>().swap( vSolsCanon );
+  nBytesCanon = 0;
+}
+
 bool Solns2Out::evalOutput() {
   if ( !fNewSol2Print )
     return true;
-  ostringstream oss;
-  if (!__evalOutput( oss, false ))
-    return false;
   if ( _opt.flag_unique || _opt.flag_canonicalize ) {
-    auto res = sSolsCanon.insert( oss.str() );
-    if ( !res.second )            // repeated solution
+    GCLock lock;
+    if ( !sSolsSeen.insert( fingerprintOutput() ).second ) {    // repeated solution
+      ++nDuplicates;
       return true;
+    }
   }
+  ostringstream oss;
+  if (!__evalOutput( oss, false ))
+    return false;
   ++nSolns;
   if ( _opt.flag_canonicalize ) {
+    vSolsCanon.push_back( oss.str() );
+    nBytesCanon += vSolsCanon.back().size() + sizeof(string);
+    if ( nBytesCanon > static_cast<size_t>(_opt.flag_canonicalize_memory) << 20 )
+      spillCanon();
     if ( pOfs_non_canon.get() )
       if ( pOfs_non_canon->good() ) {
         (*pOfs_non_canon) << oss.str();
@@ -239,12 +431,54 @@ bool Solns2Out::evalStatus( SolverInstance::Status status ) {
 }
 
 bool Solns2Out::__evalOutputFinal( bool ) {
-  /// Print the canonical list
-  for ( auto& sol : sSolsCanon ) {
-    if ( _opt.solution_comma.size() && &sol != &*sSolsCanon.begin() )
+  /// Print the canonical list, merging the runs spilled to temporary files.
+  /// Solutions with different values can still print the same, print those once.
+  typedef pair<string,unsigned int> Head;
+  priority_queue<Head, vector<Head>, greater<Head> > heads;
+  if ( vRunsCanon.empty() ) {
+    sort( vSolsCanon.begin(), vSolsCanon.end() );
+  } else {
+    if ( vSolsCanon.size() )
+      spillCanon();
+    for ( unsigned int i=0; i<vRunsCanon.size(); i++ ) {
+      Head h( string(), i );
+      if ( readCanon( vRunsCanon[i], h.first ) )
+        heads.push( h );
+    }
+  }
+  string last;
+  bool first = true;
+  for ( unsigned int i=0; ; i++ ) {
+    string sol;
+    if ( vRunsCanon.empty() ) {
+      if ( i >= vSolsCanon.size() )
+        break;
+      sol.swap( vSolsCanon[i] );
+    } else {
+      if ( heads.empty() )
+        break;
+      Head h = heads.top();
+      heads.pop();
+      sol.swap( h.first );
+      if ( readCanon( vRunsCanon[h.second], h.first ) )
+        heads.push( h );
+    }
+    if ( !first && sol == last ) {
+      ++nDuplicates;
+      --nSolns;
+      continue;
+    }
+    if ( _opt.solution_comma.size() && !first )
       getOutput() << _opt.solution_comma << '\n';
     getOutput() << sol;
+    last.swap( sol );
+    first = false;
   }
+  vector<string>().swap( vSolsCanon );
+  nBytesCanon = 0;
+  for ( unsigned int i=0; i<vRunsCanon.size(); i++ )
+    fclose( vRunsCanon[i] );
+  vRunsCanon.clear();
   return true;
 }
 
@@ -314,6 +548,8 @@ void Solns2Out::init() {
 }
 
 Solns2Out::~Solns2Out() {
+  for ( unsigned int i=0; i<vRunsCanon.size(); i++ )
+    fclose( vRunsCanon[i] );
   getOutput() << comments;
   if ( _opt.flag_output_flush )
     getOutput() << flush;
@@ -382,6 +618,10 @@ void Solns2Out::createInputMap() {
   mapInputStatus[ _opt.error_msg ] = SolverInstance::ERROR;
 }
 
-void Solns2Out::printStatistics(ostream&)
+void Solns2Out::printStatistics(ostream& os)
 {
+  os << "  % Solutions: " << nSolns;
+  if ( _opt.flag_unique || _opt.flag_canonicalize )
+    os << ", duplicates suppressed: " << nDuplicates;
+  os << endl;
 }
@@ -24,14 +24,32 @@
 #define _CRT_SECURE_NO_WARNINGS
 #endif
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <sstream>
 #include <cstdlib>
+#include <cstring>
+#include <new>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/select.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+#endif
 
 using namespace std;
 
 #include <minizinc/solver.hh>
+#include <minizinc/timer.hh>
 
 using namespace MiniZinc;
 
@@ -105,12 +123,31 @@ void MznSolver::addFlattener()
   assert(flt);
 }
 
+SolverFactory* MznSolver::findSolverFactory(const std::string& id)
+{
+  for (auto it = getGlobalSolverRegistry()->getSolverFactories().begin();
+       it != getGlobalSolverRegistry()->getSolverFactories().end(); ++it)
+    if ((*it)->getId() == id)
+      return *it;
+  return NULL;
+}
+
 void MznSolver::addSolverInterface()
 {
   if ( getGlobalSolverRegistry()->getSolverFactories().empty() ) {
     cerr << " MznSolver: NO SOLVER FACTORIES LINKED." << endl;
     assert( 0 );
   }
+  if ( !portfolio.empty() ) {             // the solver instances are created by solvePortfolio()
+    s2out.initFromEnv( flt->getEnv() );
+    if (get_flag_verbose()) {
+      cerr << "      % SOLVING PHASE\n" << "  Portfolio:";
+      for (unsigned int i=0; i<portfolio.size(); i++)
+        cerr << ' ' << portfolio[i];
+      cerr << endl;
+    }
+    return;
+  }
   si = getGlobalSolverRegistry()->getSolverFactories().back()->createSI(*flt->getEnv());
   assert(si);
   s2out.initFromEnv( flt->getEnv() );
@@ -140,6 +177,18 @@ void MznSolver::printHelp(std::ostream& os)
     << "  --version\n    Print version information." << std::endl
     << "  -v, -l, --verbose\n    Print progress/log statements. Note that some solvers may log to stdout." << std::endl
     << "  -s, --statistics\n    Print statistics." << std::endl;
+  if ( !ifMzn2Fzn() )
+  os
+    << "  --portfolio <solvers>\n    Race a comma-separated list of solvers (or \"all\" linked solvers) on the flat model,\n"
+       "    each in its own process. The improving solutions of all solvers are printed, and the race\n"
+       "    ends when a solver proves optimality or unsatisfiability, or finds a solution of a\n"
+       "    satisfaction problem. A solver can be listed several times. Linked solvers:";
+  if ( !ifMzn2Fzn() ) {
+    for (auto it = getGlobalSolverRegistry()->getSolverFactories().begin();
+         it != getGlobalSolverRegistry()->getSolverFactories().end(); ++it)
+      os << ' ' << (*it)->getId();
+    os << std::endl;
+  }
 //   if ( getNSolvers() )
   
   getFlt()->printHelp(os);
@@ -160,9 +209,11 @@ bool MznSolver::processOptions(int argc, const char** argv, std::ostream& os)
   executable_name = argv[0];
   executable_name = executable_name.substr(executable_name.find_last_of("/\\") + 1);
   int i=1;
+  string buffer;
   if (argc < 2)
     return false;
   for (i=1; i<argc; ++i) {
+    CLOParser cop( i, argc, argv );
     if (string(argv[i])=="-h" || string(argv[i])=="--help") {
       printHelp(os);
       std::exit(EXIT_SUCCESS);
@@ -179,6 +230,21 @@ bool MznSolver::processOptions(int argc, const char** argv, std::ostream& os)
       flag_verbose = true;
     } else if (string(argv[i])=="-s" || string(argv[i])=="--statistics") {
       flag_statistics = true;                  // is this Flattener's option?
+    } else if ( !ifMzn2Fzn() && cop.getOption( "--portfolio", &buffer ) ) {
+      istringstream iss( buffer );
+      string id;
+      while ( getline( iss, id, ',' ) ) {
+        if ( id=="all" ) {
+          for (auto it = getGlobalSolverRegistry()->getSolverFactories().begin();
+               it != getGlobalSolverRegistry()->getSolverFactories().end(); ++it)
+            portfolio.push_back( (*it)->getId() );
+        } else if ( findSolverFactory( id ) ) {
+          portfolio.push_back( id );
+        } else if ( !id.empty() ) {
+          os << executable_name << ": unknown solver `" << id << "' in --portfolio" << endl;
+          return false;
+        }
+      }
     } else if ( !ifMzn2Fzn() ? s2out.processOption( i, argc, argv ) : false ) {
     } else if (!getFlt()->processOption(i, argc, argv)) {
       for (auto it = getGlobalSolverRegistry()->getSolverFactories().rbegin();
@@ -210,13 +276,19 @@ void MznSolver::flatten()
 
 void MznSolver::solve()
 {
+  if ( !portfolio.empty() ) {
+    solvePortfolio();
+    return;
+  }
   GCLock lock;
   getSI()->getOptions().setBoolParam  (constants().opts.verbose.str(),  get_flag_verbose());
   getSI()->getOptions().setBoolParam  (constants().opts.statistics.str(),  get_flag_statistics());
   getSI()->processFlatZinc();
-  SolverInstance::Status status = getSI()->solve();
+  bool lex = getSI()->hasLexObjectives();
+  SolverInstance::Status status = lex ? getSI()->solveLexicographic() : getSI()->solve();
   if (status==SolverInstance::SAT || status==SolverInstance::OPT) {
-    getSI()->printSolution();             // What if it's already printed?  TODO
+    if (!lex)   // solveLexicographic prints the solution of each objective
+      getSI()->printSolution();             // What if it's already printed?  TODO
     if ( !getSI()->getSolns2Out()->fStatusPrinted )
       getSI()->getSolns2Out()->evalStatus( status );
   }
@@ -232,6 +304,394 @@ void MznSolver::printStatistics()
 { // from flattener too?   TODO
   if (si)
     getSI()->printStatisticsLine(cout, 1);
+  s2out.printStatistics(cout);
 }
 
 
+
+namespace {
+
+  /// Line preceding the separator of a solution raced in a portfolio,
+  /// followed by the objective value of the solution
+  const char* const portfolioObjective = "%%%mzn-portfolio-objective ";
+
+#ifndef _WIN32
+  /// Prints the solutions of a solver racing in a portfolio as FlatZinc
+  /// assignments, to be parsed again by the parent process
+  class PortfolioSolns2Out : public Solns2Out {
+  protected:
+    SolverInstanceBase* _si;
+    /// Print value \a e, arrays in FlatZinc arrayNd form
+    static void printValue(std::ostream& os, Expression* e) {
+      ArrayLit* al = e->dyn_cast<ArrayLit>();
+      if (al==NULL) {
+        os << *e;
+        return;
+      }
+      os << "array" << al->dims() << "d(";
+      for (int i=0; i<al->dims(); i++)
+        os << al->min(i) << ".." << al->max(i) << ", ";
+      os << "[";
+      for (unsigned int i=0; i<al->v().size(); i++)
+        os << (i==0 ? "" : ", ") << *al->v()[i];
+      os << "])";
+    }
+    virtual bool __evalOutput(std::ostream& os, bool) {
+      if ( declmap.empty() )
+        createOutputMap();
+      for (unsigned int i=0; i<outputDecls.size(); i++) {
+        Expression* e = outputDecls[i]->first->e();
+        if ( e != outputDecls[i]->second() ) {    // only variables assigned by the solution
+          os << outputDecls[i]->first->id()->str() << " = ";
+          printValue(os, e);
+          os << ";\n";
+        }
+      }
+      double v;
+      if (_si->getObjectiveValue(v)) {
+        std::streamsize prec = os.precision(17);
+        os << portfolioObjective << v << '\n';
+        os.precision(prec);
+        _si->publishObjective();
+      }
+      os << _opt.solution_separator_00 << '\n';
+      return true;
+    }
+  public:
+    PortfolioSolns2Out(SolverInstanceBase* si) : _si(si) {
+      _opt.flag_output_flush = true;
+    }
+  };
+
+  /// Solve the flat model in \a env with a solver of factory \a sf (in a
+  /// child process), printing solutions and status to the standard output
+  int solvePortfolioChild(SolverFactory* sf, Env& env, SharedObjectiveBound* bound,
+                          bool fVerbose, bool fStatistics) {
+    int ret = 0;
+    try {
+      GCLock lock;
+      SolverInstanceBase* si = sf->createSI(env);
+      PortfolioSolns2Out out(si);
+      out.initFromEnv(&env);
+      si->setSolns2Out(&out);
+      si->setSharedBound(bound);
+      si->getOptions().setBoolParam(constants().opts.verbose.str(), fVerbose);
+      si->getOptions().setBoolParam(constants().opts.statistics.str(), fStatistics);
+      si->processFlatZinc();
+      SolverInstance::Status status = si->solve();
+      if (status==SolverInstance::SAT || status==SolverInstance::OPT)
+        si->printSolution();
+      if ( !out.fStatusPrinted )
+        out.evalStatus( status );
+    } catch (const LocationException& e) {
+      cerr << e.loc() << ":" << endl << e.what() << ": " << e.msg() << endl;
+      ret = 1;
+    } catch (const Exception& e) {
+      cerr << e.what() << ": " << e.msg() << endl;
+      ret = 1;
+    } catch (const exception& e) {
+      cerr << e.what() << endl;
+      ret = 1;
+    }
+    if (ret != 0)
+      cout << "=====ERROR=====" << endl;
+    cout.flush();
+    cerr.flush();
+    return ret;
+  }
+
+  /// Milliseconds the losers of a portfolio race get to exit after SIGTERM,
+  /// before they are killed
+  const double portfolioGracePeriod = 1000.0;
+
+  /// State of a solver racing in a portfolio, as seen by the parent process
+  struct PortfolioChild {
+    std::string id;
+    pid_t pid;
+    /// Read end of the pipe connected to the standard output of the child (-1 at EOF)
+    int fd;
+    /// Incomplete last line read from the pipe
+    std::string line;
+    /// Lines of the current solution
+    std::string block;
+    /// Objective value of the current solution
+    bool hasObj;
+    double obj;
+    /// Final status reported by the child
+    bool hasStatus;
+    SolverInstance::Status status;
+    /// Number of solutions received, and of those forwarded as improving
+    int nSolns;
+    int nImproving;
+  };
+#endif
+
+}
+
+void MznSolver::solvePortfolio()
+{
+#ifdef _WIN32
+  throw InternalError("MznSolver: --portfolio is not supported on Windows");
+#else
+  GCLock lock;
+  Env& env = *getFlt()->getEnv();
+  SolveI* solveItem = env.flat()->solveItem();
+  bool fOpt = (solveItem->st() != SolveI::SolveType::ST_SAT);
+
+  // The bound lives in memory shared with the children
+  void* mem = mmap(NULL, sizeof(SharedObjectiveBound), PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED)
+    throw InternalError("MznSolver: could not allocate shared memory for the portfolio");
+  SharedObjectiveBound* bound = new (mem) SharedObjectiveBound(solveItem->st() != SolveI::SolveType::ST_MAX);
+
+  std::map<std::string, SolverInstance::Status> statusLines;
+  statusLines[ s2out._opt.search_complete_msg_00 ] = SolverInstance::OPT;
+  statusLines[ s2out._opt.unsatisfiable_msg_00 ] = SolverInstance::UNSAT;
+  statusLines[ s2out._opt.unbounded_msg_00 ] = SolverInstance::UNBND;
+  statusLines[ s2out._opt.unsatorunbnd_msg_00 ] = SolverInstance::UNSATorUNBND;
+  statusLines[ s2out._opt.unknown_msg_00 ] = SolverInstance::UNKNOWN;
+  statusLines[ s2out._opt.error_msg_00 ] = SolverInstance::ERROR;
+  const std::string separator = s2out._opt.solution_separator_00;
+  const size_t objLen = strlen(portfolioObjective);
+
+  // Nothing buffered may be written twice by the children
+  cout.flush();
+  cerr.flush();
+#ifdef __linux__
+  // Solvers started by a child are reparented to this process when the child
+  // exits, so that they can be waited for
+  prctl(PR_SET_CHILD_SUBREAPER, 1);
+#endif
+  std::vector<PortfolioChild> children(portfolio.size());
+  for (unsigned int k=0; k<portfolio.size(); k++) {
+    PortfolioChild& c = children[k];
+    c.id = portfolio[k];
+    c.pid = -1;
+    c.fd = -1;
+    c.hasObj = false;
+    c.obj = 0.0;
+    c.hasStatus = false;
+    c.status = SolverInstance::UNKNOWN;
+    c.nSolns = 0;
+    c.nImproving = 0;
+    int pipes[2];
+    if (pipe(pipes) != 0)
+      throw InternalError("MznSolver: could not create pipe for the portfolio");
+    pid_t pid = fork();
+    if (pid == -1)
+      throw InternalError("MznSolver: could not start portfolio process");
+    if (pid == 0) {
+      // Own process group, so that solvers started by the child are killed with it
+      setpgid(0, 0);
+      for (unsigned int j=0; j<k; j++)
+        close(children[j].fd);
+      close(pipes[0]);
+      dup2(pipes[1], STDOUT_FILENO);
+      close(pipes[1]);
+      _exit(solvePortfolioChild(findSolverFactory(c.id), env, bound,
+                                get_flag_verbose(), get_flag_statistics()));
+    }
+    setpgid(pid, pid);
+    close(pipes[1]);
+    c.pid = pid;
+    c.fd = pipes[0];
+  }
+
+  // Merge the solution streams until a solver wins the race
+  int winner = -1;
+  SolverInstance::Status winStatus = SolverInstance::UNKNOWN;
+  bool hasBest = false;
+  double best = 0.0;
+  int nImproving = 0;
+  unsigned int nOpen = static_cast<unsigned int>(children.size());
+  while (winner < 0 && nOpen > 0) {
+    fd_set fds;
+    FD_ZERO(&fds);
+    int fdMax = -1;
+    for (unsigned int k=0; k<children.size(); k++) {
+      if (children[k].fd >= 0) {
+        FD_SET(children[k].fd, &fds);
+        fdMax = std::max(fdMax, children[k].fd);
+      }
+    }
+    if (select(fdMax+1, &fds, NULL, NULL, NULL) < 0) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    for (unsigned int k=0; k<children.size() && winner < 0; k++) {
+      PortfolioChild& c = children[k];
+      if (c.fd < 0 || !FD_ISSET(c.fd, &fds))
+        continue;
+      char buffer[4096];
+      ssize_t count = read(c.fd, buffer, sizeof(buffer));
+      if (count < 0 && errno == EINTR)
+        continue;
+      if (count <= 0) {
+        close(c.fd);
+        c.fd = -1;
+        nOpen--;
+        continue;
+      }
+      c.line.append(buffer, count);
+      size_t start = 0;
+      size_t end;
+      while (winner < 0 && (end = c.line.find('\n', start)) != std::string::npos) {
+        std::string line = c.line.substr(start, end-start);
+        start = end+1;
+        if (!line.empty() && line.back() == '\r')
+          line.pop_back();
+        if (line.compare(0, objLen, portfolioObjective) == 0) {
+          c.hasObj = true;
+          c.obj = atof(line.c_str()+objLen);
+        } else if (line == separator) {
+          c.nSolns++;
+          // Solutions without objective value cannot be compared, forward them all
+          if (!fOpt || !c.hasObj || !hasBest || bound->better(c.obj, best)) {
+            if (c.hasObj) {
+              hasBest = true;
+              best = c.obj;
+            }
+            c.block += separator;
+            c.block += '\n';
+            s2out.feedRawDataChunk(c.block.c_str());
+            c.nImproving++;
+            nImproving++;
+          }
+          c.block.clear();
+          c.hasObj = false;
+          if (!fOpt) {
+            winner = k;
+            winStatus = SolverInstance::SAT;
+          }
+        } else {
+          auto it = statusLines.find(line);
+          if (it == statusLines.end()) {
+            c.block += line;
+            c.block += '\n';
+          } else {
+            c.hasStatus = true;
+            c.status = it->second;
+            if (c.status != SolverInstance::UNKNOWN && c.status != SolverInstance::ERROR) {
+              winner = k;
+              winStatus = c.status;
+              // Comments printed by the winner after its last solution
+              if ( s2out._opt.flag_output_comments ) {
+                istringstream iss( c.block );
+                string l;
+                while ( getline( iss, l ) ) {
+                  size_t comment_pos = l.find('%');
+                  if ( comment_pos != string::npos )
+                    s2out.comments += l.substr(comment_pos) + "\n";
+                }
+              }
+            }
+          }
+        }
+      }
+      c.line.erase(0, start);
+    }
+  }
+
+  // Ask the other solvers to stop, and let the winner exit by itself
+  Timer grace;
+  for (unsigned int k=0; k<children.size(); k++) {
+    PortfolioChild& c = children[k];
+    if (static_cast<int>(k) != winner) {
+      kill(-c.pid, SIGTERM);
+      if (c.fd >= 0) {
+        close(c.fd);
+        c.fd = -1;
+      }
+    }
+  }
+  if (winner >= 0) {
+    PortfolioChild& c = children[winner];
+    // Nothing the winner prints after its final status is needed
+    char buffer[4096];
+    while (c.fd >= 0) {
+      ssize_t count = read(c.fd, buffer, sizeof(buffer));
+      if (count < 0 && errno == EINTR)
+        continue;
+      if (count <= 0) {
+        close(c.fd);
+        c.fd = -1;
+      }
+    }
+    int wstatus;
+    while (waitpid(c.pid, &wstatus, 0) < 0 && errno == EINTR) { }
+    c.pid = -1;
+  }
+  // Kill the solvers that are still running after the grace period. A
+  // solver started by a child can outlive it, so the whole process group
+  // of the child is waited for.
+  for (;;) {
+    bool running = false;
+    for (unsigned int k=0; k<children.size(); k++) {
+      PortfolioChild& c = children[k];
+      if (c.pid < 0)
+        continue;
+      int wstatus;
+      pid_t res;
+      while ((res = waitpid(-c.pid, &wstatus, WNOHANG)) > 0) { }
+#ifdef __linux__
+      bool alive = res == 0 || (res < 0 && errno == EINTR);
+#else
+      bool alive = res == 0 || kill(-c.pid, 0) == 0;
+#endif
+      if (alive)
+        running = true;
+      else
+        c.pid = -1;
+    }
+    if (!running)
+      break;
+    if (grace.ms() >= portfolioGracePeriod) {
+      for (unsigned int k=0; k<children.size(); k++) {
+        PortfolioChild& c = children[k];
+        if (c.pid < 0)
+          continue;
+        kill(-c.pid, SIGKILL);
+        int wstatus;
+        while (waitpid(-c.pid, &wstatus, 0) > 0 || errno == EINTR) { }
+        c.pid = -1;
+      }
+      break;
+    }
+    usleep(10000);
+  }
+#ifdef __linux__
+  prctl(PR_SET_CHILD_SUBREAPER, 0);
+#endif
+  munmap(mem, sizeof(SharedObjectiveBound));
+
+  SolverInstance::Status status = winStatus;
+  if (winner < 0) {
+    if (nImproving > 0) {
+      status = SolverInstance::SAT;
+    } else {
+      // Only report an error if no solver finished regularly
+      status = SolverInstance::ERROR;
+      for (unsigned int k=0; k<children.size(); k++)
+        if (children[k].hasStatus && children[k].status != SolverInstance::ERROR)
+          status = SolverInstance::UNKNOWN;
+    }
+  }
+  if (get_flag_verbose()) {
+    if (winner >= 0)
+      cerr << "  Portfolio: " << children[winner].id << " won the race" << endl;
+    else
+      cerr << "  Portfolio: no solver finished the search" << endl;
+  }
+  if ( !s2out.fStatusPrinted )
+    s2out.evalStatus( status );
+  if (get_flag_statistics()) {
+    for (unsigned int k=0; k<children.size(); k++)
+      cout << "  % Portfolio " << children[k].id << ": " << children[k].nSolns << " solutions, "
+           << children[k].nImproving << " improving" << (static_cast<int>(k)==winner ? ", winner" : "")
+           << endl;
+    printStatistics();
+  }
+#endif
+}
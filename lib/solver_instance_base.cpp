@@ -11,6 +11,11 @@
 
 #include <minizinc/solver_instance_base.hh>
 #include <minizinc/eval_par.hh>
+#include <minizinc/timer.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
 
 #ifdef _MSC_VER 
 #define _CRT_SECURE_NO_WARNINGS
@@ -21,20 +26,139 @@
 
 namespace MiniZinc {
 
+  namespace {
+
+    /// One objective of a lexicographic objective
+    struct LexLevel {
+      SolveI::SolveType st;
+      Id* obj;
+      LexLevel(SolveI::SolveType st0, Id* obj0) : st(st0), obj(obj0) {}
+    };
+
+    /// Return the lex_objectives annotation of \a si (or NULL)
+    Call* lexObjectivesAnn(SolveI* si) {
+      for (ExpressionSetIter i = si->ann().begin(); i != si->ann().end(); ++i) {
+        Call* c = (*i)->dyn_cast<Call>();
+        if (c && c->id().str() == "lex_objectives")
+          return c;
+      }
+      return NULL;
+    }
+
+    /// Collect the objectives of the solve item \a si in \a levels
+    void lexLevels(SolveI* si, std::vector<LexLevel>& levels) {
+      if (si->st() != SolveI::SolveType::ST_SAT)
+        levels.push_back(LexLevel(si->st(), si->e()->cast<Id>()));
+      Call* lex = lexObjectivesAnn(si);
+      if (lex == NULL)
+        return;
+      ArrayLit* al = lex->args()[0]->cast<ArrayLit>();
+      for (unsigned int i=0; i<al->v().size(); i++) {
+        Call* c = al->v()[i]->dyn_cast<Call>();
+        SolveI::SolveType st;
+        if (c && c->id().str() == "lex_minimize")
+          st = SolveI::SolveType::ST_MIN;
+        else if (c && c->id().str() == "lex_maximize")
+          st = SolveI::SolveType::ST_MAX;
+        else
+          throw InternalError("lex_objectives expects lex_minimize and lex_maximize annotations");
+        // objectives that flattening has fixed are optimal already
+        if (Id* id = c->args()[0]->dyn_cast<Id>())
+          levels.push_back(LexLevel(st, id));
+      }
+    }
+
+    /// Constraint fixing the objective of \a l to its optimal value \a v
+    Item* lexFixItem(const LexLevel& l, double v) {
+      bool min = l.st == SolveI::SolveType::ST_MIN;
+      Expression* bound;
+      ASTString name;
+      if (l.obj->type().isvarint()) {
+        bound = IntLit::a(static_cast<long long int>(std::floor(v+0.5)));
+        name = constants().ids.int_.le;
+      } else {
+        // leave room for the tolerances of the solver
+        double tol = 1e-6*std::max(1.0, std::fabs(v));
+        bound = FloatLit::a(min ? v+tol : v-tol);
+        name = constants().ids.float_.le;
+      }
+      std::vector<Expression*> args(2);
+      args[0] = min ? static_cast<Expression*>(l.obj) : bound;
+      args[1] = min ? bound : static_cast<Expression*>(l.obj);
+      Call* c = new Call(Location().introduce(), name, args);
+      c->type(Type::varbool());
+      return new ConstraintI(Location().introduce(), c);
+    }
+
+  }
+
   SolverInstanceBase::Status
   SolverInstanceBase::solve(void) { return SolverInstance__ERROR; }
+
+  bool
+  SolverInstanceBase::hasLexObjectives(void) {
+    return lexObjectivesAnn(getEnv()->flat()->solveItem()) != NULL;
+  }
+
+  SolverInstanceBase::Status
+  SolverInstanceBase::solveLexicographic(void) {
+    SolveI* si = getEnv()->flat()->solveItem();
+    std::vector<LexLevel> levels;
+    lexLevels(si, levels);
+    bool report = getOptions().getBoolParam(constants().opts.verbose.str(), false) ||
+                  getOptions().getBoolParam(constants().opts.statistics.str(), false);
+    Status status = SolverInstance::UNKNOWN;
+    bool printed = false;
+    for (unsigned int k=0; k==0 || k<levels.size(); k++) {
+      if (k > 0) {
+        double v;
+        // only an optimum can be fixed
+        if (status != SolverInstance::OPT || !getObjectiveValue(v))
+          break;
+        Model fix;
+        fix.addItem(lexFixItem(levels[k-1], v));
+        processPermanentConstraints(fix.begin(), fix.end());
+      }
+      if (k < levels.size() && (k > 0 || si->st() == SolveI::SolveType::ST_SAT)) {
+        if (!setObjective(levels[k].st, levels[k].obj))
+          throw InternalError("this solver does not support lexicographic objectives");
+      }
+      Timer timer;
+      status = solve();
+      if (report && k < levels.size()) {
+        std::cerr << "%%  lex objective " << k+1 << " of " << levels.size() << " ("
+                  << (levels[k].st == SolveI::SolveType::ST_MIN ? "minimize " : "maximize ")
+                  << *levels[k].obj << "): ";
+        double v;
+        if ((status == SolverInstance::SAT || status == SolverInstance::OPT) && getObjectiveValue(v))
+          std::cerr << v << (status == SolverInstance::OPT ? " (optimal)" : "");
+        else
+          std::cerr << "no solution";
+        std::cerr << ", " << timer.ms() << " ms" << std::endl;
+      }
+      if (status != SolverInstance::SAT && status != SolverInstance::OPT)
+        break;
+      printSolution();
+      printed = true;
+    }
+    if (printed && status != SolverInstance::OPT)
+      status = SolverInstance::SAT;
+    return status;
+  }
   
   void
-  SolverInstanceBase::reset(void) { assert(false); }
+  SolverInstanceBase::reset(void) {
+    resetSolver();
+  }
   
   void
   SolverInstanceBase::resetWithConstraints(Model::iterator begin, Model::iterator end) {
-    assert(false);
+    throw InternalError("this solver does not support adding temporary constraints");
   }
 
   void
   SolverInstanceBase::processPermanentConstraints(Model::iterator begin, Model::iterator end) {
-    assert(false);
+    throw InternalError("this solver does not support adding permanent constraints");
   }
   
   void
@@ -76,10 +200,7 @@ namespace MiniZinc {
 //     }
 //   }
   
-  void SolverInstanceBase2::assignSolutionToOutput() {
-    
-    MZN_ASSERT_HARD_MSG( 0!=pS2Out, "Setup a Solns2Out object to use default solution extraction/reporting procs" );
-    
+  void SolverInstanceBase2::compileOutputPlan() {
     if ( _varsWithOutput.empty() ) {
       for (VarDeclIterator it = getEnv()->flat()->begin_vardecls(); it != getEnv()->flat()->end_vardecls(); ++it) {
         if(!it->removed()) {
@@ -94,67 +215,85 @@ namespace MiniZinc {
         }
       }
     }
-    
-    pS2Out->declNewOutput();  // Even for empty output decl
-    
-    //iterate over set of ids that have an output annotation && obtain their right hand side from the flat model
+
+    GCLock lock;
+    _outputPlan.clear();
+    _outputPlanS2Out = pS2Out;
     for(unsigned int i=0; i<_varsWithOutput.size(); i++) {
       VarDecl* vd = _varsWithOutput[i];
-      //std::cout << "DEBUG: Looking at var-decl with output-annotation: " << *vd << std::endl;
+      OutputEntry oe;
+      oe.flat = vd;
       if(Call* output_array_ann = Expression::dyn_cast<Call>(getAnnotation(vd->ann(), constants().ann.output_array.aststr()))) {
         assert(vd->e());
-
-        if(ArrayLit* al = vd->e()->dyn_cast<ArrayLit>()) {
-          std::vector<Expression*> array_elems;
-          ASTExprVec<Expression> array = al->v();
-          for(unsigned int j=0; j<array.size(); j++) {
-            if(Id* id = array[j]->dyn_cast<Id>()) {
-              //std::cout << "DEBUG: getting solution value from " << *id  << " : " << id->v() << std::endl;
-              array_elems.push_back(getSolutionValue(id));
-            } else if(FloatLit* floatLit = array[j]->dyn_cast<FloatLit>()) {
-              array_elems.push_back(floatLit);
-            } else if(IntLit* intLit = array[j]->dyn_cast<IntLit>()) {
-              array_elems.push_back(intLit);
-            } else if(BoolLit* boolLit = array[j]->dyn_cast<BoolLit>()) {
-              array_elems.push_back(boolLit);
-            } else if(SetLit* setLit = array[j]->dyn_cast<SetLit>()) {
-              array_elems.push_back(setLit);
-            } else if(StringLit* strLit = array[j]->dyn_cast<StringLit>()) {
-              array_elems.push_back(strLit);
-            } else {
-              std::cerr << "Error: array element " << *array[j] << " is ! an id nor a literal" << std::endl;
-              assert(false);
-            }
+        ArrayLit* al = vd->e()->dyn_cast<ArrayLit>();
+        if (al==NULL)
+          continue;
+        oe.isArray = true;
+        ASTExprVec<Expression> array = al->v();
+        for(unsigned int j=0; j<array.size(); j++) {
+          if(array[j]->isa<Id>()) {
+            oe.vars.push_back(j);
+          } else if(!(array[j]->isa<FloatLit>() || array[j]->isa<IntLit>() ||
+                      array[j]->isa<BoolLit>() || array[j]->isa<SetLit>() ||
+                      array[j]->isa<StringLit>())) {
+            std::ostringstream oss;
+            oss << "array element " << *array[j] << " is neither an id nor a literal";
+            throw InternalError(oss.str());
           }
-          GCLock lock;
-          ArrayLit* dims;
-          Expression* e = output_array_ann->args()[0];
-          if(ArrayLit* al = e->dyn_cast<ArrayLit>()) {
-            dims = al;
-          } else if(Id* id = e->dyn_cast<Id>()) {
-            dims = id->decl()->e()->cast<ArrayLit>();
+          oe.elems.push_back(array[j]);
+        }
+        ArrayLit* dims;
+        Expression* e = output_array_ann->args()[0];
+        if(ArrayLit* al = e->dyn_cast<ArrayLit>()) {
+          dims = al;
+        } else if(Id* id = e->dyn_cast<Id>()) {
+          dims = id->decl()->e()->cast<ArrayLit>();
+        } else {
+          throw InternalError("output_array annotation with unexpected index sets");
+        }
+        for( int i=0;i<dims->length();i++) {
+          IntSetVal* isv = eval_intset(getEnv()->envi(), dims->v()[i]);
+          if (isv->size()==0) {
+            oe.dims.push_back(std::pair<int,int>(1,0));
           } else {
-            throw -1;
-          }
-          std::vector<std::pair<int,int> > dims_v;
-          for( int i=0;i<dims->length();i++) {
-            IntSetVal* isv = eval_intset(getEnv()->envi(), dims->v()[i]);
-            if (isv->size()==0) {
-              dims_v.push_back(std::pair<int,int>(1,0));
-            } else {
-              dims_v.push_back(std::pair<int,int>(isv->min().toInt(),isv->max().toInt()));
-            }
+            oe.dims.push_back(std::pair<int,int>(isv->min().toInt(),isv->max().toInt()));
           }
-          ArrayLit* array_solution = new ArrayLit(Location(),array_elems,dims_v);
-          KeepAlive ka(array_solution);
-          auto& de = getSolns2Out()->findOutputVar(vd->id()->str().str());
-          de.first->e(array_solution);
         }
       } else if(vd->ann().contains(constants().ann.output_var)) {
-        Expression* sol = getSolutionValue(vd->id());
-        vd->e(sol);
-        auto& de = getSolns2Out()->findOutputVar(vd->id()->str().str());
-        de.first->e(sol);
+        oe.isArray = false;
+      } else {
+        continue;
+      }
+      oe.output = getSolns2Out()->findOutputVar(vd->id()->str()).first;
+      _outputPlan.push_back(oe);
+    }
+  }
+
+  void SolverInstanceBase2::assignSolutionToOutput() {
+    
+    MZN_ASSERT_HARD_MSG( 0!=pS2Out, "Setup a Solns2Out object to use default solution extraction/reporting procs" );
+
+    // Annotations, index sets and output declarations are only looked up once
+    if ( _outputPlanS2Out != pS2Out )
+      compileOutputPlan();
+    
+    pS2Out->declNewOutput();  // Even for empty output decl
+    
+    GCLock lock;
+    for(unsigned int i=0; i<_outputPlan.size(); i++) {
+      OutputEntry& oe = _outputPlan[i];
+      if(oe.isArray) {
+        _outputElems.assign(oe.elems.begin(), oe.elems.end());
+        for(unsigned int j=0; j<oe.vars.size(); j++) {
+          unsigned int k = oe.vars[j];
+          _outputElems[k] = getSolutionValue(oe.elems[k]->cast<Id>());
+        }
+        ArrayLit* array_solution = new ArrayLit(Location(),_outputElems,oe.dims);
+        oe.output->e(array_solution);
+      } else {
+        Expression* sol = getSolutionValue(oe.flat->id());
+        oe.flat->e(sol);
+        oe.output->e(sol);
       }
     }
 
@@ -16,8 +16,12 @@
 #include <minizinc/hash.hh>
 #include <minizinc/flatten_internal.hh>
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <string>
 #include <sstream>
+#include <thread>
 
 #include <minizinc/prettyprinter.hh>
 
@@ -726,7 +730,10 @@ namespace MiniZinc {
     void vId(Id& id) {
       if (&id != constants().absent) {
         assert(!id.decl()->type().isunknown());
-        id.type(id.decl()->type());
+        // The declaration already has this type. Only set the type of the
+        // identifier, since declarations are shared between items that
+        // may be checked concurrently.
+        id.typeOfId(id.decl()->type());
       }
     }
     /// Visit anonymous variable
@@ -1269,7 +1276,8 @@ namespace MiniZinc {
     void vTIId(TIId& id) {}
   };
   
-  void typecheck(Env& env, Model* m, std::vector<TypeError>& typeErrors, bool ignoreUndefinedParameters) {
+  void typecheck(Env& env, Model* m, std::vector<TypeError>& typeErrors, bool ignoreUndefinedParameters,
+                 unsigned int nThreads) {
     TopoSorter ts(m);
     
     std::vector<FunctionI*> functionItems;
@@ -1422,9 +1430,6 @@ namespace MiniZinc {
     }
     
     {
-      Typer<true> ty(env.envi(), m, typeErrors);
-      BottomUpIterator<Typer<true> > bu_ty(ty);
-      
       class TSV2 : public ItemVisitor {
       public:
         EnvI& env;
@@ -1504,12 +1509,20 @@ namespace MiniZinc {
                             +Type::parstring(1).toString(env)+"', actual `"+i->e()->type().toString(env)+"'");
         }
         void vFunctionI(FunctionI* i) {
+          vFunctionSignature(i);
+          vFunctionBody(i);
+        }
+        /// Check the annotations and return type of function \a i
+        void vFunctionSignature(FunctionI* i) {
           for (ExpressionSetIter it = i->ann().begin(); it != i->ann().end(); ++it) {
             bu_ty.run(*it);
             if (!(*it)->type().isann())
               throw TypeError(env, (*it)->loc(), "expected annotation, got `"+(*it)->type().toString(env)+"'");
           }
           bu_ty.run(i->ti());
+        }
+        /// Check the body of function \a i
+        void vFunctionBody(FunctionI* i) {
           bu_ty.run(i->e());
           if (i->e() && !env.isSubtype(i->e()->type(),i->ti()->type(),true))
             throw TypeError(env, i->e()->loc(), "return type of function does not match body, declared type is `"
@@ -1518,8 +1531,110 @@ namespace MiniZinc {
           if (i->e())
             i->e(addCoercion(env, m, i->e(), i->ti()->type())());
         }
-      } _tsv2(env.envi(), m, bu_ty, typeErrors);
-      iterItems(_tsv2,m);
+      };
+
+      if (nThreads==0)
+        nThreads = std::max(1u, std::thread::hardware_concurrency());
+      if (nThreads==1) {
+        Typer<true> ty(env.envi(), m, typeErrors);
+        BottomUpIterator<Typer<true> > bu_ty(ty);
+        TSV2 _tsv2(env.envi(), m, bu_ty, typeErrors);
+        iterItems(_tsv2,m);
+      } else {
+        // Function bodies and constraint items only depend on the types of
+        // the declarations and function signatures, so they are checked by
+        // worker threads after this thread has checked all other items. The
+        // errors of each item are kept separately and merged in item order,
+        // so the result is the same as for sequential typechecking.
+        class Items : public ItemVisitor {
+        public:
+          std::vector<Item*> items;
+          bool enter(Item* i) { items.push_back(i); return true; }
+        } _items;
+        iterItems(_items,m);
+        const std::vector<Item*>& items = _items.items;
+
+        struct ItemResult {
+          std::vector<TypeError> errors;
+          std::exception_ptr exception;
+        };
+        std::vector<ItemResult> results(items.size());
+        std::vector<unsigned int> parallel;
+        {
+          std::vector<TypeError> errors;
+          Typer<true> ty(env.envi(), m, errors);
+          BottomUpIterator<Typer<true> > bu_ty(ty);
+          TSV2 _tsv2(env.envi(), m, bu_ty, errors);
+          for (unsigned int i=0; i<items.size(); i++) {
+            try {
+              switch (items[i]->iid()) {
+                case Item::II_VD:
+                  _tsv2.vVarDeclI(items[i]->cast<VarDeclI>());
+                  break;
+                case Item::II_ASN:
+                  _tsv2.vAssignI(items[i]->cast<AssignI>());
+                  break;
+                case Item::II_SOL:
+                  _tsv2.vSolveI(items[i]->cast<SolveI>());
+                  break;
+                case Item::II_OUT:
+                  _tsv2.vOutputI(items[i]->cast<OutputI>());
+                  break;
+                case Item::II_FUN:
+                  _tsv2.vFunctionSignature(items[i]->cast<FunctionI>());
+                  parallel.push_back(i);
+                  break;
+                case Item::II_CON:
+                  parallel.push_back(i);
+                  break;
+                case Item::II_INC:
+                  break;
+              }
+            } catch (...) {
+              // Sequential typechecking stops here
+              results[i].exception = std::current_exception();
+              results[i].errors.swap(errors);
+              break;
+            }
+            results[i].errors.swap(errors);
+          }
+        }
+
+        GCShared shared;
+        std::atomic<size_t> iNext(0);
+        auto checkNext = [&]() {
+          GCShared::Use use(shared);
+          std::vector<TypeError> errors;
+          Typer<true> ty(env.envi(), m, errors);
+          BottomUpIterator<Typer<true> > bu_ty(ty);
+          TSV2 _tsv2(env.envi(), m, bu_ty, errors);
+          for (size_t j; (j = iNext++) < parallel.size(); ) {
+            ItemResult& r = results[parallel[j]];
+            try {
+              if (FunctionI* fi = items[parallel[j]]->dyn_cast<FunctionI>())
+                _tsv2.vFunctionBody(fi);
+              else
+                _tsv2.vConstraintI(items[parallel[j]]->cast<ConstraintI>());
+            } catch (...) {
+              r.exception = std::current_exception();
+            }
+            r.errors.insert(r.errors.end(), errors.begin(), errors.end());
+            errors.clear();
+          }
+        };
+        std::vector<std::thread> workers;
+        for (unsigned int k=1; k<nThreads && k<parallel.size(); k++)
+          workers.push_back(std::thread(checkNext));
+        checkNext();
+        for (unsigned int k=0; k<workers.size(); k++)
+          workers[k].join();
+
+        for (unsigned int i=0; i<results.size(); i++) {
+          typeErrors.insert(typeErrors.end(), results[i].errors.begin(), results[i].errors.end());
+          if (results[i].exception)
+            std::rethrow_exception(results[i].exception);
+        }
+      }
     }
     
     class TSV3 : public ItemVisitor {
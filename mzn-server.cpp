@@ -0,0 +1,577 @@
+/* -*- mode: C++; c-basic-offset: 2; indent-tabs-mode: nil -*- */
+
+/*
+ *  Main authors:
+ *     agent <agent@local>
+ */
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/* A compiler server. It compiles (and, if a solver is linked, solves) a
+ * sequence of requests without paying process start-up and library parsing
+ * for each of them. Before serving, the server compiles a model including
+ * globals.mzn with the default options, and keeps the parsed library files
+ * in memory (see LibraryCache). Each request is then run in a child process
+ * forked from the server, with its own Env, so that it starts with the
+ * library already in memory, and so that errors (on which the compiler
+ * exits) or crashes never affect the server or other requests.
+ *
+ * Usage: mzn-server [--socket <path>] [<default options>]
+ *
+ * The default options (e.g. --stdlib-dir or -G) are used for every request,
+ * followed by the options of the request. Requests are read from the
+ * standard input and responses written to the standard output, or, with
+ * --socket, from and to the connections to a Unix domain socket, one
+ * connection at a time. Requests are processed in order, one at a time.
+ *
+ * A request consists of the following lines:
+ *
+ *   flatten | solve        print the FlatZinc, or solve (if a solver is linked)
+ *   arg <option>           one command-line option per line (any number)
+ *   model <n>              followed by <n> bytes of model text (optional)
+ *   data <n>               followed by <n> bytes of data (any number)
+ *   timeout <ms>           kill the request after <ms> milliseconds (optional)
+ *   end
+ *
+ * Without model text, the options have to name the model file. Model text
+ * is written to a file in a temporary directory of the server, so relative
+ * includes need a -I option. The response consists of the lines
+ *
+ *   status <exit status, or 128 plus the signal number if the process was
+ *          killed (by SIGKILL when the time limit was reached)>
+ *   time <wall clock time in milliseconds>
+ *   stdout <n>             followed by the <n> bytes of the standard output
+ *   stderr <n>             followed by the <n> bytes of the standard error
+ *   end
+ *
+ * or, for a malformed request, of the lines "error <message>" and "end".
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#endif
+
+#include <minizinc/solver.hh>
+#include <minizinc/library_index.hh>
+#include <minizinc/timer.hh>
+
+using namespace std;
+using namespace MiniZinc;
+
+#ifndef _WIN32
+
+namespace {
+
+  /// Buffered reading and writing of a connection
+  class Connection {
+  protected:
+    int _in;
+    int _out;
+    /// Data read but not consumed yet
+    std::string _buf;
+    /// Read more data into the buffer, return false at EOF
+    bool fill(void) {
+      char buffer[65536];
+      for (;;) {
+        ssize_t count = ::read(_in, buffer, sizeof(buffer));
+        if (count < 0 && errno == EINTR)
+          continue;
+        if (count <= 0)
+          return false;
+        _buf.append(buffer, count);
+        return true;
+      }
+    }
+  public:
+    Connection(int in, int out) : _in(in), _out(out) {}
+    /// Read a line (without the newline), return false at EOF
+    bool readLine(std::string& line) {
+      size_t end;
+      while ((end = _buf.find('\n')) == std::string::npos) {
+        if (!fill())
+          return false;
+      }
+      line = _buf.substr(0, end);
+      _buf.erase(0, end+1);
+      if (!line.empty() && line[line.size()-1] == '\r')
+        line.erase(line.size()-1);
+      return true;
+    }
+    /// Read \a n bytes, return false at EOF
+    bool read(size_t n, std::string& s) {
+      while (_buf.size() < n) {
+        if (!fill())
+          return false;
+      }
+      s = _buf.substr(0, n);
+      _buf.erase(0, n);
+      return true;
+    }
+    /// Write \a s, return false if the connection was closed
+    bool write(const std::string& s) {
+      size_t done = 0;
+      while (done < s.size()) {
+        ssize_t count = ::write(_out, s.data()+done, s.size()-done);
+        if (count < 0 && errno == EINTR)
+          continue;
+        if (count <= 0)
+          return false;
+        done += count;
+      }
+      return true;
+    }
+  };
+
+  /// A request
+  struct Request {
+    /// Whether to solve (or only flatten)
+    bool solve;
+    /// Command-line options
+    std::vector<std::string> args;
+    /// Whether model text was given
+    bool hasModel;
+    /// The model text
+    std::string model;
+    /// The data
+    std::vector<std::string> data;
+    /// Time limit in milliseconds (0 for no limit)
+    long timeout;
+  };
+
+  /// The result of a request
+  struct Response {
+    /// Exit status (128 plus the signal number if killed)
+    int status;
+    /// Wall clock time in milliseconds
+    double ms;
+    /// Standard output
+    std::string out;
+    /// Standard error
+    std::string err;
+  };
+
+  enum ReadResult { RR_OK, RR_EOF, RR_ERROR };
+
+  /// Read a request from \a conn, setting \a error if it is malformed
+  ReadResult readRequest(Connection& conn, Request& r, std::string& error) {
+    std::string line;
+    // Skip empty lines between requests
+    do {
+      if (!conn.readLine(line))
+        return RR_EOF;
+    } while (line.empty());
+    r.args.clear();
+    r.hasModel = false;
+    r.model.clear();
+    r.data.clear();
+    r.timeout = 0;
+    if (line == "flatten") {
+      r.solve = false;
+    } else if (line == "solve") {
+      r.solve = true;
+    } else {
+      error = "expected flatten or solve, found `" + line + "'";
+      // Skip the rest of the request
+      while (line != "end" && conn.readLine(line)) {}
+      return RR_ERROR;
+    }
+    for (;;) {
+      if (!conn.readLine(line))
+        return RR_EOF;
+      if (line == "end")
+        return error.empty() ? RR_OK : RR_ERROR;
+      size_t sp = line.find(' ');
+      std::string key = line.substr(0, sp);
+      std::string arg = sp == std::string::npos ? "" : line.substr(sp+1);
+      if (key == "arg") {
+        r.args.push_back(arg);
+      } else if (key == "model" || key == "data") {
+        char* end;
+        unsigned long n = strtoul(arg.c_str(), &end, 10);
+        if (arg.empty() || *end != '\0') {
+          if (error.empty())
+            error = "bad size in `" + line + "'";
+          continue;
+        }
+        std::string text;
+        if (!conn.read(n, text))
+          return RR_EOF;
+        if (key == "model") {
+          r.hasModel = true;
+          r.model = text;
+        } else {
+          r.data.push_back(text);
+        }
+      } else if (key == "timeout") {
+        r.timeout = atol(arg.c_str());
+      } else if (error.empty()) {
+        error = "unknown request line `" + line + "'";
+      }
+    }
+  }
+
+  /// Write response \a resp to \a conn
+  bool writeResponse(Connection& conn, const Response& resp) {
+    std::ostringstream oss;
+    oss << "status " << resp.status << "\n"
+        << "time " << resp.ms << "\n"
+        << "stdout " << resp.out.size() << "\n" << resp.out
+        << "stderr " << resp.err.size() << "\n" << resp.err
+        << "end\n";
+    return conn.write(oss.str());
+  }
+
+  /// Compile (and solve) with command line \a args, like the minizinc driver
+  int compile(bool solve, const std::vector<std::string>& args, LibraryCache& cache) {
+    std::vector<const char*> argv;
+    for (unsigned int i=0; i<args.size(); i++)
+      argv.push_back(args[i].c_str());
+    bool fSuccess = false;
+    MznSolver slv(!solve);
+    try {
+      slv.addFlattener();
+      slv.getFlt()->setLibraryCache(&cache);
+      if (!slv.processOptions(static_cast<int>(argv.size()), argv.data(), cerr))
+        return 1;
+      slv.flatten();
+      if (SolverInstance::UNKNOWN == slv.getFlt()->status) {
+        fSuccess = true;
+        if (solve) {
+          GCLock lock;
+          slv.addSolverInterface();
+          slv.solve();
+        }
+      } else {
+        fSuccess = (SolverInstance::ERROR != slv.getFlt()->status);
+        if (solve)
+          slv.s2out.evalStatus( slv.getFlt()->status );
+      }
+    } catch (const LocationException& e) {
+      cerr << e.loc() << ":" << endl;
+      cerr << e.what() << ": " << e.msg() << endl;
+      slv.s2out.evalStatus( SolverInstance::ERROR );
+    } catch (const Exception& e) {
+      cerr << e.what() << ": " << e.msg() << endl;
+      slv.s2out.evalStatus( SolverInstance::ERROR );
+    } catch (const exception& e) {
+      cerr << e.what() << endl;
+      slv.s2out.evalStatus( SolverInstance::ERROR );
+    }
+    return fSuccess ? 0 : 1;
+  }
+
+  /// Run \a args in a child process, collecting its output in \a resp
+  void run(bool solve, const std::vector<std::string>& args, long timeout,
+           LibraryCache& cache, const std::vector<int>& fds, Response& resp) {
+    Timer timer;
+    resp.status = 1;
+    resp.out.clear();
+    resp.err.clear();
+    int outPipe[2];
+    int errPipe[2];
+    if (pipe(outPipe) != 0)
+      throw InternalError("mzn-server: could not create pipe");
+    if (pipe(errPipe) != 0) {
+      close(outPipe[0]);
+      close(outPipe[1]);
+      throw InternalError("mzn-server: could not create pipe");
+    }
+    cout.flush();
+    cerr.flush();
+    pid_t pid = fork();
+    if (pid == -1) {
+      close(outPipe[0]); close(outPipe[1]);
+      close(errPipe[0]); close(errPipe[1]);
+      throw InternalError("mzn-server: could not start request process");
+    }
+    if (pid == 0) {
+      // Own process group, so that solvers started by the child are killed with it
+      setpgid(0, 0);
+      signal(SIGPIPE, SIG_DFL);
+      for (unsigned int i=0; i<fds.size(); i++)
+        close(fds[i]);
+      int devNull = open("/dev/null", O_RDONLY);
+      if (devNull >= 0) {
+        dup2(devNull, STDIN_FILENO);
+        close(devNull);
+      }
+      close(outPipe[0]);
+      close(errPipe[0]);
+      dup2(outPipe[1], STDOUT_FILENO);
+      dup2(errPipe[1], STDERR_FILENO);
+      close(outPipe[1]);
+      close(errPipe[1]);
+      // The child works on a copy-on-write image of the cache
+      cache.take();
+      int ret = compile(solve, args, cache);
+      cout.flush();
+      cerr.flush();
+      fflush(NULL);
+      _exit(ret);
+    }
+    setpgid(pid, pid);
+    close(outPipe[1]);
+    close(errPipe[1]);
+    int fd[2] = { outPipe[0], errPipe[0] };
+    std::string* dest[2] = { &resp.out, &resp.err };
+    bool killed = false;
+    while (fd[0] >= 0 || fd[1] >= 0) {
+      fd_set rfds;
+      FD_ZERO(&rfds);
+      int fdMax = -1;
+      for (int k=0; k<2; k++) {
+        if (fd[k] >= 0) {
+          FD_SET(fd[k], &rfds);
+          fdMax = std::max(fdMax, fd[k]);
+        }
+      }
+      timeval tv;
+      timeval* ptv = NULL;
+      if (timeout > 0 && !killed) {
+        double left = timeout - timer.ms();
+        if (left <= 0) {
+          kill(-pid, SIGKILL);
+          killed = true;
+          continue;
+        }
+        tv.tv_sec = static_cast<long>(left) / 1000;
+        tv.tv_usec = (static_cast<long>(left) % 1000) * 1000 + 1;
+        ptv = &tv;
+      }
+      int n = select(fdMax+1, &rfds, NULL, NULL, ptv);
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        break;
+      }
+      for (int k=0; k<2; k++) {
+        if (fd[k] < 0 || !FD_ISSET(fd[k], &rfds))
+          continue;
+        char buffer[65536];
+        ssize_t count = read(fd[k], buffer, sizeof(buffer));
+        if (count < 0 && errno == EINTR)
+          continue;
+        if (count <= 0) {
+          close(fd[k]);
+          fd[k] = -1;
+        } else {
+          dest[k]->append(buffer, count);
+        }
+      }
+    }
+    for (int k=0; k<2; k++)
+      if (fd[k] >= 0)
+        close(fd[k]);
+    int wstatus;
+    while (waitpid(pid, &wstatus, 0) < 0 && errno == EINTR) { }
+    if (WIFEXITED(wstatus))
+      resp.status = WEXITSTATUS(wstatus);
+    else if (WIFSIGNALED(wstatus))
+      resp.status = 128 + WTERMSIG(wstatus);
+    resp.ms = timer.ms();
+  }
+
+  /// The server state
+  class Server {
+  protected:
+    /// Name of the executable
+    std::string _exe;
+    /// Default options of every request
+    std::vector<std::string> _defaults;
+    /// Temporary directory for model text
+    std::string _tmpdir;
+    /// The parsed library files
+    LibraryCache _cache;
+  public:
+    Server(const std::string& exe, const std::vector<std::string>& defaults)
+      : _exe(exe), _defaults(defaults) {
+      const char* t = getenv("TMPDIR");
+      std::string tmpl = std::string(t && *t ? t : "/tmp") + "/mzn-server.XXXXXX";
+      std::vector<char> buf(tmpl.begin(), tmpl.end());
+      buf.push_back('\0');
+      if (mkdtemp(buf.data()) == NULL)
+        throw InternalError("mzn-server: could not create temporary directory");
+      _tmpdir = buf.data();
+    }
+    ~Server(void) {
+      remove((_tmpdir+"/model.mzn").c_str());
+      remove((_tmpdir+"/warmup.mzn").c_str());
+      rmdir(_tmpdir.c_str());
+    }
+    /// Compile a model including the globals, keeping the library files in the cache
+    void warmUp(void) {
+      std::string warmup = _tmpdir+"/warmup.mzn";
+      {
+        std::ofstream os(warmup.c_str());
+        os << "include \"globals.mzn\";\n";
+      }
+      std::vector<std::string> args;
+      args.push_back(_exe);
+      args.insert(args.end(), _defaults.begin(), _defaults.end());
+      args.push_back("--model-check-only");
+      args.push_back(warmup);
+      if (compile(false, args, _cache) != 0)
+        throw InternalError("mzn-server: could not compile the library with the default options");
+    }
+    /// Number of library files in memory
+    unsigned int libraryFiles(void) const { return _cache.size(); }
+    /// Answer the requests read from \a conn, closing \a fds in the request processes
+    void serve(Connection& conn, const std::vector<int>& fds) {
+      Request r;
+      for (;;) {
+        std::string error;
+        ReadResult rr = readRequest(conn, r, error);
+        if (rr == RR_EOF)
+          return;
+        if (rr == RR_ERROR) {
+          if (!conn.write("error "+error+"\nend\n"))
+            return;
+          continue;
+        }
+        Response resp;
+        if (r.solve && getGlobalSolverRegistry()->getSolverFactories().empty()) {
+          resp.status = 1;
+          resp.ms = 0;
+          resp.err = _exe + ": no solver linked\n";
+        } else {
+          std::vector<std::string> args;
+          args.push_back(_exe);
+          args.insert(args.end(), _defaults.begin(), _defaults.end());
+          if (!r.solve) {
+            args.push_back("--output-to-stdout");
+            args.push_back("--no-output-ozn");
+          }
+          args.insert(args.end(), r.args.begin(), r.args.end());
+          if (r.hasModel) {
+            std::string model = _tmpdir+"/model.mzn";
+            std::ofstream os(model.c_str(), std::ios::binary);
+            os << r.model;
+            os.close();
+            args.push_back(model);
+          }
+          for (unsigned int i=0; i<r.data.size(); i++) {
+            args.push_back("-D");
+            args.push_back(r.data[i]);
+          }
+          try {
+            run(r.solve, args, r.timeout, _cache, fds, resp);
+          } catch (const Exception& e) {
+            resp.status = 1;
+            resp.ms = 0;
+            resp.err = e.msg() + "\n";
+          }
+        }
+        if (!writeResponse(conn, resp))
+          return;
+      }
+    }
+  };
+
+}
+
+int main(int argc, const char** argv) {
+
+#ifdef HAS_GECODE
+  static unique_ptr<SolverFactory>
+    pFactoryGECODE( SolverFactory::createF_GECODE() );
+#endif
+#ifdef HAS_FZN
+  static unique_ptr<SolverFactory>
+    pFactoryFZN( SolverFactory::createF_FZN() );
+#endif
+
+  std::string exe = argv[0];
+  exe = exe.substr(exe.find_last_of("/\\") + 1);
+  std::string socketPath;
+  std::vector<std::string> defaults;
+  for (int i=1; i<argc; i++) {
+    if (strcmp(argv[i], "--socket")==0 && i+1 < argc) {
+      socketPath = argv[++i];
+    } else if (strcmp(argv[i], "-h")==0 || strcmp(argv[i], "--help")==0) {
+      cerr << "Usage: " << exe << " [--socket <path>] [<default options>]" << endl
+           << "Compile requests read from the standard input (or the connections to the" << endl
+           << "Unix domain socket <path>), keeping the library files in memory." << endl
+           << "See the comment at the top of mzn-server.cpp for the protocol." << endl;
+      return EXIT_SUCCESS;
+    } else {
+      defaults.push_back(argv[i]);
+    }
+  }
+
+  // A client closing its connection must not stop the server
+  signal(SIGPIPE, SIG_IGN);
+  try {
+    Server server(exe, defaults);
+    Timer timer;
+    server.warmUp();
+    cerr << exe << ": " << server.libraryFiles() << " library files in memory ("
+         << timer.ms() << " ms)" << endl;
+    if (socketPath.empty()) {
+      Connection conn(STDIN_FILENO, STDOUT_FILENO);
+      std::vector<int> fds;
+      server.serve(conn, fds);
+    } else {
+      int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+      sockaddr_un addr;
+      memset(&addr, 0, sizeof(addr));
+      addr.sun_family = AF_UNIX;
+      if (sock < 0 || socketPath.size() >= sizeof(addr.sun_path))
+        throw InternalError("mzn-server: cannot create socket " + socketPath);
+      strcpy(addr.sun_path, socketPath.c_str());
+      unlink(socketPath.c_str());
+      if (bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+          listen(sock, 16) != 0)
+        throw InternalError("mzn-server: cannot listen on socket " + socketPath);
+      cerr << exe << ": listening on " << socketPath << endl;
+      for (;;) {
+        int c = accept(sock, NULL, NULL);
+        if (c < 0) {
+          if (errno == EINTR)
+            continue;
+          break;
+        }
+        Connection conn(c, c);
+        std::vector<int> fds;
+        fds.push_back(sock);
+        fds.push_back(c);
+        server.serve(conn, fds);
+        close(c);
+      }
+      close(sock);
+      unlink(socketPath.c_str());
+    }
+  } catch (const Exception& e) {
+    cerr << e.what() << ": " << e.msg() << endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+#else
+
+int main(int argc, const char** argv) {
+  cerr << "mzn-server is not supported on Windows" << endl;
+  return EXIT_FAILURE;
+}
+
+#endif
@@ -195,6 +195,24 @@ void MIP_cplex_wrapper::doAddVars
   wrap_assert( !status,  "Failed to declare variables." );
 }
 
+void MIP_cplex_wrapper::doRemoveRows(int first, int n)
+{
+  status = CPXdelrows (env, lp, first, first+n-1);
+  wrap_assert( !status,  "Failed to remove constraints." );
+}
+
+void MIP_cplex_wrapper::doRemoveCols(int first, int n)
+{
+  status = CPXdelcols (env, lp, first, first+n-1);
+  wrap_assert( !status,  "Failed to remove variables." );
+}
+
+void MIP_cplex_wrapper::doSetObjCoefs(int n, int* ind, double* obj)
+{
+  status = CPXchgobj (env, lp, n, ind, obj);
+  wrap_assert( !status,  "Failed to change the objective." );
+}
+
 static char getCPLEXConstrSense(MIP_wrapper::LinConType sense) {
     switch (sense) {
       case MIP_wrapper::LQ:
@@ -463,10 +481,6 @@ myusercutcallback (CPXCENVptr env,
       }
       MIP_wrapper::CutInput cutInput;
       info->cutcbfn( outpRlx, cutInput, info->ppp, fMIPSol );
-      static int nCuts=0;
-      nCuts += cutInput.size();
-      if ( cutInput.size() )
-        cerr << "\n   N CUTS:  " << nCuts << endl;
       for ( auto& cd : cutInput ) {
         assert( cd.mask &
           (MIP_wrapper::MaskConsType_Usercut|MIP_wrapper::MaskConsType_Lazy) );
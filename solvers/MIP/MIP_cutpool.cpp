@@ -0,0 +1,108 @@
+/* -*- mode: C++; c-basic-offset: 2; indent-tabs-mode: nil -*- */
+
+/*
+ *  Main authors:
+ *     agent <agent@local>
+ */
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+
+using namespace std;
+
+#include <minizinc/solvers/MIP/MIP_cutpool.hh>
+
+using namespace MiniZinc;
+
+void CutPool::normalize(size_t i) {
+  MIP_wrapper::CutDef& cut = cands[i];
+  const size_t n = cut.rmatind.size();
+  bool fSorted = true;
+  for ( size_t k=1; k<n && fSorted; ++k )
+    fSorted = cut.rmatind[k-1] < cut.rmatind[k];
+  if ( fSorted )
+    return;
+  vector< pair<int, double> > terms( n );
+  for ( size_t k=0; k<n; ++k )
+    terms[k] = make_pair( cut.rmatind[k], cut.rmatval[k] );
+  sort( terms.begin(), terms.end(),
+        []( const pair<int, double>& a, const pair<int, double>& b ) { return a.first < b.first; } );
+  cut.rmatind.clear();
+  cut.rmatval.clear();
+  for ( size_t k=0; k<n; ++k ) {
+    if ( cut.rmatind.size() && cut.rmatind.back()==terms[k].first )
+      cut.rmatval.back() += terms[k].second;
+    else
+      cut.addVar( terms[k].first, terms[k].second );
+  }
+}
+
+size_t CutPool::hash(size_t i) const {
+  const MIP_wrapper::CutDef& cut = cands[i];
+  std::hash<int> hi;
+  std::hash<double> hd;
+  size_t h = hi( cut.sense ) ^ ( hd( cut.rhs ) << 1 );
+  for ( size_t k=0; k<cut.rmatind.size(); ++k )
+    h = h*31 + ( hi( cut.rmatind[k] ) ^ ( hd( cut.rmatval[k] ) << 1 ) );
+  return h;
+}
+
+bool CutPool::same(size_t i, size_t j) const {
+  const MIP_wrapper::CutDef& a = cands[i];
+  const MIP_wrapper::CutDef& b = cands[j];
+  return a.sense==b.sense && a.rhs==b.rhs && a.mask==b.mask
+    && a.rmatind==b.rmatind && a.rmatval==b.rmatval;
+}
+
+void CutPool::select(const double* x, int nCols, const Options& opts,
+                     MIP_wrapper::CutInput& cutsOut, Statistics& stats) {
+  ++stats.nRounds;
+  stats.nCandidates += cands.size();
+  if ( cands.empty() )
+    return;
+  assert( x );
+  /// Violations of all candidates in one sweep
+  viol.resize( cands.size() );
+  for ( size_t i=0; i<cands.size(); ++i )
+    viol[i] = cands[i].computeViol( x, nCols );
+  /// Keep the violated candidates, dropping duplicates
+  vector<size_t> sel;
+  sel.reserve( cands.size() );
+  unordered_multimap<size_t, size_t> seen;
+  for ( size_t i=0; i<cands.size(); ++i ) {
+    if ( viol[i] <= opts.dMinViol )
+      continue;
+    normalize( i );
+    size_t h = hash( i );
+    bool fDup = false;
+    auto range = seen.equal_range( h );
+    for ( auto it = range.first; it != range.second && !fDup; ++it )
+      fDup = same( it->second, i );
+    if ( fDup ) {
+      ++stats.nDuplicates;
+      continue;
+    }
+    seen.insert( make_pair( h, i ) );
+    sel.push_back( i );
+  }
+  /// The most violated first; ties keep the generation order
+  auto moreViolated = [this]( size_t a, size_t b ) {
+    return viol[a] > viol[b] || ( viol[a] == viol[b] && a < b );
+  };
+  if ( opts.nMaxCuts > 0 && sel.size() > (size_t)opts.nMaxCuts ) {
+    partial_sort( sel.begin(), sel.begin()+opts.nMaxCuts, sel.end(), moreViolated );
+    sel.resize( opts.nMaxCuts );
+  } else {
+    sort( sel.begin(), sel.end(), moreViolated );
+  }
+  cutsOut.reserve( cutsOut.size() + sel.size() );
+  for ( size_t i : sel )
+    cutsOut.push_back( move( cands[i] ) );
+  stats.nAdded += sel.size();
+}
@@ -184,6 +184,8 @@ void MIP_gurobi_wrapper::openGUROBI()
   *(void**)(&dll_GRBcbcut) = dll_sym(gurobi_dll, "GRBcbcut");
   *(void**)(&dll_GRBcbget) = dll_sym(gurobi_dll, "GRBcbget");
   *(void**)(&dll_GRBcblazy) = dll_sym(gurobi_dll, "GRBcblazy");
+  *(void**)(&dll_GRBdelconstrs) = dll_sym(gurobi_dll, "GRBdelconstrs");
+  *(void**)(&dll_GRBdelvars) = dll_sym(gurobi_dll, "GRBdelvars");
   *(void**)(&dll_GRBfreeenv) = dll_sym(gurobi_dll, "GRBfreeenv");
   *(void**)(&dll_GRBfreemodel) = dll_sym(gurobi_dll, "GRBfreemodel");
   *(void**)(&dll_GRBgetdblattr) = dll_sym(gurobi_dll, "GRBgetdblattr");
@@ -196,6 +198,7 @@ void MIP_gurobi_wrapper::openGUROBI()
   *(void**)(&dll_GRBoptimize) = dll_sym(gurobi_dll, "GRBoptimize");
   *(void**)(&dll_GRBreadparams) = dll_sym(gurobi_dll, "GRBreadparams");
   *(void**)(&dll_GRBsetcallbackfunc) = dll_sym(gurobi_dll, "GRBsetcallbackfunc");
+  *(void**)(&dll_GRBsetdblattrlist) = dll_sym(gurobi_dll, "GRBsetdblattrlist");
   *(void**)(&dll_GRBsetdblparam) = dll_sym(gurobi_dll, "GRBsetdblparam");
   *(void**)(&dll_GRBsetintattr) = dll_sym(gurobi_dll, "GRBsetintattr");
   *(void**)(&dll_GRBsetintattrlist) = dll_sym(gurobi_dll, "GRBsetintattrlist");
@@ -212,6 +215,8 @@ void MIP_gurobi_wrapper::openGUROBI()
   dll_GRBcbcut = GRBcbcut;
   dll_GRBcbget = GRBcbget;
   dll_GRBcblazy = GRBcblazy;
+  dll_GRBdelconstrs = GRBdelconstrs;
+  dll_GRBdelvars = GRBdelvars;
   dll_GRBfreeenv = GRBfreeenv;
   dll_GRBfreemodel = GRBfreemodel;
   dll_GRBgetdblattr = GRBgetdblattr;
@@ -224,6 +229,7 @@ void MIP_gurobi_wrapper::openGUROBI()
   dll_GRBoptimize = GRBoptimize;
   dll_GRBreadparams = GRBreadparams;
   dll_GRBsetcallbackfunc = GRBsetcallbackfunc;
+  dll_GRBsetdblattrlist = GRBsetdblattrlist;
   dll_GRBsetdblparam = GRBsetdblparam;
   dll_GRBsetintattr = GRBsetintattr;
   dll_GRBsetintattrlist = GRBsetintattrlist;
@@ -296,6 +302,48 @@ void MIP_gurobi_wrapper::doAddVars
   wrap_assert( !error,  "Failed to update model." );
 }
 
+void MIP_gurobi_wrapper::doRemoveRows(int first, int n)
+{
+  vector<int> ind(n);
+  for (int i=0; i<n; ++i)
+    ind[i] = first+i;
+  error = dll_GRBdelconstrs(model, n, ind.data());
+  wrap_assert( !error,  "Failed to remove constraints." );
+  error = dll_GRBupdatemodel(model);
+  wrap_assert( !error,  "Failed to update model." );
+  nRows = first;
+  /// Forget pending lazy marks of the removed rows
+  size_t k=0;
+  for (size_t i=0; i<nLazyIdx.size(); ++i) {
+    if (nLazyIdx[i] < first) {
+      nLazyIdx[k] = nLazyIdx[i];
+      nLazyValue[k] = nLazyValue[i];
+      ++k;
+    }
+  }
+  nLazyIdx.resize(k);
+  nLazyValue.resize(k);
+}
+
+void MIP_gurobi_wrapper::doRemoveCols(int first, int n)
+{
+  vector<int> ind(n);
+  for (int i=0; i<n; ++i)
+    ind[i] = first+i;
+  error = dll_GRBdelvars(model, n, ind.data());
+  wrap_assert( !error,  "Failed to remove variables." );
+  error = dll_GRBupdatemodel(model);
+  wrap_assert( !error,  "Failed to update model." );
+}
+
+void MIP_gurobi_wrapper::doSetObjCoefs(int n, int* ind, double* obj)
+{
+  error = dll_GRBsetdblattrlist(model, GRB_DBL_ATTR_OBJ, n, ind, obj);
+  wrap_assert( !error,  "Failed to change the objective." );
+  error = dll_GRBupdatemodel(model);
+  wrap_assert( !error,  "Failed to update model." );
+}
+
 static char getGRBSense( MIP_wrapper::LinConType s ) {
     switch (s) {
       case MIP_wrapper::LQ:
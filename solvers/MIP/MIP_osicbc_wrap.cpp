@@ -154,6 +154,39 @@ void MIP_osicbc_wrapper::doAddVars
 //   wrap_assert( !status,  "Failed to declare variables." );
 }
 
+void MIP_osicbc_wrapper::doRemoveRows(int first, int n)
+{
+  int nOsi = osi.getNumRows();
+  if (first >= nOsi) {
+    /// only buffered rows
+    rows.resize(first-nOsi);
+    rowlb.resize(first-nOsi);
+    rowub.resize(first-nOsi);
+    return;
+  }
+  rows.clear();
+  rowlb.clear();
+  rowub.clear();
+  vector<int> ind(nOsi-first);
+  for (int i=0; i<nOsi-first; ++i)
+    ind[i] = first+i;
+  osi.deleteRows(ind.size(), ind.data());
+}
+
+void MIP_osicbc_wrapper::doRemoveCols(int first, int n)
+{
+  vector<int> ind(n);
+  for (int i=0; i<n; ++i)
+    ind[i] = first+i;
+  osi.deleteCols(n, ind.data());
+}
+
+void MIP_osicbc_wrapper::doSetObjCoefs(int n, int* ind, double* obj)
+{
+  for (int i=0; i<n; ++i)
+    osi.setObjCoeff(ind[i], obj[i]);
+}
+
 void MIP_osicbc_wrapper::addRow
   (int nnz, int* rmatind, double* rmatval, MIP_wrapper::LinConType sense,
    double rhs, int mask, string rowName)
@@ -665,7 +698,8 @@ void MIP_osicbc_wrapper::solve() {  // Move into ancestor?
 //     osi.addRows(rowStarts.size(), rowStarts.data(),
 //                 columns.data(), element.data(), rowlb.data(), rowub.data());
     /// So:
-    MIP_wrapper::addPhase1Vars();         // only now
+    if (!fPhase1Over)
+      MIP_wrapper::addPhase1Vars();         // only now, and only once
     if (fVerbose)
       cerr << "  MIP_osicbc_wrapper: adding constraints physically..." << flush;
     vector<CoinPackedVectorBase*> pRows(rowlb.size());
@@ -180,6 +180,37 @@ SCIP_RETCODE MIP_scip_wrapper::doAddVars_SCIP
   return SCIP_OKAY;
 }
 
+SCIP_RETCODE MIP_scip_wrapper::doRemoveRows_SCIP(int first, int n)
+{
+  /// solve() frees the transformed problem, so this is in problem stage.
+  /// Deleting from the end keeps the order of the remaining constraints
+  vector<SCIP_CONS*> conss(SCIPgetConss(scip), SCIPgetConss(scip)+first+n);
+  for (int i=first+n; i-- > first; )
+    SCIP_CALL( SCIPdelCons(scip, conss[i]) );
+  return SCIP_OKAY;
+}
+
+SCIP_RETCODE MIP_scip_wrapper::doRemoveCols_SCIP(int first, int n)
+{
+  for (int j=first+n; j-- > first; ) {
+    SCIP_Bool deleted = FALSE;
+    SCIP_CALL( SCIPdelVar(scip, scipVars[j], &deleted) );
+    if (!deleted)
+      throw runtime_error("  MIP_scip_wrapper: could not delete variable");
+    SCIP_CALL( SCIPreleaseVar(scip, &scipVars[j]) );
+  }
+  scipVars.resize(first);
+  return SCIP_OKAY;
+}
+
+SCIP_RETCODE MIP_scip_wrapper::doSetObjCoefs_SCIP(int n, int* ind, double* obj)
+{
+  /// Problem stage as well, see doRemoveRows_SCIP()
+  for (int i=0; i<n; ++i)
+    SCIP_CALL( SCIPchgVarObj(scip, scipVars[ind[i]], obj[i]) );
+  return SCIP_OKAY;
+}
+
 SCIP_RETCODE MIP_scip_wrapper::delSCIPVars()
 {
   for (size_t j=0; j<scipVars.size(); ++j)
@@ -23,10 +23,13 @@
 #include <string>
 #include <memory>
 #include <chrono>
+#include <algorithm>
+#include <unordered_map>
 
 using namespace std;
 
 #include <minizinc/solvers/MIP/MIP_solverinstance.hh>
+#include <minizinc/timer.hh>
 
 using namespace MiniZinc;
 
@@ -41,6 +44,26 @@ string MIP_SolverFactory::getVersion()
   return v;
 }
 
+bool MIP_SolverFactory::processOption(int& i, int argc, const char** argv)
+{
+  MiniZinc::CLOParser cop( i, argc, argv );
+  if ( cop.get( "--cuts-max", &cutPoolOptions.nMaxCuts ) ) {
+  } else if ( cop.get( "--cuts-min-viol", &cutPoolOptions.dMinViol ) ) {
+  } else
+    return MIP_WrapperFactory::processOption(i, argc, argv);
+  return true;
+}
+
+void MIP_SolverFactory::printHelp(ostream& os)
+{
+  MIP_WrapperFactory::printHelp(os);
+  os
+  << "--cuts-max <n>        add at most the <n> most violated cuts per separation round\n"
+     "      of the MiniZinc cut generators, default: all" << std::endl
+  << "--cuts-min-viol <x>   minimal violation of a generated cut, default: "
+     << CutPool::Options().dMinViol << std::endl;
+}
+
 
 MIP_solver::Variable MIP_solverinstance::exprToVar(Expression* arg) {
   if (Id* ident = arg->dyn_cast<Id>()) {
@@ -273,6 +296,21 @@ void MIP_solverinstance::printStatistics(ostream& os, bool fLegend)
 {
   auto nn = std::chrono::system_clock::now();
   auto n_c = std::chrono::system_clock::to_time_t( nn );
+  if ( cutGenerators.size() ) {
+    std::lock_guard<std::mutex> lock( cutStatsMutex );
+    std::ios oldState(nullptr);
+    oldState.copyfmt( os );
+    if (fLegend)
+      os << "  % cut rounds, candidates, duplicates, added, separation time (s): ";
+    else
+      os << "  % MIP cuts: ";
+    os << cutStats.nRounds << ",  " << cutStats.nCandidates << ",  "
+      << cutStats.nDuplicates << ",  " << cutStats.nAdded << ",  ";
+    os.setf( ios::fixed );
+    os.precision( 3 );
+    os << cutStats.dTimeMs/1000.0 << endl;
+    os.copyfmt( oldState );
+  }
     {
 //       int nPrec = 
       std::ios oldState(nullptr);
@@ -341,11 +379,28 @@ void HandleCutCallback(const MIP_wrapper::Output& out, MIP_wrapper::CutInput& in
 }
 
 
+bool MIP_solverinstance::getObjectiveValue(double& v) {
+  if ( SolveI::SolveType::ST_SAT == objType )
+    return false;
+  /// The callbacks set lastIncumbent before printing a solution
+  v = ( lastIncumbent < 1e200 ) ? lastIncumbent : getMIPWrapper()->getObjValue();
+  return true;
+}
+
+bool MIP_solverinstance::setObjective(SolveI::SolveType st, Id* obj) {
+  VarId j = exprToVar(obj);
+  getMIPWrapper()->setObjective(j);
+  objType = st;
+  dObjVarLB = getMIPWrapper()->colLB[j];
+  dObjVarUB = getMIPWrapper()->colUB[j];
+  if ( getMIPWrapper()->fVerbose )
+    cerr << "  MIP: objective variable index (0-based): " << j << endl;
+  return true;
+}
 
 SolverInstance::Status MIP_solverinstance::solve(void) {
-  SolveI* solveItem = getEnv()->flat()->solveItem();
-  if (solveItem->st() != SolveI::SolveType::ST_SAT) {
-    if (solveItem->st() == SolveI::SolveType::ST_MAX) {
+  if (objType != SolveI::SolveType::ST_SAT) {
+    if (objType == SolveI::SolveType::ST_MAX) {
       getMIPWrapper()->setObjSense(1);
       getMIPWrapper()->setProbType(1);
       if (mip_wrap->fVerbose)
@@ -386,7 +441,7 @@ SolverInstance::Status MIP_solverinstance::solve(void) {
   SolverInstance::Status s = SolverInstance::UNKNOWN;
   switch(sw) {
     case MIP_wrapper::Status::OPT:
-      if ( SolveI::SolveType::ST_SAT != getEnv()->flat()->solveItem()->st() ) {
+      if ( SolveI::SolveType::ST_SAT != objType ) {
         s = SolverInstance::OPT;
       } else {
         s = SolverInstance::SAT;    // For SAT problems, just say SAT unless we know it's complete
@@ -413,12 +468,77 @@ SolverInstance::Status MIP_solverinstance::solve(void) {
   return s;
 }
 
+void MIP_solverinstance::processVarDecl(VarDecl* vd, VarDecl* objVd) {
+  MiniZinc::TypeInst* ti = vd->ti();
+  MIP_wrapper::VarType vType = MIP_wrapper::VarType::REAL;     // fInt = false;
+  if (ti->type().isvarint() || ti->type().isint())
+    vType = MIP_wrapper::VarType::INT;
+  else if (ti->type().isvarbool() || ti->type().isbool()) {
+    vType = MIP_wrapper::VarType::BINARY;
+  } else if (ti->type().isvarfloat() || ti->type().isfloat()) {
+  } else {
+    std::stringstream ssm;
+    ssm << "This type of var is ! handled by MIP: " << *vd << ";" << std::endl;
+    ssm << "  VarDecl flags (ti, bt, st, ot): "
+      << ti->type().ti()
+      << ti->type().bt()
+      << ti->type().st()
+      << ti->type().ot()
+      << ", dim == " << ti->type().dim()
+      << endl;
+    throw InternalError(ssm.str());
+  }
+  double lb=0.0, ub=1.0;  // for bool
+  if (ti->domain()) {
+    if (MIP_wrapper::VarType::REAL == vType) {
+      FloatBounds fb = compute_float_bounds(getEnv()->envi(), vd->id());
+      assert(fb.valid);
+      lb = fb.l.toDouble();
+      ub = fb.u.toDouble();
+    } else if (MIP_wrapper::VarType::INT == vType) {
+      IntBounds ib = compute_int_bounds(getEnv()->envi(), vd->id());
+      assert(ib.valid);
+      lb = ib.l.toInt();
+      ub = ib.u.toInt();
+    } 
+  } else if (MIP_wrapper::VarType::BINARY != vType) {
+    lb = -getMIPWrapper()->getInfBound();  // if just 1 bound inf, using MZN's default?  TODO
+    ub = -lb;
+  }
+
+//       IntSetVal* dom = eval_intset(env,vdi->e()->ti()->domain());
+//       if (dom->size() > 1)
+//         throw runtime_error("MIP_solverinstance: domains with holes ! supported, use --MIPdomains");
+
+  VarId res;
+  Id* id = vd->id();
+  id = id->decl()->id();
+  if (vd->e()) {
+    res = exprToVar(vd->e());     // modify obj coef??     TODO
+  } else {
+    double obj = vd==objVd ? 1.0 : 0.0;
+    res = getMIPWrapper()->addVar(obj, lb, ub, vType, id->str().c_str());
+    if (vd==objVd) {
+      dObjVarLB = lb;
+      dObjVarUB = ub;
+      getMIPWrapper()->output.nObjVarIndex = res;
+      if ( getMIPWrapper()->fVerbose )
+        cerr << "  MIP: objective variable index (0-based): " << res << endl;
+    }
+  }
+//       if ("X_INTRODUCED_137" == string(id->str().c_str())) {
+//       }
+  _variableMap.insert(id, res);
+  assert( res == _variableMap.get(id) );
+}
+
 void MIP_solverinstance::processFlatZinc(void) {
   /// last-minute solver params
   mip_wrap->fVerbose = (getOptions().getBoolParam(constants().opts.verbose.str(), false));
 
   SolveI* solveItem = getEnv()->flat()->solveItem();
   VarDecl* objVd = NULL;
+  objType = solveItem->st();
 
   if (solveItem->st() != SolveI::SolveType::ST_SAT) {
     if(Id* id = solveItem->e()->dyn_cast<Id>()) {
@@ -446,67 +566,7 @@ void MIP_solverinstance::processFlatZinc(void) {
       }
     }
     if (vd->type().dim() == 0 && it->e()->type().isvar() && !it->removed()) {
-      MiniZinc::TypeInst* ti = it->e()->ti();
-      MIP_wrapper::VarType vType = MIP_wrapper::VarType::REAL;     // fInt = false;
-      if (ti->type().isvarint() || ti->type().isint())
-        vType = MIP_wrapper::VarType::INT;
-      else if (ti->type().isvarbool() || ti->type().isbool()) {
-        vType = MIP_wrapper::VarType::BINARY;
-      } else if (ti->type().isvarfloat() || ti->type().isfloat()) {
-      } else {
-        std::stringstream ssm;
-        ssm << "This type of var is ! handled by MIP: " << *it << std::endl;
-        ssm << "  VarDecl flags (ti, bt, st, ot): "
-          << ti->type().ti()
-          << ti->type().bt()
-          << ti->type().st()
-          << ti->type().ot()
-          << ", dim == " << ti->type().dim()
-          << endl;
-        throw InternalError(ssm.str());
-      }
-      double lb=0.0, ub=1.0;  // for bool
-      if (ti->domain()) {
-        if (MIP_wrapper::VarType::REAL == vType) {
-          FloatBounds fb = compute_float_bounds(getEnv()->envi(), it->e()->id());
-          assert(fb.valid);
-          lb = fb.l.toDouble();
-          ub = fb.u.toDouble();
-        } else if (MIP_wrapper::VarType::INT == vType) {
-          IntBounds ib = compute_int_bounds(getEnv()->envi(), it->e()->id());
-          assert(ib.valid);
-          lb = ib.l.toInt();
-          ub = ib.u.toInt();
-        } 
-      } else if (MIP_wrapper::VarType::BINARY != vType) {
-        lb = -getMIPWrapper()->getInfBound();  // if just 1 bound inf, using MZN's default?  TODO
-        ub = -lb;
-      }
-
-//       IntSetVal* dom = eval_intset(env,vdi->e()->ti()->domain());
-//       if (dom->size() > 1)
-//         throw runtime_error("MIP_solverinstance: domains with holes ! supported, use --MIPdomains");
-
-      VarId res;
-      Id* id = it->e()->id();
-      id = id->decl()->id();
-      if (it->e()->e()) {
-        res = exprToVar(it->e()->e());     // modify obj coef??     TODO
-      } else {
-        double obj = vd==objVd ? 1.0 : 0.0;
-        res = getMIPWrapper()->addVar(obj, lb, ub, vType, id->str().c_str());
-        if (vd==objVd) {
-          dObjVarLB = lb;
-          dObjVarUB = ub;
-          getMIPWrapper()->output.nObjVarIndex = res;
-          if ( getMIPWrapper()->fVerbose )
-            cerr << "  MIP: objective variable index (0-based): " << res << endl;
-        }
-      }
-//       if ("X_INTRODUCED_137" == string(id->str().c_str())) {
-//       }
-      _variableMap.insert(id, res);
-      assert( res == _variableMap.get(id) );
+      processVarDecl(vd, objVd);
     }
   }
   if (mip_wrap->fVerbose && mip_wrap->sLitValues.size())
@@ -534,8 +594,68 @@ void MIP_solverinstance::processFlatZinc(void) {
     cerr << "  MIP_solverinstance: overall,  "
       << mip_wrap->nLitVars << " literals with "
       << mip_wrap-> sLitValues.size() << " values used." << endl;
+  markRoot();
 }  // processFlatZinc
 
+void MIP_solverinstance::markRoot() {
+  nRootRows = getMIPWrapper()->getNRows();
+  nRootCols = getMIPWrapper()->colObj.size();
+  nRootCutGens = cutGenerators.size();
+  rootStatus = _status;
+}
+
+void MIP_solverinstance::resetSolver(void) {
+  getMIPWrapper()->restoreModel(nRootRows, nRootCols);
+  for (auto id : tempVars)
+    _variableMap.remove(id);
+  tempVars.clear();
+  resetOutputPlan();
+  if (cutGenerators.size() > nRootCutGens) {
+    cutGenerators.resize(nRootCutGens);
+    getMIPWrapper()->cbui.cutMask = 0;
+    for ( auto& pCG : cutGenerators )
+      getMIPWrapper()->cbui.cutMask |= pCG->getMask();
+  }
+  _status = rootStatus;
+  _status_reason = SolverInstance::SR_OK;
+}
+
+void MIP_solverinstance::processItems(Model::iterator begin, Model::iterator end,
+                                      vector<Id*>* vars) {
+  SolveI* solveItem = getEnv()->flat()->solveItem();
+  VarDecl* objVd = NULL;
+  if (solveItem->st() != SolveI::SolveType::ST_SAT)
+    objVd = solveItem->e()->cast<Id>()->decl();
+  for (Model::iterator it = begin; it != end; ++it) {
+    if ((*it)->removed())
+      continue;
+    if (VarDeclI* vdi = (*it)->dyn_cast<VarDeclI>()) {
+      VarDecl* vd = vdi->e();
+      if (vd->type().dim() == 0 && vd->type().isvar()) {
+        processVarDecl(vd, objVd);
+        if (vars)
+          vars->push_back(vd->id());
+      }
+    } else if (ConstraintI* ci = (*it)->dyn_cast<ConstraintI>()) {
+      if (Call* c = ci->e()->dyn_cast<Call>())
+        _constraintRegistry.post(c);
+    } else {
+      throw InternalError("MIP_solverinstance: only variables and constraints can be added to a solver instance");
+    }
+  }
+}
+
+void MIP_solverinstance::resetWithConstraints(Model::iterator begin, Model::iterator end) {
+  resetSolver();
+  processItems(begin, end, &tempVars);
+}
+
+void MIP_solverinstance::processPermanentConstraints(Model::iterator begin, Model::iterator end) {
+  resetSolver();
+  processItems(begin, end, NULL);
+  markRoot();
+}
+
 Expression* MIP_solverinstance::getSolutionValue(Id* id) {
   id = id->decl()->id();
 
@@ -555,11 +675,21 @@ Expression* MIP_solverinstance::getSolutionValue(Id* id) {
 
 void MIP_solverinstance::genCuts(const MIP_wrapper::Output& slvOut,
                                  MIP_wrapper::CutInput& cutsIn, bool fMIPSol) {
+  Timer timer;
+  CutPool pool;   // local: some solvers call back from several threads
   for ( auto& pCG : cutGenerators ) {
     if ( !fMIPSol || pCG->getMask()&MIP_wrapper::MaskConsType_Lazy )
-      pCG->generate( slvOut, cutsIn );
+      pCG->generate( slvOut, pool.cands );
   }
-  /// Select some most violated? TODO
+  CutPool::Statistics st;
+  pool.select( slvOut.x, slvOut.nCols, cutPoolOptions, cutsIn, st );
+  st.dTimeMs = timer.ms();
+  std::lock_guard<std::mutex> lock( cutStatsMutex );
+  cutStats.nRounds += st.nRounds;
+  cutStats.nCandidates += st.nCandidates;
+  cutStats.nDuplicates += st.nDuplicates;
+  cutStats.nAdded += st.nAdded;
+  cutStats.dTimeMs += st.dTimeMs;
 }
 
 void XBZCutGen::generate(const MIP_wrapper::Output& slvOut, MIP_wrapper::CutInput& cutsIn) {
@@ -567,6 +697,8 @@ void XBZCutGen::generate(const MIP_wrapper::Output& slvOut, MIP_wrapper::CutInpu
   const int n = varX.size();
   assert( n==varB.size() );
   MIP_wrapper::CutDef cut( MIP_wrapper::GQ, MIP_wrapper::MaskConsType_Usercut );
+  cut.rmatind.reserve( 2*n+1 );
+  cut.rmatval.reserve( 2*n+1 );
   cut.addVar( varZ, -1.0 );
   for ( int i=0; i<n; ++i ) {
     const int ix = varX[ i ];
@@ -586,19 +718,8 @@ void XBZCutGen::generate(const MIP_wrapper::Output& slvOut, MIP_wrapper::CutInpu
       cut.addVar( ib, UBXi );
     }
   }
-  double dViol = cut.computeViol( slvOut.x, slvOut.nCols );
-  if ( dViol > 0.01 ) {   // ?? PARAM?  TODO
-    cutsIn.push_back( cut );
-    cerr << " vi" << dViol << flush;
-//     cout << cut.rmatind.size() << ' '
-//       << cut.rhs << "  cutlen, rhs. (Sense fixed to GQ) " << endl;
-//     for ( int i=0; i<cut.rmatind.size(); ++i )
-//       cout << cut.rmatind[i] << ' ';
-//     cout << endl;
-//     for ( int i=0; i<cut.rmatind.size(); ++i )
-//       cout << cut.rmatval[i] << ' ';
-//     cout << endl;
-  }
+  /// The pool checks the violation
+  cutsIn.push_back( move( cut ) );
 }
 
 void XBZCutGen::print( ostream& os )
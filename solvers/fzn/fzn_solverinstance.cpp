@@ -35,12 +35,17 @@ const auto SolverInstance__ERROR = MiniZinc::SolverInstance::ERROR;  // before w
 #include <tchar.h>
 //#include <atlstr.h>
 #else
+#include <cerrno>
+#include <fcntl.h>
 #include <unistd.h>
 #include <sys/select.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 #endif
 #include <sys/types.h>
 #include <signal.h>
+#include <atomic>
+#include <chrono>
 #include <thread>
 #include <mutex>
 
@@ -55,6 +60,7 @@ namespace MiniZinc {
       return new FZNSolverInstance(env, _options);
     }
     string getVersion( );
+    string getId( ) { return "fzn"; }
     bool processOption(int& i, int argc, const char** argv);
     void printHelp(std::ostream& os);
   };
@@ -83,6 +89,9 @@ namespace MiniZinc {
     << "  -k, --keep-files\n     For compatibility only: to produce .ozn and .fzn, use mzn2fzn\n"
                            "     or <this_exe> --fzn ..., --ozn ...\n"
     << "  -r <n>, --seed <n>, --random-seed <n>\n     For compatibility only: use solver flags instead.\n"
+    << "  --fzn-pipe\n     Start the solver before the FlatZinc is written, and stream it to the solver's\n"
+       "     standard input (passing \"-\" as the model file) while the solver parses it.\n"
+    << "  --fzn-fifo\n     As above, but stream the FlatZinc through a named pipe passed as the model file.\n"
     ;
   }
 
@@ -114,6 +123,10 @@ namespace MiniZinc {
       _options.setBoolParam(constants().opts.solver.allSols.str(), true);
     } else if ( cop.getOption( "-p --parallel", &nn) ) {
       _options.setIntParam(constants().opts.solver.fzn_flag.str(), nn);
+    } else if ( cop.getOption( "--fzn-pipe" ) ) {
+      _options.setBoolParam( "fzn_pipe", true );
+    } else if ( cop.getOption( "--fzn-fifo" ) ) {
+      _options.setBoolParam( "fzn_fifo", true );
     } else if ( cop.getOption( "-k --keep-files" ) ) {
     } else if ( cop.getOption( "-r --seed --random-seed", &dd) ) {
     } else {
@@ -154,14 +167,83 @@ namespace MiniZinc {
     protected:
       vector<string> _fzncmd;
       bool _canPipe;
+      /// Whether to stream the model through a named pipe
+      bool _fifo;
       Model* _flat=0;
       Solns2Out* pS2Out=0;
     public:
-      FznProcess(vector<string>& fzncmd, bool pipe, Model* flat, Solns2Out* pso)
-        : _fzncmd(fzncmd), _canPipe(pipe), _flat(flat), pS2Out(pso) {
+      /// Latencies of a run, in milliseconds since run() was called
+      struct Timing {
+        /// The model has been written
+        double written = 0;
+        /// The solver has been started
+        double started = 0;
+        /// The solver printed its first output
+        double firstOutput = -1;
+        /// The solver terminated
+        double finished = 0;
+        /// Size of the FlatZinc
+        unsigned long long bytes = 0;
+      } timing;
+
+      FznProcess(vector<string>& fzncmd, bool pipe, bool fifo, Model* flat, Solns2Out* pso)
+        : _fzncmd(fzncmd), _canPipe(pipe), _fifo(fifo), _flat(flat), pS2Out(pso) {
         assert( 0!=_flat );
         assert( 0!=pS2Out );
       }
+#ifndef _WIN32
+      /// Write all of \a s to \a fd, return false if the reader has gone
+      static bool writeAll(int fd, const std::string& s) {
+        size_t done = 0;
+        while (done < s.size()) {
+          ssize_t n = write(fd, s.data()+done, s.size()-done);
+          if (n < 0) {
+            if (errno == EINTR)
+              continue;
+            return false;
+          }
+          done += n;
+        }
+        return true;
+      }
+      /// Stream the flat model to \a fd, or to the named pipe \a fifo if \a fd
+      /// is negative (giving up if \a fAbort is set before the solver opens it)
+      ///
+      /// Runs in a writer thread while the main thread reads the solver's
+      /// output. The plain printer does not allocate, and the main thread
+      /// holds a GCLock, so the flat model cannot change or be collected.
+      void writeModel(int fd, std::string fifo, std::atomic<bool>* fAbort, Timer* timer) {
+        if (fd < 0) {
+          while ((fd = open(fifo.c_str(), O_WRONLY | O_NONBLOCK)) < 0) {
+            if (errno != ENXIO || *fAbort)
+              return;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+          }
+          fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+        }
+        std::ostringstream oss;
+        Printer p(oss, 0);
+        bool ok = true;
+        for (Model::iterator it = _flat->begin(); ok && it != _flat->end(); ++it) {
+          if(!(*it)->removed()) {
+            p.print(*it);
+            if (oss.tellp() >= (1 << 16)) {
+              std::string str = oss.str();
+              timing.bytes += str.size();
+              ok = writeAll(fd, str);
+              oss.str("");
+            }
+          }
+        }
+        if (ok) {
+          std::string str = oss.str();
+          timing.bytes += str.size();
+          writeAll(fd, str);
+        }
+        close(fd);
+        timing.written = timer->ms();
+      }
+#endif
       std::string run(void) {
 #ifdef _WIN32
         std::stringstream result;
@@ -300,44 +382,60 @@ namespace MiniZinc {
         return result.str();
       }
 #else
+        Timer timer;
         int pipes[3][2];
         pipe(pipes[0]);
         pipe(pipes[1]);
         pipe(pipes[2]);
 
         std::string fznFile;
-        if (!_canPipe) {
+        std::string fznDir;
+        if (_fifo) {
+          char tmpdir[] = "/tmp/fznfifoXXXXXX";
+          if (mkdtemp(tmpdir) == NULL)
+            throw InternalError("FznProcess: could not create temporary directory");
+          fznDir = tmpdir;
+          fznFile = fznDir + "/model.fzn";
+          if (mkfifo(fznFile.c_str(), 0600) != 0)
+            throw InternalError("FznProcess: could not create named pipe " + fznFile);
+        } else if (!_canPipe) {
           char tmpfile[] = "/tmp/fznfileXXXXXX.fzn";
           mkstemps(tmpfile, 4);
           fznFile = tmpfile;
           std::ofstream os(tmpfile);
+          Printer p(os, 0);
           for (Model::iterator it = _flat->begin(); it != _flat->end(); ++it) {
             if(!(*it)->removed()) {
-              Item* item = *it;
-              os << *item;
+              p.print(*it);
             }
           }
+          timing.bytes = os.tellp();
+          timing.written = timer.ms();
         }
+        bool fStream = _canPipe || _fifo;
 
         // Make sure to reap child processes to avoid creating zombies
         signal(SIGCHLD, SIG_IGN);
+        // A solver exiting before reading the whole model must not kill us
+        if (fStream)
+          signal(SIGPIPE, SIG_IGN);
             
         if (int childPID = fork()) {
+          timing.started = timer.ms();
           close(pipes[0][0]);
           close(pipes[1][1]);
           close(pipes[2][1]);
-          if (_canPipe) {
-            for (Model::iterator it = _flat->begin(); it != _flat->end(); ++it) {
-              if(!(*it)->removed()) {
-                std::stringstream ss;
-                Item* item = *it;
-                ss << *item;
-                std::string str = ss.str();
-                write(pipes[0][1], str.c_str(), str.size());
-              }
-            }
+          // The model is written while the solver parses it
+          std::atomic<bool> fAbort(false);
+          std::thread writer;
+          if (fStream) {
+            writer = std::thread(&FznProcess::writeModel, this, _canPipe ? pipes[0][1] : -1,
+                                 fznFile, &fAbort, &timer);
+            if (!_canPipe)
+              close(pipes[0][1]);
+          } else {
+            close(pipes[0][1]);
           }
-          close(pipes[0][1]);
           std::stringstream result;
 
           fd_set fdset;
@@ -361,6 +459,8 @@ namespace MiniZinc {
                   if (count > 0) {
                     buffer[count] = 0;
                     if ( 1==i ) {
+                      if ( timing.firstOutput < 0 )
+                        timing.firstOutput = timer.ms();
 //                       cerr << "mzn-fzn: raw chunk stdout:::  " << flush;
 //                       cerr << buffer << flush;
                       pS2Out->feedRawDataChunk( buffer );
@@ -377,7 +477,17 @@ namespace MiniZinc {
             }
           }
 
-          if (!_canPipe) {
+          timing.finished = timer.ms();
+          if (fStream) {
+            fAbort = true;
+            writer.join();
+          }
+          close(pipes[1][0]);
+          close(pipes[2][0]);
+          if (_fifo) {
+            remove(fznFile.c_str());
+            rmdir(fznDir.c_str());
+          } else if (!_canPipe) {
             //remove(fznFile.c_str());
           }
           return result.str();
@@ -497,8 +607,24 @@ namespace MiniZinc {
       cerr << std::endl;
     }
     
-    FznProcess proc(cmd_line, false, _fzn, getSolns2Out());
+    bool fPipe = _options.getBoolParam("fzn_pipe", false);
+    bool fFifo = !fPipe && _options.getBoolParam("fzn_fifo", false);
+    FznProcess proc(cmd_line, fPipe, fFifo, _fzn, getSolns2Out());
     proc.run();
+    if (_options.getBoolParam(constants().opts.statistics.str(), false)) {
+      const FznProcess::Timing& t = proc.timing;
+      std::cerr << "%%  fzn model:        " << t.bytes << " bytes, "
+                << (fPipe ? "streamed to stdin" : fFifo ? "streamed to named pipe" : "written to file")
+                << std::endl
+                << "%%  fzn written:      " << t.written << " ms" << std::endl
+                << "%%  fzn started:      " << t.started << " ms" << std::endl
+                << "%%  fzn first output: ";
+      if (t.firstOutput >= 0)
+        std::cerr << t.firstOutput << " ms" << std::endl;
+      else
+        std::cerr << "none" << std::endl;
+      std::cerr << "%%  fzn finished:     " << t.finished << " ms" << std::endl;
+    }
 
 //     std::stringstream result;
 //     result << r;
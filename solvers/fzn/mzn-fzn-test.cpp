@@ -30,6 +30,7 @@
 #include <minizinc/astexception.hh>
 
 #include <minizinc/flatten.hh>
+#include <minizinc/flatten_internal.hh>
 #include <minizinc/optimize.hh>
 #include <minizinc/builtins.hh>
 #include <minizinc/file_utils.hh>
@@ -138,7 +139,7 @@ int main(int argc, char** argv) {
               if (flag_verbose)
                 std::cerr << " done (" << stoptime(lasttime) << ")" << std::endl;
             } else {
-              env.flat()->compact();
+              env.envi().flat_compact(true);
             }
             
             if (!opts->getBoolParam(constants().opts.noOznOutput.str())) {
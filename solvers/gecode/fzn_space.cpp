@@ -12,6 +12,8 @@
 #include <minizinc/solvers/gecode/fzn_space.hh>
 #include <minizinc/solvers/gecode_solverinstance.hh>
 
+#include <cmath>
+
 using namespace Gecode;
 
 namespace MiniZinc {
@@ -93,6 +95,7 @@ namespace MiniZinc {
     _optVarIdx = f._optVarIdx;
     _copyAuxVars = f._copyAuxVars;
     _solveType = f._solveType;
+    _sharedBound = f._sharedBound;
   }
 
 
@@ -121,6 +124,23 @@ namespace MiniZinc {
               static_cast<const FznSpace*>(&s)->fv[_optVarIdx].val());
 #endif
       }
+      // Solutions of other solvers racing on the same model
+      double b;
+      if (_sharedBound && _sharedBound->get(b)) {
+        if (_optVarIsInt) {
+          if (_solveType == MiniZinc::SolveI::SolveType::ST_MIN && b <= Gecode::Int::Limits::max)
+            rel(*this, iv[_optVarIdx], IRT_LE, static_cast<int>(std::ceil(b)));
+          else if (_solveType == MiniZinc::SolveI::SolveType::ST_MAX && b >= Gecode::Int::Limits::min)
+            rel(*this, iv[_optVarIdx], IRT_GR, static_cast<int>(std::floor(b)));
+        } else {
+#ifdef GECODE_HAS_FLOAT_VARS
+          if (_solveType == MiniZinc::SolveI::SolveType::ST_MIN)
+            rel(*this, fv[_optVarIdx], FRT_LE, b);
+          else if (_solveType == MiniZinc::SolveI::SolveType::ST_MAX)
+            rel(*this, fv[_optVarIdx], FRT_GR, b);
+#endif
+        }
+      }
     }
 
 }
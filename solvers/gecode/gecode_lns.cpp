@@ -0,0 +1,256 @@
+/* -*- mode: C++; c-basic-offset: 2; indent-tabs-mode: nil -*- */
+
+/*
+ *  Main authors:
+ *     agent <agent@local>
+ */
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <minizinc/solvers/gecode/gecode_lns.hh>
+#include <minizinc/timer.hh>
+
+#include <gecode/int.hh>
+#include <gecode/driver.hh>
+#ifdef GECODE_HAS_FLOAT_VARS
+#include <gecode/float.hh>
+#endif
+
+#include <cmath>
+#include <thread>
+
+using namespace Gecode;
+
+namespace MiniZinc {
+
+  GecodeLNS::Options::Options(void)
+    : percentage(80), failLimit(100), restart(RS_LUBY), restartBase(1.5),
+      iterations(0), threads(1), seed(1), time(0), nodes(0), stats(false) {}
+
+  bool
+  GecodeLNS::parseRestart(const std::string& s, RestartStrategy& r) {
+    if (s=="constant")
+      r = RS_CONSTANT;
+    else if (s=="linear")
+      r = RS_LINEAR;
+    else if (s=="luby")
+      r = RS_LUBY;
+    else if (s=="geometric")
+      r = RS_GEOMETRIC;
+    else
+      return false;
+    return true;
+  }
+
+  namespace {
+
+    /// Element \a i (starting at 1) of the Luby sequence 1,1,2,1,1,2,4,...
+    unsigned long long luby(unsigned long long i) {
+      for (;;) {
+        unsigned long long k = 1;
+        while ((1ULL << k)-1 < i)
+          k++;
+        if ((1ULL << k)-1 == i)
+          return 1ULL << (k-1);
+        i -= (1ULL << (k-1))-1;
+      }
+    }
+
+    /// Deterministic pseudo-random numbers, one generator per neighbourhood
+    class LnsRnd {
+      unsigned long long _seed;
+    public:
+      LnsRnd(unsigned long long seed) : _seed(seed) {}
+      unsigned int operator ()(unsigned int n) {
+        _seed = (_seed * 6364136223846793005ULL + 1442695040888963407ULL);
+        return static_cast<unsigned int>((_seed >> 33) % n);
+      }
+    };
+
+    /// Objective value of solution \a s
+    double objective(FznSpace* s) {
+      if (s->_optVarIsInt)
+        return s->iv[s->_optVarIdx].val();
+#ifdef GECODE_HAS_FLOAT_VARS
+      return s->fv[s->_optVarIdx].val().med();
+#else
+      return 0.0;
+#endif
+    }
+
+    /// Whether solution \a a is better than \a b
+    bool better(FznSpace* a, FznSpace* b) {
+      if (b==NULL)
+        return true;
+      if (a->_solveType == MiniZinc::SolveI::SolveType::ST_MIN)
+        return objective(a) < objective(b);
+      return objective(a) > objective(b);
+    }
+
+    /// One neighbourhood of an iteration
+    struct Neighbourhood {
+      /// Space to search (owned by the engine once started)
+      FznSpace* space;
+      /// Number of variables fixed
+      unsigned int fixed;
+      /// Best solution found (or NULL)
+      FznSpace* best;
+      /// Statistics of the search
+      Search::Statistics stat;
+      /// Whether a limit stopped the search
+      bool stopped;
+      /// Failure limit
+      unsigned int fails;
+      /// Time limit in milliseconds (0 for no limit)
+      unsigned int time;
+    };
+
+    /// Run branch and bound on neighbourhood \a nb
+    void explore(Neighbourhood* nb) {
+      Search::Options so;
+      so.clone = false;
+      so.stop = Driver::CombinedStop::create(0, nb->fails, nb->time, false);
+      {
+        BAB<FznSpace> e(nb->space, so);
+        while (FznSpace* sol = e.next()) {
+          delete nb->best;
+          nb->best = sol;
+        }
+        nb->stat = e.statistics();
+        nb->stopped = e.stopped();
+      }
+      delete so.stop;
+    }
+
+  }
+
+  GecodeLNS::GecodeLNS(FznSpace* root, const std::vector<int>& iv,
+                       const std::vector<int>& bv, const Options& o)
+    : _root(root), _iv(iv), _bv(bv), _o(o), _iterations(0), _improvements(0) {
+    if (_o.threads==0)
+      _o.threads = 1;
+    if (_o.failLimit==0)
+      _o.failLimit = 1;
+  }
+
+  unsigned int
+  GecodeLNS::failLimit(unsigned int i) const {
+    double l = _o.failLimit;
+    switch (_o.restart) {
+      case RS_CONSTANT:
+        break;
+      case RS_LINEAR:
+        l *= i+1;
+        break;
+      case RS_LUBY:
+        l *= static_cast<double>(luby(i+1));
+        break;
+      case RS_GEOMETRIC:
+        l *= std::pow(_o.restartBase, static_cast<double>(i));
+        break;
+    }
+    return l > 4e9 ? 4000000000U : static_cast<unsigned int>(l);
+  }
+
+  FznSpace*
+  GecodeLNS::run(FznSpace* incumbent, bool& optimal, std::ostream& err) {
+    optimal = false;
+    Timer timer;
+    unsigned int nVars = static_cast<unsigned int>(_iv.size()+_bv.size());
+    for (unsigned int it=0; _o.iterations==0 || it < _o.iterations; it++) {
+      double elapsed = timer.ms();
+      if (_o.time > 0 && elapsed >= _o.time)
+        break;
+      if (_o.nodes > 0 && _stat.node >= _o.nodes)
+        break;
+      unsigned int fails = failLimit(it);
+
+      // Create the neighbourhoods in this thread, as copying modifies the root
+      std::vector<Neighbourhood> nbs(_o.threads);
+      for (unsigned int k=0; k<nbs.size(); k++) {
+        Neighbourhood& nb = nbs[k];
+        LnsRnd rnd(static_cast<unsigned long long>(_o.seed)*7919ULL + it*nbs.size() + k);
+#if GECODE_VERSION_NUMBER < 600000
+        // Threads must not share data structures between spaces
+        nb.space = static_cast<FznSpace*>(_root->clone(_o.threads==1));
+#else
+        // Since Gecode 6, clones never share data structures
+        nb.space = static_cast<FznSpace*>(_root->clone());
+#endif
+        nb.fixed = 0;
+        nb.best = NULL;
+        nb.stopped = false;
+        nb.fails = fails;
+        nb.time = _o.time > 0 ? static_cast<unsigned int>(_o.time-elapsed) : 0;
+        for (unsigned int i=0; i<_iv.size(); i++) {
+          IntVar& x = incumbent->iv[_iv[i]];
+          if (x.assigned() && rnd(100) < _o.percentage) {
+            rel(*nb.space, nb.space->iv[_iv[i]], IRT_EQ, x.val());
+            nb.fixed++;
+          }
+        }
+        for (unsigned int i=0; i<_bv.size(); i++) {
+          BoolVar& x = incumbent->bv[_bv[i]];
+          if (x.assigned() && rnd(100) < _o.percentage) {
+            rel(*nb.space, nb.space->bv[_bv[i]], IRT_EQ, x.val());
+            nb.fixed++;
+          }
+        }
+        static_cast<Space*>(nb.space)->constrain(*incumbent);
+      }
+
+      if (nbs.size()==1) {
+        explore(&nbs[0]);
+      } else {
+        std::vector<std::thread> workers;
+        for (unsigned int k=0; k<nbs.size(); k++)
+          workers.push_back(std::thread(explore, &nbs[k]));
+        for (unsigned int k=0; k<workers.size(); k++)
+          workers[k].join();
+      }
+
+      FznSpace* best = NULL;
+      unsigned long long nodes = 0;
+      unsigned long long failures = 0;
+      for (unsigned int k=0; k<nbs.size(); k++) {
+        Neighbourhood& nb = nbs[k];
+        _stat += nb.stat;
+        nodes += nb.stat.node;
+        failures += nb.stat.fail;
+        if (nb.best && better(nb.best, best)) {
+          delete best;
+          best = nb.best;
+        } else {
+          delete nb.best;
+        }
+        // Exhausting a neighbourhood without fixed variables proves optimality
+        if (nb.fixed==0 && !nb.stopped)
+          optimal = true;
+      }
+      _iterations++;
+      if (best) {
+        delete incumbent;
+        incumbent = best;
+        _improvements++;
+      }
+      if (_o.stats) {
+        unsigned int fixed = 0;
+        for (unsigned int k=0; k<nbs.size(); k++)
+          fixed += nbs[k].fixed;
+        err << "%%  lns iteration " << it+1
+            << ": fail limit " << fails
+            << ", fixed " << fixed/nbs.size() << "/" << nVars
+            << ", nodes " << nodes << ", failures " << failures
+            << ", objective " << objective(incumbent)
+            << (best ? " (improved)" : "")
+            << ", time " << timer.ms() << " ms" << std::endl;
+      }
+      if (optimal)
+        break;
+    }
+    return incumbent;
+  }
+
+}
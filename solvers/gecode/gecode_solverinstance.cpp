@@ -12,9 +12,11 @@
 #include <minizinc/exception.hh>
 #include <minizinc/ast.hh>
 #include <minizinc/eval_par.hh>
+#include <minizinc/timer.hh>
 
 #include <minizinc/solvers/gecode_solverinstance.hh>
 #include <minizinc/solvers/gecode/gecode_constraints.hh>
+#include <minizinc/solvers/gecode/gecode_lns.hh>
 #include "aux_brancher.hh"
 #include <minizinc/solvers/gecode/fzn_space.hh>
 
@@ -30,6 +32,7 @@ namespace MiniZinc {
       return new GecodeSolverInstance(env, _options);
     }
     string getVersion( );
+    string getId( ) { return "gecode"; }
     bool processOption(int& i, int argc, const char** argv);
     void printHelp(std::ostream& os);
   };
@@ -72,6 +75,43 @@ namespace MiniZinc {
       int time = atoi(argv[i]);
       if(time >= 0)
         _options.setIntParam(std::string("time"), time);
+    } else if (string(argv[i])=="--intermediate") {
+      _options.setBoolParam(std::string("intermediate"), true);
+    } else if (string(argv[i])=="--lns") {
+      _options.setBoolParam(std::string("lns"), true);
+    } else if (string(argv[i])=="--lns-fix") {
+      if (++i==argc) return false;
+      int p = atoi(argv[i]);
+      if(p >= 0 && p <= 100)
+        _options.setIntParam(std::string("lns_fix"), p);
+    } else if (string(argv[i])=="--lns-fail") {
+      if (++i==argc) return false;
+      int fails = atoi(argv[i]);
+      if(fails > 0)
+        _options.setIntParam(std::string("lns_fail"), fails);
+    } else if (string(argv[i])=="--lns-restart") {
+      if (++i==argc) return false;
+      GecodeLNS::RestartStrategy r;
+      if (!GecodeLNS::parseRestart(argv[i], r))
+        return false;
+      _options.setStringParam(std::string("lns_restart"), argv[i]);
+    } else if (string(argv[i])=="--lns-restart-base") {
+      if (++i==argc) return false;
+      double base = atof(argv[i]);
+      if(base >= 1.0)
+        _options.setFloatParam(std::string("lns_restart_base"), base);
+    } else if (string(argv[i])=="--lns-iterations") {
+      if (++i==argc) return false;
+      int iterations = atoi(argv[i]);
+      if(iterations >= 0)
+        _options.setIntParam(std::string("lns_iterations"), iterations);
+    } else if (string(argv[i])=="--lns-threads") {
+      if (++i==argc) return false;
+      int threads = atoi(argv[i]);
+      if(threads > 0)
+        _options.setIntParam(std::string("lns_threads"), threads);
+    } else if (string(argv[i])=="--lns-stats") {
+      _options.setBoolParam(std::string("lns_stats"), true);
     }
     return true;
   }
@@ -94,6 +134,28 @@ namespace MiniZinc {
     << "    failure cutoff (0 = none, solution mode)" << std::endl
     << "  --time <ms>" << std::endl
     << "    time (in ms) cutoff (0 = none, solution mode)" << std::endl
+    << "  --intermediate" << std::endl
+    << "    print the improving solutions of optimisation problems" << std::endl
+    << "  --lns" << std::endl
+    << "    large neighbourhood search for optimisation problems, on the variables of" << std::endl
+    << "    a relax_and_reconstruct annotation, or else of the search annotations," << std::endl
+    << "    or else all non-introduced variables" << std::endl
+    << "  --lns-fix <p>" << std::endl
+    << "    probability (in percent) of fixing a variable, default 80 or given by" << std::endl
+    << "    relax_and_reconstruct" << std::endl
+    << "  --lns-fail <n>" << std::endl
+    << "    failure limit of the first iteration (default 100)" << std::endl
+    << "  --lns-restart <s>" << std::endl
+    << "    failure limits of later iterations: constant, linear, luby (default)" << std::endl
+    << "    or geometric" << std::endl
+    << "  --lns-restart-base <b>" << std::endl
+    << "    factor of the geometric restart strategy (default 1.5)" << std::endl
+    << "  --lns-iterations <n>" << std::endl
+    << "    maximum number of iterations (0 = none, default 1000 without --time/--node)" << std::endl
+    << "  --lns-threads <n>" << std::endl
+    << "    neighbourhoods explored in parallel in each iteration (default 1)" << std::endl
+    << "  --lns-stats" << std::endl
+    << "    print statistics of each iteration" << std::endl
     << std::endl;
   }
 
@@ -118,13 +180,14 @@ namespace MiniZinc {
 
      GecodeSolverInstance::GecodeSolverInstance(Env& env, const Options& options)
        : SolverInstanceImpl<GecodeSolver>(env,options), _current_space(NULL),
-       _solution(NULL), engine(NULL) {
+       _root_space(NULL), _solution(NULL), _objective(NULL), engine(NULL) {
        registerConstraints();
        _flat = env.flat();
      }
 
     GecodeSolverInstance::~GecodeSolverInstance(void) {
       delete engine;
+      delete _root_space;
       //delete _current_space;
       // delete _solution; // TODO: is this necessary?
     }
@@ -349,6 +412,143 @@ namespace MiniZinc {
     return bo >= Gecode::Int::Limits::min && bo <= Gecode::Int::Limits::max;
   }
 
+  void GecodeSolverInstance::processVarDecl(VarDecl* vd) {
+    // check if it has an output-annotation
+    if(!vd->ann().isEmpty()) {
+      if(vd->ann().containsCall(constants().ann.output_array.aststr()) ||
+          vd->ann().contains(constants().ann.output_var)
+        ) {
+        _varsWithOutput.push_back(vd);
+      }
+    }
+
+    if (vd->type().dim() != 0) {
+      // we ignore arrays - all their elements are defined
+      return;
+    }
+    MiniZinc::TypeInst* ti = vd->ti();
+    bool isDefined, isIntroduced = false;
+
+    if(vd->type().isint()) {
+      if(!vd->e()) { // if there is no initialisation expression
+        Expression* domain = ti->domain();
+        if(domain) {
+          IntVar intVar(*this->_current_space, arg2intset(_env.envi(), domain));
+          _current_space->iv.push_back(intVar);
+          insertVar(vd->id(), GecodeVariable(GecodeVariable::INT_TYPE, _current_space->iv.size()-1));
+        } else {
+          std::stringstream ssm;
+          ssm << "GecodeSolverInstance::processFlatZinc: Error: Unbounded Variable: " << *vd << std::endl;
+          throw InternalError(ssm.str());
+        }
+      } else { // there is an initialisation expression
+        Expression* init = vd->e();
+        if (init->isa<Id>() || init->isa<ArrayAccess>()) {
+          // root->iv[root->intVarCount++] = root->iv[*(int*)resolveVar(init)];
+          GecodeVariable var = resolveVar(init);
+          assert(var.isint());
+          _current_space->iv.push_back(var.intVar(_current_space));
+          insertVar(vd->id(), var);
+        } else {
+          double il = init->cast<IntLit>()->v().toInt();
+          if(valueWithinBounds(il)) {
+            IntVar intVar(*this->_current_space, il, il);
+            _current_space->iv.push_back(intVar);
+            insertVar(vd->id(), GecodeVariable(GecodeVariable::INT_TYPE,
+                  _current_space->iv.size()-1));
+          } else {
+            std::stringstream ssm;
+            ssm << "GecodeSolverInstance::processFlatZinc: Error: Unsafe value for Gecode: " << il << std::endl;
+            throw InternalError(ssm.str());
+          }
+        }
+      }
+      isIntroduced = vd->introduced() || (MiniZinc::getAnnotation(vd->ann(), constants().ann.is_introduced.str()) != NULL);
+      _current_space->iv_introduced.push_back(isIntroduced);
+      isDefined = MiniZinc::getAnnotation(vd->ann(), constants().ann.is_defined_var->str().str()) != NULL;
+      _current_space->iv_defined.push_back(isDefined);
+
+    } else if(vd->type().isbool()) {
+      double lb=0, ub=1;
+      if(!vd->e()) { // there is NO initialisation expression
+        Expression* domain = ti->domain();
+        if(domain) {
+          IntBounds ib = compute_int_bounds(_env.envi(), domain);
+          lb = ib.l.toInt();
+          ub = ib.u.toInt();
+        } else {
+          lb = 0;
+          ub = 1;
+        }
+        BoolVar boolVar(*this->_current_space, lb, ub);
+        _current_space->bv.push_back(boolVar);
+        insertVar(vd->id(), GecodeVariable(GecodeVariable::BOOL_TYPE,
+              _current_space->bv.size()-1));
+      } else { // there is an initialisation expression
+        Expression* init = vd->e();
+        if (init->isa<Id>() || init->isa<ArrayAccess>()) {
+          // root->bv[root->boolVarCount++] = root->bv[*(int*)resolveVar(init)];
+          //int index = *(int*) resolveVar(init);
+          GecodeVariable var = resolveVar(init);
+          assert(var.isbool());
+          _current_space->bv.push_back(var.boolVar(_current_space));
+          insertVar(vd->id(), var);
+        } else {
+          double b = (double) init->cast<BoolLit>()->v();
+          BoolVar boolVar(*this->_current_space, b, b);
+          _current_space->bv.push_back(boolVar);
+          insertVar(vd->id(), GecodeVariable(GecodeVariable::BOOL_TYPE,
+                _current_space->bv.size()-1));
+        }
+      }
+      isIntroduced = vd->introduced() || (MiniZinc::getAnnotation(vd->ann(), constants().ann.is_introduced.str()) != NULL);
+      _current_space->bv_introduced.push_back(isIntroduced);
+      isDefined = MiniZinc::getAnnotation(vd->ann(), constants().ann.is_defined_var->str().str()) != NULL;
+      _current_space->bv_defined.push_back(isDefined);
+    } else if(vd->type().isfloat()) {
+      if(vd->e() == NULL) { // there is NO initialisation expression
+        Expression* domain = ti->domain();
+        double lb, ub;
+        if (domain) {
+          FloatBounds fb = compute_float_bounds(_env.envi(), vd->id());
+          lb = fb.l.toDouble();
+          ub = fb.u.toDouble();
+        } else {
+          std::stringstream ssm;
+          ssm << "GecodeSolverInstance::processFlatZinc: Error: Unbounded Variable: " << *vd << std::endl;
+          throw InternalError(ssm.str());
+        }
+        FloatVar floatVar(*this->_current_space, lb, ub);
+        _current_space->fv.push_back(floatVar);
+        insertVar(vd->id(), GecodeVariable(GecodeVariable::FLOAT_TYPE,
+              _current_space->fv.size()-1));
+      } else {
+        Expression* init = vd->e();
+        if (init->isa<Id>() || init->isa<ArrayAccess>()) {
+          // root->fv[root->floatVarCount++] = root->fv[*(int*)resolveVar(init)];
+          GecodeVariable var = resolveVar(init);
+          assert(var.isfloat());
+          _current_space->fv.push_back(var.floatVar(_current_space));
+          insertVar(vd->id(), var);
+        } else {
+          double il = init->cast<FloatLit>()->v().toDouble();
+          FloatVar floatVar(*this->_current_space, il, il);
+          _current_space->fv.push_back(floatVar);
+          insertVar(vd->id(), GecodeVariable(GecodeVariable::FLOAT_TYPE,
+                _current_space->fv.size()-1));
+        }
+      }
+      isIntroduced = vd->introduced() || (MiniZinc::getAnnotation(vd->ann(), constants().ann.is_introduced.str()) != NULL);
+      _current_space->fv_introduced.push_back(isIntroduced);
+      isDefined = MiniZinc::getAnnotation(vd->ann(), constants().ann.is_defined_var->str().str()) != NULL;
+      _current_space->fv_defined.push_back(isDefined);
+    } else {
+      std::stringstream ssm;
+      ssm << "Type " << *ti << " is currently not supported by Gecode." << std::endl;
+      throw InternalError(ssm.str());
+    }
+  }
+
   void GecodeSolverInstance::processFlatZinc(void) {
     _only_range_domains = _options.getBoolParam(std::string("only-range-domains"), false);
     _run_sac = _options.getBoolParam(std::string("sac"), false);
@@ -360,143 +560,9 @@ namespace MiniZinc {
     // iterate over VarDecls of the flat model and create variables
     for (VarDeclIterator it = _flat->begin_vardecls(); it != _flat->end_vardecls(); ++it) {
       if (!it->removed() && it->e()->type().isvar()) {
-        // check if it has an output-annotation
-        VarDecl* vd = it->e();
-        if(!vd->ann().isEmpty()) {
-          if(vd->ann().containsCall(constants().ann.output_array.aststr()) ||
-              vd->ann().contains(constants().ann.output_var)
-            ) {
-            _varsWithOutput.push_back(vd);
-          }
-        }
-
-        if (it->e()->type().dim() != 0) {
-          // we ignore arrays - all their elements are defined
-          continue;
-        }
-        MiniZinc::TypeInst* ti = it->e()->ti();
-        bool isDefined, isIntroduced = false;
-
-        if(vd->type().isint()) {
-          if(!it->e()->e()) { // if there is no initialisation expression
-            Expression* domain = ti->domain();
-            if(domain) {
-              IntVar intVar(*this->_current_space, arg2intset(_env.envi(), domain));
-              _current_space->iv.push_back(intVar);
-              insertVar(it->e()->id(), GecodeVariable(GecodeVariable::INT_TYPE, _current_space->iv.size()-1));
-            } else {
-              std::stringstream ssm;
-              ssm << "GecodeSolverInstance::processFlatZinc: Error: Unbounded Variable: " << *vd << std::endl;
-              throw InternalError(ssm.str());
-            }
-          } else { // there is an initialisation expression
-            Expression* init = it->e()->e();
-            if (init->isa<Id>() || init->isa<ArrayAccess>()) {
-              // root->iv[root->intVarCount++] = root->iv[*(int*)resolveVar(init)];
-              GecodeVariable var = resolveVar(init);
-              assert(var.isint());
-              _current_space->iv.push_back(var.intVar(_current_space));
-              insertVar(it->e()->id(), var);
-            } else {
-              double il = init->cast<IntLit>()->v().toInt();
-              if(valueWithinBounds(il)) {
-                IntVar intVar(*this->_current_space, il, il);
-                _current_space->iv.push_back(intVar);
-                insertVar(it->e()->id(), GecodeVariable(GecodeVariable::INT_TYPE,
-                      _current_space->iv.size()-1));
-              } else {
-                std::stringstream ssm;
-                ssm << "GecodeSolverInstance::processFlatZinc: Error: Unsafe value for Gecode: " << il << std::endl;
-                throw InternalError(ssm.str());
-              }
-            }
-          }
-          isIntroduced = it->e()->introduced() || (MiniZinc::getAnnotation(it->e()->ann(), constants().ann.is_introduced.str()) != NULL);
-          _current_space->iv_introduced.push_back(isIntroduced);
-          isDefined = MiniZinc::getAnnotation(it->e()->ann(), constants().ann.is_defined_var->str().str()) != NULL;
-          _current_space->iv_defined.push_back(isDefined);
-
-        } else if(vd->type().isbool()) {
-          double lb=0, ub=1;
-          if(!it->e()->e()) { // there is NO initialisation expression
-            Expression* domain = ti->domain();
-            if(domain) {
-              IntBounds ib = compute_int_bounds(_env.envi(), domain);
-              lb = ib.l.toInt();
-              ub = ib.u.toInt();
-            } else {
-              lb = 0;
-              ub = 1;
-            }
-            BoolVar boolVar(*this->_current_space, lb, ub);
-            _current_space->bv.push_back(boolVar);
-            insertVar(it->e()->id(), GecodeVariable(GecodeVariable::BOOL_TYPE,
-                  _current_space->bv.size()-1));
-          } else { // there is an initialisation expression
-            Expression* init = it->e()->e();
-            if (init->isa<Id>() || init->isa<ArrayAccess>()) {
-              // root->bv[root->boolVarCount++] = root->bv[*(int*)resolveVar(init)];
-              //int index = *(int*) resolveVar(init);
-              GecodeVariable var = resolveVar(init);
-              assert(var.isbool());
-              _current_space->bv.push_back(var.boolVar(_current_space));
-              insertVar(it->e()->id(), var);
-            } else {
-              double b = (double) init->cast<BoolLit>()->v();
-              BoolVar boolVar(*this->_current_space, b, b);
-              _current_space->bv.push_back(boolVar);
-              insertVar(it->e()->id(), GecodeVariable(GecodeVariable::BOOL_TYPE,
-                    _current_space->bv.size()-1));
-            }
-          }
-          isIntroduced = it->e()->introduced() || (MiniZinc::getAnnotation(it->e()->ann(), constants().ann.is_introduced.str()) != NULL);
-          _current_space->bv_introduced.push_back(isIntroduced);
-          isDefined = MiniZinc::getAnnotation(it->e()->ann(), constants().ann.is_defined_var->str().str()) != NULL;
-          _current_space->bv_defined.push_back(isDefined);
-        } else if(vd->type().isfloat()) {
-          if(it->e()->e() == NULL) { // there is NO initialisation expression
-            Expression* domain = ti->domain();
-            double lb, ub;
-            if (domain) {
-              FloatBounds fb = compute_float_bounds(_env.envi(), vd->id());
-              lb = fb.l.toDouble();
-              ub = fb.u.toDouble();
-            } else {
-              std::stringstream ssm;
-              ssm << "GecodeSolverInstance::processFlatZinc: Error: Unbounded Variable: " << *vd << std::endl;
-              throw InternalError(ssm.str());
-            }
-            FloatVar floatVar(*this->_current_space, lb, ub);
-            _current_space->fv.push_back(floatVar);
-            insertVar(it->e()->id(), GecodeVariable(GecodeVariable::FLOAT_TYPE,
-                  _current_space->fv.size()-1));
-          } else {
-            Expression* init = it->e()->e();
-            if (init->isa<Id>() || init->isa<ArrayAccess>()) {
-              // root->fv[root->floatVarCount++] = root->fv[*(int*)resolveVar(init)];
-              GecodeVariable var = resolveVar(init);
-              assert(var.isfloat());
-              _current_space->fv.push_back(var.floatVar(_current_space));
-              insertVar(it->e()->id(), var);
-            } else {
-              double il = init->cast<FloatLit>()->v().toDouble();
-              FloatVar floatVar(*this->_current_space, il, il);
-              _current_space->fv.push_back(floatVar);
-              insertVar(it->e()->id(), GecodeVariable(GecodeVariable::FLOAT_TYPE,
-                    _current_space->fv.size()-1));
-            }
-          }
-          isIntroduced = it->e()->introduced() || (MiniZinc::getAnnotation(it->e()->ann(), constants().ann.is_introduced.str()) != NULL);
-          _current_space->fv_introduced.push_back(isIntroduced);
-          isDefined = MiniZinc::getAnnotation(it->e()->ann(), constants().ann.is_defined_var->str().str()) != NULL;
-          _current_space->fv_defined.push_back(isDefined);
-        } else {
-          std::stringstream ssm;
-          ssm << "Type " << *ti << " is currently not supported by Gecode." << std::endl;
-          throw InternalError(ssm.str());
-        }
-      } // end if it is a variable
-    } // end for all var decls
+        processVarDecl(it->e());
+      }
+    }
 
     // post the constraints
     for (ConstraintIterator it = _flat->begin_constraints(); it != _flat->end_constraints(); ++it) {
@@ -510,6 +576,7 @@ namespace MiniZinc {
     // objective
     SolveI* si = _flat->solveItem();
     _current_space->_solveType = si->st();
+    _current_space->_sharedBound = _sharedBound;
     if(si->e()) {
       _current_space->_optVarIsInt = (si->e()->type().isvarint());
       if(Id* id = si->e()->dyn_cast<Id>()) {
@@ -933,9 +1000,80 @@ namespace MiniZinc {
     }
   }
 
+  void
+  GecodeSolverInstance::saveRootSpace(void) {
+    // spaces can only be copied when stable and not failed; a failed root
+    // stays the current space, so all further solves are unsatisfiable
+    if (_root_space==NULL && _current_space->status() != SS_FAILED)
+      _root_space = static_cast<FznSpace*>(_current_space->clone());
+  }
+
   void
   GecodeSolverInstance::resetSolver(void) {
-    assert(false); // TODO: implement
+    delete engine;
+    engine = NULL;
+    delete engine_options.stop;
+    engine_options.stop = NULL;
+    delete _solution;
+    _solution = NULL;
+    for (unsigned int i=0; i<_tempVars.size(); i++)
+      _variableMap.remove(_tempVars[i]);
+    _tempVars.clear();
+    resetOutputPlan();
+    if (_root_space) {
+      delete _current_space;
+      if (_root_space->status() == SS_FAILED) {
+        // permanent constraints made the root fail
+        _current_space = _root_space;
+        _root_space = NULL;
+      } else {
+        _current_space = static_cast<FznSpace*>(_root_space->clone());
+      }
+    }
+    _status = SolverInstance::UNKNOWN;
+    _status_reason = SolverInstance::SR_OK;
+  }
+
+  void
+  GecodeSolverInstance::processItems(Model::iterator begin, Model::iterator end,
+                                     std::vector<Id*>* vars) {
+    for (Model::iterator it = begin; it != end; ++it) {
+      if ((*it)->removed())
+        continue;
+      if (VarDeclI* vdi = (*it)->dyn_cast<VarDeclI>()) {
+        VarDecl* vd = vdi->e();
+        if (vd->type().isvar()) {
+          processVarDecl(vd);
+          if (vars && vd->type().dim()==0)
+            vars->push_back(vd->id());
+        }
+      } else if (ConstraintI* ci = (*it)->dyn_cast<ConstraintI>()) {
+        if (Call* c = ci->e()->dyn_cast<Call>())
+          _constraintRegistry.post(c);
+      } else {
+        throw InternalError("GecodeSolverInstance: only variables and constraints can be added to a solver instance");
+      }
+    }
+  }
+
+  void
+  GecodeSolverInstance::resetWithConstraints(Model::iterator begin, Model::iterator end) {
+    resetSolver();
+    saveRootSpace();
+    processItems(begin, end, &_tempVars);
+  }
+
+  void
+  GecodeSolverInstance::processPermanentConstraints(Model::iterator begin, Model::iterator end) {
+    if (_root_space) {
+      FznSpace* current = _current_space;
+      _current_space = _root_space;
+      processItems(begin, end, NULL);
+      _current_space = current;
+    } else {
+      processItems(begin, end, NULL);
+    }
+    resetSolver();
   }
 
   Expression*
@@ -966,7 +1104,7 @@ namespace MiniZinc {
       // TODO: check what we need to do options-wise
       std::vector<Expression*> branch_vars;
       std::vector<Expression*> solve_args;
-      Expression* solveExpr = _flat->solveItem()->e();
+      Expression* solveExpr = _objective ? _objective : _flat->solveItem()->e();
       Expression* optSearch = NULL;
       
       switch(_current_space->_solveType) {
@@ -999,6 +1137,9 @@ namespace MiniZinc {
 
       int seed = _options.getIntParam("seed", 1);
       double decay = _options.getFloatParam("decay", 0.5);
+
+      // keep the space without branchers for resetSolver
+      saveRootSpace();
       
       createBranchers(_flat->solveItem()->ann(), optSearch,
                       seed, decay,
@@ -1037,8 +1178,132 @@ namespace MiniZinc {
         << std::endl;
   }
   
+  void
+  GecodeSolverInstance::lnsVariables(std::vector<int>& iv, std::vector<int>& bv,
+                                     int& percentage) {
+    std::vector<Expression*> flatAnn;
+    flattenSearchAnnotations(_flat->solveItem()->ann(), flatAnn);
+    std::vector<Expression*> arrays;
+    for (unsigned int i=0; i<flatAnn.size(); i++) {
+      Call* c = flatAnn[i]->dyn_cast<Call>();
+      if (c && c->id().str() == "relax_and_reconstruct") {
+        arrays.push_back(c->args()[0]);
+        percentage = static_cast<int>(c->args()[1]->cast<IntLit>()->v().toInt());
+        break;
+      }
+    }
+    if (arrays.empty()) {
+      for (unsigned int i=0; i<flatAnn.size(); i++) {
+        Call* c = flatAnn[i]->dyn_cast<Call>();
+        if (c && (c->id().str() == "int_search" || c->id().str() == "bool_search"))
+          arrays.push_back(c->args()[0]);
+      }
+    }
+    std::vector<bool> iv_seen(_current_space->iv.size(), false);
+    std::vector<bool> bv_seen(_current_space->bv.size(), false);
+    int optVar = _current_space->_optVarIsInt ? _current_space->_optVarIdx : -1;
+    for (unsigned int i=0; i<arrays.size(); i++) {
+      ArrayLit* vars = arg2arraylit(arrays[i]);
+      for (unsigned int j=0; j<vars->v().size(); j++) {
+        Expression* x = vars->v()[j];
+        if (!x->type().isvar())
+          continue;
+        GecodeVariable var = resolveVar(getVarDecl(x));
+        if (var.isint() && var.index() != optVar && !iv_seen[var.index()]) {
+          iv_seen[var.index()] = true;
+          iv.push_back(var.index());
+        } else if (var.isbool() && !bv_seen[var.index()]) {
+          bv_seen[var.index()] = true;
+          bv.push_back(var.index());
+        }
+      }
+    }
+    if (arrays.empty()) {
+      for (unsigned int i=0; i<_current_space->iv.size(); i++)
+        if (!_current_space->iv_introduced[i] && static_cast<int>(i) != optVar)
+          iv.push_back(i);
+      for (unsigned int i=0; i<_current_space->bv.size(); i++)
+        if (!_current_space->bv_introduced[i])
+          bv.push_back(i);
+    }
+  }
+
+  FznSpace*
+  GecodeSolverInstance::lns(FznSpace* incumbent, unsigned int timeLeft, bool& optimal) {
+    optimal = false;
+    // the root space with branchers is copied for each neighbourhood
+    if (_current_space->status() == SS_FAILED)
+      return incumbent;
+    std::vector<int> iv;
+    std::vector<int> bv;
+    int percentage = -1;
+    lnsVariables(iv, bv, percentage);
+
+    GecodeLNS::Options o;
+    o.percentage = static_cast<unsigned int>(_options.getIntParam("lns_fix", percentage >= 0 ? percentage : 80));
+    o.failLimit = static_cast<unsigned int>(_options.getIntParam("lns_fail", 100));
+    GecodeLNS::parseRestart(_options.getStringParam("lns_restart", "luby"), o.restart);
+    o.restartBase = _options.getFloatParam("lns_restart_base", 1.5);
+    o.threads = static_cast<unsigned int>(_options.getIntParam("lns_threads", 1));
+    o.seed = static_cast<unsigned int>(_options.getIntParam("seed", 1));
+    o.time = timeLeft;
+    o.nodes = static_cast<unsigned int>(_options.getIntParam("nodes", 0));
+    bool limited = o.time > 0 || o.nodes > 0;
+    o.iterations = static_cast<unsigned int>(_options.getIntParam("lns_iterations", limited ? 0 : 1000));
+    o.stats = _options.getBoolParam("lns_stats", false);
+
+    GecodeLNS search(_current_space, iv, bv, o);
+    FznSpace* best = search.run(incumbent, optimal, std::cerr);
+    if (_print_stats) {
+      Gecode::Search::Statistics stat = search.statistics();
+      std::cerr << "%%  lns iterations:  " << search.iterations() << std::endl
+                << "%%  lns improvements: " << search.improvements() << std::endl
+                << "%%  lns variables:   " << iv.size()+bv.size() << std::endl
+                << "%%  lns nodes:       " << stat.node << std::endl
+                << "%%  lns failures:    " << stat.fail << std::endl;
+    }
+    return best;
+  }
+
+  bool
+  GecodeSolverInstance::getObjectiveValue(double& v) {
+    if (_solution==NULL || _solution->_solveType == MiniZinc::SolveI::SolveType::ST_SAT ||
+        _solution->_optVarIdx < 0)
+      return false;
+    if (_solution->_optVarIsInt) {
+      v = _solution->iv[_solution->_optVarIdx].val();
+    } else {
+#ifdef GECODE_HAS_FLOAT_VARS
+      v = _solution->fv[_solution->_optVarIdx].val().med();
+#else
+      return false;
+#endif
+    }
+    return true;
+  }
+
+  bool
+  GecodeSolverInstance::setObjective(SolveI::SolveType st, Id* obj) {
+    GecodeVariable var = resolveVar(obj->decl());
+    bool isInt = obj->type().isvarint();
+    if (isInt ? !var.isint() : !var.isfloat())
+      return false;
+    _objective = obj;
+    // the root space is cloned by resetSolver, so it has to know the objective as well
+    FznSpace* spaces[] = {_current_space, _root_space};
+    for (unsigned int i=0; i<2; i++) {
+      if (spaces[i]) {
+        spaces[i]->_solveType = st;
+        spaces[i]->_optVarIsInt = isInt;
+        spaces[i]->_optVarIdx = var.index();
+      }
+    }
+    return true;
+  }
+
   SolverInstanceBase::Status
   GecodeSolverInstance::solve(void) {
+    Timer timer;
 
     prepareEngine();
 
@@ -1046,12 +1311,29 @@ namespace MiniZinc {
       presolve();
     }
 
+    bool lnsOptimal = false;
+    bool runLNS = _options.getBoolParam("lns", false) &&
+      _current_space->_solveType != MiniZinc::SolveI::SolveType::ST_SAT;
     if (_current_space->_solveType == MiniZinc::SolveI::SolveType::ST_SAT) {
       _solution = engine->next();
+    } else if (runLNS) {
+      // the first solution starts the neighbourhood search
+      _solution = engine->next();
+      if (_solution && !engine->stopped()) {
+        int timeStop = _options.getIntParam("time", 0);
+        if (timeStop == 0 || timer.ms() < timeStop) {
+          unsigned int timeLeft = timeStop > 0 ? static_cast<unsigned int>(timeStop-timer.ms()) : 0;
+          _solution = lns(_solution, timeLeft, lnsOptimal);
+        }
+      }
     } else {
+      bool intermediate = _options.getBoolParam("intermediate", false);
       while (FznSpace* next_sol = engine->next()) {
         if(_solution) delete _solution;
         _solution = next_sol;
+        publishObjective();
+        if (intermediate)
+          printSolution();
       }
     }
 
@@ -1059,6 +1341,9 @@ namespace MiniZinc {
       assignSolutionToOutput();
       if (_current_space->_solveType == MiniZinc::SolveI::SolveType::ST_SAT) {
         _status = SolverInstance::SAT;
+      } else if (runLNS) {
+        // neighbourhood search is incomplete unless it explored the whole space
+        _status = lnsOptimal ? SolverInstance::OPT : SolverInstance::SAT;
       } else {
         if (engine->stopped()) {
           Gecode::Search::Statistics stat = engine->statistics();
@@ -1395,6 +1680,9 @@ namespace MiniZinc {
             );
         //branchInfo.add(bh,r0,r1,names);
       } 
+      else if (flatAnn[i]->isa<Call>() && flatAnn[i]->cast<Call>()->id().str() == "relax_and_reconstruct") {
+        // used by large neighbourhood search, see lnsVariables
+      }
       else if (flatAnn[i]->isa<Call>() && flatAnn[i]->cast<Call>()->id().str() == "int_default_search") {
         Call* call = flatAnn[i]->dyn_cast<Call>();
         def_int_varsel = ann2ivarsel(call->args()[0]->cast<Id>()->str().str(),rnd,decay);
@@ -1501,6 +1789,8 @@ namespace MiniZinc {
             err << "Warning, ignored search annotation: float_search" << std::endl;
         }
 #endif
+      } else if (flatAnn[i]->isa<Call>() && flatAnn[i]->cast<Call>()->id().str() == "lex_objectives") {
+        // handled by SolverInstanceBase::solveLexicographic
       } else { 
           if (!ignoreUnknown) {
               err << "Warning, ignored search annotation: " << *flatAnn[i] << std::endl;
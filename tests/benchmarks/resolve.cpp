@@ -0,0 +1,223 @@
+/* -*- mode: C++; c-basic-offset: 2; indent-tabs-mode: nil -*- */
+
+/*
+ *  Main authors:
+ *     agent <agent@local>
+ */
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/* Benchmark for incremental solving. The model is flattened once, and then
+ * solved repeatedly, each time with a few randomly chosen integer variables
+ * fixed to values from their domains by temporary constraints. The same
+ * sequence of problems is solved twice: by creating a new solver instance
+ * from the flat model for every problem (rebuild), and by re-using a single
+ * solver instance through resetWithConstraints (incremental). The statuses
+ * of both runs must agree.
+ *
+ * Usage: mzn-bench-resolve-<solver> [--resolve-runs <n>] [--resolve-fix <k>]
+ *          [--resolve-seed <s>] <minizinc options> <model>.mzn [<data>.dzn ...]
+ *
+ * Solutions are printed to the standard output, and the timings to the
+ * standard error.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <minizinc/solver.hh>
+#include <minizinc/eval_par.hh>
+#include <minizinc/timer.hh>
+
+using namespace std;
+using namespace MiniZinc;
+
+namespace {
+
+  /// Deterministic pseudo-random numbers
+  class Rnd {
+    unsigned long long _seed;
+  public:
+    Rnd(unsigned long long seed) : _seed(seed) {}
+    unsigned long long operator ()(unsigned long long n) {
+      _seed = (_seed * 1103515245 + 12345) % (1ULL << 31);
+      return (_seed >> 8) % n;
+    }
+  };
+
+  /// A temporary constraint fixing \a x to \a v
+  struct Fix {
+    VarDecl* x;
+    long long v;
+  };
+
+  Item* fixItem(const Fix& f) {
+    std::vector<Expression*> args(2);
+    args[0] = f.x->id();
+    args[1] = IntLit::a(f.v);
+    Call* c = new Call(Location().introduce(), constants().ids.int_.eq, args);
+    c->type(Type::varbool());
+    return new ConstraintI(Location().introduce(), c);
+  }
+
+  const char* statusName(SolverInstance::Status s) {
+    switch (s) {
+      case SolverInstance::OPT: return "OPT";
+      case SolverInstance::SAT: return "SAT";
+      case SolverInstance::UNSAT: return "UNSAT";
+      case SolverInstance::UNBND: return "UNBND";
+      case SolverInstance::UNSATorUNBND: return "UNSATorUNBND";
+      case SolverInstance::UNKNOWN: return "UNKNOWN";
+      default: return "ERROR";
+    }
+  }
+
+}
+
+int main(int argc, const char** argv) {
+
+#ifdef HAS_GECODE
+  static unique_ptr<SolverFactory>
+    pFactoryGECODE( SolverFactory::createF_GECODE() );
+#endif
+#ifdef HAS_MIP
+  static unique_ptr<SolverFactory>
+    pFactoryMIP( SolverFactory::createF_MIP() );
+#endif
+
+  unsigned int runs = 20;
+  unsigned int nFix = 2;
+  unsigned long long seed = 1;
+  std::vector<const char*> args;
+  args.push_back(argv[0]);
+  for (int i=1; i<argc; i++) {
+    if (i+1 < argc && strcmp(argv[i], "--resolve-runs")==0) {
+      runs = atoi(argv[++i]);
+    } else if (i+1 < argc && strcmp(argv[i], "--resolve-fix")==0) {
+      nFix = atoi(argv[++i]);
+    } else if (i+1 < argc && strcmp(argv[i], "--resolve-seed")==0) {
+      seed = atoll(argv[++i]);
+    } else {
+      args.push_back(argv[i]);
+    }
+  }
+
+  MznSolver slv;
+  try {
+    slv.addFlattener();
+    if (!slv.processOptions(args.size(), args.data(), cerr)) {
+      slv.printHelp(cerr);
+      exit(EXIT_FAILURE);
+    }
+    slv.flatten();
+    if (SolverInstance::UNKNOWN != slv.getFlt()->status) {
+      cerr << "Model is unsatisfiable or flattening failed" << endl;
+      exit(EXIT_FAILURE);
+    }
+
+    GCLock lock;
+    Env& env = *slv.getFlt()->getEnv();
+    slv.addSolverInterface();
+    SolverFactory* sf = getGlobalSolverRegistry()->getSolverFactories().back();
+
+    // Candidate variables: integer variables with a finite domain
+    std::vector<VarDecl*> cand;
+    std::vector<IntSetVal*> dom;
+    for (VarDeclIterator it = env.flat()->begin_vardecls(); it != env.flat()->end_vardecls(); ++it) {
+      VarDecl* vd = it->e();
+      if (it->removed() || !vd->type().isvarint() || vd->type().dim() != 0 ||
+          vd->e() || vd->ti()->domain()==NULL)
+        continue;
+      IntSetVal* isv = eval_intset(env.envi(), vd->ti()->domain());
+      if (isv->size()==0 || !isv->min().isFinite() || !isv->max().isFinite())
+        continue;
+      cand.push_back(vd);
+      dom.push_back(isv);
+    }
+    if (cand.empty()) {
+      cerr << "No integer variables to fix" << endl;
+      exit(EXIT_FAILURE);
+    }
+
+    Rnd rnd(seed);
+    std::vector<std::vector<Fix> > problems(runs);
+    for (unsigned int i=0; i<runs; i++) {
+      for (unsigned int j=0; j<nFix; j++) {
+        unsigned int k = static_cast<unsigned int>(rnd(cand.size()));
+        IntSetVal* isv = dom[k];
+        unsigned int r = static_cast<unsigned int>(rnd(isv->size()));
+        long long lo = isv->min(r).toInt();
+        long long hi = isv->max(r).toInt();
+        Fix f;
+        f.x = cand[k];
+        f.v = lo + static_cast<long long>(rnd(static_cast<unsigned long long>(hi-lo)+1));
+        problems[i].push_back(f);
+      }
+    }
+
+    // Rebuild: a new solver instance for every problem
+    std::vector<SolverInstance::Status> rebuild(runs);
+    Timer tRebuild;
+    for (unsigned int i=0; i<runs; i++) {
+      std::vector<Item*> items;
+      for (unsigned int j=0; j<problems[i].size(); j++) {
+        items.push_back(fixItem(problems[i][j]));
+        env.flat()->addItem(items.back());
+      }
+      SolverInstanceBase* si = sf->createSI(env);
+      si->setSolns2Out(&slv.s2out);
+      si->processFlatZinc();
+      rebuild[i] = si->solve();
+      sf->destroySI(si);
+      for (unsigned int j=0; j<items.size(); j++)
+        items[j]->remove();
+    }
+    double msRebuild = tRebuild.ms();
+
+    // Incremental: one solver instance, temporary constraints per problem
+    std::vector<SolverInstance::Status> incremental(runs);
+    Timer tIncremental;
+    SolverInstanceBase* si = slv.getSI();
+    si->processFlatZinc();
+    for (unsigned int i=0; i<runs; i++) {
+      Model tmp;
+      for (unsigned int j=0; j<problems[i].size(); j++)
+        tmp.addItem(fixItem(problems[i][j]));
+      si->resetWithConstraints(tmp.begin(), tmp.end());
+      incremental[i] = si->solve();
+    }
+    double msIncremental = tIncremental.ms();
+
+    unsigned int mismatches = 0;
+    for (unsigned int i=0; i<runs; i++) {
+      if (rebuild[i] != incremental[i]) {
+        mismatches++;
+        cerr << "Problem " << i << ": rebuild " << statusName(rebuild[i])
+             << ", incremental " << statusName(incremental[i]) << endl;
+      }
+    }
+    cerr << runs << " problems, " << nFix << " variables fixed each:" << endl
+         << "  rebuild:     " << msRebuild << " ms" << endl
+         << "  incremental: " << msIncremental << " ms" << endl
+         << "  speedup:     " << (msIncremental > 0 ? msRebuild/msIncremental : 0) << endl;
+    if (mismatches > 0) {
+      cerr << mismatches << " status mismatches" << endl;
+      exit(EXIT_FAILURE);
+    }
+  } catch (const LocationException& e) {
+    cerr << e.loc() << ":" << endl;
+    cerr << e.what() << ": " << e.msg() << endl;
+    exit(EXIT_FAILURE);
+  } catch (const Exception& e) {
+    cerr << e.what() << ": " << e.msg() << endl;
+    exit(EXIT_FAILURE);
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    exit(EXIT_FAILURE);
+  }
+  return 0;
+}
@@ -0,0 +1,26 @@
+#!/bin/sh
+# usage: run-builtins.sh [<mzn2fzn>] [<size> ...]
+#
+# Flatten each benchmark model in the builtins directory for several
+# sizes and report the wall clock time of each run in milliseconds.
+
+BENCHDIR="$(cd "$(dirname "$0")" && pwd)"
+MZN2FZN=${1:-mzn2fzn}
+[ $# -gt 0 ] && shift
+SIZES=${*:-"1000 10000 100000 1000000"}
+STDLIB=${MZN_STDLIB_DIR:-"$BENCHDIR/../../share/minizinc"}
+TMP=${TMPDIR:-/tmp}/mzn-bench-builtins.$$
+
+for MODEL in "$BENCHDIR"/builtins/*.mzn
+do
+    NAME=$(basename "$MODEL" .mzn)
+    for N in $SIZES
+    do
+        START=$(date +%s%N)
+        "$MZN2FZN" --stdlib-dir "$STDLIB" --no-output-ozn -o "$TMP.fzn" \
+            -D "n=$N;" "$MODEL" || exit 1
+        END=$(date +%s%N)
+        echo "$NAME n=$N: $(( (END - START) / 1000000 )) ms"
+    done
+done
+rm -f "$TMP.fzn"
@@ -0,0 +1,235 @@
+#!/usr/bin/env python3
+# usage: run-compiler.py [--mzn2fzn <exe>] [--stdlib-dir <dir>]
+#                        [--baseline <file>] [--threshold <t>]
+#                        [--update-baseline] [--repeat <n>]
+#                        [--output <file>] [--only <name>]
+#
+# Run a curated set of models through the compiler pipeline (parse,
+# typecheck, flatten, optimize and FlatZinc printing) using mzn2fzn
+# --instrument-json, and record the wall clock time of each run, and the
+# time, peak resident set size and garbage collector high-water mark
+# (GC::maxMem) of each phase. Besides some of the examples, the set
+# includes scaled-up instances of the sudoku, packing and job shop
+# models in the compiler directory, which are generated on the fly.
+#
+# Each instance is run several times and the fastest time is kept. The
+# results are written as JSON and compared against a baseline file
+# written by an earlier run with --update-baseline (the baseline is
+# created if it does not exist yet). A time or memory measurement that
+# exceeds the baseline by more than the relative threshold (and by more
+# than a small absolute margin, to ignore noise on tiny values) is
+# reported as a regression, and the script then exits with status 1.
+#
+# The benchmark and benchmark_baseline targets of the CMake build run
+# this script with the mzn2fzn of the build.
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+BENCHDIR = os.path.dirname(os.path.abspath(__file__))
+EXAMPLES = os.path.join(BENCHDIR, "..", "examples")
+COMPILER = os.path.join(BENCHDIR, "compiler")
+
+# Phases of mzn2fzn reported per instance
+PHASES = ["parse", "typecheck", "flatten", "MIPdomains", "optimize",
+          "oldflatzinc", "compact", "print_fzn"]
+
+# Differences below these margins are never regressions
+TIME_MARGIN_MS = 5.0
+MEMORY_MARGIN_BYTES = 1 << 20
+
+
+def random_sequence(seed):
+    """Deterministic pseudo-random numbers, independent of the Python version."""
+    while True:
+        seed = (seed * 1103515245 + 12345) % (1 << 31)
+        yield seed >> 8
+
+
+def dzn_array2d(rows):
+    return "[|" + "|".join(", ".join(str(v) for v in row) for row in rows) + "|]"
+
+
+def sudoku(s):
+    n = s * s
+    rnd = random_sequence(s)
+    given = []
+    for r in range(n):
+        row = []
+        for c in range(n):
+            v = (s * (r % s) + r // s + c) % n + 1
+            row.append(v if next(rnd) % 3 == 0 else 0)
+        given.append(row)
+    return "S = %d;\ngiven = %s;\n" % (s, dzn_array2d(given))
+
+
+def packing(n):
+    sizes = list(range(n, 0, -1))
+    area = sum(k * k for k in sizes)
+    side = 1
+    while side * side < area:
+        side += 1
+    return ("n = %d;\npack_x = %d;\npack_y = %d;\npack_s = %s;\n"
+            % (n, side, side, sizes))
+
+
+def jobshop(jobs, machines):
+    rnd = random_sequence(jobs * 1000 + machines)
+    d = [[next(rnd) % 99 + 1 for _ in range(machines)] for _ in range(jobs)]
+    mt = []
+    for _ in range(jobs):
+        perm = list(range(1, machines + 1))
+        for i in range(machines - 1, 0, -1):
+            j = next(rnd) % (i + 1)
+            perm[i], perm[j] = perm[j], perm[i]
+        mt.append(perm)
+    return ("jobs = %d;\nmachines = %d;\nd = %s;\nmt = %s;\n"
+            % (jobs, machines, dzn_array2d(d), dzn_array2d(mt)))
+
+
+# name, model, generated data (or None), extra mzn2fzn arguments
+INSTANCES = [
+    ("golomb", os.path.join(EXAMPLES, "golomb.mzn"), None, []),
+    ("packing_example", os.path.join(EXAMPLES, "packing.mzn"), None, []),
+    ("2DPacking", os.path.join(EXAMPLES, "2DPacking.mzn"), None, []),
+    ("sudoku_16x16", os.path.join(COMPILER, "sudoku.mzn"), sudoku(4), []),
+    ("sudoku_36x36", os.path.join(COMPILER, "sudoku.mzn"), sudoku(6), []),
+    ("sudoku_64x64", os.path.join(COMPILER, "sudoku.mzn"), sudoku(8), []),
+    ("packing_20", os.path.join(COMPILER, "packing.mzn"), packing(20), []),
+    ("packing_40", os.path.join(COMPILER, "packing.mzn"), packing(40), []),
+    ("jobshop_10x10", os.path.join(COMPILER, "jobshop.mzn"), jobshop(10, 10), []),
+    ("jobshop_30x15", os.path.join(COMPILER, "jobshop.mzn"), jobshop(30, 15), []),
+    ("jobshop_30x15_linear", os.path.join(COMPILER, "jobshop.mzn"),
+     jobshop(30, 15), ["-G", "linear"]),
+]
+
+
+def run_instance(args, tmp, name, model, data, extra):
+    cmd = [args.mzn2fzn, "--stdlib-dir", args.stdlib_dir, "--no-output-ozn",
+           "-o", os.path.join(tmp, "out.fzn"),
+           "--instrument-json", os.path.join(tmp, "instr.json")] + extra + [model]
+    if data is not None:
+        dzn = os.path.join(tmp, name + ".dzn")
+        with open(dzn, "w") as f:
+            f.write(data)
+        cmd.append(dzn)
+    result = None
+    for _ in range(args.repeat):
+        start = time.perf_counter()
+        proc = subprocess.run(cmd, stdout=subprocess.DEVNULL,
+                              stderr=subprocess.PIPE, universal_newlines=True)
+        wall = (time.perf_counter() - start) * 1000.0
+        if proc.returncode != 0:
+            sys.stderr.write(proc.stderr)
+            raise RuntimeError("%s: mzn2fzn failed" % name)
+        with open(os.path.join(tmp, "instr.json")) as f:
+            instr = json.load(f)
+        run = {"wall_ms": wall,
+               "peak_rss_bytes": instr["peak_rss_bytes"],
+               "gc_max_heap_bytes": instr["gc"]["max_heap_bytes"],
+               "phases": {}}
+        for p in instr["phases"]:
+            if p["name"] in PHASES:
+                run["phases"][p["name"]] = {
+                    "time_ms": p["time_ms"],
+                    "peak_rss_bytes": p["peak_rss_bytes"],
+                    "gc_max_heap_bytes": p["gc_max_heap_bytes"]}
+        result = run if result is None else merge(result, run)
+    return result
+
+
+def merge(a, b):
+    """Keep the fastest time and the largest memory use of two runs."""
+    m = {"wall_ms": min(a["wall_ms"], b["wall_ms"]),
+         "peak_rss_bytes": max(a["peak_rss_bytes"], b["peak_rss_bytes"]),
+         "gc_max_heap_bytes": max(a["gc_max_heap_bytes"], b["gc_max_heap_bytes"]),
+         "phases": {}}
+    for name, p in a["phases"].items():
+        q = b["phases"].get(name, p)
+        m["phases"][name] = {
+            "time_ms": min(p["time_ms"], q["time_ms"]),
+            "peak_rss_bytes": max(p["peak_rss_bytes"], q["peak_rss_bytes"]),
+            "gc_max_heap_bytes": max(p["gc_max_heap_bytes"], q["gc_max_heap_bytes"])}
+    return m
+
+
+def measurements(result):
+    """Flatten the result of an instance into (metric, value) pairs."""
+    yield "wall_ms", result["wall_ms"]
+    yield "peak_rss_bytes", result["peak_rss_bytes"]
+    yield "gc_max_heap_bytes", result["gc_max_heap_bytes"]
+    for phase in PHASES:
+        if phase in result["phases"]:
+            for key, value in sorted(result["phases"][phase].items()):
+                yield phase + "." + key, value
+
+
+def compare(results, baseline, threshold):
+    regressions = 0
+    for name, result in results.items():
+        if name not in baseline:
+            print("%s: not in baseline" % name)
+            continue
+        base = dict(measurements(baseline[name]))
+        for metric, value in measurements(result):
+            if metric not in base:
+                continue
+            old = base[metric]
+            margin = TIME_MARGIN_MS if metric.endswith("_ms") else MEMORY_MARGIN_BYTES
+            if value > old * (1.0 + threshold) and value - old > margin:
+                regressions += 1
+                print("REGRESSION %s %s: %.1f -> %.1f (%+.1f%%)"
+                      % (name, metric, old, value, 100.0 * (value - old) / old))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark the compiler pipeline")
+    parser.add_argument("--mzn2fzn", default="mzn2fzn")
+    parser.add_argument("--stdlib-dir", default=os.environ.get(
+        "MZN_STDLIB_DIR", os.path.join(BENCHDIR, "..", "..", "share", "minizinc")))
+    parser.add_argument("--baseline", default="benchmark-baseline.json")
+    parser.add_argument("--threshold", type=float, default=0.1,
+                        help="relative increase reported as a regression")
+    parser.add_argument("--update-baseline", action="store_true")
+    parser.add_argument("--repeat", type=int, default=3)
+    parser.add_argument("--output", default="benchmark-results.json")
+    parser.add_argument("--only", action="append",
+                        help="only run the named instance (can be repeated)")
+    args = parser.parse_args()
+
+    results = {}
+    with tempfile.TemporaryDirectory(prefix="mzn-bench-compiler.") as tmp:
+        for name, model, data, extra in INSTANCES:
+            if args.only and name not in args.only:
+                continue
+            r = run_instance(args, tmp, name, model, data, extra)
+            results[name] = r
+            print("%s: %.1f ms, peak RSS %d KB, GC max heap %d KB (%s)"
+                  % (name, r["wall_ms"], r["peak_rss_bytes"] // 1024,
+                     r["gc_max_heap_bytes"] // 1024,
+                     ", ".join("%s %.1f ms" % (p, r["phases"][p]["time_ms"])
+                               for p in PHASES if p in r["phases"])))
+    with open(args.output, "w") as f:
+        json.dump(results, f, indent=2, sort_keys=True)
+
+    if args.update_baseline or not os.path.exists(args.baseline):
+        with open(args.baseline, "w") as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+        print("Baseline written to %s" % args.baseline)
+        return 0
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+    regressions = compare(results, baseline, args.threshold)
+    print("%d regressions (threshold %.0f%%) against %s"
+          % (regressions, args.threshold * 100.0, args.baseline))
+    return 1 if regressions > 0 else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
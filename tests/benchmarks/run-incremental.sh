@@ -0,0 +1,58 @@
+#!/bin/sh
+# usage: run-incremental.sh [<mzn2fzn>]
+#
+# For each model in the incremental directory, flatten the model with its
+# delta data from scratch, and again with --incremental-base so that the
+# results of flattening with the base data are reused. Report the wall
+# clock time of both runs in milliseconds, the number of reused
+# constraints, and check that both runs produce the same FlatZinc items
+# (ignoring the names of introduced variables).
+
+BENCHDIR="$(cd "$(dirname "$0")" && pwd)"
+MZN2FZN=${1:-mzn2fzn}
+STDLIB=${MZN_STDLIB_DIR:-"$BENCHDIR/../../share/minizinc"}
+TMP=${TMPDIR:-/tmp}/mzn-bench-incremental.$$
+
+# Erase the names of introduced variables, and sort the items
+canonical() {
+    sed 's/X_INTRODUCED_[0-9]*_/X/g' "$1" | sort
+}
+
+STATUS=0
+for MODEL in "$BENCHDIR"/incremental/*.mzn
+do
+    NAME=$(basename "$MODEL" .mzn)
+    BASE="$BENCHDIR/incremental/${NAME}_base.dzn"
+    DELTA="$BENCHDIR/incremental/${NAME}_delta.dzn"
+
+    START=$(date +%s%N)
+    "$MZN2FZN" --stdlib-dir "$STDLIB" --no-output-ozn -o "$TMP.full.fzn" \
+        -v "$MODEL" "$DELTA" 2> "$TMP.log" || exit 1
+    END=$(date +%s%N)
+    FULL=$(( (END - START) / 1000000 ))
+    FULLFLAT=$(grep "^Flattening \.\.\." "$TMP.log" | sed 's/.* done (\([0-9]*\) ms).*/\1/')
+
+    START=$(date +%s%N)
+    "$MZN2FZN" --stdlib-dir "$STDLIB" --no-output-ozn -o "$TMP.inc.fzn" \
+        --incremental-base "$BASE" -v "$MODEL" "$DELTA" 2> "$TMP.log" || exit 1
+    END=$(date +%s%N)
+    INC=$(( (END - START) / 1000000 ))
+    BASELINE=$(grep "^Flattening with base data" "$TMP.log" | sed 's/.* done (\([0-9]*\) ms).*/\1/')
+    DELTALINE=$(grep "^Flattening \.\.\." "$TMP.log")
+    FLAT=$(echo "$DELTALINE" | sed 's/.* done (\([0-9]*\) ms).*/\1/')
+    REUSED=$(echo "$DELTALINE" | sed 's/.*, reused \([0-9]* of [0-9]*\) constraints.*/\1/')
+
+    canonical "$TMP.full.fzn" > "$TMP.full.txt"
+    canonical "$TMP.inc.fzn" > "$TMP.inc.txt"
+    if cmp -s "$TMP.full.txt" "$TMP.inc.txt"; then
+        SAME="same FlatZinc"
+    else
+        SAME="DIFFERENT FlatZinc"
+        STATUS=1
+    fi
+    echo "$NAME: full $FULL ms (flattening $FULLFLAT ms)," \
+         "incremental $INC ms (base flattening $BASELINE ms," \
+         "flattening $FLAT ms, reused $REUSED constraints), $SAME"
+done
+rm -f "$TMP.full.fzn" "$TMP.inc.fzn" "$TMP.full.txt" "$TMP.inc.txt" "$TMP.log"
+exit $STATUS
@@ -0,0 +1,57 @@
+#!/usr/bin/env python3
+# usage: run-python-concurrent.py [<models> [<threads>]]
+#
+# Solve several independent models through the Python interface, first one
+# after the other and then from a pool of threads (the minizinc_internal
+# module must be importable and MZN_STDLIB_DIR must be set). Each model has
+# its own garbage collector and the GIL is released while a model is
+# flattened and solved, so the threaded run should scale with the number of
+# cores. The solutions of both runs are compared and the throughput of each
+# run is reported in models per second.
+
+import sys
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+import minizinc_internal
+
+MODELS = int(sys.argv[1]) if len(sys.argv) > 1 else 16
+THREADS = int(sys.argv[2]) if len(sys.argv) > 2 else 4
+
+MODEL = """
+include "globals.mzn";
+int: n;
+array[1..n] of var 1..n: q;
+constraint all_different(q);
+constraint all_different([q[i] + i | i in 1..n]);
+constraint all_different([q[i] - i | i in 1..n]);
+solve satisfy;
+"""
+
+
+def solve(n):
+    model = minizinc_internal.Model()
+    model.load_from_string(string=MODEL)
+    model.addData("n", n)
+    solver = model.solve(solver="gecode")
+    if solver.next() is not None:
+        return None
+    return solver.get_value("q")
+
+
+def run(name, sizes, map_fn):
+    start = time.time()
+    result = list(map_fn(solve, sizes))
+    elapsed = time.time() - start
+    print("%s: %d models in %.2f s, %.1f models/s" %
+          (name, len(sizes), elapsed, len(sizes) / elapsed))
+    return result
+
+
+sizes = [20 + i % 8 for i in range(MODELS)]
+sequential = run("sequential", sizes, map)
+with ThreadPoolExecutor(max_workers=THREADS) as pool:
+    threaded = run("%d threads" % THREADS, sizes, pool.map)
+if sequential != threaded:
+    print("error: solutions differ between the sequential and threaded runs")
+    sys.exit(1)
@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+# usage: run-python-data.py [<n>]
+#
+# Measure how fast parameter arrays are passed to a model through the
+# Python interface (the minizinc_internal module must be importable and
+# MZN_STDLIB_DIR must be set). Each array of n elements is added once as
+# a Python list and once as an object exposing the buffer protocol
+# (array.array, or a NumPy array if NumPy is installed), and the ingested
+# data is reported in MB/s, counting 8 bytes per element.
+
+import array
+import sys
+import time
+
+import minizinc_internal
+
+try:
+    import numpy
+except ImportError:
+    numpy = None
+
+N = int(sys.argv[1]) if len(sys.argv) > 1 else 1000000
+ROWS = 1000
+
+MODEL = """
+int: n; int: rows;
+array[1..n] of int: ints;
+array[1..n] of float: floats;
+array[1..n] of bool: bools;
+array[1..rows,1..n div rows] of int: matrix;
+"""
+
+
+def buffers(n):
+    ints = [i % 1000 for i in range(n)]
+    floats = [i / 7.0 for i in range(n)]
+    bools = [i % 3 == 0 for i in range(n)]
+    if numpy is not None:
+        return {
+            "ints": numpy.array(ints, dtype=numpy.int64),
+            "floats": numpy.array(floats, dtype=numpy.float64),
+            "bools": numpy.array(bools, dtype=numpy.bool_),
+            "matrix": numpy.array(ints, dtype=numpy.int64).reshape(ROWS, n // ROWS),
+        }
+    return {
+        "ints": array.array("q", ints),
+        "floats": array.array("d", floats),
+        "bools": memoryview(bytes(bools)).cast("?"),
+        "matrix": memoryview(array.array("q", ints)).cast("B").cast("q", [ROWS, n // ROWS]),
+    }
+
+
+def lists(n):
+    ints = [i % 1000 for i in range(n)]
+    return {
+        "ints": ints,
+        "floats": [i / 7.0 for i in range(n)],
+        "bools": [i % 3 == 0 for i in range(n)],
+        "matrix": [ints[r * (n // ROWS):(r + 1) * (n // ROWS)] for r in range(ROWS)],
+    }
+
+
+def ingest(name, data, n):
+    model = minizinc_internal.Model()
+    model.load_from_string(string=MODEL)
+    model.addData("n", n)
+    model.addData("rows", ROWS)
+    for key, value in data.items():
+        start = time.time()
+        model.addData(key, value)
+        elapsed = time.time() - start
+        mb = n * 8 / 1e6
+        print("%s %s: %.1f ms, %.1f MB/s" % (name, key, elapsed * 1000, mb / elapsed))
+
+
+N -= N % ROWS
+ingest("list", lists(N), N)
+ingest("numpy" if numpy is not None else "buffer", buffers(N), N)
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+# usage: run-server.py [--mzn2fzn <exe>] [--server <exe>] [--stdlib-dir <dir>]
+#                      [--globals-dir <dir>] [--repeat <n>]
+#                      [--output <file>] [model.mzn ...]
+#
+# Compare the latency of cold requests, each compiled by a new mzn2fzn
+# process, with warm requests sent to a running mzn-server, on the models
+# in tests/examples or on the models given on the command line. Both
+# print the FlatZinc to a pipe, and the time of a request is the wall clock
+# time until its output has been read completely (the server's own start-up
+# is not counted).
+#
+# Each model is run several times per mode and the fastest time is kept.
+# The script prints the times of each model and the totals, and writes
+# them as JSON. It fails if the server and mzn2fzn disagree on whether a
+# model compiles. Models that mzn2fzn rejects are skipped.
+
+import argparse
+import glob
+import json
+import os
+import subprocess
+import sys
+import time
+
+BENCHDIR = os.path.dirname(os.path.abspath(__file__))
+EXAMPLES = os.path.join(BENCHDIR, "..", "examples")
+
+
+class Server:
+    """A running mzn-server, talking the protocol over its standard input and output."""
+
+    def __init__(self, exe, options):
+        self.proc = subprocess.Popen([exe] + options, stdin=subprocess.PIPE,
+                                     stdout=subprocess.PIPE, stderr=subprocess.DEVNULL)
+
+    def _line(self):
+        line = self.proc.stdout.readline()
+        if not line:
+            raise RuntimeError("mzn-server terminated")
+        return line.decode().rstrip("\n")
+
+    def request(self, args):
+        req = "flatten\n" + "".join("arg %s\n" % a for a in args) + "end\n"
+        self.proc.stdin.write(req.encode())
+        self.proc.stdin.flush()
+        response = {}
+        while True:
+            line = self._line()
+            if line == "end":
+                return response
+            key, _, value = line.partition(" ")
+            if key in ("stdout", "stderr"):
+                response[key] = self.proc.stdout.read(int(value))
+            else:
+                response[key] = value
+
+    def close(self):
+        self.proc.stdin.close()
+        self.proc.wait()
+
+
+def cold(args, options, model):
+    start = time.perf_counter()
+    proc = subprocess.run([args.mzn2fzn] + options + [model], stdout=subprocess.PIPE,
+                          stderr=subprocess.DEVNULL)
+    return (time.perf_counter() - start) * 1000.0, proc.returncode
+
+
+def warm(server, model):
+    start = time.perf_counter()
+    response = server.request([model])
+    if "status" not in response:
+        raise RuntimeError("mzn-server: " + response.get("error", "bad response"))
+    return (time.perf_counter() - start) * 1000.0, int(response["status"])
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark cold and warm compiler requests")
+    parser.add_argument("--mzn2fzn", default="mzn2fzn")
+    parser.add_argument("--server", default="mzn-server")
+    parser.add_argument("--stdlib-dir", default=os.environ.get(
+        "MZN_STDLIB_DIR", os.path.join(BENCHDIR, "..", "..", "share", "minizinc")))
+    parser.add_argument("--globals-dir", default=None)
+    parser.add_argument("--repeat", type=int, default=3)
+    parser.add_argument("--output", default="server-results.json")
+    parser.add_argument("models", nargs="*")
+    args = parser.parse_args()
+
+    options = ["--stdlib-dir", args.stdlib_dir]
+    if args.globals_dir:
+        options += ["-G", args.globals_dir]
+    models = args.models or sorted(glob.glob(os.path.join(EXAMPLES, "*.mzn")))
+    results = {}
+    totals = {"cold_ms": 0.0, "warm_ms": 0.0}
+    server = Server(args.server, options)
+    try:
+        for model in models:
+            name = os.path.splitext(os.path.basename(model))[0]
+            model = os.path.abspath(model)
+            c, status = min(cold(args, options + ["--output-to-stdout", "--no-output-ozn"], model)
+                            for _ in range(args.repeat))
+            if status != 0:
+                print("%s: skipped" % name)
+                continue
+            w, wstatus = min(warm(server, model) for _ in range(args.repeat))
+            if wstatus != status:
+                print("%s: exit status %d with mzn-server, %d with mzn2fzn"
+                      % (name, wstatus, status))
+                return 1
+            results[name] = {"cold_ms": c, "warm_ms": w}
+            totals["cold_ms"] += c
+            totals["warm_ms"] += w
+            print("%s: %.1f ms cold, %.1f ms warm" % (name, c, w))
+    finally:
+        server.close()
+    if not results:
+        print("No models run")
+        return 1
+    print("%d models, total %.1f ms cold, %.1f ms warm (%+.1f%%)"
+          % (len(results), totals["cold_ms"], totals["warm_ms"],
+             100.0 * (totals["warm_ms"] - totals["cold_ms"]) / totals["cold_ms"]))
+    with open(args.output, "w") as f:
+        json.dump({"models": results, "totals": totals}, f, indent=2, sort_keys=True)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+# usage: run-startup.py [--mzn2fzn <exe>] [--stdlib-dir <dir>]
+#                       [--globals-dir <dir>] [--repeat <n>]
+#                       [--output <file>] [model.mzn ...]
+#
+# Measure the start-up latency of the compiler (the parse and typecheck
+# phases reported by mzn2fzn --instrument-json) on the models in
+# tests/examples, or on the models given on the command line, once with
+# the whole library parsed eagerly and once with --lazy-stdlib. The lazy
+# runs use a library index in a temporary file, which is filled by a
+# first, unmeasured run, so the numbers are those of a warm index.
+#
+# Each model is run several times per mode and the fastest time is kept.
+# The script prints the times of each model and the totals, and writes
+# them as JSON. Models that mzn2fzn rejects (e.g. because they need data)
+# are skipped.
+
+import argparse
+import glob
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+BENCHDIR = os.path.dirname(os.path.abspath(__file__))
+EXAMPLES = os.path.join(BENCHDIR, "..", "examples")
+
+# Phases that make up the start-up latency
+PHASES = ["parse", "typecheck"]
+
+
+def run(args, tmp, model, extra):
+    instr_file = os.path.join(tmp, "instr.json")
+    cmd = [args.mzn2fzn, "--stdlib-dir", args.stdlib_dir, "--no-output-ozn",
+           "-o", os.path.join(tmp, "out.fzn"), "--instrument-json", instr_file]
+    if args.globals_dir:
+        cmd += ["-G", args.globals_dir]
+    cmd += extra + [model]
+    start = time.perf_counter()
+    proc = subprocess.run(cmd, stdout=subprocess.DEVNULL,
+                          stderr=subprocess.DEVNULL)
+    wall = (time.perf_counter() - start) * 1000.0
+    if proc.returncode != 0:
+        return None
+    with open(instr_file) as f:
+        instr = json.load(f)
+    phases = dict((p["name"], p["time_ms"]) for p in instr["phases"])
+    return {"wall_ms": wall,
+            "startup_ms": sum(phases.get(p, 0.0) for p in PHASES),
+            "parse_ms": phases.get("parse", 0.0),
+            "typecheck_ms": phases.get("typecheck", 0.0)}
+
+
+def fastest(args, tmp, model, extra):
+    best = None
+    for _ in range(args.repeat):
+        r = run(args, tmp, model, extra)
+        if r is None:
+            return None
+        if best is None:
+            best = r
+        else:
+            best = dict((k, min(best[k], r[k])) for k in best)
+    return best
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark compiler start-up latency")
+    parser.add_argument("--mzn2fzn", default="mzn2fzn")
+    parser.add_argument("--stdlib-dir", default=os.environ.get(
+        "MZN_STDLIB_DIR", os.path.join(BENCHDIR, "..", "..", "share", "minizinc")))
+    parser.add_argument("--globals-dir", default=None)
+    parser.add_argument("--repeat", type=int, default=3)
+    parser.add_argument("--output", default="startup-results.json")
+    parser.add_argument("models", nargs="*")
+    args = parser.parse_args()
+
+    models = args.models or sorted(glob.glob(os.path.join(EXAMPLES, "*.mzn")))
+    results = {}
+    totals = {"eager": {}, "lazy": {}}
+    with tempfile.TemporaryDirectory(prefix="mzn-bench-startup.") as tmp:
+        lazy = ["--stdlib-index", os.path.join(tmp, "library-index")]
+        for model in models:
+            name = os.path.splitext(os.path.basename(model))[0]
+            eager = fastest(args, tmp, model, [])
+            if eager is None:
+                print("%s: skipped" % name)
+                continue
+            # Fill the index before measuring
+            if run(args, tmp, model, lazy) is None:
+                print("%s: fails with --lazy-stdlib" % name)
+                return 1
+            lz = fastest(args, tmp, model, lazy)
+            results[name] = {"eager": eager, "lazy": lz}
+            for mode, r in (("eager", eager), ("lazy", lz)):
+                for k, v in r.items():
+                    totals[mode][k] = totals[mode].get(k, 0.0) + v
+            print("%s: start-up %.1f ms eager, %.1f ms lazy (wall %.1f / %.1f ms)"
+                  % (name, eager["startup_ms"], lz["startup_ms"],
+                     eager["wall_ms"], lz["wall_ms"]))
+    if not results:
+        print("No models run")
+        return 1
+    print("%d models, total start-up %.1f ms eager, %.1f ms lazy (%+.1f%%), "
+          "total wall %.1f ms eager, %.1f ms lazy"
+          % (len(results), totals["eager"]["startup_ms"], totals["lazy"]["startup_ms"],
+             100.0 * (totals["lazy"]["startup_ms"] - totals["eager"]["startup_ms"])
+             / totals["eager"]["startup_ms"],
+             totals["eager"]["wall_ms"], totals["lazy"]["wall_ms"]))
+    with open(args.output, "w") as f:
+        json.dump({"models": results, "totals": totals}, f, indent=2, sort_keys=True)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
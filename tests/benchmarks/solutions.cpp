@@ -0,0 +1,84 @@
+/* -*- mode: C++; c-basic-offset: 2; indent-tabs-mode: nil -*- */
+
+/*
+ *  Main authors:
+ *     agent <agent@local>
+ */
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/* Benchmark for reporting solutions. The model is flattened and solved
+ * with the given options (use -a or -n <n> to enumerate several solutions),
+ * and the number of solutions per second of solving time is reported. This
+ * includes extracting the solution values into the output model and
+ * evaluating the output. tests/benchmarks/solutions/outputs.mzn has many
+ * output variables and many solutions.
+ *
+ * Usage: mzn-bench-solutions-<solver> <minizinc options> <model>.mzn [<data>.dzn ...]
+ *
+ * Solutions are printed to the standard output, and the timings to the
+ * standard error.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+
+#include <minizinc/solver.hh>
+#include <minizinc/timer.hh>
+
+using namespace std;
+using namespace MiniZinc;
+
+int main(int argc, const char** argv) {
+
+#ifdef HAS_GECODE
+  static unique_ptr<SolverFactory>
+    pFactoryGECODE( SolverFactory::createF_GECODE() );
+#endif
+#ifdef HAS_MIP
+  static unique_ptr<SolverFactory>
+    pFactoryMIP( SolverFactory::createF_MIP() );
+#endif
+
+  MznSolver slv;
+  try {
+    slv.addFlattener();
+    if (!slv.processOptions(argc, argv, cerr)) {
+      slv.printHelp(cerr);
+      exit(EXIT_FAILURE);
+    }
+    Timer tFlatten;
+    slv.flatten();
+    double msFlatten = tFlatten.ms();
+    if (SolverInstance::UNKNOWN != slv.getFlt()->status) {
+      cerr << "Model is unsatisfiable or flattening failed" << endl;
+      exit(EXIT_FAILURE);
+    }
+
+    GCLock lock;
+    slv.addSolverInterface();
+    Timer tSolve;
+    slv.solve();
+    double msSolve = tSolve.ms();
+
+    int n = slv.s2out.getNSolns();
+    cerr << n << " solutions:" << endl
+         << "  flattening:  " << msFlatten << " ms" << endl
+         << "  solving:     " << msSolve << " ms" << endl
+         << "  solutions/s: " << (msSolve > 0 ? n*1000.0/msSolve : 0) << endl;
+  } catch (const LocationException& e) {
+    cerr << e.loc() << ":" << endl;
+    cerr << e.what() << ": " << e.msg() << endl;
+    exit(EXIT_FAILURE);
+  } catch (const Exception& e) {
+    cerr << e.what() << ": " << e.msg() << endl;
+    exit(EXIT_FAILURE);
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    exit(EXIT_FAILURE);
+  }
+  return 0;
+}
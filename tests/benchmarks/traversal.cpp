@@ -0,0 +1,100 @@
+/* -*- mode: C++; c-basic-offset: 2; indent-tabs-mode: nil -*- */
+
+/*
+ *  Main authors:
+ *     agent <agent@local>
+ */
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/* Benchmark for expression traversals. The model is flattened once, and then
+ * the variable occurrences of the flat model are collected repeatedly, as
+ * done by the optimiser (CollectOccurrencesI run by iterItems, one top-down
+ * traversal per item).
+ *
+ * Usage: mzn-bench-traversal [--traversal-runs <n>] <minizinc options>
+ *          <model>.mzn [<data>.dzn ...]
+ *
+ * The time is printed to the standard error.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <minizinc/solver.hh>
+#include <minizinc/optimize.hh>
+#include <minizinc/timer.hh>
+
+using namespace std;
+using namespace MiniZinc;
+
+namespace {
+
+  /// Total number of occurrences recorded in \a vo
+  unsigned long long occurrences(VarOccurrences& vo) {
+    unsigned long long n = 0;
+    for (IdMap<VarOccurrences::Items>::iterator it = vo._m.begin(); it != vo._m.end(); ++it)
+      n += it->second.size();
+    return n;
+  }
+
+}
+
+int main(int argc, const char** argv) {
+
+  unsigned int runs = 10;
+  std::vector<const char*> args;
+  args.push_back(argv[0]);
+  for (int i=1; i<argc; i++) {
+    if (i+1 < argc && strcmp(argv[i], "--traversal-runs")==0) {
+      runs = atoi(argv[++i]);
+    } else {
+      args.push_back(argv[i]);
+    }
+  }
+
+  MznSolver slv;
+  try {
+    slv.addFlattener();
+    if (!slv.processOptions(args.size(), args.data(), cerr)) {
+      slv.printHelp(cerr);
+      exit(EXIT_FAILURE);
+    }
+    slv.flatten();
+    if (SolverInstance::UNKNOWN != slv.getFlt()->status) {
+      cerr << "Model is unsatisfiable or flattening failed" << endl;
+      exit(EXIT_FAILURE);
+    }
+
+    GCLock lock;
+    Model* flat = slv.getFlt()->getEnv()->flat();
+
+    unsigned long long nItems = 0;
+    Timer tItems;
+    for (unsigned int i=0; i<runs; i++) {
+      VarOccurrences vo;
+      CollectOccurrencesI co(vo);
+      iterItems(co, flat);
+      nItems = occurrences(vo);
+    }
+    double msItems = tItems.ms();
+
+    cerr << flat->size() << " items, " << nItems << " occurrences, "
+         << runs << " runs: " << msItems << " ms" << endl;
+  } catch (const LocationException& e) {
+    cerr << e.loc() << ":" << endl;
+    cerr << e.what() << ": " << e.msg() << endl;
+    exit(EXIT_FAILURE);
+  } catch (const Exception& e) {
+    cerr << e.what() << ": " << e.msg() << endl;
+    exit(EXIT_FAILURE);
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    exit(EXIT_FAILURE);
+  }
+  return 0;
+}
@@ -0,0 +1,175 @@
+/* -*- mode: C++; c-basic-offset: 2; indent-tabs-mode: nil -*- */
+
+/*
+ *  Main authors:
+ *     agent <agent@local>
+ */
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/* Tests of the item indices and variable occurrences of the flat model after
+ * it has been compacted: when removed constraints reach the threshold, after
+ * optimisation with a full compaction, and after conversion to old FlatZinc
+ * (which also reorders the items). Every index must point at the declaration
+ * of its variable, and the occurrence lists must keep exactly the items that
+ * are still in the model. The program returns the number of failed tests.
+ *
+ * Usage: mzn-test-compaction <stdlib dir>
+ */
+
+#include <minizinc/flatten.hh>
+#include <minizinc/flatten_internal.hh>
+#include <minizinc/optimize.hh>
+#include <minizinc/parser.hh>
+#include <minizinc/typecheck.hh>
+#include <minizinc/builtins.hh>
+
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace MiniZinc;
+
+namespace {
+
+  /// Unified variables, and reified constraints and clauses that are
+  /// simplified by optimisation
+  const char* model =
+    "array[1..20] of var 0..10: x;\n"
+    "array[1..20] of var bool: b;\n"
+    "constraint forall(i in 1..19)(x[i] = x[i+1]);\n"
+    "constraint forall(i in 1..20)(b[i] -> x[i] > i div 4);\n"
+    "constraint b[1] /\\ b[5];\n"
+    "constraint forall(i,j in 1..20 where i<j)(b[i] \\/ b[j] \\/ x[i] < j);\n"
+    "solve maximize sum(b);\n";
+
+  int nFailed = 0;
+
+  void check(const std::string& name, bool ok) {
+    if (!ok) {
+      std::cerr << "FAILED " << name << std::endl;
+      nFailed++;
+    }
+  }
+
+  typedef std::map<VarDecl*,std::set<Item*> > Occurrences;
+
+  /// Return the items in the occurrence lists that have not been removed
+  Occurrences live(EnvI& env) {
+    Occurrences occ;
+    for (IdMap<VarOccurrences::Items>::iterator it = env.vo._m.begin(); it != env.vo._m.end(); ++it) {
+      std::set<Item*>& items = occ[it->first->decl()];
+      for (VarOccurrences::Items::iterator iit = it->second.begin(); iit != it->second.end(); ++iit) {
+        if (!(*iit)->removed())
+          items.insert(*iit);
+      }
+    }
+    return occ;
+  }
+
+  /// Check the indices and occurrence lists of the flat model of \a env
+  void checkIndices(const std::string& name, EnvI& env) {
+    Model& m = *env.flat();
+    std::set<Item*> items;
+    unsigned int nDecls = 0;
+    for (unsigned int i=0; i<m.size(); i++) {
+      items.insert(m[i]);
+      if (VarDeclI* vdi = m[i]->dyn_cast<VarDeclI>()) {
+        if (!vdi->removed()) {
+          nDecls++;
+          check(name+": declaration "+vdi->e()->id()->str().str()+" is indexed",
+                env.vo.find(vdi->e())==static_cast<int>(i));
+        }
+      } else if (ConstraintI* ci = m[i]->dyn_cast<ConstraintI>()) {
+        check(name+": no removed constraints are left", !ci->removed());
+      }
+    }
+    unsigned int nIndexed = 0;
+    for (IdMap<int>::iterator it = env.vo.idx.begin(); it != env.vo.idx.end(); ++it) {
+      bool ok = it->second >= 0 && it->second < static_cast<int>(m.size()) &&
+                m[it->second]->isa<VarDeclI>() &&
+                m[it->second]->cast<VarDeclI>()->e()->id()==it->first;
+      check(name+": index of "+it->first->str().str()+" points at its declaration", ok);
+      if (ok && !m[it->second]->removed())
+        nIndexed++;
+    }
+    check(name+": only declarations in the model are indexed", nIndexed==nDecls);
+    for (IdMap<VarOccurrences::Items>::iterator it = env.vo._m.begin(); it != env.vo._m.end(); ++it) {
+      for (VarOccurrences::Items::iterator iit = it->second.begin(); iit != it->second.end(); ++iit) {
+        check(name+": occurrences of "+it->first->str().str()+" are in the model",
+              items.find(*iit) != items.end());
+      }
+    }
+  }
+
+}
+
+int main(int argc, const char** argv) {
+  if (argc != 2) {
+    std::cerr << "Usage: " << argv[0] << " <stdlib dir>" << std::endl;
+    return 1;
+  }
+  std::vector<std::string> includePaths;
+  includePaths.push_back(std::string(argv[1])+"/std/");
+
+  Env env;
+  {
+    GCLock lock;
+    std::vector<SyntaxError> syntaxErrors;
+    Model* m = parseFromString(model, "compaction.mzn", includePaths, false, false, false,
+                               std::cerr, syntaxErrors);
+    if (m==NULL)
+      return 1;
+    env.model(m);
+    std::vector<TypeError> typeErrors;
+    typecheck(env, m, typeErrors, false);
+    if (!typeErrors.empty()) {
+      std::cerr << typeErrors[0].what() << ": " << typeErrors[0].msg() << std::endl;
+      return 1;
+    }
+    registerBuiltins(env, m);
+  }
+  flatten(env);
+  EnvI& envi = env.envi();
+  Model& flat = *envi.flat();
+  GCLock lock;
+
+  // Remove constraints up to just below the threshold, then reach it
+  std::vector<int> constraints;
+  for (unsigned int i=0; i<flat.size(); i++) {
+    if (!flat[i]->removed() && flat[i]->isa<ConstraintI>())
+      constraints.push_back(i);
+  }
+  unsigned int threshold = flat.size()/4;
+  check("the model has enough constraints", constraints.size() > threshold && threshold > 1);
+  if (nFailed > 0)
+    return nFailed;
+  for (unsigned int i=0; i<threshold-1; i++)
+    envi.flat_removeItem(constraints[i]);
+  unsigned int size = flat.size();
+  envi.flat_compact();
+  check("compaction waits for the threshold", flat.size()==size);
+  envi.flat_removeItem(constraints[threshold-1]);
+  Occurrences before = live(envi);
+  envi.flat_compact();
+  check("compaction removes the constraints", flat.size()==size-threshold);
+  checkIndices("threshold", envi);
+  check("threshold: occurrences are kept", live(envi)==before);
+
+  optimize(env);
+  before = live(envi);
+  envi.flat_compact(true);
+  for (unsigned int i=0; i<flat.size(); i++)
+    check("all removed items are compacted", !flat[i]->removed());
+  checkIndices("optimize", envi);
+  check("optimize: occurrences are kept", live(envi)==before);
+
+  oldflatzinc(env);
+  checkIndices("oldflatzinc", envi);
+
+  return nFailed;
+}
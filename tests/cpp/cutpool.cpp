@@ -0,0 +1,137 @@
+/* -*- mode: C++; c-basic-offset: 2; indent-tabs-mode: nil -*- */
+
+/*
+ *  Main authors:
+ *     agent <agent@local>
+ */
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/* Tests of the selection of MIP cuts (CutPool). Each test fills a pool with
+ * candidate cuts, selects them for a fixed LP solution and compares the
+ * printed selection and counters with the expected ones. The program returns
+ * the number of failed tests.
+ */
+
+#include <minizinc/solvers/MIP/MIP_cutpool.hh>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace MiniZinc;
+
+namespace {
+
+  /// LP solution used by all tests
+  const double x[] = { 0.5, 0.5, 1.0, 0.0 };
+  const int nCols = 4;
+
+  int nFailed = 0;
+
+  /// Cut sum c[k]*x[ind[k]] <= rhs
+  MIP_wrapper::CutDef cut(std::initializer_list<std::pair<int,double> > terms, double rhs) {
+    MIP_wrapper::CutDef c( MIP_wrapper::LQ, MIP_wrapper::MaskConsType_Usercut );
+    for (const auto& t : terms)
+      c.addVar( t.first, t.second );
+    c.rhs = rhs;
+    return c;
+  }
+
+  std::string show(const MIP_wrapper::CutInput& cuts) {
+    std::ostringstream oss;
+    for (const auto& c : cuts) {
+      oss << "[";
+      for (size_t k=0; k<c.rmatind.size(); ++k)
+        oss << (k ? " " : "") << c.rmatval[k] << "*x" << c.rmatind[k];
+      oss << " <= " << c.rhs << "]";
+    }
+    return oss.str();
+  }
+
+  void check(const char* name, const std::string& actual, const std::string& expected) {
+    if (actual != expected) {
+      std::cerr << name << ": expected " << expected << ", got " << actual << std::endl;
+      nFailed++;
+    }
+  }
+
+  void check(const char* name, long long actual, long long expected) {
+    std::ostringstream a, e;
+    a << actual;
+    e << expected;
+    check(name, a.str(), e.str());
+  }
+
+  void testFilter(void) {
+    CutPool pool;
+    pool.cands.push_back( cut({{0,1},{1,1}}, 0.5) );    // violation 0.5
+    pool.cands.push_back( cut({{2,1}}, 1.0) );          // satisfied
+    pool.cands.push_back( cut({{2,1}}, 0.995) );        // below the minimal violation
+    MIP_wrapper::CutInput out;
+    CutPool::Statistics st;
+    pool.select( x, nCols, CutPool::Options(), out, st );
+    check("filter", show(out), "[1*x0 1*x1 <= 0.5]");
+    check("filter candidates", st.nCandidates, 3);
+    check("filter added", st.nAdded, 1);
+  }
+
+  void testDuplicates(void) {
+    CutPool pool;
+    pool.cands.push_back( cut({{1,1},{0,2}}, 1.0) );
+    pool.cands.push_back( cut({{0,2},{1,1}}, 1.0) );           // same after sorting
+    pool.cands.push_back( cut({{0,1},{1,1},{0,1}}, 1.0) );     // same after merging x0
+    pool.cands.push_back( cut({{0,2},{1,1}}, 0.9) );           // other right-hand side
+    MIP_wrapper::CutInput out;
+    CutPool::Statistics st;
+    pool.select( x, nCols, CutPool::Options(), out, st );
+    check("duplicates", show(out), "[2*x0 1*x1 <= 0.9][2*x0 1*x1 <= 1]");
+    check("duplicates dropped", st.nDuplicates, 2);
+  }
+
+  void testOrder(void) {
+    CutPool pool;
+    pool.cands.push_back( cut({{0,1}}, 0.3) );    // violation 0.2
+    pool.cands.push_back( cut({{2,1}}, 0.5) );    // violation 0.5
+    pool.cands.push_back( cut({{1,1}}, 0.3) );    // violation 0.2
+    pool.cands.push_back( cut({{2,2}}, 1.0) );    // violation 1
+    MIP_wrapper::CutInput out;
+    CutPool::Statistics st;
+    pool.select( x, nCols, CutPool::Options(), out, st );
+    check("order", show(out),
+          "[2*x2 <= 1][1*x2 <= 0.5][1*x0 <= 0.3][1*x1 <= 0.3]");
+
+    CutPool pool2;
+    pool2.cands = { cut({{0,1}}, 0.3), cut({{2,1}}, 0.5),
+                    cut({{1,1}}, 0.3), cut({{2,2}}, 1.0) };
+    CutPool::Options opts;
+    opts.nMaxCuts = 3;
+    MIP_wrapper::CutInput out2;
+    pool2.select( x, nCols, opts, out2, st );
+    check("maximal number of cuts", show(out2), "[2*x2 <= 1][1*x2 <= 0.5][1*x0 <= 0.3]");
+    check("rounds", st.nRounds, 2);
+    check("added over rounds", st.nAdded, 7);
+  }
+
+  void testEmpty(void) {
+    CutPool pool;
+    MIP_wrapper::CutInput out;
+    CutPool::Statistics st;
+    pool.select( x, nCols, CutPool::Options(), out, st );
+    check("empty pool", show(out), "");
+    check("empty pool rounds", st.nRounds, 1);
+  }
+
+}
+
+int main(int argc, char** argv) {
+  testFilter();
+  testDuplicates();
+  testOrder();
+  testEmpty();
+  if (nFailed==0)
+    std::cout << "all cut pool tests passed" << std::endl;
+  return nFailed;
+}
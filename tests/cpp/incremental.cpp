@@ -0,0 +1,135 @@
+/* -*- mode: C++; c-basic-offset: 2; indent-tabs-mode: nil -*- */
+
+/*
+ *  Main authors:
+ *     agent <agent@local>
+ */
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/* Tests of reusing flattened constraints across Flattener objects, the way
+ * an embedding application keeps an IncrementalFlattening between
+ * compilations of the same model with changing data. The model is flattened
+ * with the base data, then with the actual data (twice), each time by a new
+ * Flattener sharing the records, and the FlatZinc is compared with that of a
+ * Flattener without records, up to the numbering of introduced variables
+ * (reused items get fresh names). The program returns the number of failed
+ * tests.
+ *
+ * Usage: mzn-test-incremental <stdlib dir> <model> <base data> <data>
+ */
+
+#include <minizinc/flattener.hh>
+
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace MiniZinc;
+
+namespace {
+
+  int nFailed = 0;
+
+  void check(const char* name, bool ok) {
+    if (!ok) {
+      std::cerr << "FAILED " << name << std::endl;
+      nFailed++;
+    }
+  }
+
+  /// Flatten \a model with \a data into \a fzn, sharing the records in \a inc (unless NULL)
+  void flatten(IncrementalFlattening* inc, const std::string& stdlib,
+               const std::string& model, const std::string& data, const std::string& fzn) {
+    std::vector<std::string> args;
+    args.push_back("--stdlib-dir");
+    args.push_back(stdlib);
+    args.push_back("--no-output-ozn");
+    args.push_back("--output-fzn-to-file");
+    args.push_back(fzn);
+    args.push_back(model);
+    args.push_back(data);
+    std::vector<const char*> argv;
+    argv.push_back("mzn-test-incremental");
+    for (unsigned int i=0; i<args.size(); i++)
+      argv.push_back(args[i].c_str());
+    Flattener flt(false);
+    flt.setIncrementalFlattening(inc);
+    for (int i=1; i<static_cast<int>(argv.size()); i++) {
+      if (!flt.processOption(i, static_cast<int>(argv.size()), argv.data())) {
+        std::cerr << "cannot process option " << argv[i] << std::endl;
+        nFailed++;
+        return;
+      }
+    }
+    flt.flatten();
+  }
+
+  /// Return contents of FlatZinc \a file, with introduced variables numbered in order of appearance
+  std::string contents(const std::string& file) {
+    std::ifstream is(file.c_str(), std::ios::in | std::ios::binary);
+    std::ostringstream oss;
+    oss << is.rdbuf();
+    std::string fzn = oss.str();
+    const std::string prefix = "X_INTRODUCED_";
+    std::map<std::string,int> number;
+    std::string result;
+    size_t pos = 0;
+    for (size_t found; (found = fzn.find(prefix, pos)) != std::string::npos;) {
+      size_t end = found+prefix.size();
+      while (end < fzn.size() && isdigit(static_cast<unsigned char>(fzn[end])))
+        end++;
+      std::string name = fzn.substr(found, end-found);
+      if (number.find(name)==number.end()) {
+        int n = static_cast<int>(number.size());
+        number[name] = n;
+      }
+      std::ostringstream id;
+      id << prefix << number[name];
+      result += fzn.substr(pos, found-pos) + id.str();
+      pos = end;
+    }
+    return result + fzn.substr(pos);
+  }
+
+}
+
+int main(int argc, const char** argv) {
+  if (argc != 5) {
+    std::cerr << "Usage: " << argv[0] << " <stdlib dir> <model> <base data> <data>" << std::endl;
+    return 1;
+  }
+  std::string stdlib = argv[1];
+  std::string model = argv[2];
+  std::string base = argv[3];
+  std::string data = argv[4];
+
+  IncrementalFlattening inc;
+  flatten(&inc, stdlib, model, base, "incremental_base.fzn");
+  unsigned int items = inc.items();
+  check("records are made", items > 0);
+  check("nothing is reused in the first run", inc.reused()==0);
+
+  flatten(&inc, stdlib, model, data, "incremental_1.fzn");
+  unsigned int reused = inc.reused();
+  check("records are reused by the next Flattener", reused > 0);
+  check("items whose data changed are flattened again", reused < inc.items());
+
+  flatten(&inc, stdlib, model, data, "incremental_2.fzn");
+  check("records of the previous run are reused", inc.reused() >= reused);
+
+  flatten(NULL, stdlib, model, data, "incremental_none.fzn");
+  std::string expected = contents("incremental_none.fzn");
+  check("FlatZinc is written", !expected.empty());
+  check("FlatZinc with reused items is unchanged", contents("incremental_1.fzn")==expected);
+  check("FlatZinc after two runs is unchanged", contents("incremental_2.fzn")==expected);
+
+  std::cout << "reused " << reused << " of " << inc.items() << " constraints" << std::endl;
+  return nFailed;
+}
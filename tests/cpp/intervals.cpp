@@ -0,0 +1,131 @@
+/* -*- mode: C++; c-basic-offset: 2; indent-tabs-mode: nil -*- */
+
+/*
+ *  Main authors:
+ *     agent <agent@local>
+ */
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/* Tests of the interval sets used by MIPdomains (SetOfIntervals). Each test
+ * applies an operation to a set and compares the printed result with the
+ * expected intervals. The program returns the number of failed tests.
+ */
+
+#include <minizinc/MIPdomains.hh>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace MiniZinc;
+
+namespace {
+
+  const double inf = IntvReal::infPlus();
+
+  int nFailed = 0;
+
+  std::string show(const SetOfIntvReal& s) {
+    std::ostringstream oss;
+    for (SetOfIntvReal::const_iterator it = s.begin(); it != s.end(); ++it)
+      oss << "[" << it->left << "," << it->right << "]";
+    return oss.str();
+  }
+
+  void check(const char* name, const SetOfIntvReal& s, const std::string& expected) {
+    std::string actual = show(s);
+    if (actual != expected) {
+      std::cerr << name << ": expected " << expected << ", got " << actual << std::endl;
+      nFailed++;
+    }
+  }
+
+  void testCutOut(void) {
+    SetOfIntvReal s1 { IntvReal(0,10) };
+    s1.cutOut(IntvReal(3,5));
+    check("cut out of one interval", s1, "[0,3][5,10]");
+
+    SetOfIntvReal s2 { IntvReal(0,2), IntvReal(4,6), IntvReal(8,10) };
+    s2.cutOut(IntvReal(1,9));
+    check("cut across several intervals", s2, "[0,1][9,10]");
+
+    SetOfIntvReal s3 { IntvReal(0,3), IntvReal(4,10) };
+    s3.cutOut(IntvReal(3,4));
+    check("cut out of a gap", s3, "[0,3][4,10]");
+
+    SetOfIntvReal s4 { IntvReal(0,3), IntvReal(4,10) };
+    s4.cutOut(IntvReal(12,15));
+    check("cut beyond the last interval", s4, "[0,3][4,10]");
+
+    SetOfIntvReal s5 { IntvReal(0,10) };
+    s5.cutOut(IntvReal(-1,11));
+    check("cut of everything", s5, "");
+
+    SetOfIntvReal s6 { IntvReal(0,3), IntvReal(4,10) };
+    s6.cutOut(IntvReal(-inf,5));
+    check("cut from minus infinity", s6, "[5,10]");
+
+    SetOfIntvReal s7 { IntvReal(0,3), IntvReal(4,10) };
+    s7.cutOut(IntvReal(5,inf));
+    check("cut to plus infinity", s7, "[0,3][4,5]");
+
+    SetOfIntvReal s8 { IntvReal(0,3), IntvReal(6,10) };
+    s8.cutOut(IntvReal(-1,3));
+    check("cut ending at a right bound", s8, "[3,3][6,10]");
+
+    SetOfIntvReal s9;
+    s9.cutOut(IntvReal(0,1));
+    check("cut of an empty set", s9, "");
+  }
+
+  void testSplit(void) {
+    SetOfIntvReal s { IntvReal(0,2), IntvReal(4,10), IntvReal(12,14) };
+    SetOfIntvReal::iterator it = s.begin()+1;
+    SetOfIntvReal::SplitResult r = s.split(it, 7);
+    check("split", s, "[0,2][4,7][7,10][12,14]");
+    if (r.first != s.begin()+1 || r.second != s.begin()+2 || it != s.end()) {
+      std::cerr << "split: wrong iterators" << std::endl;
+      nFailed++;
+    }
+  }
+
+  void testIntersect(void) {
+    SetOfIntvReal s { IntvReal(0,10) };
+    s.intersect(SetOfIntvReal { IntvReal(2,3), IntvReal(5,7) });
+    check("intersect", s, "[2,3][5,7]");
+
+    SetOfIntvReal s2 { IntvReal(0,10) };
+    s2.intersect(SetOfIntvReal());
+    check("intersect with the empty set", s2, "");
+  }
+
+  void testCutDeltas(void) {
+    SetOfIntvReal s { IntvReal(0,10) };
+    s.cutDeltas(SetOfIntvReal { IntvReal(3,5) }, 1.0);
+    check("cut deltas", s, "[0,2][3,5][6,10]");
+  }
+
+  void testInsert(void) {
+    SetOfIntvReal s;
+    s.insert(IntvReal(5,6));
+    s.insert(IntvReal(0,1));
+    s.insert(IntvReal(8,9));
+    s.insert(IntvReal(2,3));
+    check("insert", s, "[0,1][2,3][5,6][8,9]");
+  }
+
+}
+
+int main(int argc, char** argv) {
+  testCutOut();
+  testSplit();
+  testIntersect();
+  testCutDeltas();
+  testInsert();
+  if (nFailed==0)
+    std::cout << "all interval tests passed" << std::endl;
+  return nFailed;
+}
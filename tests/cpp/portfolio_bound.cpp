@@ -0,0 +1,103 @@
+/* -*- mode: C++; c-basic-offset: 2; indent-tabs-mode: nil -*- */
+
+/*
+ *  Main authors:
+ *     agent <agent@local>
+ */
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/* Tests of the objective bound shared by the solvers of a portfolio
+ * (SharedObjectiveBound). Like MznSolver::solvePortfolio, the bound is
+ * placed in anonymous shared memory and improved concurrently by several
+ * forked processes. The program returns the number of failed tests.
+ */
+
+#include <minizinc/solver_instance_base.hh>
+
+#include <iostream>
+#include <new>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace MiniZinc;
+
+namespace {
+
+  int nFailed = 0;
+
+  void check(const char* name, bool ok) {
+    if (!ok) {
+      std::cerr << name << " failed" << std::endl;
+      nFailed++;
+    }
+  }
+
+  void testSequential(void) {
+    SharedObjectiveBound min(true);
+    double v;
+    check("no initial bound", !min.get(v));
+    check("first value improves", min.improve(10));
+    check("smaller value improves", min.improve(7));
+    check("larger value does not improve", !min.improve(8));
+    check("equal value does not improve", !min.improve(7));
+    check("minimization bound", min.get(v) && v==7);
+
+    SharedObjectiveBound max(false);
+    max.improve(3);
+    max.improve(5);
+    check("smaller value does not improve maximization", !max.improve(4));
+    check("maximization bound", max.get(v) && v==5);
+  }
+
+#ifndef _WIN32
+  /// Each of \a nProcs processes publishes the values \a nValues down to 1
+  /// (shifted by the process number), so the best bound is 1
+  void testProcesses(bool minimize) {
+    const int nProcs = 4;
+    const int nValues = 100000;
+    void* mem = mmap(NULL, sizeof(SharedObjectiveBound), PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+      check("shared memory", false);
+      return;
+    }
+    SharedObjectiveBound* bound = new (mem) SharedObjectiveBound(minimize);
+    int sign = minimize ? 1 : -1;
+    for (int p=0; p<nProcs; p++) {
+      pid_t pid = fork();
+      if (pid==0) {
+        for (int i=nValues; i>=1; i--)
+          bound->improve(sign*(i+(p*i)%nProcs));
+        _exit(0);
+      }
+    }
+    int status;
+    while (wait(&status) > 0) {
+      check("child exit", WIFEXITED(status) && WEXITSTATUS(status)==0);
+    }
+    double v;
+    check(minimize ? "concurrent minimization" : "concurrent maximization",
+          bound->get(v) && v==sign*1);
+    munmap(mem, sizeof(SharedObjectiveBound));
+  }
+#endif
+
+}
+
+int main(int argc, char** argv) {
+  testSequential();
+#ifndef _WIN32
+  testProcesses(true);
+  testProcesses(false);
+#endif
+  if (nFailed==0)
+    std::cout << "all portfolio bound tests passed" << std::endl;
+  return nFailed;
+}